@@ -112,40 +112,74 @@ int DoIt( int argc, char * argv[] )
   atlasBuilder->AdjustResampledImageSize( doImageSizeAdjustment );
   atlasBuilder->AdjustResampledImageOrigin( doImageOriginAdjustment );
 
-  ImageDocumentListType::const_iterator it_imgDoc = imageObjects.begin();
-  tube::FmtInfoMessage( "Starting image addition..." );
+  atlasBuilder->SetNumberOfOutlierImagesToRemove( outlierImagesToRemove );
+  atlasBuilder->SetMaximumSlabMemoryInMegabytes( maximumSlabMemory );
+  if( useMedian )
+    {
+    atlasBuilder->UseMedian( imageObjects.size() );
+    }
 
-  /* Iteratively add the images to atlas summation method. This is done so that
-     only one image must be held in memory at a time. */
+  ImageDocumentListType::const_iterator it_imgDoc = imageObjects.begin();
   DocumentToImageFilter::Pointer filter = DocumentToImageFilter::New();
 
-  while( it_imgDoc != imageObjects.end() )
+  if( !doImageSizeAdjustment && !doImageOriginAdjustment )
     {
-    ImageDocumentType::Pointer doc
-      = static_cast< ImageDocumentType * >( ( *it_imgDoc ).GetPointer() );
-    tube::FmtInfoMessage( "Adding image: %s", doc->GetObjectName().c_str() );
-
-    filter->SetInput( doc );
-    filter->SetApplyTransforms( false );
-    filter->Update();
-    filter->GetComposedTransform();
+    /* Queue the images with their transforms and build the atlas slab by
+       slab. The images are read again for every slab, so that the memory
+       does not grow with the number of images. */
+    tube::FmtInfoMessage( "Starting slab by slab atlas building..." );
 
-    if( filter->GetComposedTransformIsIdentity() )
+    while( it_imgDoc != imageObjects.end() )
       {
-      tube::DebugMessage( "ComposedTransform is IDENTITY" );
-      atlasBuilder->AddImage( filter->GetOutput() );
+      ImageDocumentType::Pointer doc
+        = static_cast< ImageDocumentType * >( ( *it_imgDoc ).GetPointer() );
+      tube::FmtInfoMessage( "Adding image: %s",
+        doc->GetObjectName().c_str() );
+
+      filter->SetInput( doc );
+      atlasBuilder->AddSubject( doc->GetObjectName(),
+        filter->GetComposedTransform().GetPointer() );
+      ++it_imgDoc;
       }
-    else
+
+    atlasBuilder->BuildAtlasBySlabs();
+    tube::InfoMessage( "Done!" );
+    }
+  else
+    {
+    tube::FmtInfoMessage( "Starting image addition..." );
+
+    /* Iteratively add the images to atlas summation method. This is done
+       so that only one image must be held in memory at a time. */
+    while( it_imgDoc != imageObjects.end() )
       {
-      atlasBuilder->AddImage( filter->GetOutput(),
-                              filter->GetComposedTransform().GetPointer() );
+      ImageDocumentType::Pointer doc
+        = static_cast< ImageDocumentType * >( ( *it_imgDoc ).GetPointer() );
+      tube::FmtInfoMessage( "Adding image: %s",
+        doc->GetObjectName().c_str() );
+
+      filter->SetInput( doc );
+      filter->SetApplyTransforms( false );
+      filter->Update();
+      filter->GetComposedTransform();
+
+      if( filter->GetComposedTransformIsIdentity() )
+        {
+        tube::DebugMessage( "ComposedTransform is IDENTITY" );
+        atlasBuilder->AddImage( filter->GetOutput() );
+        }
+      else
+        {
+        atlasBuilder->AddImage( filter->GetOutput(),
+                                filter->GetComposedTransform().GetPointer() );
+        }
+      ++it_imgDoc;
       }
-    ++it_imgDoc;
-    }
 
-  tube::InfoMessage( "Finalizing the images..." );
-  atlasBuilder->Finalize();
-  tube::InfoMessage( "Done!" );
+    tube::InfoMessage( "Finalizing the images..." );
+    atlasBuilder->Finalize();
+    tube::InfoMessage( "Done!" );
+    }
 
   // Save output images.
   WriteImage( atlasBuilder->GetMeanImage(), outputMeanAtlas.c_str() );
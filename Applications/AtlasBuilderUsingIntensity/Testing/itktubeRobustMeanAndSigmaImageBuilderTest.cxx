@@ -0,0 +1,258 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright 2010 Kitware Inc. 28 Corporate Drive,
+Clifton Park, NY, 12065, USA.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "itktubeRobustMeanAndSigmaImageBuilder.h"
+#include "tubeMacro.h"
+
+#include <itkImageRegionIteratorWithIndex.h>
+#include <itkMersenneTwisterRandomVariateGenerator.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+
+typedef itk::Image< float, 3 >                          ImageType;
+typedef itk::tube::RobustMeanAndSigmaImageBuilder< ImageType, ImageType,
+  ImageType >                                           BuilderType;
+
+typedef itk::Statistics::MersenneTwisterRandomVariateGenerator
+                                                        RandGenType;
+
+// Small integer values, so that ties occur and sums are exact
+ImageType::Pointer CreateImage( const ImageType::SizeType & size,
+  RandGenType * rndGen )
+{
+  ImageType::RegionType region;
+  region.SetSize( size );
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions( region );
+  image->Allocate();
+
+  itk::ImageRegionIterator< ImageType > it( image, region );
+  while( !it.IsAtEnd() )
+    {
+    it.Set( std::floor( rndGen->GetUniformVariate( 0, 8 ) ) );
+    ++it;
+    }
+
+  return image;
+}
+
+// Sorted values of the images at index, skipping the images that do not
+// contain it
+std::vector< float > GetSortedValues(
+  const std::vector< ImageType::Pointer > & images,
+  const ImageType::IndexType & index )
+{
+  std::vector< float > values;
+  for( unsigned int i = 0; i < images.size(); i++ )
+    {
+    if( images[i]->GetLargestPossibleRegion().IsInside( index ) )
+      {
+      values.push_back( images[i]->GetPixel( index ) );
+      }
+    }
+  std::sort( values.begin(), values.end() );
+
+  return values;
+}
+
+} // End namespace
+
+int itktubeRobustMeanAndSigmaImageBuilderTest( int argc, char * argv[] )
+{
+  if( argc > 1 )
+    {
+    tubeStandardErrorMacro( << "Usage: " << argv[0] );
+
+    return EXIT_FAILURE;
+    }
+
+  RandGenType::Pointer rndGen = RandGenType::New();
+  rndGen->Initialize( 1234 );
+
+  ImageType::SizeType size;
+  size[0] = 5;
+  size[1] = 4;
+  size[2] = 6;
+
+  std::vector< ImageType::Pointer > images;
+  for( unsigned int i = 0; i < 7; i++ )
+    {
+    images.push_back( CreateImage( size, rndGen ) );
+    }
+
+  int failures = 0;
+
+  // Odd median and the variance without the two lowest and two highest
+  // values, merged by slabs in three threads
+  BuilderType::Pointer builder = BuilderType::New();
+  builder->SetNumberOfThreads( 3 );
+  builder->SetNumberOfOutlierImagesToRemove( 2 );
+  builder->UseMedianImage( images.size() );
+  builder->SetUseStandardDeviation( false );
+  for( unsigned int i = 0; i < images.size(); i++ )
+    {
+    builder->AddImage( images[i] );
+    }
+  builder->FinalizeOutput();
+
+  itk::ImageRegionIteratorWithIndex< ImageType > it(
+    builder->GetOutputMeanImage(),
+    builder->GetOutputMeanImage()->GetLargestPossibleRegion() );
+  while( !it.IsAtEnd() )
+    {
+    const ImageType::IndexType index = it.GetIndex();
+    std::vector< float > values = GetSortedValues( images, index );
+
+    double sum = 0;
+    double sumSqr = 0;
+    for( unsigned int i = 2; i < values.size() - 2; i++ )
+      {
+      sum += values[i];
+      sumSqr += values[i] * values[i];
+      }
+    const double variance = ( sumSqr - sum * sum / 3 ) / 2;
+
+    if( it.Get() != values[3] )
+      {
+      tubeErrorMacro( << "Median at " << index << " is " << it.Get()
+        << " instead of " << values[3] );
+      ++failures;
+      }
+    if( std::fabs( builder->GetOutputSigmaImage()->GetPixel( index )
+      - variance ) > 1e-4 )
+      {
+      tubeErrorMacro( << "Variance at " << index << " is "
+        << builder->GetOutputSigmaImage()->GetPixel( index )
+        << " instead of " << variance );
+      ++failures;
+      }
+    if( builder->GetValidCountImage()->GetPixel( index ) != 3 )
+      {
+      tubeErrorMacro( << "Count at " << index << " is "
+        << builder->GetValidCountImage()->GetPixel( index )
+        << " instead of 3" );
+      ++failures;
+      }
+    ++it;
+    }
+
+  // Even median, one thread
+  std::vector< ImageType::Pointer > evenImages( images.begin(),
+    images.begin() + 6 );
+  builder = BuilderType::New();
+  builder->SetNumberOfThreads( 1 );
+  builder->UseMedianImage( evenImages.size() );
+  for( unsigned int i = 0; i < evenImages.size(); i++ )
+    {
+    builder->AddImage( evenImages[i] );
+    }
+  builder->FinalizeOutput();
+
+  it = itk::ImageRegionIteratorWithIndex< ImageType >(
+    builder->GetOutputMeanImage(),
+    builder->GetOutputMeanImage()->GetLargestPossibleRegion() );
+  while( !it.IsAtEnd() )
+    {
+    std::vector< float > values = GetSortedValues( evenImages,
+      it.GetIndex() );
+    const float median = ( values[2] + values[3] ) / 2;
+    if( it.Get() != median )
+      {
+      tubeErrorMacro( << "Even median at " << it.GetIndex() << " is "
+        << it.Get() << " instead of " << median );
+      ++failures;
+      }
+    ++it;
+    }
+
+  // Trimmed mean of images added before and after the output grows: the
+  // values kept for the old voxels must move to their new positions
+  ImageType::SizeType largeSize;
+  largeSize[0] = 7;
+  largeSize[1] = 5;
+  largeSize[2] = 6;
+  std::vector< ImageType::Pointer > resizedImages( images.begin(),
+    images.begin() + 3 );
+  for( unsigned int i = 0; i < 3; i++ )
+    {
+    resizedImages.push_back( CreateImage( largeSize, rndGen ) );
+    }
+
+  builder = BuilderType::New();
+  builder->SetNumberOfThreads( 2 );
+  builder->SetNumberOfOutlierImagesToRemove( 1 );
+  for( unsigned int i = 0; i < resizedImages.size(); i++ )
+    {
+    if( i == 3 )
+      {
+      builder->UpdateOutputImageSize( largeSize );
+      }
+    builder->AddImage( resizedImages[i] );
+    }
+  builder->FinalizeOutput();
+
+  if( builder->GetOutputMeanImage()->GetLargestPossibleRegion().GetSize()
+    != largeSize )
+    {
+    tubeErrorMacro( << "Output size is "
+      << builder->GetOutputMeanImage()->GetLargestPossibleRegion().GetSize()
+      << " instead of " << largeSize );
+    ++failures;
+    }
+
+  it = itk::ImageRegionIteratorWithIndex< ImageType >(
+    builder->GetOutputMeanImage(),
+    builder->GetOutputMeanImage()->GetLargestPossibleRegion() );
+  while( !it.IsAtEnd() )
+    {
+    std::vector< float > values = GetSortedValues( resizedImages,
+      it.GetIndex() );
+    double sum = 0;
+    for( unsigned int i = 1; i < values.size() - 1; i++ )
+      {
+      sum += values[i];
+      }
+    const double mean = sum / ( values.size() - 2 );
+    if( std::fabs( it.Get() - mean ) > 1e-4 )
+      {
+      tubeErrorMacro( << "Trimmed mean at " << it.GetIndex() << " is "
+        << it.Get() << " instead of " << mean << " ("
+        << values.size() << " values)" );
+      ++failures;
+      }
+    ++it;
+    }
+
+  if( failures > 0 )
+    {
+    tubeErrorMacro( << failures << " voxels failed." );
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,209 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright 2010 Kitware Inc. 28 Corporate Drive,
+Clifton Park, NY, 12065, USA.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "tubeAtlasSummation.h"
+#include "tubeMacro.h"
+
+#include <itkImageRegionIteratorWithIndex.h>
+#include <itkMersenneTwisterRandomVariateGenerator.h>
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+typedef tube::AtlasSummation                            AtlasSummationType;
+typedef AtlasSummationType::InputImageType              ImageType;
+typedef AtlasSummationType::TransformType               TransformType;
+typedef itk::tube::RobustMeanAndSigmaImageBuilder< ImageType, ImageType,
+  ImageType >                                           BuilderType;
+
+typedef itk::Statistics::MersenneTwisterRandomVariateGenerator
+                                                        RandGenType;
+
+ImageType::Pointer CreateImage( RandGenType * rndGen )
+{
+  ImageType::SizeType size;
+  size[0] = 9;
+  size[1] = 8;
+  size[2] = 11;
+  ImageType::RegionType region;
+  region.SetSize( size );
+  ImageType::SpacingType spacing;
+  spacing.Fill( 1.5 );
+  ImageType::PointType origin;
+  origin.Fill( -3 );
+
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions( region );
+  image->SetSpacing( spacing );
+  image->SetOrigin( origin );
+  image->Allocate();
+
+  itk::ImageRegionIterator< ImageType > it( image, region );
+  while( !it.IsAtEnd() )
+    {
+    it.Set( std::floor( rndGen->GetUniformVariate( 1, 9 ) ) );
+    ++it;
+    }
+
+  return image;
+}
+
+// Subject on the grid of reference, as AtlasSummation::AddImage() does
+ImageType::Pointer ResampleImage( ImageType::Pointer image,
+  TransformType::Pointer transform, ImageType::Pointer reference )
+{
+  typedef itk::ResampleImageFilter< ImageType, ImageType > ResampleType;
+
+  TransformType::Pointer inverse = TransformType::New();
+  transform->GetInverse( inverse );
+
+  ResampleType::Pointer resample = ResampleType::New();
+  resample->SetInput( image );
+  resample->SetTransform( inverse );
+  resample->SetOutputSpacing( reference->GetSpacing() );
+  resample->SetOutputOrigin( reference->GetOrigin() );
+  resample->SetSize( reference->GetLargestPossibleRegion().GetSize() );
+  resample->SetDefaultPixelValue( AtlasSummationType::DEFAULT_PIXEL_FILL );
+  resample->Update();
+
+  return resample->GetOutput();
+}
+
+int CompareImages( ImageType * image, ImageType * expected,
+  const std::string & description )
+{
+  int failures = 0;
+  itk::ImageRegionIteratorWithIndex< ImageType > it( image,
+    expected->GetLargestPossibleRegion() );
+  while( !it.IsAtEnd() )
+    {
+    const float value = expected->GetPixel( it.GetIndex() );
+    if( std::fabs( it.Get() - value ) > 1e-4 )
+      {
+      tubeErrorMacro( << description << " at " << it.GetIndex() << " is "
+        << it.Get() << " instead of " << value );
+      ++failures;
+      }
+    ++it;
+    }
+  return failures;
+}
+
+} // End namespace
+
+int tubeAtlasSummationTest( int argc, char * argv[] )
+{
+  if( argc > 1 )
+    {
+    tubeStandardErrorMacro( << "Usage: " << argv[0] );
+
+    return EXIT_FAILURE;
+    }
+
+  RandGenType::Pointer rndGen = RandGenType::New();
+  rndGen->Initialize( 1234 );
+
+  // Subjects shifted and slightly rotated, so that some of them leave
+  // the output grid and are resampled between voxels
+  std::vector< ImageType::Pointer > images;
+  std::vector< TransformType::Pointer > transforms;
+  for( unsigned int i = 0; i < 7; i++ )
+    {
+    images.push_back( CreateImage( rndGen ) );
+
+    TransformType::Pointer transform = TransformType::New();
+    TransformType::OutputVectorType translation;
+    translation[0] = 0.7 * i;
+    translation[1] = -0.4 * i;
+    translation[2] = 1.1 * ( i % 3 );
+    transform->Translate( translation );
+    transform->Rotate( 0, 1, 0.02 * i );
+    transforms.push_back( transform );
+    }
+
+  int failures = 0;
+
+  // Mean and variance: one slice per slab and three subjects resampled at
+  // once must give the images of AddImage()
+  AtlasSummationType wholeAtlas;
+  AtlasSummationType slabAtlas;
+  slabAtlas.SetNumberOfThreads( 3 );
+  slabAtlas.SetMaximumSlabMemoryInMegabytes( 0 );
+  for( unsigned int i = 0; i < images.size(); i++ )
+    {
+    wholeAtlas.AddImage( images[i], transforms[i] );
+    slabAtlas.AddSubject( images[i], transforms[i] );
+    }
+  wholeAtlas.Finalize();
+  slabAtlas.BuildAtlasBySlabs();
+
+  failures += CompareImages( slabAtlas.GetMeanImage(),
+    wholeAtlas.GetMeanImage(), "Mean" );
+  failures += CompareImages( slabAtlas.GetVarianceImage(),
+    wholeAtlas.GetVarianceImage(), "Sigma" );
+  failures += CompareImages( slabAtlas.GetValidCountImage(),
+    wholeAtlas.GetValidCountImage(), "Count" );
+
+  // Median and trimmed variance by slabs of a few slices must give those
+  // of the whole resampled images
+  BuilderType::Pointer builder = BuilderType::New();
+  builder->SetNumberOfOutlierImagesToRemove( 1 );
+  builder->UseMedianImage( images.size() );
+  builder->AddImage( images[0] );
+  for( unsigned int i = 1; i < images.size(); i++ )
+    {
+    builder->AddImage( ResampleImage( images[i], transforms[i],
+      images[0] ) );
+    }
+  builder->FinalizeOutput();
+
+  AtlasSummationType robustAtlas;
+  robustAtlas.SetNumberOfThreads( 2 );
+  robustAtlas.SetNumberOfOutlierImagesToRemove( 1 );
+  robustAtlas.UseMedian( images.size() );
+  robustAtlas.SetMaximumSlabMemoryInMegabytes( 0.01 );
+  for( unsigned int i = 0; i < images.size(); i++ )
+    {
+    robustAtlas.AddSubject( images[i], transforms[i] );
+    }
+  robustAtlas.BuildAtlasBySlabs();
+
+  failures += CompareImages( robustAtlas.GetMeanImage(),
+    builder->GetOutputMeanImage(), "Median" );
+  failures += CompareImages( robustAtlas.GetVarianceImage(),
+    builder->GetOutputSigmaImage(), "Trimmed sigma" );
+  failures += CompareImages( robustAtlas.GetValidCountImage(),
+    builder->GetValidCountImage(), "Trimmed count" );
+
+  if( failures > 0 )
+    {
+    tubeStandardErrorMacro( << failures << " values differ" );
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
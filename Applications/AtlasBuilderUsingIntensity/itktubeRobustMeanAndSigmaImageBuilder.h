@@ -27,6 +27,11 @@ limitations under the License.
 #include "itktubeMeanAndSigmaImageBuilder.h"
 #include "tubeMessage.h"
 
+#include <itkMultiThreader.h>
+
+#include <algorithm>
+#include <vector>
+
 namespace itk
 {
 
@@ -41,6 +46,14 @@ namespace tube
  * image addition, as must be the number of outlier images to crop from the
  * ends.
  *
+ * Rather than as images, the kept values are stored per voxel, sorted, in
+ * one buffer for the lower and one for the upper values.  Each added image
+ * is merged into them in a single pass, threaded over slabs of the volume.
+ * The buffers cover the whole added image, so memory grows with the
+ * number of outliers removed and, for the median, with half the total
+ * number of images; ::tube::AtlasSummation::BuildAtlasBySlabs() bounds
+ * it by adding one slab of the images at a time.
+ *
  * All Inputed images are assumed to have the same spacing, origin.
  * Optionally, if the tag DynamicallyAdjustOutputSize() is used, then the
  * size many vary and the images will be updated to insure the largest region
@@ -83,6 +96,10 @@ public:
   typedef typename Superclass::SpacingType                  SpacingType;
   typedef typename Superclass::PointType                    PointType;
   typedef typename Superclass::SizeType                     SizeType;
+  typedef typename SizeType::SizeValueType                  SizeValueType;
+
+  itkStaticConstMacro( ImageDimension, unsigned int,
+                       Superclass::ImageDimension );
 
   /**
    * Add an image to the group being summed. No check is made to insure
@@ -123,6 +140,10 @@ public:
 
   itkGetConstMacro( TotalNumberOfImages, unsigned int );
 
+  /** Number of threads used to merge an added image into the kept values */
+  itkSetMacro( NumberOfThreads, ThreadIdType );
+  itkGetConstMacro( NumberOfThreads, ThreadIdType );
+
   /**
    * Update the output images to the inputed size. Can be called at any
    * point during the mean building process.
@@ -157,73 +178,53 @@ protected:
   typedef typename Superclass::OutputMeanIteratorType   OutputMeanIteratorType;
   typedef typename Superclass::OutputSigmaIteratorType  OutputSigmaIteratorType;
 
-  typedef typename std::vector<InputImagePointer>       InputImageListType;
-
   /**
    * Build new processing images ( i.e., sumImage, sumSquareImage,
-   * validCountImage )
+   * validCountImage ) and the buffers of kept values
    */
   void BuildProcessingImages( InputImagePointer i );
 
-  /**
-   * Get the ordered image list representing the lower half of voxel values.
-   * Used to determine median.  Order is ascending pixel value
-   */
-  InputImageListType& GetLowerOutlierImages( void )
-    { return m_LowerOutlierImages; }
-
-  /**
-   * Set the ordered image list representing the lower half of voxel values.
-   * Used to determine median.
-   */
-  void  SetLowerOutlierImages( InputImageListType& list )
-    { m_LowerOutlierImages = list; }
-
-  /**
-   * Get the ordered image list representing the upper outlier values.
-   * Size is dependent on the number of outliers to remove for robust standard
-   * deviation calculation.  Used to determine sigma calculations. Order is
-   * descending starting from highest intensity
-   */
-  InputImageListType& GetUpperOutlierImages( void )
-    { return m_UpperOutlierImages; }
-
-  /**
-   * Set the ordered image list representing the upper outlier values.
-   * Size is dependent on the number of outliers to remove for robust standard
-   * deviation calculation. Used to determine sigma calculations. Order is
-   * descending starting from highest intensity
-   */
-  void SetUpperOutlierImages( InputImageListType& list )
-    { m_UpperOutlierImages = list; }
-
-  void SetUpperImages( InputImagePointer i );
-  void SetLowerImages( InputImagePointer i );
-  void SetMedianImages( InputImagePointer i );
-
-  InputImagePointer GetImageCopy( InputImagePointer );
-  InputImageListType& AddToUpdateImageList( InputImagePointer input,
-                                            InputImageListType& list,
-                                            bool ListIsAscending );
-
   bool UseMedian( void )
     { return ( m_TotalNumberOfImages > 0 ); }
 
   /**
-   * Builds median image from the LowerOutlierImages. Can only
+   * Builds median image from the lower values. Can only
    * be (reasonably) called after at least 1 image has been added
    */
   OutputMeanImagePointer  GetMedianImage();
 
-
 private:
 
-  InputImageListType                      m_LowerOutlierImages;
-  InputImageListType                      m_UpperOutlierImages;
+  /**
+   * The lowest values of each voxel, in ascending order, and its highest
+   * values, in descending order.  The values of a voxel are contiguous and
+   * voxels are in buffer order.  Missing values are the largest (resp.
+   * smallest) pixel value.  Used for the outliers and the median.
+   */
+  std::vector< InputPixelType >           m_LowerValues;
+  std::vector< InputPixelType >           m_UpperValues;
+  unsigned int                            m_NumberOfLowerValues;
+  unsigned int                            m_NumberOfUpperValues;
 
   unsigned int                            m_NumberOfOutlierImagesToRemove;
   unsigned int                            m_TotalNumberOfImages;
 
+  ThreadIdType                            m_NumberOfThreads;
+
+  struct AddImageThreadStruct
+    {
+    Self *                                Filter;
+    InputImagePointer                     Image;
+    }; // End struct AddImageThreadStruct
+
+  /** Merge the values of one slab of the added image into the kept ones */
+  static ITK_THREAD_RETURN_TYPE AddImageThreaderCallback( void * arg );
+
+  /** Insert value into the sorted values [first, first + count) and drop
+   *  the last one.  Equal values keep their order. */
+  static void InsertValue( InputPixelType value, InputPixelType * first,
+    unsigned int count, bool ascending );
+
 }; // End class RobustMeanAndSigmaImageBuilder
 
 #ifndef ITK_MANUAL_INSTANTIATION
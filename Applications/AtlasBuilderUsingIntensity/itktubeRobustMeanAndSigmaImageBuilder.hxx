@@ -32,9 +32,12 @@ RobustMeanAndSigmaImageBuilder< TInputImageType,
                                 TOutputMeanImageType,
                                 TOutputSigmaImageType >
 ::RobustMeanAndSigmaImageBuilder( void )
-: m_NumberOfOutlierImagesToRemove(0),
+: m_NumberOfLowerValues(0),
+  m_NumberOfUpperValues(0),
+  m_NumberOfOutlierImagesToRemove(0),
   m_TotalNumberOfImages(0)
 {
+  m_NumberOfThreads = MultiThreader::GetGlobalDefaultNumberOfThreads();
 }
 
 template< class TInputImageType, class TOutputMeanImageType,
@@ -47,57 +50,30 @@ RobustMeanAndSigmaImageBuilder< TInputImageType,
 {
   Superclass::BuildProcessingImages( image );
 
-  InputImageListType  lowerImages = this->GetLowerOutlierImages();
-  InputImageListType  upperImages = this->GetUpperOutlierImages();
+  m_NumberOfUpperValues = this->GetNumberOfOutlierImagesToRemove();
+  m_NumberOfLowerValues = this->GetNumberOfOutlierImagesToRemove();
 
-  for( unsigned int i = 0; i < this->GetNumberOfOutlierImagesToRemove(); i++ )
-    {
-    InputImagePointer lowerImage = InputImageType::New();
-    lowerImage->SetRegions( image->GetLargestPossibleRegion() );
-    lowerImage->SetSpacing( image->GetSpacing() );
-    lowerImage->SetOrigin( image->GetOrigin() );
-    lowerImage->Allocate();
-    lowerImage->FillBuffer( NumericTraits<InputPixelType>::max() );
-
-    InputImagePointer upperImage = InputImageType::New();
-    upperImage->SetRegions( image->GetLargestPossibleRegion() );
-    upperImage->SetSpacing( image->GetSpacing() );
-    upperImage->SetOrigin( image->GetOrigin() );
-    upperImage->Allocate();
-    upperImage->FillBuffer( NumericTraits<InputPixelType>::NonpositiveMin() );
-
-    lowerImages.push_back( lowerImage );
-    upperImages.push_back( upperImage );
-    ::tube::FmtInfoMessage("Building outlier image %d!", i);
-    }
-
-  // Add additional images to the lower outlier list if the median is used
+  // Keep additional lower values if the median is used
   if( UseMedian() )
     {
-    // Number of remaining images to add to lower group to insure that
+    // Number of remaining values to add to lower group to insure that
     // all possible median values are covered
     unsigned int nTotal = this->GetTotalNumberOfImages();
     unsigned int nOutliers = this->GetNumberOfOutlierImagesToRemove();
     unsigned int remaining = ( nTotal / 2 ) + 1 - nOutliers;
-    ::tube::FmtInfoMessage("Images remaining to be built: %d!", remaining);
+    ::tube::FmtInfoMessage("Values remaining to be kept: %d!", remaining);
 
-    for( unsigned int i = 0; i < remaining; i++ )
-      {
-      InputImagePointer lowerImage = InputImageType::New();
-      lowerImage->SetRegions( image->GetLargestPossibleRegion() );
-      lowerImage->SetSpacing( image->GetSpacing() );
-      lowerImage->SetOrigin( image->GetOrigin() );
-      lowerImage->Allocate();
-      lowerImage->FillBuffer( NumericTraits<InputPixelType>::max() );
-
-      lowerImages.push_back( lowerImage );
-      }
+    m_NumberOfLowerValues += remaining;
     }
   ::tube::FmtInfoMessage("This is the lower list size: %d",
-    lowerImages.size());
-
-  this->SetLowerOutlierImages( lowerImages );
-  this->SetUpperOutlierImages( upperImages );
+    m_NumberOfLowerValues);
+
+  const SizeValueType numberOfVoxels =
+    image->GetLargestPossibleRegion().GetNumberOfPixels();
+  m_LowerValues.assign( numberOfVoxels * m_NumberOfLowerValues,
+    NumericTraits<InputPixelType>::max() );
+  m_UpperValues.assign( numberOfVoxels * m_NumberOfUpperValues,
+    NumericTraits<InputPixelType>::NonpositiveMin() );
 }
 
 template< class TInputImageType, class TOutputMeanImageType,
@@ -111,140 +87,127 @@ RobustMeanAndSigmaImageBuilder< TInputImageType,
   // Add image to running total for the variance calculation
   Superclass::AddImage( i );
 
-  InputImagePointer medianCopy  = GetImageCopy( i );
-  InputImagePointer upperCopy   = GetImageCopy( i );
-
-  // Update the median image list
-  if( this->UseMedian() )
-    {
-    // ** Update the lower half of the images
-    SetMedianImages( i );
-    }
-  else
+  if( m_NumberOfLowerValues == 0 && m_NumberOfUpperValues == 0 )
     {
-    // Update the lower outlying images
-    SetLowerImages( i );
+    return;
     }
 
-  // Update the upper outlying images
-  SetUpperImages( i );
-}
-
-template< class TInputImageType, class TOutputMeanImageType,
-          class TOutputSigmaImageType >
-void
-RobustMeanAndSigmaImageBuilder< TInputImageType,
-                                TOutputMeanImageType,
-                                TOutputSigmaImageType >
-::SetMedianImages( InputImagePointer i )
-{
-  // Get image copy, such that input pointer is not changed by fun
-  InputImagePointer image = GetImageCopy( i );
-
-  bool isAscending = true;
-  AddToUpdateImageList( image, this->GetLowerOutlierImages(), isAscending );
+  // Update the lower (or median) and upper values
+  AddImageThreadStruct str;
+  str.Filter = this;
+  str.Image = i;
 
+  typename MultiThreader::Pointer threader = MultiThreader::New();
+  threader->SetNumberOfThreads( m_NumberOfThreads );
+  threader->SetSingleMethod( this->AddImageThreaderCallback, &str );
+  threader->SingleMethodExecute();
 }
 
 template< class TInputImageType, class TOutputMeanImageType,
           class TOutputSigmaImageType >
-void
+ITK_THREAD_RETURN_TYPE
 RobustMeanAndSigmaImageBuilder< TInputImageType,
                                 TOutputMeanImageType,
                                 TOutputSigmaImageType >
-::SetLowerImages( InputImagePointer i )
+::AddImageThreaderCallback( void * arg )
 {
-  bool isAscending = true;
-  InputImagePointer image = GetImageCopy( i );
-  AddToUpdateImageList( image, this->GetLowerOutlierImages(), isAscending );
-}
+  MultiThreader::ThreadInfoStruct * info =
+    static_cast< MultiThreader::ThreadInfoStruct * >( arg );
+  AddImageThreadStruct * str =
+    static_cast< AddImageThreadStruct * >( info->UserData );
+  Self * filter = str->Filter;
+
+  // Each thread handles a slab along the last dimension of the output
+  // region, whose voxels are contiguous in the buffers
+  const unsigned int lastDim = ImageDimension - 1;
+  const SizeType outputSize = filter->GetOutputSize();
+  const SizeValueType firstSlice =
+    ( outputSize[lastDim] * info->ThreadID ) / info->NumberOfThreads;
+  const SizeValueType lastSlice =
+    ( outputSize[lastDim] * ( info->ThreadID + 1 ) ) / info->NumberOfThreads;
+  if( firstSlice >= lastSlice )
+    {
+    return ITK_THREAD_RETURN_VALUE;
+    }
 
-template< class TInputImageType, class TOutputMeanImageType,
-          class TOutputSigmaImageType >
-void
-RobustMeanAndSigmaImageBuilder< TInputImageType,
-                                TOutputMeanImageType,
-                                TOutputSigmaImageType>
-::SetUpperImages( InputImagePointer i )
-{
-  bool isAscending = false;
-  InputImagePointer image = GetImageCopy( i );
-  AddToUpdateImageList( image, this->GetUpperOutlierImages(), isAscending );
+  typename RegionType::IndexType slabIndex;
+  slabIndex.Fill( 0 );
+  slabIndex[lastDim] = firstSlice;
+  SizeType slabSize = outputSize;
+  slabSize[lastDim] = lastSlice - firstSlice;
+  RegionType slab;
+  slab.SetIndex( slabIndex );
+  slab.SetSize( slabSize );
+
+  SizeValueType voxel = firstSlice;
+  for( unsigned int d = 0; d < lastDim; d++ )
+    {
+    voxel *= outputSize[d];
+    }
 
-}
+  const unsigned int nLower = filter->m_NumberOfLowerValues;
+  const unsigned int nUpper = filter->m_NumberOfUpperValues;
+  InputPixelType * lower = NULL;
+  if( nLower > 0 )
+    {
+    lower = &filter->m_LowerValues[0] + voxel * nLower;
+    }
+  InputPixelType * upper = NULL;
+  if( nUpper > 0 )
+    {
+    upper = &filter->m_UpperValues[0] + voxel * nUpper;
+    }
 
-template< class TInputImageType, class TOutputMeanImageType,
-          class TOutputSigmaImageType >
-typename RobustMeanAndSigmaImageBuilder< TInputImageType,
-                                         TOutputMeanImageType,
-                                         TOutputSigmaImageType >::InputImageListType&
-RobustMeanAndSigmaImageBuilder< TInputImageType,
-                                TOutputMeanImageType,
-                                TOutputSigmaImageType >
-::AddToUpdateImageList( InputImagePointer input, InputImageListType& list,
-                        bool ListIsAscending )
-{
-  // List is filled from front to back and is assumed to be in ascending order
-  InputIteratorType  it_input( input, input->GetLargestPossibleRegion() );
-  for( int i = 0; i < list.size(); i ++ )
+  const bool thresholdOn = filter->GetThresholdInputImageBelowOn();
+  const InputPixelType threshold = filter->GetThresholdInputImageBelow();
+
+  InputConstIteratorType it_input( str->Image, slab );
+  it_input.GoToBegin();
+  while( !it_input.IsAtEnd() )
     {
-    InputIteratorType  it_list( list[i], list[i]->GetLargestPossibleRegion() );
+    const InputPixelType value = it_input.Get();
 
-    it_input.GoToBegin();
-    it_list.GoToBegin();
-    while( !it_list.IsAtEnd() && !it_input.IsAtEnd() )
+    // Do not count a pixel if the user requests to threshold and the pixel
+    // is below the threshold ( same as itkMeanAndSigmaImageBuilder )
+    if( !thresholdOn || value > threshold )
       {
-      // Do not count a pixel if the user requests to threshold and the pixel
-      // is below the threshold
-      if( this->GetThresholdInputImageBelowOn() &&
-          it_input.Get() <= this->GetThresholdInputImageBelow() )
-        {
-        // Do nothing for this pixel ( should not be included in calcualations
-        // ( same as itkMeanAndSigmaImageBuilder )
-        }
-      /* List is ascending & the input value is less than list swap, and vice versa */
-      else if( ( ListIsAscending && it_input.Get() < it_list.Get() ) ||
-                  ( !ListIsAscending && it_input.Get() > it_list.Get() ) )
-        {
-        // Swap the values and continue
-        InputPixelType tmp = it_list.Get();
-        it_list.Set( it_input.Get() );
-        it_input.Set( tmp );
-        }
-      ++it_input;
-      ++it_list;
+      InsertValue( value, lower, nLower, true );
+      InsertValue( value, upper, nUpper, false );
       }
+    lower += nLower;
+    upper += nUpper;
+    ++it_input;
     }
-  return list;
+
+  return ITK_THREAD_RETURN_VALUE;
 }
 
 template< class TInputImageType, class TOutputMeanImageType,
           class TOutputSigmaImageType >
-typename RobustMeanAndSigmaImageBuilder< TInputImageType,
-                                         TOutputMeanImageType,
-                                        TOutputSigmaImageType >::InputImagePointer
+void
 RobustMeanAndSigmaImageBuilder< TInputImageType,
                                 TOutputMeanImageType,
                                 TOutputSigmaImageType >
-::GetImageCopy( InputImagePointer input )
+::InsertValue( InputPixelType value, InputPixelType * first,
+  unsigned int count, bool ascending )
 {
-  InputImagePointer copy = InputImageType::New();
-  copy->SetRegions( input->GetLargestPossibleRegion() );
-  copy->SetSpacing( input->GetSpacing() );
-  copy->SetOrigin( input->GetOrigin() );
-  copy->Allocate();
-
-  InputConstIteratorType it_input( input, input->GetLargestPossibleRegion() );
-  InputIteratorType it_copy( copy, copy->GetLargestPossibleRegion() );
-
-  while( !it_input.IsAtEnd() )
+  // Values are sorted, so the ones after the insertion position move
+  // up by one
+  unsigned int k = 0;
+  while( k < count && ( ascending ? !( value < first[k] )
+                                  : !( value > first[k] ) ) )
     {
-    it_copy.Set( it_input.Get() );
-
-    ++it_input;
-    ++it_copy;
+    ++k;
     }
-  return copy;
+  if( k == count )
+    {
+    return;
+    }
+  for( unsigned int j = count - 1; j > k; --j )
+    {
+    first[j] = first[j - 1];
+    }
+  first[k] = value;
 }
 
 template< class TInputImageType, class TOutputMeanImageType,
@@ -261,9 +224,6 @@ RobustMeanAndSigmaImageBuilder< TInputImageType,
     return;
     }
 
-  InputImageListType  lowInputs   = this->GetLowerOutlierImages();
-  InputImageListType  highInputs  = this->GetUpperOutlierImages();
-
   ProcessImagePointer sumImage        = this->GetSumImage();
   ProcessImagePointer sumSquareImage  = this->GetSumSquareImage();
   CountImagePointer   validImages     = this->GetValidCountImage();
@@ -277,41 +237,41 @@ RobustMeanAndSigmaImageBuilder< TInputImageType,
   CountIteratorType   it_valid( validImages,
                                 validImages->GetLargestPossibleRegion() );
 
-  unsigned int outlierImage = this->GetNumberOfOutlierImagesToRemove();
-  for( unsigned int i = 0; i < outlierImage; i++ )
-    {
-    it_sum.GoToBegin();
-    it_sumSqr.GoToBegin();
-    it_valid.GoToBegin();
-
-    InputConstIteratorType it_lowInput( lowInputs[i],
-                                        lowInputs[i]->GetLargestPossibleRegion() );
-    InputConstIteratorType it_highInput( highInputs[i],
-                                         highInputs[i]->GetLargestPossibleRegion() );
+  const unsigned int outlierImage = this->GetNumberOfOutlierImagesToRemove();
+  const InputPixelType * lower = m_LowerValues.empty() ? NULL
+    : &m_LowerValues[0];
+  const InputPixelType * upper = m_UpperValues.empty() ? NULL
+    : &m_UpperValues[0];
 
-    while( !it_lowInput.IsAtEnd() )
+  it_sum.GoToBegin();
+  it_sumSqr.GoToBegin();
+  it_valid.GoToBegin();
+  while( !it_sum.IsAtEnd() )
+    {
+    // Remove the outliers of the voxel, lowest and highest first
+    for( unsigned int i = 0; i < outlierImage; i++ )
       {
       if( it_valid.Get() > 2*outlierImage )
         {
-        ProcessPixelType  sumValue    = it_lowInput.Get() + it_highInput.Get();
-        ProcessPixelType  sumSqrValue = it_lowInput.Get()*it_lowInput.Get() +
-                                        it_highInput.Get()*it_highInput.Get();
+        ProcessPixelType  sumValue    = lower[i] + upper[i];
+        ProcessPixelType  sumSqrValue = lower[i]*lower[i] +
+                                        upper[i]*upper[i];
 
         it_sum.Set( it_sum.Get() - sumValue );
         it_sumSqr.Set( it_sumSqr.Get() - sumSqrValue );
         it_valid.Set( it_valid.Get() - 2 );
         }
-
-      ++it_lowInput;
-      ++it_highInput;
-      ++it_sum;
-      ++it_sumSqr;
-      ++it_valid;
       }
+
+    lower += m_NumberOfLowerValues;
+    upper += m_NumberOfUpperValues;
+    ++it_sum;
+    ++it_sumSqr;
+    ++it_valid;
     }
-  SetSumImage( sumImage );
-  SetSumSquareImage( sumSquareImage );
-  SetValidCountImage( validImages );
+  this->SetSumImage( sumImage );
+  this->SetSumSquareImage( sumSquareImage );
+  this->SetValidCountImage( validImages );
 
   // Run the finalization using the superclass (NOTE: Must occur AFTER the
   // subtraction of the outlier images from the summed images)
@@ -322,8 +282,12 @@ RobustMeanAndSigmaImageBuilder< TInputImageType,
   if( UseMedian() )
     {
     // Build the median image and replace the mean with the median
-    SetOutputMeanImage( this->GetMedianImage() );
+    this->SetOutputMeanImage( this->GetMedianImage() );
     }
+
+  // The kept values are not needed anymore
+  std::vector< InputPixelType >().swap( m_LowerValues );
+  std::vector< InputPixelType >().swap( m_UpperValues );
 }
 
 template< class TInputImageType, class TOutputMeanImageType,
@@ -334,63 +298,44 @@ typename RobustMeanAndSigmaImageBuilder<
                 TOutputSigmaImageType>::OutputMeanImagePointer
 RobustMeanAndSigmaImageBuilder< TInputImageType,
                                 TOutputMeanImageType,
-                                TOutputSigmaImageType>
+                                TOutputSigmaImageType >
 ::GetMedianImage( void )
 {
   unsigned int totalNumImages = this->GetTotalNumberOfImages();
-  InputImageListType lowerImages = this->GetLowerOutlierImages();
-
   unsigned int numImages = totalNumImages/2;
-  typename InputImageType::ConstPointer lastLowerImage = lowerImages[numImages];
+
+  ProcessImagePointer sumImage = this->GetSumImage();
 
   // Build output median image
   OutputMeanImagePointer medianImage = OutputMeanImageType::New();
-  medianImage->SetRegions( lastLowerImage->GetLargestPossibleRegion() );
-  medianImage->SetSpacing( lastLowerImage->GetSpacing() );
-  medianImage->SetOrigin( lastLowerImage->GetOrigin() );
+  medianImage->SetRegions( sumImage->GetLargestPossibleRegion() );
+  medianImage->SetSpacing( sumImage->GetSpacing() );
+  medianImage->SetOrigin( sumImage->GetOrigin() );
   medianImage->Allocate();
 
   OutputMeanIteratorType it_median( medianImage,
                                     medianImage->GetLargestPossibleRegion() );
-  // Odd number
-  if( (totalNumImages % 2) )
-    {
-
-    InputConstIteratorType it_middle( lastLowerImage,
-                                      lastLowerImage->GetLargestPossibleRegion() );
-    it_middle.GoToBegin();
-    it_median.GoToBegin();
 
-    while( !it_middle.IsAtEnd() )
+  const InputPixelType * lower = &m_LowerValues[0];
+  it_median.GoToBegin();
+  while( !it_median.IsAtEnd() )
+    {
+    // Odd number
+    if( (totalNumImages % 2) )
       {
-      it_median.Set( it_middle.Get() );
-      ++it_middle;
-      ++it_median;
+      it_median.Set( lower[numImages] );
       }
-    }
-  // Even number
-  else
-    {
-    InputConstIteratorType it_middle1( lastLowerImage,
-                                       lastLowerImage->GetLargestPossibleRegion() );
-    typename InputImageType::ConstPointer prevLowerImage = lowerImages[numImages - 1];
-    InputConstIteratorType it_middle2( prevLowerImage,
-                                       prevLowerImage->GetLargestPossibleRegion() );
-
-    it_middle1.GoToBegin();
-    it_middle2.GoToBegin();
-    it_median.GoToBegin();
-    while( !it_middle1.IsAtEnd() && !it_middle2.IsAtEnd() )
+    // Even number
+    else
       {
       // Average the values
-      OutputMeanPixelType median =  ( double(it_middle1.Get()) +
-                                      double(it_middle2.Get()) ) / 2;
+      OutputMeanPixelType median =  ( double(lower[numImages]) +
+                                      double(lower[numImages - 1]) ) / 2;
       it_median.Set( median );
-
-      ++it_middle1;
-      ++it_middle2;
-      ++it_median;
       }
+
+    lower += m_NumberOfLowerValues;
+    ++it_median;
     }
   return medianImage;
 }
@@ -400,7 +345,7 @@ template< class TInputImageType, class TOutputMeanImageType,
 void
 RobustMeanAndSigmaImageBuilder< TInputImageType,
                                 TOutputMeanImageType,
-                                TOutputSigmaImageType>
+                                TOutputSigmaImageType >
 ::UpdateOutputImageSize( SizeType inputSize )
 {
   if( !( this->GetIsProcessing() ) )
@@ -409,39 +354,55 @@ RobustMeanAndSigmaImageBuilder< TInputImageType,
     return;
     }
 
-  Superclass::UpdateOutputImageSize( inputSize );
-
-  typedef ResampleImageFilter<InputImageType, InputImageType> ResampleInputImageType;
+  const SizeType oldSize = this->GetOutputSize();
 
-  InputImageListType  lowerList = this->GetLowerOutlierImages();
+  Superclass::UpdateOutputImageSize( inputSize );
 
-  typename InputImageListType::const_iterator  it_lower = lowerList.begin();
-  while( it_lower != lowerList.end() )
+  // Move the kept values of the voxels common to both sizes, the others
+  // start without values
+  SizeValueType numberOfVoxels = 1;
+  for( unsigned int d = 0; d < ImageDimension; d++ )
     {
-    typename ResampleInputImageType::Pointer filter = ResampleInputImageType::New();
-    filter->SetInput( *it_lower );
-    filter->SetSize( inputSize );
-    filter->SetOutputSpacing( (*it_lower)->GetSpacing() );
-    filter->SetOutputOrigin( (*it_lower)->GetOrigin() );
-    filter->Update();
-
-    ++it_lower;
+    numberOfVoxels *= inputSize[d];
     }
 
-  InputImageListType  upperList = this->GetUpperOutlierImages();
+  std::vector< InputPixelType > lowerValues( numberOfVoxels *
+    m_NumberOfLowerValues, NumericTraits<InputPixelType>::max() );
+  std::vector< InputPixelType > upperValues( numberOfVoxels *
+    m_NumberOfUpperValues, NumericTraits<InputPixelType>::NonpositiveMin() );
 
-  typename InputImageListType::const_iterator  it_upper = upperList.begin();
-  while( it_upper != upperList.end() )
+  for( SizeValueType voxel = 0; voxel < numberOfVoxels; voxel++ )
     {
-    typename ResampleInputImageType::Pointer filter = ResampleInputImageType::New();
-    filter->SetInput( *it_upper );
-    filter->SetSize( inputSize );
-    filter->SetOutputSpacing( (*it_upper)->GetSpacing() );
-    filter->SetOutputOrigin( (*it_upper)->GetOrigin() );
-    filter->Update();
-
-    ++it_upper;
+    SizeValueType offset = voxel;
+    SizeValueType oldVoxel = 0;
+    SizeValueType oldStride = 1;
+    bool isInside = true;
+    for( unsigned int d = 0; d < ImageDimension; d++ )
+      {
+      const SizeValueType index = offset % inputSize[d];
+      offset /= inputSize[d];
+      if( index >= oldSize[d] )
+        {
+        isInside = false;
+        break;
+        }
+      oldVoxel += index * oldStride;
+      oldStride *= oldSize[d];
+      }
+    if( !isInside )
+      {
+      continue;
+      }
+    std::copy( m_LowerValues.begin() + oldVoxel * m_NumberOfLowerValues,
+      m_LowerValues.begin() + ( oldVoxel + 1 ) * m_NumberOfLowerValues,
+      lowerValues.begin() + voxel * m_NumberOfLowerValues );
+    std::copy( m_UpperValues.begin() + oldVoxel * m_NumberOfUpperValues,
+      m_UpperValues.begin() + ( oldVoxel + 1 ) * m_NumberOfUpperValues,
+      upperValues.begin() + voxel * m_NumberOfUpperValues );
     }
+
+  m_LowerValues.swap( lowerValues );
+  m_UpperValues.swap( upperValues );
 }
 
 #endif // End !defined(__itktubeRobustMeanAndSigmaImageBuilder_hxx)
@@ -50,6 +50,10 @@ AtlasSummation
   m_NumOfImages  = 0;  // Variable used for median calculations
   m_MedianDefaultPixelValue = itk::NumericTraits<InputPixelType>::max();
   m_Count = 0;
+
+  m_NumberOfOutlierImagesToRemove = 0;
+  m_MaximumSlabMemoryInMegabytes = 512;
+  m_NumberOfThreads = itk::MultiThreader::GetGlobalDefaultNumberOfThreads();
 }
 
 
@@ -230,6 +234,308 @@ void AtlasSummation
 ::Finalize( void )
 {
   m_MeanBuilder->FinalizeOutput();
+
+  m_MeanImage = m_MeanBuilder->GetOutputMeanImage();
+  m_VarianceImage = m_MeanBuilder->GetOutputSigmaImage();
+  m_CountImage = m_MeanBuilder->GetValidCountImage();
+}
+
+
+void AtlasSummation
+::AddSubject( const std::string & fileName, TransformPointer t )
+{
+  SubjectType subject;
+  subject.FileName = fileName;
+  subject.Transform = t;
+  m_Subjects.push_back( subject );
+}
+
+
+void AtlasSummation
+::AddSubject( InputImagePointer image, TransformPointer t )
+{
+  SubjectType subject;
+  subject.Image = image;
+  subject.Transform = t;
+  m_Subjects.push_back( subject );
+}
+
+
+void AtlasSummation
+::BuildAtlasBySlabs( void )
+{
+  if( m_Subjects.empty() )
+    {
+    ::tube::ErrorMessage( "Must call AddSubject() before building!" );
+    return;
+    }
+  if( m_AdjustResampledImageSize || m_AdjustResampledImageOrigin )
+    {
+    ::tube::ErrorMessage(
+      "Size and origin adjustments need all the images: use AddImage()" );
+    return;
+    }
+
+  // The first subject defines the output, only its header is needed
+  InputImagePointer reference = m_Subjects[0].Image;
+  if( reference.IsNull() )
+    {
+    ReaderType::Pointer reader = ReaderType::New();
+    reader->SetFileName( m_Subjects[0].FileName );
+    reader->UpdateOutputInformation();
+    reference = reader->GetOutput();
+    }
+  const SizeType outputSize = reference->GetLargestPossibleRegion().GetSize();
+  const SpacingType outputSpacing = reference->GetSpacing();
+  const PointType outputOrigin = reference->GetOrigin();
+
+  RegionType outputRegion;
+  outputRegion.SetSize( outputSize );
+
+  m_MeanImage = MeanImageType::New();
+  m_MeanImage->SetRegions( outputRegion );
+  m_MeanImage->SetSpacing( outputSpacing );
+  m_MeanImage->SetOrigin( outputOrigin );
+  m_MeanImage->Allocate();
+
+  m_VarianceImage = VarianceImageType::New();
+  m_VarianceImage->SetRegions( outputRegion );
+  m_VarianceImage->SetSpacing( outputSpacing );
+  m_VarianceImage->SetOrigin( outputOrigin );
+  m_VarianceImage->Allocate();
+
+  m_CountImage = CountImageType::New();
+  m_CountImage->SetRegions( outputRegion );
+  m_CountImage->SetSpacing( outputSpacing );
+  m_CountImage->SetOrigin( outputOrigin );
+  m_CountImage->Allocate();
+
+  const unsigned int numberOfSubjects = m_Subjects.size();
+  const itk::ThreadIdType numberOfThreads = std::max( itk::ThreadIdType( 1 ),
+    std::min( m_NumberOfThreads, itk::ThreadIdType( numberOfSubjects ) ) );
+  const SizeType::SizeValueType slicesPerSlab =
+    this->GetNumberOfSlicesPerSlab( outputSize );
+  const unsigned int lastDim = Dimension - 1;
+
+  ::tube::FmtInfoMessage( "Building the atlas by slabs of %d slices",
+    static_cast< int >( slicesPerSlab ) );
+
+  for( SizeType::SizeValueType firstSlice = 0;
+       firstSlice < outputSize[lastDim]; firstSlice += slicesPerSlab )
+    {
+    RegionType slab = outputRegion;
+    slab.SetIndex( lastDim, firstSlice );
+    slab.SetSize( lastDim, std::min( slicesPerSlab,
+      outputSize[lastDim] - firstSlice ) );
+
+    // Statistics of this slab only, configured like m_MeanBuilder
+    SlabBuilderType::Pointer builder = SlabBuilderType::New();
+    builder->SetNumberOfThreads( m_NumberOfThreads );
+    builder->SetNumberOfOutlierImagesToRemove(
+      m_NumberOfOutlierImagesToRemove );
+    if( this->UseMedian() )
+      {
+      builder->UseMedianImage( numberOfSubjects );
+      }
+    builder->SetImageCountThreshold(
+      m_MeanBuilder->GetImageCountThreshold() );
+    builder->SetUseStandardDeviation(
+      m_MeanBuilder->GetUseStandardDeviation() );
+    if( m_MeanBuilder->GetThresholdInputImageBelowOn() )
+      {
+      builder->SetThresholdInputImageBelow(
+        m_MeanBuilder->GetThresholdInputImageBelow() );
+      }
+
+    // Resample a batch of subjects at once, then add them in order so
+    // that the sums do not depend on the number of threads
+    SlabThreadStruct str;
+    str.Summation = this;
+    str.Slab = slab;
+    for( unsigned int first = 0; first < numberOfSubjects;
+         first += numberOfThreads )
+      {
+      const unsigned int batchSize = std::min(
+        static_cast< unsigned int >( numberOfThreads ),
+        numberOfSubjects - first );
+
+      str.FirstSubject = first;
+      str.Images.resize( batchSize );
+      str.Slabs.resize( batchSize );
+      for( unsigned int i = 0; i < batchSize; i++ )
+        {
+        str.Images[i] = this->GetSubjectImage( first + i );
+        }
+
+      itk::MultiThreader::Pointer threader = itk::MultiThreader::New();
+      threader->SetNumberOfThreads( batchSize );
+      threader->SetSingleMethod( SlabThreaderCallback, &str );
+      threader->SingleMethodExecute();
+
+      str.Images.clear();
+      for( unsigned int i = 0; i < batchSize; i++ )
+        {
+        builder->AddImage( str.Slabs[i] );
+        }
+      str.Slabs.clear();
+      }
+
+    builder->FinalizeOutput();
+
+    // Copy the slab into the outputs
+    RegionType slabRegion;
+    slabRegion.SetSize( slab.GetSize() );
+    itk::ImageRegionConstIterator< MeanImageType > it_slabMean(
+      builder->GetOutputMeanImage(), slabRegion );
+    itk::ImageRegionConstIterator< VarianceImageType > it_slabVariance(
+      builder->GetOutputSigmaImage(), slabRegion );
+    itk::ImageRegionConstIterator< CountImageType > it_slabCount(
+      builder->GetValidCountImage(), slabRegion );
+    MeanIteratorType it_mean( m_MeanImage, slab );
+    VarianceIteratorType it_variance( m_VarianceImage, slab );
+    CountIteratorType it_count( m_CountImage, slab );
+    while( !it_mean.IsAtEnd() )
+      {
+      it_mean.Set( it_slabMean.Get() );
+      it_variance.Set( it_slabVariance.Get() );
+      it_count.Set( it_slabCount.Get() );
+      ++it_slabMean;
+      ++it_slabVariance;
+      ++it_slabCount;
+      ++it_mean;
+      ++it_variance;
+      ++it_count;
+      }
+    }
+}
+
+
+AtlasSummation::SizeType::SizeValueType AtlasSummation
+::GetNumberOfSlicesPerSlab( const SizeType & outputSize ) const
+{
+  const unsigned int lastDim = Dimension - 1;
+  SizeType::SizeValueType voxelsPerSlice = 1;
+  for( unsigned int i = 0; i < lastDim; i++ )
+    {
+    voxelsPerSlice *= outputSize[i];
+    }
+
+  // Kept values of the outliers and of the median, as in
+  // RobustMeanAndSigmaImageBuilder
+  const unsigned int numberOfSubjects = m_Subjects.size();
+  unsigned int numberOfKeptValues = 2 * m_NumberOfOutlierImagesToRemove;
+  if( this->UseMedian()
+    && numberOfSubjects / 2 + 1 > m_NumberOfOutlierImagesToRemove )
+    {
+    numberOfKeptValues += numberOfSubjects / 2 + 1
+      - m_NumberOfOutlierImagesToRemove;
+    }
+
+  // Sum, sum of squares, count, mean and sigma, the kept values and the
+  // resampled subjects of a batch
+  const double bytesPerSlice = static_cast< double >( voxelsPerSlice )
+    * sizeof( InputPixelType )
+    * ( 5 + numberOfKeptValues + m_NumberOfThreads );
+  const double slices = m_MaximumSlabMemoryInMegabytes * 1024 * 1024
+    / bytesPerSlice;
+  if( slices < 1 )
+    {
+    return 1;
+    }
+  if( slices > outputSize[lastDim] )
+    {
+    return outputSize[lastDim];
+    }
+  return static_cast< SizeType::SizeValueType >( slices );
+}
+
+
+AtlasSummation::InputImagePointer AtlasSummation
+::GetSubjectImage( unsigned int subject ) const
+{
+  if( m_Subjects[subject].Image.IsNotNull() )
+    {
+    return m_Subjects[subject].Image;
+    }
+
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( m_Subjects[subject].FileName );
+  reader->Update();
+  return reader->GetOutput();
+}
+
+
+AtlasSummation::InputImagePointer AtlasSummation
+::GetSubjectSlab( unsigned int subject,
+                  InputImagePointer image,
+                  const RegionType & slab ) const
+{
+  // The slab image starts at index 0, as the builder expects
+  RegionType slabRegion;
+  slabRegion.SetSize( slab.GetSize() );
+  PointType slabOrigin;
+  m_MeanImage->TransformIndexToPhysicalPoint( slab.GetIndex(), slabOrigin );
+
+  InputImagePointer slabImage = InputImageType::New();
+  slabImage->SetRegions( slabRegion );
+  slabImage->SetSpacing( m_MeanImage->GetSpacing() );
+  slabImage->SetOrigin( slabOrigin );
+
+  if( subject == 0 )
+    {
+    // The first image is not resampled, see AddImage()
+    slabImage->Allocate();
+    itk::ImageRegionConstIterator< InputImageType > it_image( image, slab );
+    InputIteratorType it_slab( slabImage, slabRegion );
+    while( !it_slab.IsAtEnd() )
+      {
+      it_slab.Set( it_image.Get() );
+      ++it_image;
+      ++it_slab;
+      }
+    return slabImage;
+    }
+
+  // Same grid as TransformInputImage() on the whole output
+  typedef itk::ResampleImageFilter< InputImageType, InputImageType >
+               ResampleFilterType;
+
+  ResampleFilterType::Pointer transfilter = ResampleFilterType::New();
+  transfilter->SetNumberOfThreads( 1 );
+  transfilter->SetInput( image );
+  transfilter->SetOutputSpacing( m_MeanImage->GetSpacing() );
+  transfilter->SetOutputOrigin( m_MeanImage->GetOrigin() );
+  transfilter->SetOutputStartIndex( slab.GetIndex() );
+  transfilter->SetSize( slab.GetSize() );
+  transfilter->SetDefaultPixelValue( DEFAULT_PIXEL_FILL );
+
+  TransformType::Pointer inverse = TransformType::New();
+  m_Subjects[subject].Transform->GetInverse( inverse );
+  transfilter->SetTransform( inverse );
+  transfilter->Update();
+
+  slabImage->SetPixelContainer(
+    transfilter->GetOutput()->GetPixelContainer() );
+  return slabImage;
+}
+
+
+ITK_THREAD_RETURN_TYPE AtlasSummation
+::SlabThreaderCallback( void * arg )
+{
+  itk::MultiThreader::ThreadInfoStruct * info =
+    static_cast< itk::MultiThreader::ThreadInfoStruct * >( arg );
+  SlabThreadStruct * str =
+    static_cast< SlabThreadStruct * >( info->UserData );
+
+  const unsigned int i = info->ThreadID;
+  if( i < str->Images.size() )
+    {
+    str->Slabs[i] = str->Summation->GetSubjectSlab( str->FirstSubject + i,
+      str->Images[i], str->Slab );
+    }
+
+  return ITK_THREAD_RETURN_VALUE;
 }
 
 
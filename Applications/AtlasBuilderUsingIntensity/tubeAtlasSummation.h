@@ -31,10 +31,16 @@ limitations under the License.
 
 #include <itkAffineTransform.h>
 #include <itkImage.h>
+#include <itkImageFileReader.h>
 #include <itkImageFileWriter.h>
 #include <itkImageRegionIterator.h>
+#include <itkMultiThreader.h>
 #include <itkResampleImageFilter.h>
 
+#include <algorithm>
+#include <string>
+#include <vector>
+
 namespace tube
 {
 
@@ -69,6 +75,7 @@ public:
   typedef InputImageType::SpacingType                     SpacingType;
   typedef InputImageType::SizeType                        SizeType;
   typedef InputImageType::PointType                       PointType;
+  typedef InputImageType::RegionType                      RegionType;
 
 private:
 
@@ -89,6 +96,11 @@ private:
   typedef itk::tube::MeanAndSigmaImageBuilder<
     InputImageType, MeanImageType, VarianceImageType >    RobustMeanBuilderType;
 
+  typedef itk::tube::RobustMeanAndSigmaImageBuilder<
+    InputImageType, MeanImageType, VarianceImageType >    SlabBuilderType;
+
+  typedef itk::ImageFileReader< InputImageType >          ReaderType;
+
 public:
 
   /** CTOR, DTOR */
@@ -107,18 +119,38 @@ public:
   /** Build Mean and variance image & end AddImage() addition abilities */
   void Finalize( void );
 
+  /**
+   * Queue a subject for BuildAtlasBySlabs() -- Receives Moving -> Fixed
+   * Image Transform.  The image is read from the file for every slab, so
+   * only the subjects being resampled are in memory.
+   */
+  void AddSubject( const std::string & fileName, TransformPointer t );
+
+  /** Queue a subject already in memory for BuildAtlasBySlabs() */
+  void AddSubject( InputImagePointer image, TransformPointer t );
+
+  /**
+   * Build the mean (or median) and variance images of the queued subjects
+   * one slab of slices at a time.  As with AddImage(), the first subject
+   * defines the output and is not resampled.  The subjects of a slab are
+   * resampled several at once, and the sums and the kept values of the
+   * outliers and the median exist for the current slab only.  Size and
+   * origin adjustments are not supported.
+   */
+  void BuildAtlasBySlabs( void );
+
   /**
    * Return final Summation products-Mean (or median) & Variance
    * (or standard deviation & image count for # of valid images
    */
   MeanImageType * GetMeanImage( void ) const
-    { return m_MeanBuilder->GetOutputMeanImage(); }
+    { return m_MeanImage; }
 
   VarianceImageType * GetVarianceImage( void ) const
-    { return m_MeanBuilder->GetOutputSigmaImage(); }
+    { return m_VarianceImage; }
 
   CountImageType * GetValidCountImage( void ) const
-    { return m_MeanBuilder->GetValidCountImage(); }
+    { return m_CountImage; }
 
   /**
    * OPTIONAL PARAMETERS
@@ -185,6 +217,34 @@ public:
   bool UseMedian( void ) const
     { return (m_NumOfImages > 0); }
 
+  /**
+   * Number of lowest and of highest values of each voxel left out of the
+   * mean and variance by BuildAtlasBySlabs(), default is 0
+   */
+  void SetNumberOfOutlierImagesToRemove( unsigned int numberOfOutliers )
+    { m_NumberOfOutlierImagesToRemove = numberOfOutliers; }
+
+  unsigned int GetNumberOfOutlierImagesToRemove( void ) const
+    { return m_NumberOfOutlierImagesToRemove; }
+
+  /**
+   * Memory, in megabytes, of the sums and kept values of a slab in
+   * BuildAtlasBySlabs(); it sets the number of slices per slab.  The
+   * output images and the subject images are not counted.
+   */
+  void SetMaximumSlabMemoryInMegabytes( double maximumMemory )
+    { m_MaximumSlabMemoryInMegabytes = maximumMemory; }
+
+  double GetMaximumSlabMemoryInMegabytes( void ) const
+    { return m_MaximumSlabMemoryInMegabytes; }
+
+  /** Number of subjects resampled at once by BuildAtlasBySlabs() */
+  void SetNumberOfThreads( itk::ThreadIdType numberOfThreads )
+    { m_NumberOfThreads = numberOfThreads; }
+
+  itk::ThreadIdType GetNumberOfThreads( void ) const
+    { return m_NumberOfThreads; }
+
   /**
    * Adjust all the resampled images origins and size (if not already defined)
    * so that no elements are cut off due to transforming & resampling the image
@@ -241,6 +301,37 @@ private:
   void WriteImage( MeanImageType::Pointer, const std::string & );
   void WriteImage( ProcessImagePointer, const std::string & );
 
+  /** Number of slices of the slabs of BuildAtlasBySlabs() */
+  SizeType::SizeValueType GetNumberOfSlicesPerSlab(
+    const SizeType & outputSize ) const;
+
+  /** The subject image in memory, or read from its file */
+  InputImagePointer GetSubjectImage( unsigned int subject ) const;
+
+  /** The slab of a subject image on the output grid */
+  InputImagePointer GetSubjectSlab( unsigned int subject,
+                                    InputImagePointer image,
+                                    const RegionType & slab ) const;
+
+  struct SubjectType
+    {
+    std::string                  FileName;
+    InputImagePointer            Image;
+    TransformPointer             Transform;
+    }; // End struct SubjectType
+
+  struct SlabThreadStruct
+    {
+    const AtlasSummation *           Summation;
+    RegionType                       Slab;
+    unsigned int                     FirstSubject;
+    std::vector< InputImagePointer > Images;
+    std::vector< InputImagePointer > Slabs;
+    }; // End struct SlabThreadStruct
+
+  /** Resample one subject of the batch in SlabThreadStruct */
+  static ITK_THREAD_RETURN_TYPE SlabThreaderCallback( void * arg );
+
   /** Median specific functions */
   MedianImageListType&  GetInputImageList( void ) { return m_MedianList; }
   void SetupImageList( InputImagePointer example );
@@ -249,6 +340,16 @@ private:
 
   RobustMeanBuilderType::Pointer m_MeanBuilder;
 
+  MeanImagePointer               m_MeanImage;
+  VarianceImagePointer           m_VarianceImage;
+  CountImageType::Pointer        m_CountImage;
+
+  /** Subjects queued for BuildAtlasBySlabs() */
+  std::vector< SubjectType >     m_Subjects;
+  unsigned int                   m_NumberOfOutlierImagesToRemove;
+  double                         m_MaximumSlabMemoryInMegabytes;
+  itk::ThreadIdType              m_NumberOfThreads;
+
   /** Median Image calculation variables */
   MedianImageListType            m_MedianList;
   InputPixelType                 m_MedianDefaultPixelValue;
@@ -22,6 +22,7 @@ limitations under the License.
 =========================================================================*/
 
 #include "tubeMessage.h"
+#include "tubeSparseAdjacencyMatrix.h"
 
 #include <itkVesselTubeSpatialObject.h>
 
@@ -56,34 +57,25 @@ int DoIt( int argc, char * argv[] )
   logMsg << "Reading file: " << filename;
   tube::InfoMessage( logMsg.str() );
 
-  readStream.open(filename.c_str(), std::ios::binary | std::ios::in);
-  readStream >> numberOfCentroids;
-  readStream.get();
+  // The connectivity matrices may be in dense text or compact binary form
+  typedef tube::SparseAdjacencyMatrix AdjacencyMatrixType;
+  AdjacencyMatrixType cMat;
+  if( !cMat.Read( filename ) )
+    {
+    tube::ErrorMessage( "Error: cannot read matrix " + filename );
+    return EXIT_FAILURE;
+    }
+  numberOfCentroids = cMat.GetNumberOfNodes();
 
-  vnl_matrix<double> cMat(numberOfCentroids, numberOfCentroids);
-  cMat.fill(0);
   vnl_vector<double> bVect(numberOfCentroids);
   bVect.fill(0);
 
-  vnl_matrix<double> meanCMat(numberOfCentroids, numberOfCentroids);
-  meanCMat.fill(0);
+  AdjacencyMatrixType meanCMat;
   vnl_vector<double> meanBVect(numberOfCentroids);
   meanBVect.fill(0);
   vnl_vector<double> meanCVect(numberOfCentroids);
   meanCVect.fill(0);
 
-  // Fill-up connectivity matrix
-  for(unsigned int i=0; i<numberOfCentroids; i++)
-    {
-    for(unsigned int j=0; j<numberOfCentroids; j++)
-      {
-      readStream >> tf;
-      readStream.get();
-      cMat[i][j] = tf;
-      }
-    }
-  readStream.close();
-
   unsigned int numberOfCentroids2;
 
   // Branch information
@@ -116,24 +108,17 @@ int DoIt( int argc, char * argv[] )
   logMsg << "Reading file: " << filename;
   tube::InfoMessage( logMsg.str() );
 
-  readStream.open(filename.c_str(), std::ios::binary | std::ios::in);
-  readStream >> numberOfCentroids2;
-  readStream.get();
-  if(numberOfCentroids != numberOfCentroids2)
+  if( !meanCMat.Read( filename ) )
     {
-    tube::ErrorMessage( "Error: fileList's #Centroids != mean matrix #Centroids" );
+    tube::ErrorMessage( "Error: cannot read matrix " + filename );
     return EXIT_FAILURE;
     }
-  for(unsigned int i=0; i<numberOfCentroids; i++)
+  numberOfCentroids2 = meanCMat.GetNumberOfNodes();
+  if(numberOfCentroids != numberOfCentroids2)
     {
-    for(unsigned int j=0; j<numberOfCentroids; j++)
-      {
-      readStream >> tf;
-      readStream.get();
-      meanCMat[i][j] = tf;
-      }
+    tube::ErrorMessage( "Error: fileList's #Centroids != mean matrix #Centroids" );
+    return EXIT_FAILURE;
     }
-  readStream.close();
 
   // MEAN branch file
   filename = meanGraphFile + ".brc";
@@ -194,12 +179,14 @@ int DoIt( int argc, char * argv[] )
   for( unsigned int i=0; i < numberOfCentroids; i++ )
     {
     bool used = false;
-    for( unsigned int j = 0; j < numberOfCentroids; j++ )
+    for( AdjacencyMatrixType::EdgeIdType k = cMat.GetRowBegin( i );
+      k < cMat.GetRowEnd( i ); k++ )
       {
       // (i,j) connected
-      if( cMat[i][j] > 0 )
+      if( cMat.GetValue( k ) > 0 )
         {
-        writeMatStream << meanCMat[i][j] << std::endl;
+        writeMatStream << meanCMat.GetValue( i, cMat.GetColumn( k ) )
+          << std::endl;
         used = true;
         }
       }
@@ -21,8 +21,7 @@ limitations under the License.
 
 =========================================================================*/
 
-#include "tubeShortestPathKernel.h"
-#include "tubeWLSubtreeKernel.h"
+#include "tubeGraphKernelMatrix.h"
 
 #include <boost/filesystem.hpp>
 
@@ -30,8 +29,6 @@ limitations under the License.
 
 #include "ComputeTubeGraphSimilarityKernelMatrixCLP.h"
 
-enum { GK_SPKernel = 0, GK_WLKernel = 1 };
-
 /** Read-in a list of graphs from a list.
  *  Reads a list of input graphs from JSON file 'fileName' and stores the full
  *  path's the the graph files in 'list', as well as the label (i.e., class
@@ -276,8 +273,8 @@ int main( int argc, char * argv[] )
     {
     switch( argGraphKernelType )
       {
-      case GK_WLKernel:
-      case GK_SPKernel:
+      case tube::GK_WLKernel:
+      case tube::GK_SPKernel:
         break;
       default:
         tube::ErrorMessage("Unsupported kernel!");
@@ -326,19 +323,42 @@ int main( int argc, char * argv[] )
     tube::GraphKernel::DefaultNodeLabelingType defLabelType =
       static_cast<tube::GraphKernel::DefaultNodeLabelingType>( argDefaultLabelType );
 
+    /*
+     * Every graph is loaded once. If both lists are the same, the
+     * kernel matrix is symmetric and the graphs of 'listA' are reused.
+     */
+
+    const bool symmetric = ( listA == listB );
+
+    std::vector< tube::GraphKernel::GraphType > graphsA( N );
+    std::vector< tube::GraphKernel::GraphType > graphsB;
+    for( int i = 0; i < N; ++i )
+      {
+      graphsA[i] = loadGraph( listA[i], defLabelType,
+                              argGlobalLabelFileName );
+      }
+    if( !symmetric )
+      {
+      graphsB.resize( M );
+      for( int j = 0; j < M; ++j )
+        {
+        graphsB[j] = loadGraph( listB[j], defLabelType,
+                                argGlobalLabelFileName );
+        }
+      }
+
     tube::WLSubtreeKernel::LabelMapVectorType labelMap( argSubtreeHeight );
     int labelCount = 0;
 
-    if( argGraphKernelType == GK_WLKernel )
+    if( argGraphKernelType == tube::GK_WLKernel )
       {
       for( int i = 0; i < N; ++i )
         {
         tube::FmtInfoMessage("Adding data from graph %s",
           listA[i].c_str());
 
-        tube::GraphKernel::GraphType f = loadGraph( listA[i],
-                                                    defLabelType,
-                                                    argGlobalLabelFileName );
+        // The label compression relabels the graph, keep the loaded one
+        tube::GraphKernel::GraphType f = graphsA[i];
         tube::WLSubtreeKernel::UpdateLabelCompression( f,
                                                        labelMap,
                                                        labelCount,
@@ -349,50 +369,18 @@ int main( int argc, char * argv[] )
 
     /*
      * Next, we build the kernel matrix K, where the K_ij-th entry
-     * is the WL kernel value between the i-th graph of the first
+     * is the kernel value between the i-th graph of the first
      * (i.e., 'listA') list and the j-th graph of the second list
      * (i.e., 'listB').
      */
 
-    for( int i = 0; i < N; ++i )
-      {
-      tube::GraphKernel::GraphType f = loadGraph( listA[i],
-                                                  defLabelType,
-                                                  argGlobalLabelFileName );
-      for( int j = 0; j < M; ++j )
-        {
-        tube::GraphKernel::GraphType g = loadGraph( listB[j],
-                                                    defLabelType,
-                                                    argGlobalLabelFileName );
-
-        tube::FmtInfoMessage("Running kernel on graphs (%d,%d)",
-          i,j);
-
-        tube::GraphKernel *gk = 0;
-        switch( argGraphKernelType )
-          {
-          case GK_SPKernel:
-            {
-            gk = new tube::ShortestPathKernel(f, g);
-            K[i][j] = gk->Compute();
-            delete gk;
-            break;
-            }
-          case GK_WLKernel:
-            {
-            gk = new tube::WLSubtreeKernel( f,
-                                            g,
-                                            labelMap,
-                                            labelCount,
-                                            argSubtreeHeight );
-
-            K[i][j] = gk->Compute();
-            delete gk;
-            break;
-            }
-          }
-        }
-      }
+    tube::FmtInfoMessage( "Running kernel on %d x %d graphs",
+      N, M );
+
+    tube::ComputeGraphKernelMatrix( argGraphKernelType, graphsA,
+                                    symmetric ? NULL : &graphsB,
+                                    labelMap, labelCount,
+                                    argSubtreeHeight, K );
 
     /*
      * Eventually, dump the kernel to disk - 1) in LIBSVM comp.
@@ -0,0 +1,222 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright 2010 Kitware Inc. 28 Corporate Drive,
+Clifton Park, NY, 12065, USA.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "tubeGraphKernelMatrix.h"
+
+#include <itkMersenneTwisterRandomVariateGenerator.h>
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace
+{
+
+typedef tube::GraphKernel::GraphType                    GraphType;
+typedef std::vector< GraphType >                        GraphListType;
+typedef itk::Statistics::MersenneTwisterRandomVariateGenerator
+                                                        RandGenType;
+
+/** Random graph with a few labels and unit edge weights, not always
+ *  connected */
+GraphType CreateGraph( RandGenType * rndGen )
+{
+  const int nVertices = 2 + rndGen->GetIntegerVariate( 6 );
+  GraphType g( nVertices );
+  for( int i = 0; i < nVertices; ++i )
+    {
+    g[boost::vertex( i, g )].type = rndGen->GetIntegerVariate( 3 );
+    }
+  for( int i = 1; i < nVertices; ++i )
+    {
+    for( int j = 0; j < i; ++j )
+      {
+      if( rndGen->GetUniformVariate( 0, 1 ) < 0.4 )
+        {
+        boost::add_edge( i, j, 1.0, g );
+        }
+      }
+    }
+  return g;
+}
+
+/** SP kernel with the delta edge kernel, one pair of shortest paths at a
+ *  time, see tube::ShortestPathKernel */
+double ComputeShortestPathKernel( const GraphType & g0,
+  const GraphType & g1 )
+{
+  const int n0 = boost::num_vertices( g0 );
+  const int n1 = boost::num_vertices( g1 );
+  tube::GraphKernel::DistanceMatrixType d0( n0 );
+  tube::GraphKernel::DistanceMatrixMapType dm0( d0, g0 );
+  boost::floyd_warshall_all_pairs_shortest_paths( g0, dm0 );
+  tube::GraphKernel::DistanceMatrixType d1( n1 );
+  tube::GraphKernel::DistanceMatrixMapType dm1( d1, g1 );
+  boost::floyd_warshall_all_pairs_shortest_paths( g1, dm1 );
+
+  const double inf = std::numeric_limits< double >::max();
+  double kernelValue = 0.0;
+  for( int i0 = 0; i0 < n0; ++i0 )
+    {
+    for( int j0 = 0; j0 <= i0; ++j0 )
+      {
+      if( dm0[i0][j0] == inf )
+        {
+        continue;
+        }
+      int src0 = g0[boost::vertex( i0, g0 )].type;
+      int dst0 = g0[boost::vertex( j0, g0 )].type;
+      for( int i1 = 0; i1 < n1; ++i1 )
+        {
+        for( int j1 = 0; j1 <= i1; ++j1 )
+          {
+          if( dm1[i1][j1] != dm0[i0][j0] )
+            {
+            continue;
+            }
+          int src1 = g1[boost::vertex( i1, g1 )].type;
+          int dst1 = g1[boost::vertex( j1, g1 )].type;
+          if( ( src0 == src1 && dst0 == dst1 )
+            || ( src0 == dst1 && dst0 == src1 ) )
+            {
+            kernelValue += 1.0;
+            }
+          }
+        }
+      }
+    }
+  return kernelValue;
+}
+
+/** Compares K with the kernel objects run on every pair of graphs and,
+ *  for the SP kernel, with the pairwise computation above */
+int CompareKernelMatrix( int graphKernelType, const GraphListType & graphsA,
+  const GraphListType & graphsB,
+  const tube::WLSubtreeKernel::LabelMapVectorType & labelMap,
+  int labelCount, int subtreeHeight, const vnl_matrix< double > & K )
+{
+  int failures = 0;
+  if( K.rows() != graphsA.size() || K.cols() != graphsB.size() )
+    {
+    tube::ErrorMessage( "Wrong kernel matrix size" );
+    return 1;
+    }
+  for( unsigned int i = 0; i < graphsA.size(); ++i )
+    {
+    for( unsigned int j = 0; j < graphsB.size(); ++j )
+      {
+      double expected = 0.0;
+      if( graphKernelType == tube::GK_SPKernel )
+        {
+        tube::ShortestPathKernel gk( graphsA[i], graphsB[j] );
+        expected = gk.Compute();
+        double reference =
+          ComputeShortestPathKernel( graphsA[i], graphsB[j] );
+        if( expected != reference )
+          {
+          tube::FmtErrorMessage( "SP kernel of (%d,%d) is %g, not %g",
+            i, j, expected, reference );
+          ++failures;
+          }
+        }
+      else
+        {
+        tube::WLSubtreeKernel gk( graphsA[i], graphsB[j], labelMap,
+          labelCount, subtreeHeight );
+        expected = gk.Compute();
+        }
+      if( std::fabs( K[i][j] - expected ) > 1e-9 )
+        {
+        tube::FmtErrorMessage( "K(%d,%d) is %g, not %g", i, j, K[i][j],
+          expected );
+        ++failures;
+        }
+      }
+    }
+  return failures;
+}
+
+} // End namespace
+
+int tubeGraphKernelMatrixTest( int argc, char * argv[] )
+{
+  if( argc > 1 )
+    {
+    tube::FmtErrorMessage( "Usage: %s", argv[0] );
+    return EXIT_FAILURE;
+    }
+
+  RandGenType::Pointer rndGen = RandGenType::New();
+  rndGen->Initialize( 1234 );
+
+  // More graphs than a tile of the kernel matrix holds
+  GraphListType graphsA;
+  for( int i = 0; i < 37; ++i )
+    {
+    graphsA.push_back( CreateGraph( rndGen ) );
+    }
+  GraphListType graphsB;
+  for( int i = 0; i < 5; ++i )
+    {
+    graphsB.push_back( CreateGraph( rndGen ) );
+    }
+
+  const int subtreeHeight = 3;
+  tube::WLSubtreeKernel::LabelMapVectorType labelMap( subtreeHeight );
+  int labelCount = 0;
+  for( unsigned int i = 0; i < graphsA.size(); ++i )
+    {
+    GraphType g = graphsA[i];
+    tube::WLSubtreeKernel::UpdateLabelCompression( g, labelMap,
+      labelCount, subtreeHeight );
+    }
+
+  int failures = 0;
+  const int kernelTypes[] = { tube::GK_SPKernel, tube::GK_WLKernel };
+  for( int k = 0; k < 2; ++k )
+    {
+    // The kernel matrix relabels the graphs for the WL kernel
+    GraphListType a = graphsA;
+    GraphListType b = graphsB;
+    vnl_matrix< double > K;
+
+    tube::ComputeGraphKernelMatrix( kernelTypes[k], a, NULL, labelMap,
+      labelCount, subtreeHeight, K );
+    failures += CompareKernelMatrix( kernelTypes[k], graphsA, graphsA,
+      labelMap, labelCount, subtreeHeight, K );
+
+    a = graphsA;
+    tube::ComputeGraphKernelMatrix( kernelTypes[k], a, &b, labelMap,
+      labelCount, subtreeHeight, K );
+    failures += CompareKernelMatrix( kernelTypes[k], graphsA, graphsB,
+      labelMap, labelCount, subtreeHeight, K );
+    }
+
+  if( failures > 0 )
+    {
+    tube::FmtErrorMessage( "%d kernel values differ", failures );
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
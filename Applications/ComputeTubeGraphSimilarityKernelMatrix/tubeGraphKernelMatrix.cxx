@@ -0,0 +1,232 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright 2010 Kitware Inc. 28 Corporate Drive,
+Clifton Park, NY, 12065, USA.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "tubeGraphKernelMatrix.h"
+
+#include <itkMultiThreader.h>
+
+#include <algorithm>
+#include <utility>
+
+namespace tube
+{
+
+namespace
+{
+
+/** Side length of the square tiles of the kernel matrix that are handed
+ *  out to the threads */
+const int KernelMatrixTileSize = 32;
+
+typedef ShortestPathKernel::EdgeHistogramType  EdgeHistogramType;
+typedef std::vector< int >                     FeatureVectorType;
+
+/** Per-graph features of a list of graphs */
+struct GraphFeaturesThreadStruct
+  {
+  int                                         GraphKernelType;
+  std::vector< GraphKernel::GraphType >     * Graphs;
+  const WLSubtreeKernel::LabelMapVectorType * LabelMap;
+  int                                         LabelCount;
+  int                                         SubtreeHeight;
+  std::vector< EdgeHistogramType >          * EdgeHistograms;
+  std::vector< FeatureVectorType >          * FeatureVectors;
+  }; // End struct GraphFeaturesThreadStruct
+
+/** Kernel matrix entries from the per-graph features of both lists */
+struct KernelMatrixThreadStruct
+  {
+  int                                       GraphKernelType;
+  const std::vector< EdgeHistogramType >  * EdgeHistogramsA;
+  const std::vector< EdgeHistogramType >  * EdgeHistogramsB;
+  const std::vector< FeatureVectorType >  * FeatureVectorsA;
+  const std::vector< FeatureVectorType >  * FeatureVectorsB;
+  std::vector< std::pair< int, int > >      Tiles;
+  bool                                      Symmetric;
+  vnl_matrix< double >                    * K;
+  }; // End struct KernelMatrixThreadStruct
+
+/** Computes the features of the graphs assigned to one thread.  Graphs
+ *  are handed out round-robin since their sizes vary. */
+ITK_THREAD_RETURN_TYPE GraphFeaturesThreaderCallback( void * arg )
+{
+  itk::MultiThreader::ThreadInfoStruct * info =
+    static_cast< itk::MultiThreader::ThreadInfoStruct * >( arg );
+  GraphFeaturesThreadStruct * str =
+    static_cast< GraphFeaturesThreadStruct * >( info->UserData );
+
+  const int nGraphs = str->Graphs->size();
+  for( int g = info->ThreadID; g < nGraphs;
+       g += info->NumberOfThreads )
+    {
+    switch( str->GraphKernelType )
+      {
+      case GK_SPKernel:
+        ( *str->EdgeHistograms )[g] =
+          ShortestPathKernel::ComputeEdgeHistogram(
+            ( *str->Graphs )[g] );
+        break;
+      case GK_WLKernel:
+        ( *str->FeatureVectors )[g] =
+          WLSubtreeKernel::ComputeFeatureVector( ( *str->Graphs )[g],
+            *str->LabelMap, str->LabelCount, str->SubtreeHeight );
+        break;
+      }
+    }
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+/** Fills the kernel matrix tiles assigned to one thread.  Every entry
+ *  only depends on the features of its two graphs, so the result does not
+ *  depend on the number of threads.  For a symmetric matrix only the
+ *  entries on and above the diagonal are computed. */
+ITK_THREAD_RETURN_TYPE KernelMatrixThreaderCallback( void * arg )
+{
+  itk::MultiThreader::ThreadInfoStruct * info =
+    static_cast< itk::MultiThreader::ThreadInfoStruct * >( arg );
+  KernelMatrixThreadStruct * str =
+    static_cast< KernelMatrixThreadStruct * >( info->UserData );
+
+  vnl_matrix< double > & K = *str->K;
+  const int N = K.rows();
+  const int M = K.cols();
+  const int nTiles = str->Tiles.size();
+  for( int t = info->ThreadID; t < nTiles; t += info->NumberOfThreads )
+    {
+    const int iBegin = str->Tiles[t].first * KernelMatrixTileSize;
+    const int iEnd = std::min( iBegin + KernelMatrixTileSize, N );
+    const int jBegin = str->Tiles[t].second * KernelMatrixTileSize;
+    const int jEnd = std::min( jBegin + KernelMatrixTileSize, M );
+    for( int i = iBegin; i < iEnd; ++i )
+      {
+      for( int j = ( str->Symmetric ? std::max( i, jBegin ) : jBegin );
+           j < jEnd; ++j )
+        {
+        switch( str->GraphKernelType )
+          {
+          case GK_SPKernel:
+            K[i][j] = ShortestPathKernel::Compute(
+              ( *str->EdgeHistogramsA )[i], ( *str->EdgeHistogramsB )[j] );
+            break;
+          case GK_WLKernel:
+            K[i][j] = WLSubtreeKernel::Compute(
+              ( *str->FeatureVectorsA )[i], ( *str->FeatureVectorsB )[j] );
+            break;
+          }
+        }
+      }
+    }
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+} // End namespace
+
+
+//-----------------------------------------------------------------------------
+void ComputeGraphKernelMatrix( int graphKernelType,
+  std::vector< GraphKernel::GraphType > & graphsA,
+  std::vector< GraphKernel::GraphType > * graphsB,
+  const WLSubtreeKernel::LabelMapVectorType & labelMap,
+  int labelCount,
+  int subtreeHeight,
+  vnl_matrix< double > & K )
+{
+  const bool symmetric = ( graphsB == NULL );
+  const int N = graphsA.size();
+  const int M = symmetric ? N : graphsB->size();
+
+  K.set_size( N, M );
+  K.fill( 0.0 );
+
+  itk::MultiThreader::Pointer threader = itk::MultiThreader::New();
+
+  std::vector< EdgeHistogramType > edgeHistogramsA, edgeHistogramsB;
+  std::vector< FeatureVectorType > featureVectorsA, featureVectorsB;
+
+  GraphFeaturesThreadStruct featuresStr;
+  featuresStr.GraphKernelType = graphKernelType;
+  featuresStr.LabelMap = &labelMap;
+  featuresStr.LabelCount = labelCount;
+  featuresStr.SubtreeHeight = subtreeHeight;
+
+  edgeHistogramsA.resize( graphKernelType == GK_SPKernel ? N : 0 );
+  featureVectorsA.resize( graphKernelType == GK_WLKernel ? N : 0 );
+  featuresStr.Graphs = &graphsA;
+  featuresStr.EdgeHistograms = &edgeHistogramsA;
+  featuresStr.FeatureVectors = &featureVectorsA;
+  threader->SetSingleMethod( GraphFeaturesThreaderCallback, &featuresStr );
+  threader->SingleMethodExecute();
+
+  if( !symmetric )
+    {
+    edgeHistogramsB.resize( graphKernelType == GK_SPKernel ? M : 0 );
+    featureVectorsB.resize( graphKernelType == GK_WLKernel ? M : 0 );
+    featuresStr.Graphs = graphsB;
+    featuresStr.EdgeHistograms = &edgeHistogramsB;
+    featuresStr.FeatureVectors = &featureVectorsB;
+    threader->SetSingleMethod( GraphFeaturesThreaderCallback,
+                               &featuresStr );
+    threader->SingleMethodExecute();
+    }
+
+  KernelMatrixThreadStruct kernelStr;
+  kernelStr.GraphKernelType = graphKernelType;
+  kernelStr.EdgeHistogramsA = &edgeHistogramsA;
+  kernelStr.EdgeHistogramsB =
+    symmetric ? &edgeHistogramsA : &edgeHistogramsB;
+  kernelStr.FeatureVectorsA = &featureVectorsA;
+  kernelStr.FeatureVectorsB =
+    symmetric ? &featureVectorsA : &featureVectorsB;
+  kernelStr.Symmetric = symmetric;
+  kernelStr.K = &K;
+
+  const int nTileRows =
+    ( N + KernelMatrixTileSize - 1 ) / KernelMatrixTileSize;
+  const int nTileCols =
+    ( M + KernelMatrixTileSize - 1 ) / KernelMatrixTileSize;
+  for( int ti = 0; ti < nTileRows; ++ti )
+    {
+    for( int tj = ( symmetric ? ti : 0 ); tj < nTileCols; ++tj )
+      {
+      kernelStr.Tiles.push_back( std::make_pair( ti, tj ) );
+      }
+    }
+
+  threader->SetSingleMethod( KernelMatrixThreaderCallback, &kernelStr );
+  threader->SingleMethodExecute();
+
+  if( symmetric )
+    {
+    for( int i = 0; i < N; ++i )
+      {
+      for( int j = 0; j < i; ++j )
+        {
+        K[i][j] = K[j][i];
+        }
+      }
+    }
+}
+
+} // End namespace tube
@@ -0,0 +1,61 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright 2010 Kitware Inc. 28 Corporate Drive,
+Clifton Park, NY, 12065, USA.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#ifndef __tubeGraphKernelMatrix_h
+#define __tubeGraphKernelMatrix_h
+
+#include "tubeShortestPathKernel.h"
+#include "tubeWLSubtreeKernel.h"
+
+#include <vnl/vnl_matrix.h>
+
+#include <vector>
+
+namespace tube
+{
+
+/** Graph kernel types */
+enum { GK_SPKernel = 0, GK_WLKernel = 1 };
+
+/**
+ * Computes the kernel matrix K, where K_ij is the kernel value between the
+ * i-th graph of 'graphsA' and the j-th graph of 'graphsB'.  If 'graphsB'
+ * is NULL, K is the symmetric matrix of 'graphsA' with itself.
+ *
+ * The kernel values of a pair only depend on per-graph features (the edge
+ * histogram of the Floyd transform for the SP kernel, the feature mapping
+ * phi for the WL kernel), so these are computed once per graph, and the
+ * matrix is then filled in tiles.  Both steps run in parallel.  The WL
+ * kernel relabels the vertex types of the graphs.
+ */
+void ComputeGraphKernelMatrix( int graphKernelType,
+  std::vector< GraphKernel::GraphType > & graphsA,
+  std::vector< GraphKernel::GraphType > * graphsB,
+  const WLSubtreeKernel::LabelMapVectorType & labelMap,
+  int labelCount,
+  int subtreeHeight,
+  vnl_matrix< double > & K );
+
+} // End namespace tube
+
+#endif // End !defined(__tubeGraphKernelMatrix_h)
@@ -80,83 +80,75 @@ ShortestPathKernel::FloydTransform(const GraphType &in)
 
 
 //-----------------------------------------------------------------------------
-double ShortestPathKernel::Compute( void )
+ShortestPathKernel::EdgeHistogramType
+ShortestPathKernel::ComputeEdgeHistogram( const GraphType & g )
 {
-  double kernelValue = 0.0;
-  long int cntEdgeEvaluations = 0;
+  tube::FmtDebugMessage( "Computing Floyd transform." );
+  GraphType fg = FloydTransform( g );
+
+  EdgeWeightMapType wmFG = boost::get( boost::edge_weight, fg );
+
+  EdgeHistogramType histogram;
   EdgeIteratorType aIt, aEnd;
+  for( tie( aIt, aEnd ) = edges( fg ); aIt != aEnd; ++aIt )
+    {
+    const EdgeDescriptorType &e = *aIt;
 
-  tube::FmtDebugMessage( "Computing Floyd transform." );
-  m_FG0 = FloydTransform( m_G0 );
-  m_FG1 = FloydTransform( m_G1 );
+    EdgeKeyType key;
+    key.SrcLabel = fg[source(e, fg)].type; // Type of start vertex
+    key.DstLabel = fg[target(e, fg)].type; // Type of end vertex
+    ensureOrder( key.SrcLabel, key.DstLabel );
+    key.Weight = wmFG[*aIt];
 
+    histogram[key] += 1.0;
+    }
 
-  // Get the weight maps for both Floyd-transformed graphs
-  EdgeWeightMapType wmFG0 = boost::get( boost::edge_weight, m_FG0 );
-  EdgeWeightMapType wmFG1 = boost::get( boost::edge_weight, m_FG1 );
+  return histogram;
+}
 
-  // Iterate over all the edges of Floyd-transformed graph fg0
-  for( tie( aIt, aEnd ) = edges( m_FG0 ); aIt != aEnd; ++aIt )
-    {
-    const EdgeDescriptorType &e0 = *aIt;
 
-    int srcLabel = m_FG0[source(e0, m_FG0)].type; // Type of start vertex
-    int dstLabel = m_FG0[target(e0, m_FG0)].type; // Type of end vertex
-    ensureOrder( srcLabel, dstLabel );
+//-----------------------------------------------------------------------------
+double ShortestPathKernel::Compute( const EdgeHistogramType & h0,
+                                    const EdgeHistogramType & h1 )
+{
+  double kernelValue = 0.0;
 
-    // Iterate over all the edges of Floyd-transformed graph fg1
-    EdgeIteratorType bIt, bEnd;
-    for( tie( bIt, bEnd ) = edges( m_FG1 ); bIt != bEnd; ++bIt )
+  // With the delta edge kernel, every pair of edges of equal length and
+  // equal end-vertex labels contributes 1, so matching histogram bins
+  // contribute the product of their counts.  We only consider walks of
+  // equal length --- At this point we only support weights of 1, since
+  // this gives integer lengths of the shortest paths and makes it easy to
+  // check for equality.
+  EdgeHistogramType::const_iterator it0 = h0.begin();
+  EdgeHistogramType::const_iterator it1 = h1.begin();
+  while( it0 != h0.end() && it1 != h1.end() )
+    {
+    if( it0->first < it1->first )
       {
-      cntEdgeEvaluations++;
-      const EdgeDescriptorType &e1 = *bIt;
-
-      // We only consider walks of equal length --- At this point we
-      // only support weights of 1, since this gives integer lengths
-      // of the shortest paths and makes it easy to check for equality.
-      //
-      // We could also use a Brownian bridge kernel to bound the max.
-      // shortest-path length, e.g., max(0,c - |len(e)-len(e')|)
-
-      double weightE0 = wmFG0[*aIt];
-      double weightE1 = wmFG1[*bIt];
-
-      // Skip edges, unless the weights are equal
-      if( !( vnl_math_abs(weightE0 - weightE1) <
-          std::numeric_limits<double>::epsilon() ) )
-        {
-        continue;
-        }
-
-      double edgeKernelValue = 0.0;
-      switch( m_EdgeKernelType )
-        {
-        case EDGE_KERNEL_DEL:
-          int cmpSrcLabel = m_FG1[source(e1, m_FG1)].type;
-          int cmpDstLabel = m_FG1[target(e1, m_FG1)].type;
-          ensureOrder( cmpSrcLabel, cmpDstLabel );
-
-          bool vertexTypeCheck =
-            ( srcLabel == cmpSrcLabel ) &&
-            ( dstLabel == cmpDstLabel );
-          if( !vertexTypeCheck )
-            {
-            continue;
-            }
-          else
-            {
-            edgeKernelValue = 1.0;
-            }
-          break;
-        }
-      kernelValue += edgeKernelValue;
+      ++it0;
+      }
+    else if( it1->first < it0->first )
+      {
+      ++it1;
+      }
+    else
+      {
+      kernelValue += it0->second * it1->second;
+      ++it0;
+      ++it1;
       }
     }
 
-  tube::FmtInfoMessage("Performed %ld edge evaluations",
-    cntEdgeEvaluations);
   return kernelValue;
 }
 
 
+//-----------------------------------------------------------------------------
+double ShortestPathKernel::Compute( void )
+{
+  return Compute( ComputeEdgeHistogram( m_G0 ),
+                  ComputeEdgeHistogram( m_G1 ) );
+}
+
+
 } // End namespace tube
@@ -27,6 +27,7 @@ limitations under the License.
 #include "GraphKernel.h"
 
 #include <algorithm>
+#include <map>
 
 namespace tube
 {
@@ -58,15 +59,48 @@ public:
     m_EdgeKernelType = edgeKernelType;
     }
 
+  /** An edge of a Floyd-transformed graph, up to the order of its end
+   *  vertices: their labels (smallest first) and its length */
+  struct EdgeKeyType
+    {
+    int    SrcLabel;
+    int    DstLabel;
+    double Weight;
+
+    bool operator<( const EdgeKeyType & key ) const
+      {
+      if( SrcLabel != key.SrcLabel )
+        {
+        return SrcLabel < key.SrcLabel;
+        }
+      if( DstLabel != key.DstLabel )
+        {
+        return DstLabel < key.DstLabel;
+        }
+      return Weight < key.Weight;
+      }
+    }; // End struct EdgeKeyType
+
+  /** Number of edges of a Floyd-transformed graph per edge key */
+  typedef std::map< EdgeKeyType, double >  EdgeHistogramType;
+
+  /** Computes the edge histogram of the Floyd transform of a graph */
+  static EdgeHistogramType ComputeEdgeHistogram( const GraphType & g );
+
+  /** Computes the SP kernel value with the delta edge kernel from the edge
+   *  histograms of two graphs */
+  static double Compute( const EdgeHistogramType & h0,
+                         const EdgeHistogramType & h1 );
+
   /** Computes the SP kernel value, see [1], Section 4.2 */
   double Compute( void );
 
 private:
 
   /** Computes a Floyd-transformed graph, see [1], Section 4.1 */
-  GraphType FloydTransform( const GraphType & in );
+  static GraphType FloydTransform( const GraphType & in );
 
-  void ensureOrder( int & first, int & second )
+  static void ensureOrder( int & first, int & second )
     {
     if( first > second )
       {
@@ -74,9 +108,6 @@ private:
       }
     }
 
-  /** Floyd-transformed graphs */
-  GraphType  m_FG0;
-  GraphType  m_FG1;
   int        m_EdgeKernelType;
 
 }; // End class ShortestPathKernel
@@ -88,7 +88,14 @@ void WLSubtreeKernel::UpdateLabelCompression( GraphType & G,
 
 std::vector< int > WLSubtreeKernel::BuildPhi( GraphType & G )
 {
-  std::vector< int > phi( m_LabelCount, 0 );
+  return ComputeFeatureVector( G, m_LabelMap, m_LabelCount,
+                               m_SubtreeHeight );
+}
+
+std::vector< int > WLSubtreeKernel::ComputeFeatureVector( GraphType & G,
+  const LabelMapVectorType & labelMap, int labelCount, int subtreeHeight )
+{
+  std::vector< int > phi( labelCount, 0 );
   const int N = num_vertices( G );
 
   for( int i = 0; i < N; ++i )
@@ -96,8 +103,8 @@ std::vector< int > WLSubtreeKernel::BuildPhi( GraphType & G )
     const int height = 0;
     const int type = G[vertex( i, G )].type;
     LabelMapType::const_iterator it
-      = m_LabelMap[height].find( boost::lexical_cast< std::string >( type ) );
-    if( it != m_LabelMap[height].end() )
+      = labelMap[height].find( boost::lexical_cast< std::string >( type ) );
+    if( it != labelMap[height].end() )
       {
       const int cLab = it->second;
       G[vertex( i, G )].type = cLab;
@@ -105,14 +112,14 @@ std::vector< int > WLSubtreeKernel::BuildPhi( GraphType & G )
       }
     }
 
-  for( int height = 1; height < m_SubtreeHeight; ++height )
+  for( int height = 1; height < subtreeHeight; ++height )
     {
     std::vector< int > relabel( N, -1 );
     for( int i = 0; i < N; ++i )
       {
       const std::string nbStr = BuildNeighborStr( G, i );
-      LabelMapType::const_iterator it = m_LabelMap[height].find( nbStr );
-      if( it != m_LabelMap[height].end() )
+      LabelMapType::const_iterator it = labelMap[height].find( nbStr );
+      if( it != labelMap[height].end() )
         {
         const int cLab = it->second;
         relabel[i] = cLab;
@@ -135,6 +142,12 @@ double WLSubtreeKernel::Compute( void )
   const std::vector< int > phiG0 = this->BuildPhi( m_G0 );
   const std::vector< int > phiG1 = this->BuildPhi( m_G1 );
 
+  return Compute( phiG0, phiG1 );
+}
+
+double WLSubtreeKernel::Compute( const std::vector< int > & phiG0,
+                                 const std::vector< int > & phiG1 )
+{
   if( phiG0.size() != phiG1.size() )
     {
     tube::ErrorMessage( "Mismatch in feature mapping." );
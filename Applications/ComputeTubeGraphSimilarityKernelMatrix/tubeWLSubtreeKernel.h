@@ -77,6 +77,20 @@ public:
   /** Compute the WLSubtree kernel */
   double Compute( void );
 
+  /**
+   * Take a graph 'G' and use the label map information and the number of
+   * compressed labels per subtree level to compute a feature mapping phi
+   * for the graph, see [1].  The vertex types of 'G' are relabeled.
+   */
+  static std::vector<int> ComputeFeatureVector( GraphType &G,
+                             const LabelMapVectorType & labelMap,
+                             int labelCount,
+                             int subtreeHeight );
+
+  /** Compute the WLSubtree kernel from the feature mappings of two graphs */
+  static double Compute( const std::vector<int> & phiG0,
+                         const std::vector<int> & phiG1 );
+
   /**
    * Take graph information and update
    *
@@ -25,31 +25,18 @@
 #include "tubeMacro.h"
 #include "tubeMessage.h"
 #include "tubeCLIProgressReporter.h"
-#include "itktubeTortuositySpatialObjectFilter.h"
+#include "itktubeTortuosityTubeTreeSpatialObjectFilter.h"
 #include "tubeTubeMath.h"
 
 // ITK INCLUDES
 #include "itkTimeProbesCollectorBase.h"
 #include "itkSpatialObjectReader.h"
-#include "itkSpatialObjectWriter.h"
 #include "itkGroupSpatialObject.h"
 #include "itkVesselTubeSpatialObject.h"
 #include "metaScene.h"
 
-// VTK INCLUDES
-#include "vtkNew.h"
-#include "vtkTable.h"
-#include "vtkVersion.h"
-#include "vtkIntArray.h"
-#include "vtkDoubleArray.h"
-#include "vtkSmartPointer.h"
-#include "vtkDelimitedTextWriter.h"
-
 // std includes
-#include <sstream>
-#include <string.h>
-#include <vector>
-#include <map>
+#include <fstream>
 #include <string>
 
 #include "ComputeTubeTortuosityMeasuresCLP.h"
@@ -75,10 +62,11 @@ int DoIt( int argc, char * argv[] )
   typedef itk::VesselTubeSpatialObject< VDimension >  TubeType;
   typedef itk::SpatialObjectReader< VDimension >      TubesReaderType;
   typedef itk::GroupSpatialObject< VDimension >       TubeGroupType;
-  typedef typename TubeGroupType::ChildrenListPointer TubeListPointerType;
 
-  typedef itk::tube::TortuositySpatialObjectFilter< TubeType >
-    TortuosityFilterType;
+  typedef itk::tube::TortuosityTubeTreeSpatialObjectFilter< TubeGroupType,
+    TubeType >                                        TortuosityFilterType;
+  typedef typename TortuosityFilterType::TortuosityFilterType
+    TubeTortuosityFilterType;
 
   // Load TRE File
   tubeStandardOutputMacro( << "\n>> Loading TRE File" );
@@ -129,239 +117,62 @@ int DoIt( int argc, char * argv[] )
   if( basicMetrics )
     {
     metricFlag = metricFlag
-                 | TortuosityFilterType::AVERAGE_RADIUS_METRIC
-                 | TortuosityFilterType::CHORD_LENGTH_METRIC
-                 | TortuosityFilterType::PATH_LENGTH_METRIC;
+                 | TubeTortuosityFilterType::AVERAGE_RADIUS_METRIC
+                 | TubeTortuosityFilterType::CHORD_LENGTH_METRIC
+                 | TubeTortuosityFilterType::PATH_LENGTH_METRIC;
     }
 
   if( oldMetrics )
     {
     metricFlag = metricFlag
-                 | TortuosityFilterType::DISTANCE_METRIC
-                 | TortuosityFilterType::INFLECTION_COUNT_METRIC
-                 | TortuosityFilterType::INFLECTION_POINTS_METRIC
-                 | TortuosityFilterType::SUM_OF_ANGLES_METRIC;
+                 | TubeTortuosityFilterType::DISTANCE_METRIC
+                 | TubeTortuosityFilterType::INFLECTION_COUNT_METRIC
+                 | TubeTortuosityFilterType::INFLECTION_POINTS_METRIC
+                 | TubeTortuosityFilterType::SUM_OF_ANGLES_METRIC;
     }
 
   if( curvatureMetrics )
     {
     metricFlag = metricFlag
-                 | TortuosityFilterType::INFLECTION_COUNT_1_METRIC
-                 | TortuosityFilterType::INFLECTION_COUNT_2_METRIC
-                 | TortuosityFilterType::PERCENTILE_95_METRIC
-                 | TortuosityFilterType::TOTAL_CURVATURE_METRIC
-                 | TortuosityFilterType::TOTAL_SQUARED_CURVATURE_METRIC
-                 | TortuosityFilterType::CURVATURE_SCALAR_METRIC
-                 | TortuosityFilterType::CURVATURE_VECTOR_METRIC;
+                 | TubeTortuosityFilterType::INFLECTION_COUNT_1_METRIC
+                 | TubeTortuosityFilterType::INFLECTION_COUNT_2_METRIC
+                 | TubeTortuosityFilterType::PERCENTILE_95_METRIC
+                 | TubeTortuosityFilterType::TOTAL_CURVATURE_METRIC
+                 | TubeTortuosityFilterType::TOTAL_SQUARED_CURVATURE_METRIC
+                 | TubeTortuosityFilterType::CURVATURE_SCALAR_METRIC
+                 | TubeTortuosityFilterType::CURVATURE_VECTOR_METRIC;
     }
 
   if( histogramMetrics )
     {
-    metricFlag |= TortuosityFilterType::CURVATURE_HISTOGRAM_METRICS;
+    metricFlag |= TubeTortuosityFilterType::CURVATURE_HISTOGRAM_METRICS;
     }
 
-  std::map<int, std::string> MetricFlagToNameMap;
-  MetricFlagToNameMap
-    [TortuosityFilterType::AVERAGE_RADIUS_METRIC] = "AverageRadiusMetric";
-  MetricFlagToNameMap
-    [TortuosityFilterType::CHORD_LENGTH_METRIC] = "ChordLengthMetric";
-  MetricFlagToNameMap
-    [TortuosityFilterType::DISTANCE_METRIC] = "DistanceMetric";
-  MetricFlagToNameMap
-    [TortuosityFilterType::INFLECTION_COUNT_METRIC] = "InflectionCountMetric";
-  MetricFlagToNameMap
-    [TortuosityFilterType::INFLECTION_COUNT_1_METRIC]
-      = "InflectionCount1Metric";
-  MetricFlagToNameMap
-    [TortuosityFilterType::INFLECTION_COUNT_2_METRIC]
-      = "InflectionCount2Metric";
-  MetricFlagToNameMap
-    [TortuosityFilterType::PATH_LENGTH_METRIC] = "PathLengthMetric";
-  MetricFlagToNameMap
-    [TortuosityFilterType::PERCENTILE_95_METRIC] = "Percentile95Metric";
-  MetricFlagToNameMap
-    [TortuosityFilterType::SUM_OF_ANGLES_METRIC] = "SumOfAnglesMetric";
-  MetricFlagToNameMap
-    [TortuosityFilterType::TOTAL_CURVATURE_METRIC] = "TotalCurvatureMetric";
-  MetricFlagToNameMap
-    [TortuosityFilterType::TOTAL_SQUARED_CURVATURE_METRIC]
-      = "TotalSquaredCurvatureMetric";
-
   // Run tortuosity filter
   tubeStandardOutputMacro( << "\n>> Computing tortuosity measures" );
 
   timeCollector.Start( "Computing tortuosity measures" );
 
-  char childName[] = "Tube";
-  TubeListPointerType tubeList = pTubeGroup->GetChildren(
-    pTubeGroup->GetMaximumDepth(), childName );
-
-  vtkSmartPointer< vtkIntArray > tubeIdArray =
-    vtkSmartPointer<vtkIntArray>::New();
-  tubeIdArray->Initialize();
-  tubeIdArray->SetName( "TubeIDs" );
-  tubeIdArray->SetNumberOfValues( tubeList->size() );
-
-  vtkSmartPointer< vtkIntArray > numPointsArray =
-    vtkSmartPointer<vtkIntArray>::New();
-  numPointsArray->Initialize();
-  numPointsArray->SetName( "NumberOfPoints" );
-  numPointsArray->SetNumberOfValues( tubeList->size() );
-
-  std::vector< vtkSmartPointer< vtkDoubleArray >  > metricArrayVec;
-  for( int compareFlag = 0x01; compareFlag <=
-    static_cast< int >( TortuosityFilterType::BITMASK_ALL_METRICS );
-    compareFlag = compareFlag << 1)
-    {
-    // If metric is asked to print and is printable
-    if( (metricFlag & compareFlag &
-        TortuosityFilterType::BITMASK_VESSEL_WISE_METRICS) > 0 )
-      {
-      vtkSmartPointer< vtkDoubleArray > metricArray =
-        vtkSmartPointer< vtkDoubleArray >::New();
-      metricArray->Initialize();
-      metricArray->SetName( MetricFlagToNameMap[compareFlag].c_str() );
-      metricArray->SetNumberOfValues( tubeList->size() );
-      metricArrayVec.push_back( metricArray );
-      }
-    }
+  typename TortuosityFilterType::Pointer tortuosityFilter =
+    TortuosityFilterType::New();
+  tortuosityFilter->SetMeasureFlag( metricFlag );
+  tortuosityFilter->SetSmoothingScale( smoothingScale );
+  tortuosityFilter->SetSmoothingMethod( smoothingMethodEnum );
+  tortuosityFilter->SetNumberOfBins( numberOfHistogramBins );
+  tortuosityFilter->SetHistogramMin( histogramMin );
+  tortuosityFilter->SetHistogramMax( histogramMax );
+  tortuosityFilter->SetInput( pTubeGroup );
 
-  if( curvatureMetrics )
-    {
-    vtkSmartPointer< vtkDoubleArray > tau4Array =
-      vtkSmartPointer< vtkDoubleArray >::New();
-    tau4Array->Initialize();
-    tau4Array->SetName( "Tau4Metric" );
-    tau4Array->SetNumberOfValues( tubeList->size() );
-    metricArrayVec.push_back( tau4Array );
-    }
-
-  std::vector< vtkSmartPointer<vtkIntArray> > histogramArrays;
-  if( (metricFlag & TortuosityFilterType::CURVATURE_HISTOGRAM_METRICS) > 0 )
+  try
     {
-    double histStep = (histogramMax - histogramMin) / numberOfHistogramBins;
-
-    for(int i = 0; i < numberOfHistogramBins; i++)
-      {
-      std::ostringstream oss;
-      oss << "Hist-Bin#" << i << ": " << i*histStep <<" - "
-        << (i+1) * histStep;
-      std::string binArrayName = oss.str();
-
-      vtkSmartPointer< vtkIntArray > histArray =
-        vtkSmartPointer< vtkIntArray >::New();
-      histArray->Initialize();
-      histArray->SetName( binArrayName.c_str() );
-      histArray->SetNumberOfValues( tubeList->size() );
-      histogramArrays.push_back(histArray);
-      }
+    tortuosityFilter->Update();
     }
-
-  int tubeIndex = 0;
-  for( typename TubeGroupType::ChildrenListType::iterator
-    itTubes = tubeList->begin(); itTubes != tubeList->end(); ++itTubes )
+  catch( itk::ExceptionObject & err )
     {
-    TubeType* curTube = dynamic_cast<TubeType*>((*itTubes).GetPointer());
-    if (!curTube)
-      {
-      continue;
-      }
-
-    typename TortuosityFilterType::Pointer tortuosityFilter =
-      TortuosityFilterType::New();
-    tortuosityFilter->SetMeasureFlag( metricFlag );
-    tortuosityFilter->SetSmoothingScale( smoothingScale );
-    tortuosityFilter->SetSmoothingMethod( smoothingMethodEnum );
-    tortuosityFilter->SetNumberOfBins( numberOfHistogramBins );
-    tortuosityFilter->SetHistogramMin( histogramMin );
-    tortuosityFilter->SetHistogramMax( histogramMax );
-    tortuosityFilter->SetInput( curTube );
-    tortuosityFilter->Update();
-
-    tubeIdArray->SetValue( tubeIndex, tubeIndex );
-    numPointsArray->SetValue( tubeIndex, curTube->GetNumberOfPoints() );
-
-    std::cout << "vess = " << curTube->GetId() << std::endl;
-
-    for( unsigned int i = 0; i < metricArrayVec.size(); i++ )
-      {
-      std::string metricName = metricArrayVec[i]->GetName();
-
-      if( metricName == "AverageRadiusMetric" )
-        {
-        metricArrayVec[i]->SetValue( tubeIndex,
-          tortuosityFilter->GetAverageRadiusMetric() );
-        }
-      if( metricName == "ChordLengthMetric" )
-        {
-        metricArrayVec[i]->SetValue( tubeIndex,
-          tortuosityFilter->GetChordLengthMetric() );
-        }
-      if( metricName == "DistanceMetric" )
-        {
-        metricArrayVec[i]->SetValue( tubeIndex,
-          tortuosityFilter->GetDistanceMetric() );
-        }
-      if( metricName == "InflectionCountMetric" )
-        {
-        metricArrayVec[i]->SetValue( tubeIndex,
-          tortuosityFilter->GetInflectionCountMetric() );
-        }
-      if( metricName == "InflectionCount1Metric" )
-        {
-        metricArrayVec[i]->SetValue( tubeIndex,
-          tortuosityFilter->GetInflectionCount1Metric() );
-        }
-      if( metricName == "InflectionCount2Metric" )
-        {
-        metricArrayVec[i]->SetValue( tubeIndex,
-          tortuosityFilter->GetInflectionCount2Metric() );
-        }
-      if( metricName == "PathLengthMetric" )
-        {
-        metricArrayVec[i]->SetValue( tubeIndex,
-          tortuosityFilter->GetPathLengthMetric() );
-        }
-      if( metricName == "Percentile95Metric" )
-        {
-        metricArrayVec[i]->SetValue( tubeIndex,
-          tortuosityFilter->GetPercentile95Metric() );
-        }
-      if( metricName == "SumOfAnglesMetric" )
-        {
-        metricArrayVec[i]->SetValue( tubeIndex,
-          tortuosityFilter->GetSumOfAnglesMetric() );
-        }
-      if( metricName == "Tau4Metric" )
-        {
-        metricArrayVec[i]->SetValue( tubeIndex,
-          tortuosityFilter->GetTotalCurvatureMetric()
-            / tortuosityFilter->GetPathLengthMetric() );
-        }
-      if( metricName == "TotalCurvatureMetric" )
-        {
-        metricArrayVec[i]->SetValue( tubeIndex,
-          tortuosityFilter->GetTotalCurvatureMetric() );
-        }
-      if( metricName == "TotalSquaredCurvatureMetric" )
-        {
-        metricArrayVec[i]->SetValue( tubeIndex,
-          tortuosityFilter->GetTotalSquaredCurvatureMetric() );
-        }
-      }
-
-    if( ( metricFlag & TortuosityFilterType::CURVATURE_HISTOGRAM_METRICS )
-      > 0 )
-      {
-      // Get the histogram features
-      for( int i = 0; i < numberOfHistogramBins; i++ )
-        {
-        histogramArrays[i]->SetValue( tubeIndex,
-          tortuosityFilter->GetCurvatureHistogramMetric(i) );
-        }
-      }
-
-    tubeIndex++;
+    tube::ErrorMessage( "Error computing tortuosity measures: "
+                        + std::string( err.GetDescription() ) );
+    timeCollector.Report();
+    return EXIT_FAILURE;
     }
 
   timeCollector.Stop( "Computing tortuosity measures" );
@@ -371,34 +182,15 @@ int DoIt( int argc, char * argv[] )
 
   timeCollector.Start( "Writing tortuosity measures to CSV" );
 
-  vtkNew< vtkTable > table;
-
-  table->AddColumn( tubeIdArray.GetPointer() );
-  table->AddColumn( numPointsArray.GetPointer() );
-
-  for( unsigned int i = 0; i < metricArrayVec.size(); i++ )
-    {
-    table->AddColumn( metricArrayVec[i].GetPointer() );
-    }
-
-  if( ( metricFlag & TortuosityFilterType::CURVATURE_HISTOGRAM_METRICS )
-    > 0 )
+  std::ofstream csvFile( outputCSVFile.c_str() );
+  if( !csvFile )
     {
-    // Get the histogram features
-    for( int i = 0; i < numberOfHistogramBins; i++ )
-      {
-      table->AddColumn( histogramArrays[i].GetPointer() );
-      }
+    tube::ErrorMessage( "Error opening CSV file: " + outputCSVFile );
+    timeCollector.Report();
+    return EXIT_FAILURE;
     }
-
-  vtkNew< vtkDelimitedTextWriter > writer;
-  writer->SetFileName( outputCSVFile.c_str() );
-#if VTK_MAJOR_VERSION <= 5
-  writer->SetInput( table.GetPointer() );
-#else
-  writer->SetInputData( table.GetPointer() );
-#endif
-  writer->Write();
+  tortuosityFilter->WriteCSV( csvFile );
+  csvFile.close();
 
   timeCollector.Stop( "Writing tortuosity measures to CSV" );
 
@@ -22,9 +22,11 @@ limitations under the License.
 =========================================================================*/
 
 #include "tubeMessage.h"
+#include "tubeSparseAdjacencyMatrix.h"
 
 #include <itkImageFileReader.h>
 #include <itkMinimumMaximumImageFilter.h>
+#include <itkMultiThreader.h>
 #include <itkSpatialObjectReader.h>
 #include <itkTimeProbesCollectorBase.h>
 
@@ -32,6 +34,41 @@ limitations under the License.
 
 #include "ConvertTubeToTubeGraphCLP.h"
 
+enum { Dimension = 3 };
+
+typedef short                                      PixelType;
+typedef itk::Image< PixelType, Dimension >         ImageType;
+typedef itk::GroupSpatialObject< Dimension >       GroupType;
+typedef itk::ImageFileReader< ImageType >          ImageReaderType;
+typedef itk::SpatialObjectReader< >                SpatialObjectReaderType;
+typedef itk::VesselTubeSpatialObject< Dimension >  TubeSpatialObjectType;
+typedef TubeSpatialObjectType::TubePointType       TubePointType;
+typedef TubeSpatialObjectType::TransformType       TubeTransformType;
+
+typedef tube::SparseAdjacencyMatrix                AdjacencyMatrixType;
+
+/** The graph of one tube and its contribution to the adjacency matrix */
+struct TubeGraphType
+{
+  TubeSpatialObjectType *              Tube;
+  const TubeTransformType *            Transform;
+  bool                                 IsRoot;
+  int                                  StartNode;
+  MetaTubeGraph *                      Graph;
+  AdjacencyMatrixType::EdgeListType    Edges;
+  std::vector< std::string >           Warnings;
+}; // End struct TubeGraphType
+
+struct ConvertTubesThreadStruct
+{
+  const ImageType *                    Image;
+  std::vector< TubeGraphType > *       TubeGraphs;
+}; // End struct ConvertTubesThreadStruct
+
+void ConvertTube( const ImageType * image, TubeGraphType & tubeGraph );
+
+ITK_THREAD_RETURN_TYPE ConvertTubesThreaderCallback( void * arg );
+
 int DoIt( int argc, char * argv[] );
 
 int main( int argc, char * argv[] )
@@ -41,19 +78,167 @@ int main( int argc, char * argv[] )
   return DoIt( argc, argv );
 }
 
-int DoIt( int argc, char * argv[] )
+void ConvertTube( const ImageType * image, TubeGraphType & tubeGraph )
 {
-  enum { Dimension = 3 };
+  std::stringstream logMsg;
+
+  TubeSpatialObjectType * tube = tubeGraph.Tube;
+  const TubeTransformType * tubeTransform = tubeGraph.Transform;
+
+  vnl_matrix<double> cMat(3, 3);
+  vnl_vector<double> cVect(3);
+
+  int numberOfPoints = tube->GetNumberOfPoints();
 
-  typedef short                                      PixelType;
-  typedef itk::Image< PixelType, Dimension >         ImageType;
-  typedef itk::GroupSpatialObject< Dimension >       GroupType;
-  typedef itk::ImageFileReader< ImageType >          ImageReaderType;
-  typedef itk::SpatialObjectReader< >                SpatialObjectReaderType;
-  typedef itk::VesselTubeSpatialObject< Dimension >  TubeSpatialObjectType;
-  typedef TubeSpatialObjectType::TubePointType       TubePointType;
-  typedef TubeSpatialObjectType::TransformType       TubeTransformType;
+  MetaTubeGraph * graph = new MetaTubeGraph(3);
+
+  TubePointType tubePoint;
+  itk::Point<double, 3> pnt;
+  itk::Index< 3 > indx;
+  tubePoint = static_cast<TubePointType>(tube->GetPoints()[0]);
+  pnt = tubePoint.GetPosition();
+  pnt = tubeTransform->TransformPoint(pnt);
+  image->TransformPhysicalPointToIndex(pnt, indx);
+  double cCount = 1;
+  int cNode = image->GetPixel(indx);
+  double cRadius = tubePoint.GetRadius();
+  for(int i=0; i<3; i++)
+    {
+    cVect[i] = tubePoint.GetTangent()[i];
+    }
+  cMat = outer_product(cVect, cVect);
+  tubeGraph.StartNode = cNode;
+  int numberOfNodesCrossed = 0;
+  for(int p=1; p<numberOfPoints; p++)
+    {
+    tubePoint = static_cast<TubePointType>(tube->GetPoints()[p]);
+    pnt = tubePoint.GetPosition();
+    pnt = tubeTransform->TransformPoint(pnt);
+    image->TransformPhysicalPointToIndex(pnt, indx);
+    int tNode = image->GetPixel(indx);
+    if(tNode == cNode)
+      {
+      cCount++;
+      cRadius += tubePoint.GetRadius();
+      for(int i=0; i<3; i++)
+        {
+        cVect[i] = tubePoint.GetTangent()[i];
+        }
+      cMat = cMat + outer_product(cVect, cVect);
+      }
+    else
+      {
+      int len = graph->GetPoints().size();
+      if(graph->GetPoints().size()>3
+        && graph->GetPoints().at(len-1)->m_GraphNode == tNode
+        && graph->GetPoints().at(len-2)->m_GraphNode == cNode)
+        {
+        logMsg.str( "" );
+        logMsg  << "Oscillation detected"
+                << " : tube = " << cNode
+                << " : seq = " << graph->GetPoints().at(len-3)->m_GraphNode
+                << " " << graph->GetPoints().at(len-2)->m_GraphNode
+                << " " << graph->GetPoints().at(len-1)->m_GraphNode
+                << " " << cNode << " " << tNode;
+        tubeGraph.Warnings.push_back( logMsg.str() );
+
+        TubeGraphPnt * tgP = graph->GetPoints().back();
+        cNode = tNode;
+        cRadius = tgP->m_R;
+        for(int i=0; i<3; i++)
+          {
+          for(int j=0; j<3; j++)
+            {
+            cMat[i][j] = tgP->m_T[i*3+j];
+            }
+          }
+        cCount = tgP->m_P;
+        graph->GetPoints().pop_back();
+        /* Memory allocated for each element of list returned by
+        graph->GetPoints() usually released when destructor of graph called,
+        but since tgP is popped off back of list, memory would not be
+        released without explicit delete. */
+        delete tgP;
+        }
+      else
+        {
+        numberOfNodesCrossed++;
+        if(cNode > 0 && tNode > 0)
+          {
+          AdjacencyMatrixType::EdgeType edge;
+          edge.Row = cNode-1;
+          edge.Column = tNode-1;
+          edge.Value = 1;
+          tubeGraph.Edges.push_back( edge );
+          }
+        TubeGraphPnt * tgP = new TubeGraphPnt(3);
+        tgP->m_GraphNode = cNode;
+        tgP->m_R = cRadius/cCount;
+        tgP->m_P = cCount;
+        for(int i=0; i<3; i++)
+          {
+          for(int j=0; j<3; j++)
+            {
+            tgP->m_T[i*3+j] = cMat[i][j] / cCount;
+            }
+          }
+        graph->GetPoints().push_back(tgP);
+        cNode = tNode;
+        cRadius = tubePoint.GetRadius();
+        for(int i=0; i<3; i++)
+          {
+          cVect[i] = tubePoint.GetTangent()[i];
+          }
+        cMat = outer_product(cVect, cVect);
+        cCount = 1;
+        }
+      }
+    }
+  if(numberOfNodesCrossed>0)
+    {
+    TubeGraphPnt * tgP = new TubeGraphPnt(3);
+    tgP->m_GraphNode = cNode;
+    tgP->m_R = cRadius/cCount;
+    for(int i=0; i<3; i++)
+      {
+      for(int j=0; j<3; j++)
+        {
+        tgP->m_T[i*3+j] = cMat[i][j] / cCount;
+        }
+      }
+    graph->GetPoints().push_back(tgP);
+    tubeGraph.Graph = graph;
+    }
+  else
+    {
+    delete graph;
+    tubeGraph.Graph = NULL;
+    }
+}
 
+ITK_THREAD_RETURN_TYPE ConvertTubesThreaderCallback( void * arg )
+{
+  itk::MultiThreader::ThreadInfoStruct * info =
+    static_cast< itk::MultiThreader::ThreadInfoStruct * >( arg );
+  ConvertTubesThreadStruct * str =
+    static_cast< ConvertTubesThreadStruct * >( info->UserData );
+
+  std::vector< TubeGraphType > & tubeGraphs = *( str->TubeGraphs );
+  const unsigned int numTubes = tubeGraphs.size();
+  const unsigned int firstTube =
+    ( numTubes * info->ThreadID ) / info->NumberOfThreads;
+  const unsigned int lastTube =
+    ( numTubes * ( info->ThreadID + 1 ) ) / info->NumberOfThreads;
+  for( unsigned int t = firstTube; t < lastTube; t++ )
+    {
+    ConvertTube( str->Image, tubeGraphs[t] );
+    }
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+int DoIt( int argc, char * argv[] )
+{
   PARSE_ARGS;
 
   itk::TimeProbesCollectorBase timeCollector;
@@ -106,18 +291,11 @@ int DoIt( int argc, char * argv[] )
   logMsg << "Number of Centroids = " << numberOfCentroids;
   tube::InfoMessage( logMsg.str() );
 
-  vnl_matrix<int> aMat(numberOfCentroids, numberOfCentroids);
-  aMat.fill(0);
-
-  vnl_matrix<double> cMat(3, 3);
-  vnl_vector<double> cVect(3);
-
   vnl_vector<int> rootNodes(numberOfCentroids);
   rootNodes.fill(0);
   vnl_vector<double> branchNodes(numberOfCentroids);
   branchNodes.fill(0);
 
-  int count = 0;
   char tubeName[10];
   std::sprintf( tubeName, "Tube" );
   TubeSpatialObjectType::ChildrenListType *
@@ -125,144 +303,62 @@ int DoIt( int argc, char * argv[] )
   TubeSpatialObjectType::ChildrenListType::const_iterator
            tubeIt = tubeList->begin();
   int numTubes = tubeList->size();
-  TubePointType tubePoint;
-  MetaScene scene(3);
-  MetaTubeGraph * graph;
-  TubeTransformType::Pointer tubeTransform;
-  while(tubeIt != tubeList->end())
+
+  // The tubes and their transforms are updated here, since updating the
+  // transform of a tube also updates those of its children
+  std::vector< TubeGraphType > tubeGraphs( numTubes );
+  for( int t = 0; t < numTubes; t++ )
     {
     TubeSpatialObjectType::Pointer tube =
           dynamic_cast<TubeSpatialObjectType *>((*tubeIt).GetPointer());
 
     tube->RemoveDuplicatePoints();
     tube->ComputeTangentAndNormals();
+    tube->ComputeObjectToWorldTransform();
 
-    int numberOfPoints = tube->GetNumberOfPoints();
+    tubeGraphs[t].Tube = tube;
+    tubeGraphs[t].IsRoot = tube->GetRoot();
+    tubeGraphs[t].Graph = NULL;
+    ++tubeIt;
+    }
+  for( int t = 0; t < numTubes; t++ )
+    {
+    tubeGraphs[t].Transform = tubeGraphs[t].Tube->GetIndexToWorldTransform();
+    }
 
-    graph = new MetaTubeGraph(3);
+  // Walk the tubes through the CVT in parallel
+  ConvertTubesThreadStruct str;
+  str.Image = image;
+  str.TubeGraphs = &tubeGraphs;
+  itk::MultiThreader::Pointer threader = itk::MultiThreader::New();
+  threader->SetSingleMethod( ConvertTubesThreaderCallback, &str );
+  threader->SingleMethodExecute();
 
-    itk::Point<double, 3> pnt;
-    itk::Index< 3 > indx;
-    tubePoint = static_cast<TubePointType>(tube->GetPoints()[0]);
-    pnt = tubePoint.GetPosition();
-    tube->ComputeObjectToWorldTransform();
-    tubeTransform = tube->GetIndexToWorldTransform();
-    pnt = tubeTransform->TransformPoint(pnt);
-    image->TransformPhysicalPointToIndex(pnt, indx);
-    double cCount = 1;
-    int cNode = image->GetPixel(indx);
-    double cRadius = tubePoint.GetRadius();
-    for(int i=0; i<3; i++)
+  // Merge the tube graphs in tube order
+  MetaScene scene(3);
+  AdjacencyMatrixType::EdgeListType edges;
+  for( int t = 0; t < numTubes; t++ )
+    {
+    TubeGraphType & tubeGraph = tubeGraphs[t];
+    for( unsigned int w = 0; w < tubeGraph.Warnings.size(); w++ )
       {
-      cVect[i] = tubePoint.GetTangent()[i];
+      tube::WarningMessage( tubeGraph.Warnings[w] );
       }
-    cMat = outer_product(cVect, cVect);
-    if(tube->GetRoot())
+    int cNode = tubeGraph.StartNode;
+    if(tubeGraph.IsRoot)
       {
       rootNodes[cNode-1] = rootNodes[cNode-1]+1;
       }
     branchNodes[cNode-1] = branchNodes[cNode-1]+1.0/numTubes;
-    int numberOfNodesCrossed = 0;
-    for(int p=1; p<numberOfPoints; p++)
+    edges.insert( edges.end(), tubeGraph.Edges.begin(),
+      tubeGraph.Edges.end() );
+    if( tubeGraph.Graph != NULL )
       {
-      tubePoint = static_cast<TubePointType>(tube->GetPoints()[p]);
-      pnt = tubePoint.GetPosition();
-      pnt = tubeTransform->TransformPoint(pnt);
-      image->TransformPhysicalPointToIndex(pnt, indx);
-      int tNode = image->GetPixel(indx);
-      if(tNode == cNode)
-        {
-        cCount++;
-        cRadius += tubePoint.GetRadius();
-        for(int i=0; i<3; i++)
-          {
-          cVect[i] = tubePoint.GetTangent()[i];
-          }
-        cMat = cMat + outer_product(cVect, cVect);
-        }
-      else
-        {
-        int len = graph->GetPoints().size();
-        if(graph->GetPoints().size()>3
-          && graph->GetPoints().at(len-1)->m_GraphNode == tNode
-          && graph->GetPoints().at(len-2)->m_GraphNode == cNode)
-          {
-          logMsg.str( "" );
-          logMsg  << "Oscillation detected"
-                  << " : tube = " << cNode
-                  << " : seq = " << graph->GetPoints().at(len-3)->m_GraphNode
-                  << " " << graph->GetPoints().at(len-2)->m_GraphNode
-                  << " " << graph->GetPoints().at(len-1)->m_GraphNode
-                  << " " << cNode << " " << tNode;
-          tube::WarningMessage( logMsg.str() );
-
-          TubeGraphPnt * tgP = graph->GetPoints().back();
-          cNode = tNode;
-          cRadius = tgP->m_R;
-          for(int i=0; i<3; i++)
-            {
-            for(int j=0; j<3; j++)
-              {
-              cMat[i][j] = tgP->m_T[i*3+j];
-              }
-            }
-          cCount = tgP->m_P;
-          graph->GetPoints().pop_back();
-          /* Memory allocated for each element of list returned by
-          graph->GetPoints() usually released when destructor of graph called,
-          but since tgP is popped off back of list, memory would not be
-          released without explicit delete. */
-          delete tgP;
-          }
-        else
-          {
-          numberOfNodesCrossed++;
-          aMat[cNode-1][tNode-1] = aMat[cNode-1][tNode-1]+1;
-          TubeGraphPnt * tgP = new TubeGraphPnt(3);
-          tgP->m_GraphNode = cNode;
-          tgP->m_R = cRadius/cCount;
-          tgP->m_P = cCount;
-          for(int i=0; i<3; i++)
-            {
-            for(int j=0; j<3; j++)
-              {
-              tgP->m_T[i*3+j] = cMat[i][j] / cCount;
-              }
-            }
-          graph->GetPoints().push_back(tgP);
-          cNode = tNode;
-          cRadius = tubePoint.GetRadius();
-          for(int i=0; i<3; i++)
-            {
-            cVect[i] = tubePoint.GetTangent()[i];
-            }
-          cMat = outer_product(cVect, cVect);
-          cCount = 1;
-          }
-        }
-      }
-    if(numberOfNodesCrossed>0)
-      {
-      TubeGraphPnt * tgP = new TubeGraphPnt(3);
-      tgP->m_GraphNode = cNode;
-      tgP->m_R = cRadius/cCount;
-      for(int i=0; i<3; i++)
-        {
-        for(int j=0; j<3; j++)
-          {
-          tgP->m_T[i*3+j] = cMat[i][j] / cCount;
-          }
-        }
-      graph->GetPoints().push_back(tgP);
-      scene.AddObject(graph);
-      }
-    else
-      {
-      delete graph;
+      scene.AddObject(tubeGraph.Graph);
       }
-    ++tubeIt;
-    ++count;
     }
+  AdjacencyMatrixType aMat;
+  aMat.SetEdges( numberOfCentroids, edges );
 
   timeCollector.Stop( "Processing" );
 
@@ -270,24 +366,10 @@ int DoIt( int argc, char * argv[] )
   scene.Write(graphFile.c_str());
 
   std::string matrixFile = graphFile + ".mat";
-  std::ofstream writeStream;
-  writeStream.open(matrixFile.c_str(), std::ios::binary | std::ios::out);
-  writeStream << numberOfCentroids << std::endl;
-  for(int i=0; i<numberOfCentroids; i++)
-    {
-    for(int j=0; j<numberOfCentroids; j++)
-      {
-      writeStream << aMat[i][j];
-      if(j<numberOfCentroids-1)
-        {
-        writeStream << " ";
-        }
-      }
-    writeStream << std::endl;
-    }
-  writeStream.close();
+  aMat.Write( matrixFile, sparseMatrix );
 
   std::string branchFile = graphFile + ".brc";
+  std::ofstream writeStream;
   writeStream.open(branchFile.c_str(), std::ios::binary | std::ios::out);
   writeStream << numberOfCentroids << std::endl;
   for(int i=0; i<numberOfCentroids; i++)
@@ -129,6 +129,8 @@ int DoIt( int argc, char * argv[] )
 
   timeCollector.Stop( "LoadData" );
 
+  fvGenerator->SetUseDenseFeatures( useDenseFeatures );
+
   basisGenerator->SetInputFeatureVectorGenerator( static_cast<
    FeatureVectorGeneratorType * >( fvGenerator.GetPointer() ) );
 
@@ -206,7 +208,10 @@ int DoIt( int argc, char * argv[] )
     {
     timeCollector.Start( "SaveBasisImages" );
 
-    unsigned int numBasis = basisGenerator->GetNumberOfFeatures();
+    // All basis images are generated in one pass over the n-jet features
+    typename BasisFeatureVectorGeneratorType::FeatureImageListType
+      basisImageList = basisGenerator->GetFeatureImages();
+    unsigned int numBasis = basisImageList.size();
     for( unsigned int i = 0; i < numBasis; i++ )
       {
       typename BasisImageWriterType::Pointer basisImageWriter =
@@ -217,7 +222,7 @@ int DoIt( int argc, char * argv[] )
       basename += std::string( c );
       basisImageWriter->SetUseCompression( true );
       basisImageWriter->SetFileName( basename.c_str() );
-      basisImageWriter->SetInput( basisGenerator->GetFeatureImage( i ) );
+      basisImageWriter->SetInput( basisImageList[i] );
       basisImageWriter->Update();
       }
     timeCollector.Stop( "SaveBasisImages" );
@@ -28,6 +28,26 @@ limitations under the License.
 #include <metaCommand.h>
 #include "ImageMathCLP.h"
 
+// Description:
+// Options that only change each voxel from its own value (and the value of
+// the same voxel in a second image).  Consecutive pointwise options are
+// queued and then applied together in a single pass.
+static bool IsPointwiseOption( MetaCommand & command,
+  const MetaCommand::Option & option )
+{
+  if( option.name == "Intensity" || option.name == "Threshold"
+    || option.name == "Masking" || option.name == "Add"
+    || option.name == "Multiply" )
+    {
+    return true;
+    }
+  if( option.name == "Process" || option.name == "process" )
+    {
+    return command.GetValueAsInt( option, "mode" ) == 0;
+    }
+  return false;
+}
+
 /** Main command */
 template< class TPixel, unsigned int VDimension >
 int DoIt( MetaCommand & command )
@@ -66,9 +86,18 @@ int DoIt( MetaCommand & command )
     return EXIT_FAILURE;
     }
 
+  typedef tube::ImageFilters< VDimension > ImageFiltersType;
+  typename ImageFiltersType::PointwiseOperationListType pointwiseOperations;
+
   MetaCommand::OptionVector::const_iterator it = parsed.begin();
   while( it != parsed.end() )
     {
+    if( !IsPointwiseOption( command, *it ) )
+      {
+      ImageFiltersType::ApplyPointwiseOperations( imIn,
+        pointwiseOperations );
+      }
+
     if( ( *it ).name == "Write" )
       {
       std::string outFilename =
@@ -222,8 +251,8 @@ int DoIt( MetaCommand & command )
     else if( ( *it ).name == "Intensity" )
       {
       std::cout << "Intensity windowing" << std::endl;
-      tube::ImageFilters< VDimension >::ApplyIntensityWindowing(
-        imIn,
+      ImageFiltersType::AddIntensityWindowingOperation(
+        pointwiseOperations,
         command.GetValueAsFloat( *it, "inValMin" ),
         command.GetValueAsFloat( *it, "inValMax" ),
         command.GetValueAsFloat( *it, "outMin" ),
@@ -269,8 +298,8 @@ int DoIt( MetaCommand & command )
     else if( ( *it ).name == "Add" )
       {
       std::cout << "Adding" << std::endl;
-      bool success = tube::ImageFilters< VDimension >::AddImages( imIn,
-        command.GetValueAsString( *it, "Infile" ),
+      bool success = ImageFiltersType::AddAddImagesOperation(
+        pointwiseOperations, command.GetValueAsString( *it, "Infile" ),
         command.GetValueAsFloat( *it, "weight1" ),
         command.GetValueAsFloat( *it, "weight2" ) );
       if ( !success )
@@ -282,8 +311,8 @@ int DoIt( MetaCommand & command )
     else if( ( *it ).name == "Multiply" )
       {
       std::cout << "Multiplying" << std::endl;
-      bool success = tube::ImageFilters< VDimension >::MultiplyImages(
-        imIn, command.GetValueAsString( *it, "Infile" ) );
+      bool success = ImageFiltersType::AddMultiplyImagesOperation(
+        pointwiseOperations, command.GetValueAsString( *it, "Infile" ) );
       if ( !success )
         {
         return EXIT_FAILURE;
@@ -338,7 +367,7 @@ int DoIt( MetaCommand & command )
     else if( ( *it ).name == "Threshold" )
       {
       std::cout << "Thresholding" << std::endl;
-      tube::ImageFilters< VDimension >::ThresholdImage( imIn,
+      ImageFiltersType::AddThresholdOperation( pointwiseOperations,
         command.GetValueAsFloat( *it, "threshLow" ),
         command.GetValueAsFloat( *it, "threshHigh" ),
         command.GetValueAsFloat( *it, "valTrue" ),
@@ -368,9 +397,8 @@ int DoIt( MetaCommand & command )
       int mode = command.GetValueAsInt( *it, "mode" );
       if ( mode == 0 )
         {
-        bool success =
-          tube::ImageFilters< VDimension >::MultiplyImages( imIn,
-          command.GetValueAsString( *it, "file2" ) );
+        bool success = ImageFiltersType::AddMultiplyImagesOperation(
+          pointwiseOperations, command.GetValueAsString( *it, "file2" ) );
         if( !success )
           {
           return EXIT_FAILURE;
@@ -383,15 +411,15 @@ int DoIt( MetaCommand & command )
       int mode = command.GetValueAsInt( *it, "mode" );
       if( mode == 0 )
         {
-        tube::ImageFilters< VDimension >::AbsoluteImage( imIn );
+        ImageFiltersType::AddAbsoluteOperation( pointwiseOperations );
         }
       }
     // Masking
     else if( ( *it ).name == "Masking" )
       {
       std::cout << "Masking" << std::endl;
-      bool success = tube::ImageFilters< VDimension >::
-        MaskImageWithValueIfNotWithinSecondImageRange( imIn,
+      bool success = ImageFiltersType::AddMaskOperation(
+        pointwiseOperations, imIn,
         command.GetValueAsString( *it, "inFile2" ),
         command.GetValueAsFloat( *it, "threshLow" ),
         command.GetValueAsFloat( *it, "threshHigh" ),
@@ -595,6 +623,8 @@ int DoIt( MetaCommand & command )
     ++it;
     }
 
+  ImageFiltersType::ApplyPointwiseOperations( imIn, pointwiseOperations );
+
   return EXIT_SUCCESS;
 }
 
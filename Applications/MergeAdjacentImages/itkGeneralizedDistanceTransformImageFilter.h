@@ -26,6 +26,8 @@
 
 #include "itkImageToImageFilter.h"
 
+#include <vector>
+
 namespace itk
 {
 /** \class GeneralizedDistanceTransformImageFilter
@@ -145,6 +147,8 @@ public:
   typedef typename FunctionImageType::IndexValueType IndexValueType;
   typedef typename LabelImageType::PixelType         LabelPixelType;
   typedef typename DistanceImageType::PixelType      DistancePixelType;
+  typedef typename DistanceImageType::SizeType       SizeType;
+  typedef typename DistanceImageType::SizeValueType  SizeValueType;
 
   /** Set if a voronoi map should be created. */
   void SetCreateVoronoiMap(bool);
@@ -200,7 +204,8 @@ protected:
   /** Allocate and initialize output images. Used by GenerateData() */
   void PrepareData();
 
-  /** Compute distance transform and optionally the voronoi map as well. */
+  /** Compute distance transform and optionally the voronoi map as well.
+   * The scanlines of each dimension are transformed in parallel. */
   void GenerateData();
 
 
@@ -323,6 +328,34 @@ private:
     const Parabolas &envelope,
     const AbscissaIndexType &from, const long &steps,
     LabelPixelType *buffer);
+
+  /** Data shared by the threads transforming the scanlines along one
+   * dimension. Only the scanlines handed to a thread are written by it. */
+  struct ScanlineThreadStruct
+    {
+    Self *                             Filter;
+    DistancePixelType *                Distance;
+    LabelPixelType *                   Labels;
+    SizeType                           Size;
+    unsigned int                       Dimension;
+    SpacingType                        SquaredSpacing;
+    const std::vector< SpacingType > * DivisionTable;
+    SizeValueType                      MaxSize;
+    SizeValueType                      PixelsInCacheLine;
+    };
+
+  static ITK_THREAD_RETURN_TYPE ScanlineThreaderCallback(void *arg);
+
+  /** Transform the scanlines [firstLine, lastLine) along dimension 0 */
+  void ThreadedTransformLines(const ScanlineThreadStruct &str,
+    SizeValueType firstLine, SizeValueType lastLine);
+
+  /** Transform the strips [firstStrip, lastStrip) of scanlines along
+   * dimension str.Dimension > 0. Strips are numbered row by row, a row being
+   * the scanlines along that dimension that only differ in their index along
+   * dimension 0. */
+  void ThreadedTransformStrips(const ScanlineThreadStruct &str,
+    SizeValueType firstStrip, SizeValueType lastStrip);
 }; // end of GeneralizedDistanceTransformImageFilter class
 } //end namespace itk
 
@@ -27,7 +27,6 @@
 #include <limits>
 
 #include "itkGeneralizedDistanceTransformImageFilter.h"
-#include "itkImageLinearIteratorWithIndex.h"
 #include "itkImageRegionConstIterator.h"
 #include "itkImageRegionIterator.h"
 
@@ -295,8 +294,7 @@ GeneralizedDistanceTransformImageFilter<
   // We need the size and probably the spacing of the images.
   DistanceImagePointer distance = this->GetDistance();
   typename DistanceImageType::SpacingType spacing = distance->GetSpacing();
-  typename DistanceImageType::SizeType size =
-    distance->GetRequestedRegion().GetSize();
+  const SizeType size = distance->GetRequestedRegion().GetSize();
 
   // The distance image has been initialized to contain the function values
   // f(x) at x = (x1 x2 ... xN).
@@ -305,158 +303,234 @@ GeneralizedDistanceTransformImageFilter<
   // Information on the region covered by a paraboloid is provided optionally
   // by copying the label at x.
   //
-  // The iterations visit each scanline in each dimension.
+  // The iterations visit each scanline in each dimension. Scanlines along one
+  // dimension are independent, so each pass is split across threads, and
+  // every thread uses its own envelopes and output buffers.
   //
   // To make better use of L1 cache, a few scanlines are read and written in
-  // parallel for dimensions 1 and upward. See below for details.
-  typedef itk::ImageLinearIteratorWithIndex<DistanceImageType> DIt;
-  DIt distanceIt(distance, distance->GetRequestedRegion());
-
-  typedef itk::ImageLinearIteratorWithIndex<LabelImageType> LIt;
-  LIt voronoiMapIt;
+  // parallel for dimensions 1 and upward. See ThreadedTransformStrips().
+  //
+  // \todo When ITK offers new methods to store images in memory, this code
+  // would need to be revisited, as it assumes row mayor layout and
+  // contiguous memory.
+  ScanlineThreadStruct str;
+  str.Filter = this;
+  str.Distance = distance->GetBufferPointer();
+  str.Labels = 0;
   if (this->m_CreateVoronoiMap)
     {
-    LabelImagePointer voronoiMap =
-      dynamic_cast<LabelImageType *>(this->ProcessObject::GetOutput(1));
-    voronoiMapIt = LIt(voronoiMap, voronoiMap->GetRequestedRegion());
+    str.Labels = this->GetVoronoiMap()->GetBufferPointer();
     }
+  str.Size = size;
 
   // Compute the maximal extent in number of pixels, rounded up to fill full
   // cache lines.
   // This is used to set up various vectors, buffers, and a division table
-  typedef typename DistanceImageType::SizeValueType DistSizeValueType;
-  DistSizeValueType maxSize = 0;
-
+  str.MaxSize = 0;
   for (unsigned int d = 0; d < FunctionImageType::ImageDimension; ++d)
     {
-    maxSize = std::max(maxSize, size[d]);
+    str.MaxSize = std::max(str.MaxSize, size[d]);
     }
-
-  maxSize = (DistSizeValueType)(
-    std::ceil((double)maxSize / m_CacheLineSize) * m_CacheLineSize);
+  str.MaxSize = (SizeValueType)(
+    std::ceil((double)str.MaxSize / m_CacheLineSize) * m_CacheLineSize);
 
   // With the division table, we reduce the cost of the code that needs to
   // take image spacing into account.
-  // It will be initialized later, once for each dimension.
-  std::vector< SpacingType > divisionTable( maxSize, 0 );
+  // It will be initialized later, once for each dimension, and is only read
+  // by the threads.
+  std::vector< SpacingType > divisionTable( str.MaxSize, 0 );
+  str.DivisionTable = &divisionTable;
 
-  // Loop over all dimensions and compute the generalized distance transform
-  // and voronoi map for each scanline.
+  // The number of scanlines is the number of pixels that fit in a L1 cache
+  // line or a small multiple thereof. This way, we will use everything from L1
+  // cache (when the memory is properly aligned).
+  str.PixelsInCacheLine =
+    std::max( (SizeValueType)1,
+      (SizeValueType)(m_CacheLineSize/
+        sizeof(typename DistanceImageType::PixelType)));
+
+  this->GetMultiThreader()->SetNumberOfThreads( this->GetNumberOfThreads() );
+  this->GetMultiThreader()->SetSingleMethod(
+    this->ScanlineThreaderCallback, &str );
+
+  // dimension 0, nice and easy
   //
   // Scanning lines along dimension 0 exhibit a good hit rate of L1 cache and no
   // special care has to be taken to make use of this fact.
-  //
-  // We can work on multiple scanlines in parallel, however, thus making use of
-  // multiple processors.
-  // dimension 0
-  const SpacingType sqrs = spacing[0]*spacing[0];
-  Parabolas envelope;
-  envelope.reserve(size[0]);
+  str.Dimension = 0;
+  str.SquaredSpacing = spacing[0]*spacing[0];
+  if (this->m_UseImageSpacing)
+    {
+    updateDivisionTable(divisionTable, spacing[0], size[0]);
+    }
+  this->GetMultiThreader()->SingleMethodExecute();
 
-  // dimension 0, nice and easy
+  // We are looping over the remaining image dimensions starting with the
+  // highest. This is due to the following observation:
   //
-  // To use openmp, we let distanceIt advance in direction 1 and parallelize
-  // the loop over each scanline along direction 1. See below for details.
-  distanceIt.SetDirection(1);
-  distanceIt.GoToBegin();
+  // The algorithm detects scanlines with all background pixels and can
+  // afterwards skip writing them back. On the other hand, when you have a
+  // single non-background pixel in an axial slice, after scanning and
+  // resampling along dimension 0 you will have a whole scanline of
+  // non-background pixels. After that, none of the scanlines on this slice in
+  // dimension 1 will stay empty.
+  //
+  // The CT data sets that we have investigated almost never had a completely
+  // empty axial slice. They had a certain amount of empty coronary slices,
+  // however.
+  //
+  // This iteration order saves about 8% runtime on our test system, so we opted
+  // to investigate that direction first.
+  for (int d = FunctionImageType::ImageDimension-1; d > 0; --d)
+  // Curious how it works for you the other way round? Then try this instead:
+  //for (int d = 1; d < FunctionImageType::ImageDimension; ++d)
+    {
+    // Set up spacing and division info
+    str.Dimension = d;
+    str.SquaredSpacing = spacing[d]*spacing[d];
+    if (this->m_UseImageSpacing)
+      {
+      updateDivisionTable(divisionTable, spacing[d], size[d]);
+      }
+    this->GetMultiThreader()->SingleMethodExecute();
+    }
+} // end GenerateData()
 
-  if (this->m_CreateVoronoiMap)
+/**
+ * Split the scanlines of one pass among the threads
+ */
+template < class TFunctionImage,class TDistanceImage, class TLabelImage >
+ITK_THREAD_RETURN_TYPE
+GeneralizedDistanceTransformImageFilter<
+  TFunctionImage, TDistanceImage, TLabelImage >
+::ScanlineThreaderCallback(void *arg)
+{
+  MultiThreader::ThreadInfoStruct *info =
+    static_cast<MultiThreader::ThreadInfoStruct *>(arg);
+  ScanlineThreadStruct *str =
+    static_cast<ScanlineThreadStruct *>(info->UserData);
+
+  const SizeType & size = str->Size;
+  const unsigned int d = str->Dimension;
+
+  SizeValueType numberOfPixels = 1;
+  for (unsigned int i = 0; i < FunctionImageType::ImageDimension; ++i)
     {
-    voronoiMapIt.SetDirection(1);
-    voronoiMapIt.GoToBegin();
+    numberOfPixels *= size[i];
     }
 
-  if (this->m_UseImageSpacing)
+  // Along dimension 0, each scanline is a work unit. Along the other
+  // dimensions, it is a strip of neighboring scanlines, see
+  // ThreadedTransformStrips(). Each thread gets a contiguous range of them.
+  SizeValueType numberOfUnits = numberOfPixels / size[d];
+  if (d > 0)
     {
-    updateDivisionTable(divisionTable, spacing[0], size[0]);
+    numberOfUnits = (numberOfPixels / (size[0] * size[d])) *
+      ((size[0] + str->PixelsInCacheLine - 1) / str->PixelsInCacheLine);
+    }
+  const SizeValueType firstUnit =
+    (numberOfUnits * info->ThreadID) / info->NumberOfThreads;
+  const SizeValueType lastUnit =
+    (numberOfUnits * (info->ThreadID + 1)) / info->NumberOfThreads;
+
+  if (d == 0)
+    {
+    str->Filter->ThreadedTransformLines(*str, firstUnit, lastUnit);
+    }
+  else
+    {
+    str->Filter->ThreadedTransformStrips(*str, firstUnit, lastUnit);
     }
 
-  // Distance in pixels from one scanline to the next
-  const size_t stride = size[ 0 ];
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+/**
+ * Transform the scanlines [firstLine, lastLine) along dimension 0
+ */
+template < class TFunctionImage,class TDistanceImage, class TLabelImage >
+void
+GeneralizedDistanceTransformImageFilter<
+  TFunctionImage, TDistanceImage, TLabelImage >
+::ThreadedTransformLines(const ScanlineThreadStruct &str,
+  SizeValueType firstLine, SizeValueType lastLine)
+{
+  const SizeType & size = str.Size;
+  const std::vector< SpacingType > & divisionTable = *str.DivisionTable;
+
+  Parabolas envelope;
+  envelope.reserve(size[0]);
 
-  // Iterate over all scanlines. The outer while advances slices, the for-loop
-  // below iterates along direction 1 over each scanline in direction 0.
-  while (!distanceIt.IsAtEnd())
+  for (SizeValueType line = firstLine; line < lastLine; ++line)
     {
-    // Compute the generalized distance transform for the current scanline.
-    // We are using raw pointers to the data in order to simplify access with
-    // OpenMP.
-    //
-    // \todo When ITK offers new methods to store images in memory, this code
-    // would need to be revisited, as it assumes row mayor layout and
-    // contiguous memory.
-    DistancePixelType *rawDistance = &distanceIt.Value();
+    // Where does the scanline start in the buffers?
+    DistancePixelType *rawDistance = str.Distance + line * size[0];
     LabelPixelType *rawLabel =
-      this->m_CreateVoronoiMap ?  &voronoiMapIt.Value() : 0;
-    for (size_t i = 0; i < size[ 1 ]; ++i)
-      {
-      // Where does the scanline start in rawDistance?
-      size_t offset = i * stride;
+      this->m_CreateVoronoiMap ? str.Labels + line * size[0] : 0;
 
-      // First compute the lower envelope of parabolas
-      envelope.clear();
-      if (this->m_UseImageSpacing)
-        {
-        for (size_t j = 0; j < size[0]; ++j, ++offset)
-          {
-          addParabola(
-            envelope, size[0],
-            j,
-            *(rawDistance + offset),
-            this->m_CreateVoronoiMap ?
-            *(rawLabel + offset) :
-            typename LabelImageType::PixelType(),
-            divisionTable);
-          }
-        offset -= size[0];
-        }
-      else
-        {
-        for (size_t j = 0; j < size[ 0 ]; ++j, ++offset)
-          {
-          addParabola(
-            envelope, size[0],
-            j,
-            *(rawDistance + offset),
-            this->m_CreateVoronoiMap ?
-            *(rawLabel + offset) :
-            typename LabelImageType::PixelType());
-          }
-        offset -= size[0];
-        }
-
-      // And now sample the lower envelope for the whole scanline
-      if (this->m_UseImageSpacing)
+    // First compute the lower envelope of parabolas
+    envelope.clear();
+    if (this->m_UseImageSpacing)
+      {
+      for (size_t j = 0; j < size[0]; ++j)
         {
-        sampleValues(envelope, 0, size[0], rawDistance + offset, sqrs);
+        addParabola(
+          envelope, size[0],
+          j,
+          *(rawDistance + j),
+          this->m_CreateVoronoiMap ?
+          *(rawLabel + j) :
+          typename LabelImageType::PixelType(),
+          divisionTable);
         }
-      else
+      }
+    else
+      {
+      for (size_t j = 0; j < size[0]; ++j)
         {
-        sampleValues(envelope, 0, size[0], rawDistance + offset);
+        addParabola(
+          envelope, size[0],
+          j,
+          *(rawDistance + j),
+          this->m_CreateVoronoiMap ?
+          *(rawLabel + j) :
+          typename LabelImageType::PixelType());
         }
+      }
 
-      if (this->m_CreateVoronoiMap)
-        {
-        sampleVoronoi(envelope, 0, size[0], rawLabel + offset);
-        }
+    // And now sample the lower envelope for the whole scanline
+    if (this->m_UseImageSpacing)
+      {
+      sampleValues(envelope, 0, size[0], rawDistance, str.SquaredSpacing);
+      }
+    else
+      {
+      sampleValues(envelope, 0, size[0], rawDistance);
       }
 
-    // Advance the iterators to the next slice
-    for (size_t i = 0; i < size[ 1 ]; ++i)
+    if (this->m_CreateVoronoiMap)
       {
-      distanceIt.NextLine();
-      if (this->m_CreateVoronoiMap)
-        {
-        voronoiMapIt.NextLine();
-        }
+      sampleVoronoi(envelope, 0, size[0], rawLabel);
       }
     }
+}
 
-
+/**
+ * Transform the strips [firstStrip, lastStrip) of scanlines along dimension
+ * str.Dimension > 0
+ */
+template < class TFunctionImage,class TDistanceImage, class TLabelImage >
+void
+GeneralizedDistanceTransformImageFilter<
+  TFunctionImage, TDistanceImage, TLabelImage >
+::ThreadedTransformStrips(const ScanlineThreadStruct &str,
+  SizeValueType firstStrip, SizeValueType lastStrip)
+{
   // Dimensions 1 and up are interesting when it comes to L1 cache usage.
   //
   // We will build several envelopes in parallel along direction d by reading a
-  // number of scanlines along direction 0 at once.
+  // number of scanlines along direction 0 at once. We call the group of
+  // scanlines that is sampled in parallel a strip.
   //
   // For writing the result, we first sample all new scanlines into a cache
   // efficient buffer and then write that buffer into the output image, again in
@@ -466,269 +540,210 @@ GeneralizedDistanceTransformImageFilter<
   // be better optimized when it can be handled in one go. Therefore we can not
   // sample multiple envelopes at once without loosing a lot of runtime
   // performance.
-
-  // The number of scanlines is the number of pixels that fit in a L1 cache
-  // line or a small multiple thereof. This way, we will use everything from L1
-  // cache (when the memory is properly aligned).
-  const DistSizeValueType pixelsInCacheLine =
-    std::max( (DistSizeValueType)1,
-      (DistSizeValueType)(m_CacheLineSize/
-        sizeof(typename DistanceImageType::PixelType)));
-
-  // We are using a buffer for each thread for intermediate output.
-  std::vector< DistancePixelType > valuesBuffer;
-  valuesBuffer.resize(pixelsInCacheLine*maxSize);
+  //
+  // The alternative implementation to make valuesBuffer and voronoiBuffer
+  // cover the whole slice and share the data for output has been discarded
+  // as it would create a prohibitively large intermediate image when used
+  // with large 2D-images.
+  const SizeType & size = str.Size;
+  const int d = str.Dimension;
+  const std::vector< SpacingType > & divisionTable = *str.DivisionTable;
+  const SizeValueType maxSize = str.MaxSize;
+  const SizeValueType pixelsInCacheLine = str.PixelsInCacheLine;
+  const SpacingType sqrsD = str.SquaredSpacing;
+
+  // Buffers for intermediate output, scanlines are maxSize elements apart
+  std::vector< DistancePixelType > valuesBuffer(pixelsInCacheLine*maxSize);
   std::vector< LabelPixelType > voronoiBuffer;
-  if( this->m_UseImageSpacing )
+  if (this->m_CreateVoronoiMap)
     {
     voronoiBuffer.resize(pixelsInCacheLine*maxSize);
     }
 
-  // We are looping over the remaining image dimensions starting with the
-  // highest. This is due to the following observation:
-  //
-  // The algorithm detects scanlines with all background pixels and can
-  // afterwards skip writing them back. On the other hand, when you have a
-  // single non-background pixel in an axial slice, after scanning and
-  // resampling along dimension 0 you will have a whole scanline of
-  // non-background pixels. After that, none of the scanlines on this slice in
-  // dimension 1 will stay empty.
-  //
-  // The CT data sets that we have investigated almost never had a completely
-  // empty axial slice. They had a certain amount of empty coronary slices,
-  // however.
-  //
-  // This iteration order saves about 8% runtime on our test system, so we opted
-  // to investigate that direction first.
-  for (int d = FunctionImageType::ImageDimension-1; d > 0; --d)
-  // Curious how it works for you the other way round? Then try this instead:
-  //for (int d = 1; d < FunctionImageType::ImageDimension; ++d)
+  std::vector< Parabolas > envelopeD( pixelsInCacheLine );
+  for (size_t i = 0; i < pixelsInCacheLine; ++i)
     {
-    // Set up spacing and division info
-    const SpacingType sqrsD = spacing[d]*spacing[d];
+    envelopeD[i].reserve( maxSize );
+    }
 
-    if (this->m_UseImageSpacing)
-      {
-      updateDivisionTable(divisionTable, spacing[d], size[d]);
-      }
+  // How many strips are there per row of scanlines along direction 0?
+  const SizeValueType strips =
+    (size[0] + pixelsInCacheLine - 1) / pixelsInCacheLine;
 
-    distanceIt.SetDirection(d);
-    distanceIt.GoToBegin();
+  // Compute stride from one scanline in direction d to the next
+  size_t strideD = 1;
+  for (int i = 0; i < d; ++i)
+    {
+    strideD *= size[i];
+    }
+  const SizeValueType rowsPerSlice = strideD / size[0];
 
-    if (this->m_CreateVoronoiMap)
-      {
-      voronoiMapIt.SetDirection(d);
-      voronoiMapIt.GoToBegin();
-      }
+  for (SizeValueType strip = firstStrip; strip < lastStrip; ++strip)
+    {
+    // Offset of the first scanline of the row the strip belongs to. Rows
+    // within a slice normal to dimension d are size[0] apart, and slices are
+    // strideD * size[d] apart.
+    const SizeValueType row = strip / strips;
+    const SizeValueType rowOffset =
+      (row / rowsPerSlice) * strideD * size[d] +
+      (row % rowsPerSlice) * size[0];
+
+    // Inside the loop, we are working with lean and mean pointers into the
+    // image buffer and offsets therein.
+    DistancePixelType *rawDistance = str.Distance + rowOffset;
+    LabelPixelType *rawLabel =
+      this->m_CreateVoronoiMap ? str.Labels + rowOffset : 0;
 
-    std::vector< Parabolas > envelopeD( pixelsInCacheLine );
-    for (size_t i = 0; i < pixelsInCacheLine; ++i)
-      {
-      envelopeD[i].reserve( maxSize );
-      }
+    const SizeValueType i = strip % strips;
+    const IndexValueType currentStripOffset = i * pixelsInCacheLine;
 
-    // We call the group of scanlines that is sampled in parallel a strip. How
-    // many strips are there? This many:
-    const int strips =
-      static_cast< int >(std::ceil(double(size[0]) / pixelsInCacheLine));
+    // We can work on at most linesInCache lines in parallel to be cache
+    // effective. To avoid wrap-around effects at the end of a line, we also
+    // need to take the image size in dimension 0 in account.
+    const SizeValueType parallelLines = std::min(
+      pixelsInCacheLine,
+      size[0] - i * pixelsInCacheLine);
 
-    // Compute stride from one scanline in direction d to the next
-    size_t strideD = 1;
-    for (int i = 0; i < d; ++i)
+    // Now compute the lower envelope of parabolas for each scanline
+    for (size_t line = 0; line < parallelLines; ++line)
       {
-      strideD *= size[i];
+      envelopeD[line].clear();
       }
 
-    while (!distanceIt.IsAtEnd())
+    // Read a strip of parallelLines scanlines along direction d
+    for (size_t j = 0, offset = currentStripOffset;
+          j < size[d];
+          ++j, offset += strideD - parallelLines)
       {
-      // Inside the for loop, we are working with lean and mean pointers into
-      // the image buffer and offsets therein.
-      // This makes parallelization with openmp easier as we do not need to
-      // modify an iterator in the inner loop.
-      //
-      // \todo Again, this needs to be reinvestigated when other memory layouts
-      // are introduced into ITK
-      DistancePixelType *rawDistance = &distanceIt.Value();
-      LabelPixelType *rawLabel =
-        this->m_CreateVoronoiMap ?  &voronoiMapIt.Value() : 0;
-
-      // When you compile with openmp support, this loop can be handled in
-      // parallel. Each thread gets its own copy of envelope and output buffers
-      // to work on. All other data can be shared as it is not written to.
-      //
-      // The alternative implementation to make valuesBuffer and voronoiBuffer
-      // cover the whole slice and share the data for output has been discarded
-      // as it would create a prohibitively large intermediate image when used
-      // with large 2D-images.
-      //
-      // The static schedule seemed best for the task at hand. It has the least
-      // overhead to implement and as each strip takes approximately the same
-      // time to complete, it fits well.
-      //
-      // Each thread will handle a single strip and therefore have everything in
-      // L1 cache of its CPU.
-      for (int i = 0; i < strips; ++i)
+      if (this->m_UseImageSpacing)
         {
-        const IndexValueType currentStripOffset = i * pixelsInCacheLine;
-
-        // We can work on at most linesInCache lines in parallel to be cache
-        // effective. To avoid wrap-around effects at the end of a line, we also
-        // need to take the image size in dimension 0 in account.
-        const DistSizeValueType parallelLines = std::min(
-          pixelsInCacheLine,
-          size[0] - i * pixelsInCacheLine);
-
-        // Now compute the lower envelope of parabolas for each scanline
-        for (size_t line = 0; line < parallelLines; ++line)
+        // This is the inner loop where it matters to utilize L1 cache
+        for (size_t line = 0; line < parallelLines; ++line, ++offset)
           {
-          envelopeD[line].clear();
-          }
-
-        // Read a strip of parallelLines scanlines along direction d
-        for (size_t j = 0, offset = currentStripOffset;
-              j < size[d];
-              ++j, offset += strideD - parallelLines)
-          {
-          if (this->m_UseImageSpacing)
-            {
-            // This is the inner loop where it matters to utilize L1 cache
-            for (size_t line = 0; line < parallelLines; ++line, ++offset)
-              {
-              addParabola(
-                envelopeD[line], size[d],
-                j,
-                *(rawDistance + offset),
-                this->m_CreateVoronoiMap ?
-                *(rawLabel + offset) :
-                typename LabelImageType::PixelType(),
-                divisionTable);
-              }
-            }
-          else
-            {
-            // No wait, this one! ;-)
-            for (size_t line = 0; line < parallelLines; ++line, ++offset)
-              {
-              addParabola(
-                envelopeD[line], size[d],
-                j,
-                *(rawDistance + offset),
-                this->m_CreateVoronoiMap ?
-                *(rawLabel + offset) :
-                typename LabelImageType::PixelType());
-              }
-            }
-          }
-
-        // And now evaluate the lower envelope
-        //
-        // We first sample into the intermediate buffer. Each envelope samples a
-        // whole line.  This allows for efficient loop unrolling in sampleValues
-        // by the compiler and effective use of L1 cache during the sampling.
-        //
-        // We can avoid to write empty lines into the output buffer because we
-        // already know that the output image has to be all background anyway.
-        // We only have to remember that a line is empty.
-        //
-        // There is also some possibility that we can avoid to write the whole
-        // strip.
-        //
-        // In the output buffers, the scanlines are maxSize elements apart.
-        bool stripNeedsCopy = true;
-        std::vector< bool > lineNeedsCopy( parallelLines, false );
-        if (m_UseImageSpacing)
-          {
-          for (size_t line = 0, offset = 0;
-                line < parallelLines;
-                ++line, offset += maxSize)
-            {
-            lineNeedsCopy[line] =
-              sampleValues(
-                envelopeD[line], 0, size[d], &valuesBuffer[offset], sqrsD);
-            stripNeedsCopy &= lineNeedsCopy[line];
-            }
+          addParabola(
+            envelopeD[line], size[d],
+            j,
+            *(rawDistance + offset),
+            this->m_CreateVoronoiMap ?
+            *(rawLabel + offset) :
+            typename LabelImageType::PixelType(),
+            divisionTable);
           }
-        else
+        }
+      else
+        {
+        // No wait, this one! ;-)
+        for (size_t line = 0; line < parallelLines; ++line, ++offset)
           {
-          for( size_t line = 0, offset = 0;
-            line < parallelLines; ++line, offset += maxSize )
-            {
-            lineNeedsCopy[line] =
-              sampleValues(
-                envelopeD[line], 0, size[d], &valuesBuffer[offset]);
-            stripNeedsCopy &= lineNeedsCopy[line];
-            }
+          addParabola(
+            envelopeD[line], size[d],
+            j,
+            *(rawDistance + offset),
+            this->m_CreateVoronoiMap ?
+            *(rawLabel + offset) :
+            typename LabelImageType::PixelType());
           }
+        }
+      }
 
-        // Now we write the buffer to the output image. This is done in parallel
-        // for all scanlines in the strip. Therefore, we utilize the cache lines
-        // that hold a few words of each scanline in valuesBuffer and a cache
-        // line for the output to rawDistance.
-        //
-        // With probably 1000 lines of L1 cache available and much less lines in
-        // a single strip, we utilize L1 cache quite well again.
-        if (!stripNeedsCopy) continue;
-        for (size_t j = 0, outoffset = currentStripOffset;
-          j < size[d]; ++j, outoffset += strideD - parallelLines)
-          {
-          for (size_t line = 0, inoffset = j;
+    // And now evaluate the lower envelope
+    //
+    // We first sample into the intermediate buffer. Each envelope samples a
+    // whole line.  This allows for efficient loop unrolling in sampleValues
+    // by the compiler and effective use of L1 cache during the sampling.
+    //
+    // We can avoid to write empty lines into the output buffer because we
+    // already know that the output image has to be all background anyway.
+    // We only have to remember that a line is empty.
+    //
+    // There is also some possibility that we can avoid to write the whole
+    // strip.
+    //
+    // In the output buffers, the scanlines are maxSize elements apart.
+    bool stripNeedsCopy = true;
+    std::vector< bool > lineNeedsCopy( parallelLines, false );
+    if (m_UseImageSpacing)
+      {
+      for (size_t line = 0, offset = 0;
             line < parallelLines;
-            ++line,
-            inoffset += maxSize, // ...scanlines are maxSize elements apart
-            ++outoffset)
-            {
-            // outoffset advances by 1, so rawDistance is written sequentially.
-            // inoffset advances by a larger amount, but after parallelLines
-            // iterations, the cache line read first can be reused again.
-            if (lineNeedsCopy[line])
-              {
-              *(rawDistance + outoffset) = valuesBuffer[inoffset];
-              }
-            }
-          }
+            ++line, offset += maxSize)
+        {
+        lineNeedsCopy[line] =
+          sampleValues(
+            envelopeD[line], 0, size[d], &valuesBuffer[offset], sqrsD);
+        stripNeedsCopy &= lineNeedsCopy[line];
+        }
+      }
+    else
+      {
+      for( size_t line = 0, offset = 0;
+        line < parallelLines; ++line, offset += maxSize )
+        {
+        lineNeedsCopy[line] =
+          sampleValues(
+            envelopeD[line], 0, size[d], &valuesBuffer[offset]);
+        stripNeedsCopy &= lineNeedsCopy[line];
+        }
+      }
 
-        if (this->m_CreateVoronoiMap)
+    // Now we write the buffer to the output image. This is done in parallel
+    // for all scanlines in the strip. Therefore, we utilize the cache lines
+    // that hold a few words of each scanline in valuesBuffer and a cache
+    // line for the output to rawDistance.
+    //
+    // With probably 1000 lines of L1 cache available and much less lines in
+    // a single strip, we utilize L1 cache quite well again.
+    if (!stripNeedsCopy) continue;
+    for (size_t j = 0, outoffset = currentStripOffset;
+      j < size[d]; ++j, outoffset += strideD - parallelLines)
+      {
+      for (size_t line = 0, inoffset = j;
+        line < parallelLines;
+        ++line,
+        inoffset += maxSize, // ...scanlines are maxSize elements apart
+        ++outoffset)
+        {
+        // outoffset advances by 1, so rawDistance is written sequentially.
+        // inoffset advances by a larger amount, but after parallelLines
+        // iterations, the cache line read first can be reused again.
+        if (lineNeedsCopy[line])
           {
-          // More of the same
-          for (size_t line = 0, offset = 0;
-            line < parallelLines; ++line, offset += maxSize)
-               {
-               if( lineNeedsCopy[line] )
-                 {
-                 sampleVoronoi(envelopeD[line], 0, size[d],
-                   &voronoiBuffer[offset]);
-                 }
-               }
-
-          for( size_t j = 0, outoffset = currentStripOffset;
-            j < size[d];
-            ++j, outoffset += strideD - parallelLines)
-            {
-            for( size_t line = 0, inoffset = j;
-              line < parallelLines;
-              ++line, inoffset += maxSize, ++outoffset)
-              {
-              if( lineNeedsCopy[line] )
-                {
-                *(rawLabel + outoffset) = voronoiBuffer[inoffset];
-                }
-              }
-            }
+          *(rawDistance + outoffset) = valuesBuffer[inoffset];
           }
         }
+      }
 
-      // Ok, all strips are done
-      for (size_t i = 0; i < size[0]; ++i)
+    if (this->m_CreateVoronoiMap)
+      {
+      // More of the same
+      for (size_t line = 0, offset = 0;
+        line < parallelLines; ++line, offset += maxSize)
+           {
+           if( lineNeedsCopy[line] )
+             {
+             sampleVoronoi(envelopeD[line], 0, size[d],
+               &voronoiBuffer[offset]);
+             }
+           }
+
+      for( size_t j = 0, outoffset = currentStripOffset;
+        j < size[d];
+        ++j, outoffset += strideD - parallelLines)
         {
-        distanceIt.NextLine();
-        if( this->m_CreateVoronoiMap )
+        for( size_t line = 0, inoffset = j;
+          line < parallelLines;
+          ++line, inoffset += maxSize, ++outoffset)
           {
-          voronoiMapIt.NextLine();
+          if( lineNeedsCopy[line] )
+            {
+            *(rawLabel + outoffset) = voronoiBuffer[inoffset];
+            }
           }
         }
       }
     }
-} // end GenerateData()
+}
+
 
 template < class TFunctionImage, class TDistanceImage, class TLabelImage >
 typename GeneralizedDistanceTransformImageFilter<
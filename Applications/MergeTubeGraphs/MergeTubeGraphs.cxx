@@ -23,6 +23,7 @@ limitations under the License.
 
 #include "tubeMessage.h"
 #include "tubeMetaObjectDocument.h"
+#include "tubeSparseAdjacencyMatrix.h"
 
 #include <vnl/algo/vnl_matrix_inverse.h>
 
@@ -72,8 +73,8 @@ int DoIt( int argc, char * argv[] )
   logMsg << "Number of graphs " << numberOfGraphs;
   tube::InfoMessage( logMsg.str() );
 
-  vnl_matrix<double> aMat(numberOfCentroids, numberOfCentroids);
-  aMat.fill(0);
+  typedef tube::SparseAdjacencyMatrix AdjacencyMatrixType;
+  AdjacencyMatrixType::EdgeListType edges;
   vnl_vector<double> bVect(numberOfCentroids);
   bVect.fill(0);
   vnl_vector<double> rVect(numberOfCentroids);
@@ -88,12 +89,18 @@ int DoIt( int argc, char * argv[] )
     {
     filename = (*graphIt)->GetObjectName();
 
+    // The matrix may be in dense text or compact binary form
     std::string matrixFilename = filename + ".mat";
     tube::InfoMessage( "Reading file " + matrixFilename );
-    std::ifstream readMatrixStream;
-    readMatrixStream.open(matrixFilename.c_str(), std::ios::in);
-    readMatrixStream >> numberOfCentroids2;
-    readMatrixStream.get();
+    AdjacencyMatrixType graphMatrix;
+    if( !graphMatrix.Read( matrixFilename ) )
+      {
+      std::cerr << "Error: cannot read matrix " << matrixFilename
+                << std::endl;
+      delete reader;
+      return EXIT_FAILURE;
+      }
+    numberOfCentroids2 = graphMatrix.GetNumberOfNodes();
     if(numberOfCentroids != numberOfCentroids2)
       {
       std::cerr << "Error: fileList's #Centroids != matrix #Centroids"
@@ -103,16 +110,7 @@ int DoIt( int argc, char * argv[] )
       delete reader;
       return 0;
       }
-    for(int i=0; i<numberOfCentroids; i++)
-      {
-      for(int j=0; j<numberOfCentroids; j++)
-        {
-        readMatrixStream >> tf;
-        readMatrixStream.get();
-        aMat[i][j] += tf;
-        }
-      }
-    readMatrixStream.close();
+    graphMatrix.GetEdges( edges );
 
     std::string branchFilename = filename + ".brc";
     std::ifstream readBranchStream;
@@ -157,24 +155,25 @@ int DoIt( int argc, char * argv[] )
     ++graphIt;
     }
 
+  // Sum the matrices in graph order and average them
+  AdjacencyMatrixType meanMatrix;
+  meanMatrix.SetEdges( numberOfCentroids, edges );
+  meanMatrix.Normalize( numberOfGraphs );
+
   std::string matrixFile = graphFile + ".mat";
-  std::ofstream writeStream;
-  writeStream.open(matrixFile.c_str(), std::ios::binary | std::ios::out);
-  writeStream << numberOfCentroids << std::endl;
+  meanMatrix.Write( matrixFile, sparseMatrix );
+
+  // The centrality needs the inverse of the dense matrix
+  vnl_matrix<double> aMat(numberOfCentroids, numberOfCentroids);
+  aMat.fill(0);
   for(int i=0; i<numberOfCentroids; i++)
     {
-    for(int j=0; j<numberOfCentroids; j++)
+    for(AdjacencyMatrixType::EdgeIdType k = meanMatrix.GetRowBegin(i);
+      k < meanMatrix.GetRowEnd(i); k++)
       {
-      aMat[i][j] = aMat[i][j] / numberOfGraphs;
-      writeStream << aMat[i][j];
-      if(j<numberOfCentroids-1)
-        {
-        writeStream << " ";
-        }
+      aMat[i][meanMatrix.GetColumn(k)] = meanMatrix.GetValue(k);
       }
-    writeStream << std::endl;
     }
-  writeStream.close();
 
   vnl_matrix<double> iMat(numberOfCentroids, numberOfCentroids);
   iMat.set_identity();
@@ -188,6 +187,7 @@ int DoIt( int argc, char * argv[] )
   cntMatI = vnl_matrix_inverse<double>(cntMat).inverse();
   cnt = cntMatI * e;
   std::string cntFile = graphFile + ".cnt";
+  std::ofstream writeStream;
   writeStream.open(cntFile.c_str(), std::ios::binary | std::ios::out);
   writeStream << numberOfCentroids << std::endl;
   for(int i=0; i<numberOfCentroids; i++)
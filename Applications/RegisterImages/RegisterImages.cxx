@@ -419,6 +419,44 @@ int DoIt( int argc, char * argv[] )
       << std::endl;
     }
 
+  typename RegistrationType::ShrinkFactorsListType shrinkFactors;
+  for( unsigned int i = 0; i < rigidShrinkFactors.size(); i++ )
+    {
+    if( rigidShrinkFactors[i] <= 0 )
+      {
+      std::cerr << "rigidShrinkFactors must be positive." << std::endl;
+      return EXIT_FAILURE;
+      }
+    shrinkFactors.push_back( rigidShrinkFactors[i] );
+    }
+  reger->SetRigidShrinkFactors( shrinkFactors );
+  shrinkFactors.clear();
+  for( unsigned int i = 0; i < affineShrinkFactors.size(); i++ )
+    {
+    if( affineShrinkFactors[i] <= 0 )
+      {
+      std::cerr << "affineShrinkFactors must be positive." << std::endl;
+      return EXIT_FAILURE;
+      }
+    shrinkFactors.push_back( affineShrinkFactors[i] );
+    }
+  reger->SetAffineShrinkFactors( shrinkFactors );
+  if( verbosity >= STANDARD )
+    {
+    std::cout << "###RigidShrinkFactors:";
+    for( unsigned int i = 0; i < rigidShrinkFactors.size(); i++ )
+      {
+      std::cout << " " << rigidShrinkFactors[i];
+      }
+    std::cout << std::endl;
+    std::cout << "###AffineShrinkFactors:";
+    for( unsigned int i = 0; i < affineShrinkFactors.size(); i++ )
+      {
+      std::cout << " " << affineShrinkFactors[i];
+      }
+    std::cout << std::endl;
+    }
+
   /** not sure */
   if( interpolation == "NearestNeighbor" )
     {
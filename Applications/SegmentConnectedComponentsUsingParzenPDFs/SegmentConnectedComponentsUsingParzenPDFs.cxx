@@ -22,6 +22,7 @@ limitations under the License.
 =========================================================================*/
 
 #include "itktubePDFSegmenterParzen.h"
+#include "itktubePDFSegmenterParzenIO.h"
 #include "tubeMacro.h"
 
 #include "SegmentConnectedComponentsUsingParzenPDFsCLP.h"
@@ -86,6 +87,8 @@ int DoIt( int argc, char * argv[] )
 
   typedef itk::tube::PDFSegmenterParzen< InputImageType, LabelMapType >
     PDFSegmenterType;
+  typedef itk::tube::PDFSegmenterParzenIO< InputImageType, LabelMapType >
+    PDFSegmenterIOType;
 
   typedef itk::Image< float, PARZEN_MAX_NUMBER_OF_FEATURES >
     PDFImageType;
@@ -197,6 +200,7 @@ int DoIt( int argc, char * argv[] )
     probImageSmoothingStdDev );
   pdfSegmenter->SetHistogramSmoothingStandardDeviation(
     histogramSmoothingStdDev );
+  pdfSegmenter->SetUseSparsePDFs( useSparsePDFs );
   pdfSegmenter->SetReclassifyNotObjectLabels( reclassifyNotObjectLabels );
   pdfSegmenter->SetReclassifyObjectLabels( reclassifyObjectLabels );
   if( forceClassification )
@@ -204,7 +208,20 @@ int DoIt( int argc, char * argv[] )
     pdfSegmenter->SetForceClassification( true );
     }
 
-  if( loadClassPDFBase.size() > 0 )
+  if( loadClassPDFBase.size() > 0 && useSparsePDFs )
+    {
+    // Sparse class PDFs are only stored with the .mpd of the segmenter
+    std::string fname = loadClassPDFBase + ".mpd";
+    PDFSegmenterIOType pdfSegmenterIO( pdfSegmenter );
+    if( !pdfSegmenterIO.Read( fname.c_str() ) )
+      {
+      std::cout << "ERROR: Could not read sparse PDFs from " << fname
+        << std::endl;
+      return EXIT_FAILURE;
+      }
+    pdfSegmenter->ClassifyImages();
+    }
+  else if( loadClassPDFBase.size() > 0 )
     {
     unsigned int numClasses = pdfSegmenter->GetNumberOfClasses();
     std::cout << "loading classes" << std::endl;
@@ -272,7 +289,19 @@ int DoIt( int argc, char * argv[] )
   writer->SetInput( pdfSegmenter->GetLabelMap() );
   writer->Update();
 
-  if( saveClassPDFBase.size() > 0 )
+  if( saveClassPDFBase.size() > 0 && pdfSegmenter->GetPDFsAreSparse() )
+    {
+    // Sparse class PDFs are not images, save them with the .mpd writer
+    std::string fname = saveClassPDFBase + ".mpd";
+    PDFSegmenterIOType pdfSegmenterIO( pdfSegmenter );
+    if( !pdfSegmenterIO.Write( fname.c_str() ) )
+      {
+      std::cout << "ERROR: Could not write sparse PDFs to " << fname
+        << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+  else if( saveClassPDFBase.size() > 0 )
     {
     unsigned int numClasses = pdfSegmenter->GetNumberOfClasses();
     for( unsigned int i = 0; i < numClasses; i++ )
@@ -341,15 +341,17 @@ int DoIt( int argc, char * argv[] )
     teReader.Read( parametersFile.c_str() );
     }
 
-  typename IndexListType::iterator seedIndexIter =
-    seedIndexList.begin();
-  ScaleListType::iterator seedRadiusIter =
-    seedRadiusList.begin();
-
   tubeOp->SetDebug( false );
   tubeOp->GetRidgeOp()->SetDebug( false );
   tubeOp->GetRadiusOp()->SetDebug( false );
 
+  tubeOp->GetRidgeOp()->SetUseIntensityCache( useIntensityCache );
+
+  if( numberOfThreads > 0 )
+    {
+    tubeOp->SetNumberOfThreads( numberOfThreads );
+    }
+
   if( border > 0 )
     {
     typename ImageType::IndexType minIndx = inputImage->
@@ -367,33 +369,26 @@ int DoIt( int argc, char * argv[] )
     }
 
   timeCollector.Start("Ridge Extractor");
-  unsigned int count = 1;
+  typename TubeOpType::SeedRadiusListType seedRadii( seedRadiusList.begin(),
+    seedRadiusList.end() );
+  std::cout << "Extracting from " << seedIndexList.size() << " seeds."
+    << std::endl;
+  typename TubeOpType::TubeListType xTubes = tubeOp->ExtractTubes(
+    seedIndexList, seedRadii, 1, true );
+
   bool foundOneTube = false;
-  while( seedIndexIter != seedIndexList.end() )
+  for( unsigned int seedNum=0; seedNum<xTubes.size(); ++seedNum )
     {
-    tubeOp->SetRadius( *seedRadiusIter );
-
-    std::cout << "Extracting from index point " << *seedIndexIter
-      << " at radius " << *seedRadiusIter << std::endl;
-    typename TubeType::Pointer xTube =
-      tubeOp->ExtractTube( *seedIndexIter, count, true );
-    if( !xTube.IsNull() )
+    if( !xTubes[seedNum].IsNull() )
       {
-      tubeOp->AddTube( xTube );
-      std::cout << "  Extracted " << xTube->GetPoints().size() << " points."
-        << std::endl;
       foundOneTube = true;
       }
     else
       {
       std::stringstream ss;
-      ss << "Error: Ridge not found for seed #" << count;
+      ss << "Error: Ridge not found for seed #" << seedNum+1;
       tube::Message(ss.str());
       }
-
-    ++seedIndexIter;
-    ++seedRadiusIter;
-    ++count;
     }
 
   if (!foundOneTube)
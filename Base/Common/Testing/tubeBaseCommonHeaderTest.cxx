@@ -25,6 +25,7 @@ limitations under the License.
 #include "tubeMacro.h"
 #include "tubeMessage.h"
 #include "tubeObject.h"
+#include "tubeSparseAdjacencyMatrix.h"
 #include "tubeStringUtilities.h"
 
 #include "itkMacro.h"
@@ -30,4 +30,5 @@ void RegisterTests( void )
   REGISTER_TEST( tubeMacroTest );
   REGISTER_TEST( tubeMessageTest );
   REGISTER_TEST( tubeObjectTest );
+  REGISTER_TEST( tubeSparseAdjacencyMatrixTest );
 }
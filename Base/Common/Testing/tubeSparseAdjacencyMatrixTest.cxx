@@ -0,0 +1,184 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright 2010 Kitware Inc. 28 Corporate Drive,
+Clifton Park, NY, 12065, USA.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "tubeMacro.h"
+#include "tubeSparseAdjacencyMatrix.h"
+
+#include <cstring>
+#include <sstream>
+
+namespace
+{
+
+bool CompareMatrices( const tube::SparseAdjacencyMatrix & matrix1,
+  const tube::SparseAdjacencyMatrix & matrix2 )
+{
+  if( matrix1.GetNumberOfNodes() != matrix2.GetNumberOfNodes()
+    || matrix1.GetNumberOfEdges() != matrix2.GetNumberOfEdges() )
+    {
+    return false;
+    }
+  for( unsigned int i = 0; i < matrix1.GetNumberOfNodes(); i++ )
+    {
+    for( unsigned int j = 0; j < matrix1.GetNumberOfNodes(); j++ )
+      {
+      if( matrix1.GetValue( i, j ) != matrix2.GetValue( i, j ) )
+        {
+        return false;
+        }
+      }
+    }
+  return true;
+}
+
+// A corrupted binary matrix must be rejected without changing the matrix
+bool RejectsCorruptedMatrix( const tube::SparseAdjacencyMatrix & matrix,
+  const std::string & data )
+{
+  tube::SparseAdjacencyMatrix readMatrix = matrix;
+  std::stringstream stream( data );
+  return !readMatrix.Read( stream )
+    && CompareMatrices( matrix, readMatrix );
+}
+
+} // End namespace
+
+int tubeSparseAdjacencyMatrixTest( int argc, char * argv[] )
+{
+  if( argc > 1 )
+    {
+    tubeStandardErrorMacro( << "Usage: " << argv[0] );
+
+    return EXIT_FAILURE;
+    }
+
+  typedef tube::SparseAdjacencyMatrix MatrixType;
+
+  // Repeated edges are summed
+  MatrixType::EdgeListType edges;
+  const unsigned int edgeList[5][2] = { {3, 1}, {0, 2}, {3, 1}, {0, 0},
+    {2, 3} };
+  for( unsigned int e = 0; e < 5; e++ )
+    {
+    MatrixType::EdgeType edge;
+    edge.Row = edgeList[e][0];
+    edge.Column = edgeList[e][1];
+    edge.Value = 1;
+    edges.push_back( edge );
+    }
+
+  MatrixType matrix;
+  matrix.SetEdges( 5, edges );
+
+  int result = EXIT_SUCCESS;
+  if( matrix.GetNumberOfEdges() != 4 || matrix.GetValue( 3, 1 ) != 2
+    || matrix.GetValue( 0, 2 ) != 1 || matrix.GetValue( 1, 3 ) != 0
+    || matrix.GetRowBegin( 4 ) != matrix.GetRowEnd( 4 ) )
+    {
+    tubeErrorMacro( << "Error building the matrix from edges" );
+    result = EXIT_FAILURE;
+    }
+
+  // Dense text form, as read by the original graph tools
+  std::stringstream denseStream;
+  matrix.Write( denseStream, false );
+  std::string firstRow;
+  std::getline( denseStream, firstRow );
+  std::getline( denseStream, firstRow );
+  if( firstRow != "1 0 1 0 0" )
+    {
+    tubeErrorMacro( << "Error writing the dense form: " << firstRow );
+    result = EXIT_FAILURE;
+    }
+  denseStream.seekg( 0 );
+  MatrixType denseMatrix;
+  if( !denseMatrix.Read( denseStream )
+    || !CompareMatrices( matrix, denseMatrix ) )
+    {
+    tubeErrorMacro( << "Error reading the dense form" );
+    result = EXIT_FAILURE;
+    }
+
+  // Compact binary form
+  matrix.Normalize( 2 );
+  std::stringstream sparseStream;
+  matrix.Write( sparseStream, true );
+  MatrixType sparseMatrix;
+  if( !sparseMatrix.Read( sparseStream )
+    || !CompareMatrices( matrix, sparseMatrix )
+    || sparseMatrix.GetValue( 3, 1 ) != 1 )
+    {
+    tubeErrorMacro( << "Error reading the binary form" );
+    result = EXIT_FAILURE;
+    }
+
+  // The binary form is the magic line, the numbers of nodes and edges,
+  //   then the row offsets, which are 0 2 2 3 4 4 here
+  const std::string sparseData = sparseStream.str();
+  const std::string::size_type nodesPos =
+    std::strlen( "TubeTKSparseAdjacencyMatrix\n" );
+  const std::string::size_type edgesPos =
+    nodesPos + sizeof( MatrixType::NodeIdType );
+  const std::string::size_type offsetsPos =
+    edgesPos + sizeof( MatrixType::EdgeIdType );
+
+  if( !RejectsCorruptedMatrix( matrix,
+    sparseData.substr( 0, sparseData.size() - 1 ) ) )
+    {
+    tubeErrorMacro( << "Error rejecting a truncated binary form" );
+    result = EXIT_FAILURE;
+    }
+
+  std::string corruptData = sparseData;
+  const MatrixType::EdgeIdType badOffset = 3;
+  std::memcpy( &corruptData[ offsetsPos + sizeof( MatrixType::EdgeIdType ) ],
+    &badOffset, sizeof( badOffset ) );
+  if( !RejectsCorruptedMatrix( matrix, corruptData ) )
+    {
+    tubeErrorMacro( << "Error rejecting non-monotone row offsets" );
+    result = EXIT_FAILURE;
+    }
+
+  corruptData = sparseData;
+  const MatrixType::EdgeIdType badNumberOfEdges = 3;
+  std::memcpy( &corruptData[ edgesPos ], &badNumberOfEdges,
+    sizeof( badNumberOfEdges ) );
+  if( !RejectsCorruptedMatrix( matrix, corruptData ) )
+    {
+    tubeErrorMacro( << "Error rejecting a wrong number of edges" );
+    result = EXIT_FAILURE;
+    }
+
+  corruptData = sparseData;
+  const MatrixType::NodeIdType hugeNumberOfNodes = 4000000000u;
+  std::memcpy( &corruptData[ nodesPos ], &hugeNumberOfNodes,
+    sizeof( hugeNumberOfNodes ) );
+  if( !RejectsCorruptedMatrix( matrix, corruptData ) )
+    {
+    tubeErrorMacro( << "Error rejecting a number of nodes larger than the "
+      << "file" );
+    result = EXIT_FAILURE;
+    }
+
+  return result;
+}
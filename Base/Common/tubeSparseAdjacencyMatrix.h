@@ -0,0 +1,390 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright 2010 Kitware Inc. 28 Corporate Drive,
+Clifton Park, NY, 12065, USA.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#ifndef __tubeSparseAdjacencyMatrix_h
+#define __tubeSparseAdjacencyMatrix_h
+
+#include <itkIntTypes.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace tube
+{
+
+/** Adjacency matrix of a tube graph (the .mat file of ConvertTubeToTubeGraph
+ *  and MergeTubeGraphs) stored in compressed sparse row form.
+ *
+ *  Two file forms are supported: the original dense text matrix (the
+ *  number of nodes, then one line of values per row) and a compact binary
+ *  form that only stores the non-zero entries.  Read() detects which one
+ *  it is given.  The binary form is written in native byte order. */
+class SparseAdjacencyMatrix
+{
+public:
+
+  typedef double                        ValueType;
+  typedef itk::uint32_t                 NodeIdType;
+  typedef itk::uint64_t                 EdgeIdType;
+
+  struct EdgeType
+    {
+    NodeIdType                          Row;
+    NodeIdType                          Column;
+    ValueType                           Value;
+
+    bool operator<( const EdgeType & edge ) const
+      {
+      return Row < edge.Row || ( Row == edge.Row && Column < edge.Column );
+      }
+    }; // End struct EdgeType
+
+  typedef std::vector< EdgeType >       EdgeListType;
+
+  SparseAdjacencyMatrix( void )
+    : m_NumberOfNodes( 0 ), m_RowOffsets( 1, 0 )
+    {}
+
+  /** Build the matrix from a list of edges, which is sorted in place.
+   *  The values of repeated edges are summed in list order. */
+  void SetEdges( NodeIdType numberOfNodes, EdgeListType & edges );
+
+  /** Append the non-zero entries of the matrix to a list of edges */
+  void GetEdges( EdgeListType & edges ) const;
+
+  NodeIdType GetNumberOfNodes( void ) const
+    { return m_NumberOfNodes; }
+  EdgeIdType GetNumberOfEdges( void ) const
+    { return m_Columns.size(); }
+
+  /** The entries of a row are [GetRowBegin(row), GetRowEnd(row)), sorted
+   *  by column */
+  EdgeIdType GetRowBegin( NodeIdType row ) const
+    { return m_RowOffsets[row]; }
+  EdgeIdType GetRowEnd( NodeIdType row ) const
+    { return m_RowOffsets[row + 1]; }
+  NodeIdType GetColumn( EdgeIdType edge ) const
+    { return m_Columns[edge]; }
+  ValueType GetValue( EdgeIdType edge ) const
+    { return m_Values[edge]; }
+
+  /** Value at (row, column), zero if there is no such edge */
+  ValueType GetValue( NodeIdType row, NodeIdType column ) const;
+
+  /** Divide every value by divisor */
+  void Normalize( ValueType divisor );
+
+  /** Returns false, leaving the matrix unchanged, if the file cannot be
+   *  parsed or, for the binary form, is truncated or not a valid matrix */
+  bool Read( std::istream & stream );
+  bool Read( const std::string & fileName );
+
+  /** Write the binary form if sparse is true, else the dense text form */
+  bool Write( std::ostream & stream, bool sparse ) const;
+  bool Write( const std::string & fileName, bool sparse ) const;
+
+private:
+
+  static const char * GetMagicString( void )
+    { return "TubeTKSparseAdjacencyMatrix"; }
+
+  NodeIdType                            m_NumberOfNodes;
+  std::vector< EdgeIdType >             m_RowOffsets;
+  std::vector< NodeIdType >             m_Columns;
+  std::vector< ValueType >              m_Values;
+
+}; // End class SparseAdjacencyMatrix
+
+inline void
+SparseAdjacencyMatrix
+::SetEdges( NodeIdType numberOfNodes, EdgeListType & edges )
+{
+  std::stable_sort( edges.begin(), edges.end() );
+
+  m_NumberOfNodes = numberOfNodes;
+  m_RowOffsets.assign( numberOfNodes + 1, 0 );
+  m_Columns.clear();
+  m_Values.clear();
+
+  EdgeListType::const_iterator edgeIt = edges.begin();
+  while( edgeIt != edges.end() )
+    {
+    EdgeType edge = *edgeIt;
+    ++edgeIt;
+    while( edgeIt != edges.end() && edgeIt->Row == edge.Row
+      && edgeIt->Column == edge.Column )
+      {
+      edge.Value += edgeIt->Value;
+      ++edgeIt;
+      }
+    m_Columns.push_back( edge.Column );
+    m_Values.push_back( edge.Value );
+    ++m_RowOffsets[edge.Row + 1];
+    }
+  for( NodeIdType row = 0; row < numberOfNodes; row++ )
+    {
+    m_RowOffsets[row + 1] += m_RowOffsets[row];
+    }
+}
+
+inline void
+SparseAdjacencyMatrix
+::GetEdges( EdgeListType & edges ) const
+{
+  edges.reserve( edges.size() + m_Columns.size() );
+  for( NodeIdType row = 0; row < m_NumberOfNodes; row++ )
+    {
+    for( EdgeIdType k = m_RowOffsets[row]; k < m_RowOffsets[row + 1]; k++ )
+      {
+      EdgeType edge;
+      edge.Row = row;
+      edge.Column = m_Columns[k];
+      edge.Value = m_Values[k];
+      edges.push_back( edge );
+      }
+    }
+}
+
+inline SparseAdjacencyMatrix::ValueType
+SparseAdjacencyMatrix
+::GetValue( NodeIdType row, NodeIdType column ) const
+{
+  std::vector< NodeIdType >::const_iterator rowBegin =
+    m_Columns.begin() + m_RowOffsets[row];
+  std::vector< NodeIdType >::const_iterator rowEnd =
+    m_Columns.begin() + m_RowOffsets[row + 1];
+  std::vector< NodeIdType >::const_iterator it =
+    std::lower_bound( rowBegin, rowEnd, column );
+  if( it == rowEnd || *it != column )
+    {
+    return 0;
+    }
+  return m_Values[ it - m_Columns.begin() ];
+}
+
+inline void
+SparseAdjacencyMatrix
+::Normalize( ValueType divisor )
+{
+  for( EdgeIdType k = 0; k < m_Values.size(); k++ )
+    {
+    m_Values[k] = m_Values[k] / divisor;
+    }
+}
+
+inline bool
+SparseAdjacencyMatrix
+::Read( std::istream & stream )
+{
+  EdgeListType edges;
+  NodeIdType numberOfNodes = 0;
+
+  stream >> std::ws;
+  if( stream.peek() == GetMagicString()[0] )
+    {
+    std::string magic;
+    std::getline( stream, magic );
+    if( magic != GetMagicString() )
+      {
+      return false;
+      }
+    EdgeIdType numberOfEdges = 0;
+    stream.read( reinterpret_cast< char * >( &numberOfNodes ),
+      sizeof( numberOfNodes ) );
+    stream.read( reinterpret_cast< char * >( &numberOfEdges ),
+      sizeof( numberOfEdges ) );
+    if( !stream
+      || numberOfEdges > static_cast< EdgeIdType >( numberOfNodes )
+      * numberOfNodes )
+      {
+      return false;
+      }
+
+    // Reject sizes that the rest of the file cannot hold before allocating
+    const std::istream::pos_type dataBegin = stream.tellg();
+    if( dataBegin != std::istream::pos_type( -1 ) )
+      {
+      stream.seekg( 0, std::ios::end );
+      const std::istream::pos_type dataEnd = stream.tellg();
+      stream.seekg( dataBegin );
+      const EdgeIdType dataSize =
+        ( static_cast< EdgeIdType >( numberOfNodes ) + 1 )
+        * sizeof( EdgeIdType )
+        + numberOfEdges * ( sizeof( NodeIdType ) + sizeof( ValueType ) );
+      if( !stream || dataEnd < dataBegin
+        || static_cast< EdgeIdType >( dataEnd - dataBegin ) < dataSize )
+        {
+        return false;
+        }
+      }
+
+    std::vector< EdgeIdType > rowOffsets( numberOfNodes + 1 );
+    std::vector< NodeIdType > columns( numberOfEdges );
+    std::vector< ValueType > values( numberOfEdges );
+    stream.read( reinterpret_cast< char * >( &rowOffsets[0] ),
+      rowOffsets.size() * sizeof( EdgeIdType ) );
+    if( numberOfEdges > 0 )
+      {
+      stream.read( reinterpret_cast< char * >( &columns[0] ),
+        numberOfEdges * sizeof( NodeIdType ) );
+      stream.read( reinterpret_cast< char * >( &values[0] ),
+        numberOfEdges * sizeof( ValueType ) );
+      }
+    if( stream.fail() || rowOffsets[0] != 0
+      || rowOffsets[numberOfNodes] != numberOfEdges )
+      {
+      return false;
+      }
+
+    // The rows must be contiguous, with their columns sorted and in range
+    for( NodeIdType row = 0; row < numberOfNodes; row++ )
+      {
+      if( rowOffsets[row + 1] < rowOffsets[row] )
+        {
+        return false;
+        }
+      for( EdgeIdType k = rowOffsets[row]; k < rowOffsets[row + 1]; k++ )
+        {
+        if( columns[k] >= numberOfNodes
+          || ( k > rowOffsets[row] && columns[k] <= columns[k - 1] ) )
+          {
+          return false;
+          }
+        }
+      }
+
+    m_NumberOfNodes = numberOfNodes;
+    m_RowOffsets.swap( rowOffsets );
+    m_Columns.swap( columns );
+    m_Values.swap( values );
+    return true;
+    }
+
+  // Dense text form
+  stream >> numberOfNodes;
+  stream.get();
+  ValueType value;
+  for( NodeIdType row = 0; row < numberOfNodes; row++ )
+    {
+    for( NodeIdType column = 0; column < numberOfNodes; column++ )
+      {
+      stream >> value;
+      stream.get();
+      if( value != 0 )
+        {
+        EdgeType edge;
+        edge.Row = row;
+        edge.Column = column;
+        edge.Value = value;
+        edges.push_back( edge );
+        }
+      }
+    }
+  if( stream.fail() )
+    {
+    return false;
+    }
+  this->SetEdges( numberOfNodes, edges );
+  return true;
+}
+
+inline bool
+SparseAdjacencyMatrix
+::Read( const std::string & fileName )
+{
+  std::ifstream stream( fileName.c_str(), std::ios::binary | std::ios::in );
+  if( !stream )
+    {
+    return false;
+    }
+  return this->Read( stream );
+}
+
+inline bool
+SparseAdjacencyMatrix
+::Write( std::ostream & stream, bool sparse ) const
+{
+  if( sparse )
+    {
+    const EdgeIdType numberOfEdges = m_Columns.size();
+    stream << GetMagicString() << "\n";
+    stream.write( reinterpret_cast< const char * >( &m_NumberOfNodes ),
+      sizeof( m_NumberOfNodes ) );
+    stream.write( reinterpret_cast< const char * >( &numberOfEdges ),
+      sizeof( numberOfEdges ) );
+    stream.write( reinterpret_cast< const char * >( &m_RowOffsets[0] ),
+      m_RowOffsets.size() * sizeof( EdgeIdType ) );
+    if( numberOfEdges > 0 )
+      {
+      stream.write( reinterpret_cast< const char * >( &m_Columns[0] ),
+        numberOfEdges * sizeof( NodeIdType ) );
+      stream.write( reinterpret_cast< const char * >( &m_Values[0] ),
+        numberOfEdges * sizeof( ValueType ) );
+      }
+    return !stream.fail();
+    }
+
+  // Dense text form, one row at a time
+  stream << m_NumberOfNodes << std::endl;
+  for( NodeIdType row = 0; row < m_NumberOfNodes; row++ )
+    {
+    EdgeIdType k = m_RowOffsets[row];
+    for( NodeIdType column = 0; column < m_NumberOfNodes; column++ )
+      {
+      if( k < m_RowOffsets[row + 1] && m_Columns[k] == column )
+        {
+        stream << m_Values[k];
+        ++k;
+        }
+      else
+        {
+        stream << 0;
+        }
+      if( column < m_NumberOfNodes - 1 )
+        {
+        stream << " ";
+        }
+      }
+    stream << std::endl;
+    }
+  return !stream.fail();
+}
+
+inline bool
+SparseAdjacencyMatrix
+::Write( const std::string & fileName, bool sparse ) const
+{
+  std::ofstream stream( fileName.c_str(), std::ios::binary | std::ios::out );
+  if( !stream )
+    {
+    return false;
+    }
+  return this->Write( stream, sparse );
+}
+
+} // End namespace tube
+
+#endif // End !defined(__tubeSparseAdjacencyMatrix_h)
@@ -25,6 +25,32 @@ limitations under the License.
 
 #include <itkImageFileReader.h>
 #include <itkImageFileWriter.h>
+#include <itkImageRegionConstIteratorWithIndex.h>
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+template< class TImage >
+bool
+CompareFFTGaussianDerivativeImages( const TImage * image1,
+  const TImage * image2, const typename TImage::RegionType & region,
+  double tolerance, const std::string & description )
+{
+  itk::ImageRegionConstIteratorWithIndex< TImage > it( image1, region );
+  while( !it.IsAtEnd() )
+    {
+    const typename TImage::IndexType & index = it.GetIndex();
+    if( std::fabs( it.Get() - image2->GetPixel( index ) ) > tolerance )
+      {
+      std::cerr << description << " at " << index << ": " << it.Get()
+        << " vs " << image2->GetPixel( index ) << std::endl;
+      return false;
+      }
+    ++it;
+    }
+  return true;
+}
 
 int itktubeFFTGaussianDerivativeIFFTFilterTest( int argc, char * argv[] )
 {
@@ -32,7 +58,8 @@ int itktubeFFTGaussianDerivativeIFFTFilterTest( int argc, char * argv[] )
     {
     std::cerr << "Missing arguments." << std::endl;
     std::cerr << "Usage: " << std::endl;
-    std::cerr << argv[0] << " orderX orderY scaleX scaleY inputImage outputImage" << std::endl;
+    std::cerr << argv[0] << " orderX orderY scaleX scaleY inputImage outputImage"
+      << " [maximumFFTMemoryInMegabytes]" << std::endl;
     return EXIT_FAILURE;
     }
 
@@ -79,6 +106,12 @@ int itktubeFFTGaussianDerivativeIFFTFilterTest( int argc, char * argv[] )
   sigmas[0] = atof( argv[3] );
   sigmas[1] = atof( argv[4] );
   func->SetSigmas( sigmas );
+  const bool tiled = ( argc > 7 );
+  if( tiled )
+    {
+    func->SetMaximumFFTMemoryInMegabytes( atof( argv[7] ) );
+    func->SetNumberOfThreads( 4 );
+    }
   func->Update();
 
   WriterType::Pointer writer = WriterType::New();
@@ -96,5 +129,88 @@ int itktubeFFTGaussianDerivativeIFFTFilterTest( int argc, char * argv[] )
     return EXIT_FAILURE;
     }
 
-  return EXIT_SUCCESS;
+  if( !tiled )
+    {
+    return EXIT_SUCCESS;
+    }
+
+  // The tile layout depends on the number of threads sharing the memory
+  //   budget, but the tiled result must not
+  FunctionType::Pointer func1 = FunctionType::New();
+  func1->SetInput( inputImage );
+  func1->SetOrders( orders );
+  func1->SetSigmas( sigmas );
+  func1->SetMaximumFFTMemoryInMegabytes( atof( argv[7] ) );
+  func1->SetNumberOfThreads( 1 );
+  func1->Update();
+
+  // The untiled convolution wraps around the image, so it only matches
+  //   the tiled one farther than the kernel support from the boundary
+  FunctionType::Pointer untiled = FunctionType::New();
+  untiled->SetInput( inputImage );
+  untiled->SetOrders( orders );
+  untiled->SetSigmas( sigmas );
+  untiled->Update();
+
+  ImageType::RegionType interior = inputImage->GetLargestPossibleRegion();
+  ImageType::SizeType margin;
+  for( unsigned int i = 0; i < Dimension; ++i )
+    {
+    margin[i] = static_cast< ImageType::SizeValueType >(
+      std::ceil( 5 * sigmas[i] / inputImage->GetSpacing()[i] ) );
+    }
+  interior.ShrinkByRadius( margin );
+
+  const double tolerance = 0.01;
+  int returnStatus = EXIT_SUCCESS;
+  if( !CompareFFTGaussianDerivativeImages< ImageType >( func->GetOutput(),
+    func1->GetOutput(), func->GetOutput()->GetLargestPossibleRegion(),
+    tolerance, "Tiled result depends on the number of threads" ) )
+    {
+    returnStatus = EXIT_FAILURE;
+    }
+  if( !CompareFFTGaussianDerivativeImages< ImageType >( func->GetOutput(),
+    untiled->GetOutput(), interior, tolerance,
+    "Tiled result differs from the untiled one" ) )
+    {
+    returnStatus = EXIT_FAILURE;
+    }
+
+  // The N-jet is tiled the same way, with each tile's spectrum shared by
+  //   all the derivatives
+  ImageType::Pointer njetD;
+  std::vector< ImageType::Pointer > njetDx;
+  std::vector< ImageType::Pointer > njetDxx;
+  func->GenerateNJet( njetD, njetDx, njetDxx );
+
+  ImageType::Pointer untiledD;
+  std::vector< ImageType::Pointer > untiledDx;
+  std::vector< ImageType::Pointer > untiledDxx;
+  untiled->GenerateNJet( untiledD, untiledDx, untiledDxx );
+
+  if( !CompareFFTGaussianDerivativeImages< ImageType >( njetD, untiledD,
+    interior, tolerance, "Tiled N-jet D differs from the untiled one" ) )
+    {
+    returnStatus = EXIT_FAILURE;
+    }
+  for( unsigned int i = 0; i < njetDx.size(); ++i )
+    {
+    if( !CompareFFTGaussianDerivativeImages< ImageType >( njetDx[i],
+      untiledDx[i], interior, tolerance,
+      "Tiled N-jet Dx differs from the untiled one" ) )
+      {
+      returnStatus = EXIT_FAILURE;
+      }
+    }
+  for( unsigned int i = 0; i < njetDxx.size(); ++i )
+    {
+    if( !CompareFFTGaussianDerivativeImages< ImageType >( njetDxx[i],
+      untiledDxx[i], interior, tolerance,
+      "Tiled N-jet Dxx differs from the untiled one" ) )
+      {
+      returnStatus = EXIT_FAILURE;
+      }
+    }
+
+  return returnStatus;
 }
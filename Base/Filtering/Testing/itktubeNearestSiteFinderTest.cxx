@@ -0,0 +1,153 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright 2010 Kitware Inc. 28 Corporate Drive,
+Clifton Park, NY, 12065, USA.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "itktubeNearestSiteFinder.h"
+
+#include <itkMersenneTwisterRandomVariateGenerator.h>
+
+#include <vector>
+
+namespace
+{
+
+struct SiteIndexFunction
+{
+  typedef int SiteType;
+
+  const std::vector< itk::Index< 3 > > * Indices;
+
+  double operator()( int site, unsigned int dimension ) const
+    {
+    return ( *Indices )[site][dimension];
+    }
+};
+
+} // End namespace
+
+int itktubeNearestSiteFinderTest( int, char *[] )
+{
+  enum { Dimension = 3 };
+  typedef itk::tube::NearestSiteFinder< Dimension, SiteIndexFunction >
+    FinderType;
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator
+    RandomType;
+
+  FinderType::SizeType size;
+  size[0] = 17;
+  size[1] = 13;
+  size[2] = 11;
+  const int numberOfVoxels = size[0] * size[1] * size[2];
+
+  itk::MultiThreader::Pointer threader = itk::MultiThreader::New();
+  threader->SetNumberOfThreads( 3 );
+
+  // Without any site, no voxel gets one
+  FinderType::SiteArrayType sites( numberOfVoxels, -1 );
+  std::vector< itk::Index< Dimension > > indices;
+  SiteIndexFunction siteIndex;
+  siteIndex.Indices = &indices;
+  FinderType::FindNearestSites( size, siteIndex, sites, threader );
+  for( int p = 0; p < numberOfVoxels; p++ )
+    {
+    if( sites[p] != -1 )
+      {
+      std::cerr << "Voxel " << p << " got a site in an empty grid"
+        << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // Random sites, two of them on the same line
+  RandomType::Pointer random = RandomType::New();
+  random->Initialize( 1234 );
+  const int numberOfSites = 20;
+  for( int s = 0; s < numberOfSites; s++ )
+    {
+    itk::Index< Dimension > index;
+    int p;
+    do
+      {
+      for( unsigned int i = 0; i < Dimension; i++ )
+        {
+        index[i] = random->GetIntegerVariate( size[i] - 1 );
+        }
+      if( s == 1 )
+        {
+        index[1] = indices[0][1];
+        index[2] = indices[0][2];
+        }
+      p = index[0] + size[0] * ( index[1] + size[1] * index[2] );
+      }
+    while( sites[p] != -1 );
+    sites[p] = s;
+    indices.push_back( index );
+    }
+  FinderType::FindNearestSites( size, siteIndex, sites, threader );
+
+  // Compare to the brute force distance transform; ties may pick either
+  int returnStatus = EXIT_SUCCESS;
+  int p = 0;
+  for( itk::IndexValueType z = 0; z < ( itk::IndexValueType )size[2]; z++ )
+    {
+    for( itk::IndexValueType y = 0; y < ( itk::IndexValueType )size[1];
+      y++ )
+      {
+      for( itk::IndexValueType x = 0; x < ( itk::IndexValueType )size[0];
+        x++, p++ )
+        {
+        itk::IndexValueType minimum = -1;
+        for( int s = 0; s < numberOfSites; s++ )
+          {
+          const itk::IndexValueType dx = x - indices[s][0];
+          const itk::IndexValueType dy = y - indices[s][1];
+          const itk::IndexValueType dz = z - indices[s][2];
+          const itk::IndexValueType d = dx * dx + dy * dy + dz * dz;
+          if( minimum < 0 || d < minimum )
+            {
+            minimum = d;
+            }
+          }
+        if( sites[p] < 0 || sites[p] >= numberOfSites )
+          {
+          std::cerr << "Voxel " << x << "," << y << "," << z
+            << " has no site" << std::endl;
+          return EXIT_FAILURE;
+          }
+        const itk::Index< Dimension > & site = indices[sites[p]];
+        const itk::IndexValueType dx = x - site[0];
+        const itk::IndexValueType dy = y - site[1];
+        const itk::IndexValueType dz = z - site[2];
+        if( dx * dx + dy * dy + dz * dz != minimum )
+          {
+          std::cerr << "Voxel " << x << "," << y << "," << z
+            << ": squared distance " << dx * dx + dy * dy + dz * dz
+            << " to site " << sites[p] << ", expected " << minimum
+            << std::endl;
+          returnStatus = EXIT_FAILURE;
+          }
+        }
+      }
+    }
+
+  return returnStatus;
+}
@@ -0,0 +1,202 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright 2010 Kitware Inc. 28 Corporate Drive,
+Clifton Park, NY, 12065, USA.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "itktubeTortuosityTubeTreeSpatialObjectFilter.h"
+
+#include <itkGroupSpatialObject.h>
+#include <itkMath.h>
+#include <itkVesselTubeSpatialObject.h>
+
+#include <cmath>
+#include <sstream>
+
+int itktubeTortuosityTubeTreeSpatialObjectFilterTest( int, char *[] )
+{
+  enum { Dimension = 3 };
+  typedef itk::VesselTubeSpatialObject< Dimension > TubeSpatialObjectType;
+  typedef itk::GroupSpatialObject< Dimension >      GroupSpatialObjectType;
+
+  typedef itk::tube::TortuosityTubeTreeSpatialObjectFilter<
+    GroupSpatialObjectType, TubeSpatialObjectType > FilterType;
+  typedef FilterType::TortuosityFilterType          TubeFilterType;
+
+  // Build a tree of sine tubes, with a tube too short to be measured
+  GroupSpatialObjectType::Pointer group = GroupSpatialObjectType::New();
+  TubeSpatialObjectType::Pointer parent = NULL;
+  for( int t = 0; t < 7; t++ )
+    {
+    TubeSpatialObjectType::Pointer tube = TubeSpatialObjectType::New();
+    tube->SetId( t );
+    TubeSpatialObjectType::PointListType pointList;
+    int numberOfPoints = ( t == 3 ) ? 1 : 40 + 15 * t;
+    for( int i = 0; i < numberOfPoints; i++ )
+      {
+      double x = 0.1 * i;
+      TubeSpatialObjectType::TubePointType point;
+      point.SetPosition( x, ( 1 + t ) * 0.3 * std::sin( x * ( 1 + t % 3 ) ),
+        0.05 * t * x );
+      point.SetRadius( 1.0 + 0.1 * t );
+      pointList.push_back( point );
+      }
+    tube->SetPoints( pointList );
+    if( t % 2 == 0 || parent.IsNull() )
+      {
+      group->AddSpatialObject( tube );
+      }
+    else
+      {
+      parent->AddSpatialObject( tube );
+      }
+    parent = tube;
+    }
+
+  int measureFlag = TubeFilterType::BITMASK_ALL_METRICS;
+  unsigned int numberOfBins = 10;
+
+  FilterType::Pointer filter = FilterType::New();
+  filter->SetInput( group );
+  filter->SetMeasureFlag( measureFlag );
+  filter->SetSmoothingScale( 2.0 );
+  filter->SetNumberOfBins( numberOfBins );
+  filter->SetNumberOfThreads( 3 );
+  try
+    {
+    filter->Update();
+    }
+  catch( itk::ExceptionObject & error )
+    {
+    std::cerr << "Error: " << error << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // TubeIDs, NumberOfPoints, 11 vessel-wise metrics, Tau4 and the bins
+  if( filter->GetNumberOfColumns() != 2 + 11 + 1 + numberOfBins )
+    {
+    std::cerr << "Wrong number of columns: "
+      << filter->GetNumberOfColumns() << std::endl;
+    return EXIT_FAILURE;
+    }
+  if( filter->GetNumberOfRows() != 7 )
+    {
+    std::cerr << "Wrong number of rows: " << filter->GetNumberOfRows()
+      << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Histogram columns keep the names of ComputeTubeTortuosityMeasures
+  if( filter->GetColumnName( 2 + 11 + 1 + 1 ) != "Hist-Bin#1: 0.1 - 0.2" )
+    {
+    std::cerr << "Wrong histogram column name: "
+      << filter->GetColumnName( 2 + 11 + 1 + 1 ) << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Each row must match a TortuositySpatialObjectFilter run on its tube
+  char childName[] = "Tube";
+  GroupSpatialObjectType::ChildrenListType * children =
+    group->GetChildren( group->GetMaximumDepth(), childName );
+  GroupSpatialObjectType::ChildrenListType::iterator it = children->begin();
+  unsigned int row = 0;
+  int returnStatus = EXIT_SUCCESS;
+  while( it != children->end() )
+    {
+    TubeSpatialObjectType * tube =
+      dynamic_cast< TubeSpatialObjectType * >( it->GetPointer() );
+    ++it;
+
+    // A tube too short to be measured keeps its row, without metrics
+    std::vector< double > expected;
+    expected.push_back( row );
+    expected.push_back( tube->GetNumberOfPoints() );
+    if( tube->GetNumberOfPoints() < 2 )
+      {
+      expected.resize( filter->GetNumberOfColumns(), -1.0 );
+      }
+    else
+      {
+      TubeFilterType::Pointer tubeFilter = TubeFilterType::New();
+      tubeFilter->SetMeasureFlag( measureFlag );
+      tubeFilter->SetSmoothingScale( 2.0 );
+      tubeFilter->SetNumberOfBins( numberOfBins );
+      tubeFilter->SetInput( tube );
+      tubeFilter->Update();
+
+      expected.push_back( tubeFilter->GetDistanceMetric() );
+      expected.push_back( tubeFilter->GetInflectionCountMetric() );
+      expected.push_back( tubeFilter->GetSumOfAnglesMetric() );
+      expected.push_back( tubeFilter->GetPathLengthMetric() );
+      expected.push_back( tubeFilter->GetChordLengthMetric() );
+      expected.push_back( tubeFilter->GetTotalCurvatureMetric() );
+      expected.push_back( tubeFilter->GetTotalSquaredCurvatureMetric() );
+      expected.push_back( tubeFilter->GetInflectionCount1Metric() );
+      expected.push_back( tubeFilter->GetInflectionCount2Metric() );
+      expected.push_back( tubeFilter->GetPercentile95Metric() );
+      expected.push_back( tubeFilter->GetAverageRadiusMetric() );
+      expected.push_back( tubeFilter->GetTotalCurvatureMetric()
+        / tubeFilter->GetPathLengthMetric() );
+      for( unsigned int i = 0; i < numberOfBins; i++ )
+        {
+        expected.push_back( tubeFilter->GetCurvatureHistogramMetric( i ) );
+        }
+      }
+
+    for( unsigned int column = 0; column < expected.size(); column++ )
+      {
+      double value = filter->GetColumn( column )[row];
+      if( !itk::Math::FloatAlmostEqual( value, expected[column], 4, 1e-8 ) )
+        {
+        std::cerr << "Row " << row << ", column "
+          << filter->GetColumnName( column ) << ": expected "
+          << expected[column] << " got " << value << std::endl;
+        returnStatus = EXIT_FAILURE;
+        }
+      }
+    ++row;
+    }
+  delete children;
+
+  // The CSV has a header line and one line per tube
+  std::ostringstream csv;
+  filter->WriteCSV( csv );
+  std::string text = csv.str();
+  if( text.compare( 0, 27, "\"TubeIDs\",\"NumberOfPoints\"," ) != 0 )
+    {
+    std::cerr << "Wrong CSV header" << std::endl;
+    returnStatus = EXIT_FAILURE;
+    }
+  size_t numberOfLines = 0;
+  for( size_t i = 0; i < text.size(); i++ )
+    {
+    if( text[i] == '\n' )
+      {
+      ++numberOfLines;
+      }
+    }
+  if( numberOfLines != filter->GetNumberOfRows() + 1 )
+    {
+    std::cerr << "Wrong number of CSV lines: " << numberOfLines << std::endl;
+    returnStatus = EXIT_FAILURE;
+    }
+
+  return returnStatus;
+}
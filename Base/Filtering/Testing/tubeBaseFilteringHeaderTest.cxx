@@ -33,6 +33,7 @@ limitations under the License.
 #include "itktubeGaussianDerivativeFilter.h"
 #include "itktubeFFTGaussianDerivativeIFFTFilter.h"
 #include "itktubeMinimumSpanningTreeVesselConnectivityFilter.h"
+#include "itktubeNearestSiteFinder.h"
 #include "itktubeRidgeFFTFilter.h"
 #include "itktubeSheetnessMeasureImageFilter.h"
 #include "itktubeShrinkWithBlendingImageFilter.h"
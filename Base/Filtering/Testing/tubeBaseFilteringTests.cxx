@@ -34,6 +34,7 @@ void RegisterTests( void )
   REGISTER_TEST( itktubeCVTImageFilterTest );
   REGISTER_TEST( itktubeExtractTubePointsSpatialObjectFilterTest );
   REGISTER_TEST( itktubeFFTGaussianDerivativeIFFTFilterTest );
+  REGISTER_TEST( itktubeNearestSiteFinderTest );
   REGISTER_TEST( itktubeRidgeFFTFilterTest );
   REGISTER_TEST( itktubeSubSampleTubeSpatialObjectFilterTest );
   REGISTER_TEST( itktubeSubSampleTubeTreeSpatialObjectFilterTest );
@@ -47,6 +48,7 @@ void RegisterTests( void )
   REGISTER_TEST( itktubeAnisotropicCoherenceEnhancingDiffusionImageFilterTest );
   REGISTER_TEST( itktubeAnisotropicEdgeEnhancementDiffusionImageFilterTest );
   REGISTER_TEST( itktubeTortuositySpatialObjectFilterTest );
+  REGISTER_TEST( itktubeTortuosityTubeTreeSpatialObjectFilterTest );
 
   #if defined( TubeTK_USE_GPU_ARRAYFIRE )
     REGISTER_TEST( itktubeGPUArrayFireGaussianDerivativeFilterTest );
@@ -24,12 +24,15 @@ limitations under the License.
 #ifndef __itktubeCVTImageFilter_h
 #define __itktubeCVTImageFilter_h
 
+#include "itktubeNearestSiteFinder.h"
+
 #include <itkContinuousIndex.h>
 #include <itkImage.h>
 #include <itkImageRegionIterator.h>
 #include <itkImageToImageFilter.h>
 #include <itkIndex.h>
 #include <itkMersenneTwisterRandomVariateGenerator.h>
+#include <itkMultiThreader.h>
 #include <itkProcessObject.h>
 
 #include <vector>
@@ -128,9 +131,25 @@ protected:
   double ComputeIteration(double & energyDiff);
   void ComputeSample(PointArrayType * sample, unsigned int sampleSize,
                      SamplingMethodEnum samplingMethod);
+
+  /** Assign each sample to its closest centroid, using the kd-tree built
+   *  by BuildCentroidTree() over m_Centroids.  The samples are split
+   *  across threads. */
   void ComputeClosest(const PointArrayType & sample,
-                      const PointArrayType & centroids,
-                      unsigned int * nearest);
+                      std::vector< unsigned int > & nearest);
+
+  /** Build a kd-tree over m_Centroids.  Rebuilt once per iteration. */
+  void BuildCentroidTree( void );
+
+  /** Closest centroid to a point.  Ties go to the lowest centroid id, as
+   *  with an exhaustive search. */
+  unsigned int FindClosestCentroid(const ContinuousIndexType & point) const;
+
+  /** Label each pixel of m_OutputImage with one plus the id of the
+   *  closest centroid, by a separable distance transform that propagates
+   *  the centroid ids.  Each pass over one dimension is threaded over the
+   *  image lines along it. */
+  void ComputeVoronoiLabels( void );
 
 private:
   CVTImageFilter(const Self&);
@@ -159,6 +178,47 @@ private:
   unsigned int          m_NumberOfIterationsPerBatch;
   unsigned int          m_NumberOfSamplesPerBatch;
 
+  /** Kd-tree over the centroids: a permutation of the centroid ids in
+   *  which each range is split at its middle element along the dimension
+   *  stored for that element. */
+  std::vector< unsigned int >                 m_CentroidTreeIds;
+  std::vector< unsigned int >                 m_CentroidTreeSplitDimensions;
+
+  void BuildCentroidTree( unsigned int begin, unsigned int end );
+  void FindClosestCentroid( const ContinuousIndexType & point,
+    unsigned int begin, unsigned int end, unsigned int & closest,
+    double & closestDistance ) const;
+
+  struct CentroidComponentLess
+    {
+    const PointArrayType *                    Centroids;
+    unsigned int                              Dimension;
+    bool operator()( unsigned int a, unsigned int b ) const
+      { return ( *Centroids )[a][Dimension] < ( *Centroids )[b][Dimension]; }
+    }; // End struct CentroidComponentLess
+
+  struct ClosestThreadStruct
+    {
+    Self *                                    Filter;
+    const PointArrayType *                    Sample;
+    std::vector< unsigned int > *             Nearest;
+    }; // End struct ClosestThreadStruct
+
+  static ITK_THREAD_RETURN_TYPE ClosestThreaderCallback( void * arg );
+
+  /** Voxel index of each centroid, for NearestSiteFinder */
+  struct CentroidIndexFunction
+    {
+    typedef int                               SiteType;
+
+    const std::vector< IndexType > *          Indices;
+
+    double operator()( int site, unsigned int dimension ) const
+      {
+      return ( *Indices )[site][dimension];
+      }
+    }; // End struct CentroidIndexFunction
+
 }; // End class CVTImageFilter
 
 } // End namespace tube
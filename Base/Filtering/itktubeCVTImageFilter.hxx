@@ -26,9 +26,11 @@ limitations under the License.
 
 #include "itktubeCVTImageFilter.h"
 
-#include <itkDanielssonDistanceMapImageFilter.h>
 #include <itkMersenneTwisterRandomVariateGenerator.h>
 
+#include <algorithm>
+#include <limits>
+
 namespace itk
 {
 
@@ -205,9 +207,37 @@ GenerateData( void )
     }
 
   // Generate output image
-  IndexType iIndx;
-  for( int j = 0; j < (int)m_NumberOfCentroids; j++ )
+  if( this->GetDebug() )
+    {
+    for( int j = 0; j < (int)m_NumberOfCentroids; j++ )
+      {
+      std::cout << " Final Centroid [" << j << "] = " << m_Centroids[j]
+        << std::endl;
+      }
+    }
+
+  this->ComputeVoronoiLabels();
+}
+
+
+/** ComputeVoronoiLabels */
+template< class TInputImage, class TOutputImage >
+void
+CVTImageFilter< TInputImage, TOutputImage >::
+ComputeVoronoiLabels( void )
+{
+  const SizeValueType numberOfPixels =
+    m_OutputImage->GetLargestPossibleRegion().GetNumberOfPixels();
+
+  // The site of each pixel is the id of its closest centroid, or -1.
+  //   Each centroid is first placed at the pixel containing it.
+  std::vector< int > sites( numberOfPixels, -1 );
+  std::vector< IndexType > siteIndices( m_NumberOfCentroids );
+  for( unsigned int j = 0; j < m_NumberOfCentroids; j++ )
     {
+    IndexType & iIndx = siteIndices[j];
+    SizeValueType offset = 0;
+    SizeValueType stride = 1;
     for( unsigned int i=0; i<ImageDimension; i++ )
       {
       iIndx[i] = (int)( m_Centroids[j][i] );
@@ -219,34 +249,24 @@ GenerateData( void )
         {
         iIndx[i] = m_InputImageSize[i]-1;
         }
+      offset += iIndx[i] * stride;
+      stride *= m_InputImageSize[i];
       }
-    m_OutputImage->SetPixel( iIndx, j+1 );
-    if( this->GetDebug() )
-      {
-      std::cout << " Final Centroid [" << j << "] = " << m_Centroids[j]
-        << std::endl;
-      }
+    sites[offset] = j;
     }
 
-  typedef DanielssonDistanceMapImageFilter<OutputImageType, OutputImageType>
-    DDFilterType;
-  typename DDFilterType::Pointer ddFilter = DDFilterType::New();
-  ddFilter->SetInput( m_OutputImage );
-  ddFilter->SetInputIsBinary( false );
-  ddFilter->Update();
-  typename OutputImageType::Pointer tmpImage = ddFilter->GetVoronoiMap();
+  CentroidIndexFunction centroidIndex;
+  centroidIndex.Indices = &siteIndices;
 
-  ImageRegionConstIterator< OutputImageType > tmpImageIt( tmpImage,
-    region );
-  ImageRegionIterator< OutputImageType > outputImageIt( m_OutputImage,
-    region );
-  tmpImageIt.GoToBegin();
-  outputImageIt.GoToBegin();
-  while( !tmpImageIt.IsAtEnd() )
+  this->GetMultiThreader()->SetNumberOfThreads( this->GetNumberOfThreads() );
+  NearestSiteFinder< ImageDimension, CentroidIndexFunction >::
+    FindNearestSites( m_InputImageSize, centroidIndex, sites,
+    this->GetMultiThreader() );
+
+  OutputPixelType * outputBuffer = m_OutputImage->GetBufferPointer();
+  for( SizeValueType p = 0; p < numberOfPixels; p++ )
     {
-    outputImageIt.Set( tmpImageIt.Get() );
-    ++outputImageIt;
-    ++tmpImageIt;
+    outputBuffer[p] = static_cast< OutputPixelType >( sites[p] + 1 );
     }
 }
 
@@ -260,6 +280,7 @@ ComputeIteration( double & energyDiff )
   int i;
   int j;
   int j2;
+  double dist;
 
   //  Take each generator as the first sample point for its region.
   //  This can slightly slow the convergence, but it simplifies the
@@ -268,8 +289,8 @@ ComputeIteration( double & energyDiff )
   double energy = 0.0;
 
   PointArrayType centroids2( m_NumberOfCentroids );
-  double * count = new double[m_NumberOfCentroids];
-  unsigned int * nearest = new unsigned int[m_NumberOfSamplesPerBatch];
+  std::vector< double > count( m_NumberOfCentroids );
+  std::vector< unsigned int > nearest;
   PointArrayType batch( m_NumberOfSamplesPerBatch );
 
   for( j = 0; j < (int)m_NumberOfCentroids; j++ )
@@ -278,6 +299,10 @@ ComputeIteration( double & energyDiff )
     count[j] = 1;
     }
 
+  // The centroids only move at the end of the iteration, so the tree over
+  //   them serves every batch
+  this->BuildCentroidTree();
+
   if( this->GetDebug() )
     {
     std::cout << " computing iteration..." << std::endl;
@@ -287,7 +312,6 @@ ComputeIteration( double & energyDiff )
   //
   int get;
   int have = 0;
-  double dist;
   while( have < (int)m_NumberOfSamples )
     {
     if( this->GetDebug() )
@@ -310,8 +334,10 @@ ComputeIteration( double & energyDiff )
     ComputeSample( &batch, get, m_BatchSamplingMethod );
     have = have + get;
 
-    ComputeClosest( batch, m_Centroids, nearest );
+    this->ComputeClosest( batch, nearest );
 
+    // Only the search is threaded; the samples are summed in order so
+    //   the centroids do not depend on the number of threads
     for( j = 0; j < get; j++ )
       {
       j2 = nearest[j];
@@ -320,7 +346,7 @@ ComputeIteration( double & energyDiff )
       for( i = 0; i < (int)ImageDimension; i++ )
         {
         centroids2[j2][i] = centroids2[j2][i] + batch[j][i];
-        dist = ( m_Centroids[j2][i] - batch[j][i] )
+        dist += ( m_Centroids[j2][i] - batch[j][i] )
           * ( m_Centroids[j2][i] - batch[j][i] );
         }
       energy = energy + std::sqrt( dist );
@@ -351,9 +377,6 @@ ComputeIteration( double & energyDiff )
 
   energy = energy / m_NumberOfSamples;
 
-  delete [] count;
-  delete [] nearest;
-
   return energy;
 }
 
@@ -469,41 +492,197 @@ template< class TInputImage, class TOutputImage >
 void
 CVTImageFilter< TInputImage, TOutputImage >::
 ComputeClosest( const PointArrayType & sample,
-  const PointArrayType & centroids, unsigned int * nearest )
+  std::vector< unsigned int > & nearest )
 {
   if( this->GetDebug() )
     {
     std::cout << "    computing closest" << std::endl;
     }
 
-  unsigned int numberOfSamples = sample.size();
+  nearest.resize( sample.size() );
+
+  ClosestThreadStruct str;
+  str.Filter = this;
+  str.Sample = &sample;
+  str.Nearest = &nearest;
+
+  this->GetMultiThreader()->SetNumberOfThreads( this->GetNumberOfThreads() );
+  this->GetMultiThreader()->SetSingleMethod( this->ClosestThreaderCallback,
+    &str );
+  this->GetMultiThreader()->SingleMethodExecute();
+
+  if( this->GetDebug() )
+    {
+    std::cout << "    computing closest done" << std::endl;
+    }
+}
+
+
+/** ClosestThreaderCallback */
+template< class TInputImage, class TOutputImage >
+ITK_THREAD_RETURN_TYPE
+CVTImageFilter< TInputImage, TOutputImage >::
+ClosestThreaderCallback( void * arg )
+{
+  MultiThreader::ThreadInfoStruct * info =
+    static_cast< MultiThreader::ThreadInfoStruct * >( arg );
+  ClosestThreadStruct * str =
+    static_cast< ClosestThreadStruct * >( info->UserData );
+
+  Self * filter = str->Filter;
+  const PointArrayType & sample = *( str->Sample );
+  std::vector< unsigned int > & nearest = *( str->Nearest );
+
+  const unsigned int numberOfSamples = sample.size();
+  const unsigned int firstSample =
+    ( numberOfSamples * info->ThreadID ) / info->NumberOfThreads;
+  const unsigned int lastSample =
+    ( numberOfSamples * ( info->ThreadID + 1 ) ) / info->NumberOfThreads;
+
+  for( unsigned int js = firstSample; js < lastSample; js++ )
+    {
+    nearest[js] = filter->FindClosestCentroid( sample[js] );
+    }
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+
+/** BuildCentroidTree */
+template< class TInputImage, class TOutputImage >
+void
+CVTImageFilter< TInputImage, TOutputImage >::
+BuildCentroidTree( void )
+{
+  const unsigned int numberOfCentroids = m_Centroids.size();
+  m_CentroidTreeIds.resize( numberOfCentroids );
+  m_CentroidTreeSplitDimensions.resize( numberOfCentroids );
+  for( unsigned int j = 0; j < numberOfCentroids; j++ )
+    {
+    m_CentroidTreeIds[j] = j;
+    }
+  this->BuildCentroidTree( 0, numberOfCentroids );
+}
 
-  unsigned int numberOfCentroids = centroids.size();
 
-  for( unsigned int js = 0; js < numberOfSamples; js++ )
+template< class TInputImage, class TOutputImage >
+void
+CVTImageFilter< TInputImage, TOutputImage >::
+BuildCentroidTree( unsigned int begin, unsigned int end )
+{
+  if( end - begin < 2 )
     {
-    double distMin = 1e20;
-    nearest[js] = 0;
+    if( end > begin )
+      {
+      m_CentroidTreeSplitDimensions[begin] = 0;
+      }
+    return;
+    }
 
-    for( unsigned int jc = 0; jc < numberOfCentroids; jc++ )
+  // Split along the dimension of largest extent
+  ContinuousIndexType minIndx = m_Centroids[ m_CentroidTreeIds[begin] ];
+  ContinuousIndexType maxIndx = minIndx;
+  for( unsigned int j = begin + 1; j < end; j++ )
+    {
+    const ContinuousIndexType & indx = m_Centroids[ m_CentroidTreeIds[j] ];
+    for( unsigned int i = 0; i < ImageDimension; i++ )
       {
-      double dist = 0.0;
-      for( unsigned int i = 0; i < ImageDimension; i++ )
+      if( indx[i] < minIndx[i] )
         {
-        dist += ( sample[js][i] - centroids[jc][i] )
-          * ( sample[js][i] - centroids[jc][i] );
+        minIndx[i] = indx[i];
         }
-
-      if( jc == 0 || dist < distMin )
+      else if( indx[i] > maxIndx[i] )
         {
-        distMin = dist;
-        nearest[js] = jc;
+        maxIndx[i] = indx[i];
         }
       }
     }
-  if( this->GetDebug() )
+  unsigned int splitDimension = 0;
+  for( unsigned int i = 1; i < ImageDimension; i++ )
     {
-    std::cout << "    computing closest done" << std::endl;
+    if( maxIndx[i] - minIndx[i]
+      > maxIndx[splitDimension] - minIndx[splitDimension] )
+      {
+      splitDimension = i;
+      }
+    }
+
+  const unsigned int mid = ( begin + end ) / 2;
+  CentroidComponentLess less;
+  less.Centroids = &m_Centroids;
+  less.Dimension = splitDimension;
+  std::nth_element( m_CentroidTreeIds.begin() + begin,
+    m_CentroidTreeIds.begin() + mid, m_CentroidTreeIds.begin() + end, less );
+  m_CentroidTreeSplitDimensions[mid] = splitDimension;
+
+  this->BuildCentroidTree( begin, mid );
+  this->BuildCentroidTree( mid + 1, end );
+}
+
+
+/** FindClosestCentroid */
+template< class TInputImage, class TOutputImage >
+unsigned int
+CVTImageFilter< TInputImage, TOutputImage >::
+FindClosestCentroid( const ContinuousIndexType & point ) const
+{
+  unsigned int closest = m_Centroids.size();
+  double closestDistance = std::numeric_limits< double >::max();
+  this->FindClosestCentroid( point, 0, m_CentroidTreeIds.size(), closest,
+    closestDistance );
+  return closest;
+}
+
+
+template< class TInputImage, class TOutputImage >
+void
+CVTImageFilter< TInputImage, TOutputImage >::
+FindClosestCentroid( const ContinuousIndexType & point, unsigned int begin,
+  unsigned int end, unsigned int & closest, double & closestDistance ) const
+{
+  if( begin >= end )
+    {
+    return;
+    }
+
+  const unsigned int mid = ( begin + end ) / 2;
+  const unsigned int jc = m_CentroidTreeIds[mid];
+  const ContinuousIndexType & centroid = m_Centroids[jc];
+  double dist = 0.0;
+  for( unsigned int i = 0; i < ImageDimension; i++ )
+    {
+    dist += ( point[i] - centroid[i] ) * ( point[i] - centroid[i] );
+    }
+  if( dist < closestDistance
+    || ( dist == closestDistance && jc < closest ) )
+    {
+    closestDistance = dist;
+    closest = jc;
+    }
+
+  // Ranges whose split plane is exactly as far as the closest centroid are
+  //   still visited, so that ties resolve as in an exhaustive search
+  const unsigned int splitDimension = m_CentroidTreeSplitDimensions[mid];
+  const double diff = point[splitDimension] - centroid[splitDimension];
+  if( diff < 0 )
+    {
+    this->FindClosestCentroid( point, begin, mid, closest,
+      closestDistance );
+    if( diff * diff <= closestDistance )
+      {
+      this->FindClosestCentroid( point, mid + 1, end, closest,
+        closestDistance );
+      }
+    }
+  else
+    {
+    this->FindClosestCentroid( point, mid + 1, end, closest,
+      closestDistance );
+    if( diff * diff <= closestDistance )
+      {
+      this->FindClosestCentroid( point, begin, mid, closest,
+        closestDistance );
+      }
     }
 }
 
@@ -32,6 +32,7 @@ limitations under the License.
 #include "itkImage.h"
 #include "itkInverseFFTImageFilter.h"
 #include "itkMultiplyImageFilter.h"
+#include "itkMultiThreader.h"
 #include "itkParametricImageSource.h"
 #include "itkSize.h"
 
@@ -69,6 +70,11 @@ public:
   typedef typename Superclass::OrdersType     OrdersType;
   typedef typename Superclass::SigmasType     SigmasType;
 
+  /** Limit on the memory, in megabytes, used for the FFTs.  When set, the
+   *  input is convolved in overlapping tiles.  Zero = whole image. */
+  itkSetMacro( MaximumFFTMemoryInMegabytes, double );
+  itkGetConstMacro( MaximumFFTMemoryInMegabytes, double );
+
   void GenerateNJet( typename OutputImageType::Pointer & D,
     std::vector< typename TOutputImage::Pointer > & Dx,
     std::vector< typename TOutputImage::Pointer > & Dxx );
@@ -95,8 +101,32 @@ protected:
   void ComputeConvolvedImageFFT();
   void ComputeConvolvedImage();
 
+  /** Multiply the input spectrum by one or two (if kernel2 is not NULL)
+   *  kernel spectra into m_ConvolvedImageFFT, which is reused between
+   *  calls.  The buffer is split between the filter's threads. */
+  void MultiplyInputImageFFT( const ComplexImageType * kernel1,
+    const ComplexImageType * kernel2 );
+
+  void GenerateInputRequestedRegion();
+
+  void EnlargeOutputRequestedRegion( DataObject * output );
+
   void GenerateData();
 
+  typedef typename TOutputImage::RegionType           OutputImageRegionType;
+  typedef std::vector< typename TOutputImage::Pointer >
+                                                      OutputImageListType;
+
+  /** Number of pixels, per dimension, by which a tile overlaps its
+   *  neighbours */
+  typename OutputImageRegionType::SizeType GetTileMargin( void ) const;
+
+  /** Convolve outputRegion of the input tile by tile.  With computeNJet
+   *  the outputs are D, Dx and Dxx, as returned by GenerateNJet;
+   *  otherwise the single output is the derivative given by m_Orders. */
+  void ConvolveInTiles( const OutputImageRegionType & outputRegion,
+    OutputImageListType & outputs, bool computeNJet );
+
   void PrintSelf( std::ostream & os, Indent indent ) const;
 
 private:
@@ -113,6 +143,32 @@ private:
   typename TOutputImage::Pointer                      m_ConvolvedImage;
 
   const InputImageType *                              m_LastInputImage;
+  unsigned long                                       m_LastInputImageMTime;
+
+  double                                       m_MaximumFFTMemoryInMegabytes;
+
+  struct TileThreadStruct
+    {
+    Self *                                            Filter;
+    std::vector< OutputImageRegionType >              Tiles;
+    OutputImageListType *                             Outputs;
+    bool                                              ComputeNJet;
+    }; // End struct TileThreadStruct
+
+  static ITK_THREAD_RETURN_TYPE TileThreaderCallback( void * arg );
+
+  typedef typename ComplexImageType::PixelType        ComplexPixelType;
+
+  struct MultiplyThreadStruct
+    {
+    const ComplexPixelType *                          Input;
+    const ComplexPixelType *                          Kernel1;
+    const ComplexPixelType *                          Kernel2;
+    ComplexPixelType *                                Output;
+    SizeValueType                                     NumberOfPixels;
+    }; // End struct MultiplyThreadStruct
+
+  static ITK_THREAD_RETURN_TYPE MultiplyThreaderCallback( void * arg );
 };
 
 
@@ -22,10 +22,16 @@
 #include "itktubePadImageFilter.h"
 #include "itktubeRegionFromReferenceImageFilter.h"
 
+#include <itkImageRegionConstIterator.h>
+#include <itkImageRegionIterator.h>
+#include <itkImageRegionIteratorWithIndex.h>
 #include <itkTimeProbesCollectorBase.h>
 #include <itkParametricImageSource.h>
 #include <itkSize.h>
 
+#include <algorithm>
+#include <cmath>
+
 namespace itk {
 
 namespace tube {
@@ -40,6 +46,9 @@ FFTGaussianDerivativeIFFTFilter<TInputImage, TOutputImage>
   m_ConvolvedImage = NULL;
 
   this->m_LastInputImage = NULL;
+  this->m_LastInputImageMTime = 0;
+
+  m_MaximumFFTMemoryInMegabytes = 0;
 }
 
 template< typename TInputImage, typename TOutputImage >
@@ -50,11 +59,13 @@ FFTGaussianDerivativeIFFTFilter<TInputImage, TOutputImage>
   typedef PadImageFilter< InputImageType, RealImageType >   PadFilterType;
   typename PadFilterType::Pointer padFilter = PadFilterType::New();
   padFilter->SetInput( this->GetInput() );
+  padFilter->SetNumberOfThreads( this->GetNumberOfThreads() );
   padFilter->SetGreatestPrimeFactor( 5 );
   padFilter->SetPadMethod( PadFilterType::ZERO_FLUX_NEUMANN );
   padFilter->Update();
 
   typename FFTFilterType::Pointer fftFilter = FFTFilterType::New();
+  fftFilter->SetNumberOfThreads( this->GetNumberOfThreads() );
   fftFilter->SetInput( padFilter->GetOutput() );
   fftFilter->Update();
 
@@ -68,6 +79,7 @@ FFTGaussianDerivativeIFFTFilter<TInputImage, TOutputImage>
 {
   typename GaussianDerivativeImageSourceType::Pointer gaussSource =
     GaussianDerivativeImageSourceType::New();
+  gaussSource->SetNumberOfThreads( this->GetNumberOfThreads() );
 
   const typename ComplexImageType::RegionType inputRegion(
     this->GetInput()->GetLargestPossibleRegion() );
@@ -108,10 +120,12 @@ FFTGaussianDerivativeIFFTFilter<TInputImage, TOutputImage>
 
   typename FFTShiftFilterType::Pointer fftShiftFilter =
     FFTShiftFilterType::New();
+  fftShiftFilter->SetNumberOfThreads( this->GetNumberOfThreads() );
   fftShiftFilter->SetInput( gaussSource->GetOutput() );
   fftShiftFilter->Update();
 
   typename FFTFilterType::Pointer fftFilter = FFTFilterType::New();
+  fftFilter->SetNumberOfThreads( this->GetNumberOfThreads() );
   fftFilter->SetInput( fftShiftFilter->GetOutput() );
   fftFilter->Update();
   m_KernelImageFFT = fftFilter->GetOutput();
@@ -122,13 +136,78 @@ void
 FFTGaussianDerivativeIFFTFilter<TInputImage, TOutputImage>
 ::ComputeConvolvedImageFFT()
 {
-  typename MultiplyFilterType::Pointer multiplyFilter =
-    MultiplyFilterType::New();
-  multiplyFilter->SetInput1( m_InputImageFFT );
-  multiplyFilter->SetInput2( m_KernelImageFFT );
-  multiplyFilter->Update();
+  this->MultiplyInputImageFFT( m_KernelImageFFT, NULL );
+}
+
+template< typename TInputImage, typename TOutputImage >
+void
+FFTGaussianDerivativeIFFTFilter<TInputImage, TOutputImage>
+::MultiplyInputImageFFT( const ComplexImageType * kernel1,
+  const ComplexImageType * kernel2 )
+{
+  const typename ComplexImageType::RegionType fftRegion(
+    m_InputImageFFT->GetLargestPossibleRegion() );
+
+  if( m_ConvolvedImageFFT.IsNull()
+    || m_ConvolvedImageFFT->GetLargestPossibleRegion() != fftRegion )
+    {
+    m_ConvolvedImageFFT = ComplexImageType::New();
+    m_ConvolvedImageFFT->CopyInformation( m_InputImageFFT );
+    m_ConvolvedImageFFT->SetRegions( fftRegion );
+    m_ConvolvedImageFFT->Allocate();
+    }
+
+  MultiplyThreadStruct str;
+  str.Input = m_InputImageFFT->GetBufferPointer();
+  str.Kernel1 = kernel1->GetBufferPointer();
+  str.Kernel2 = NULL;
+  if( kernel2 != NULL )
+    {
+    str.Kernel2 = kernel2->GetBufferPointer();
+    }
+  str.Output = m_ConvolvedImageFFT->GetBufferPointer();
+  str.NumberOfPixels = fftRegion.GetNumberOfPixels();
+
+  this->GetMultiThreader()->SetNumberOfThreads( this->GetNumberOfThreads() );
+  this->GetMultiThreader()->SetSingleMethod( this->MultiplyThreaderCallback,
+    &str );
+  this->GetMultiThreader()->SingleMethodExecute();
+
+  m_ConvolvedImageFFT->Modified();
+}
+
+template< typename TInputImage, typename TOutputImage >
+ITK_THREAD_RETURN_TYPE
+FFTGaussianDerivativeIFFTFilter<TInputImage, TOutputImage>
+::MultiplyThreaderCallback( void * arg )
+{
+  MultiThreader::ThreadInfoStruct * info =
+    static_cast< MultiThreader::ThreadInfoStruct * >( arg );
+  MultiplyThreadStruct * str =
+    static_cast< MultiplyThreadStruct * >( info->UserData );
+
+  const SizeValueType first = ( str->NumberOfPixels * info->ThreadID )
+    / info->NumberOfThreads;
+  const SizeValueType last = ( str->NumberOfPixels
+    * ( info->ThreadID + 1 ) ) / info->NumberOfThreads;
+
+  if( str->Kernel2 == NULL )
+    {
+    for( SizeValueType i = first; i < last; ++i )
+      {
+      str->Output[i] = str->Input[i] * str->Kernel1[i];
+      }
+    }
+  else
+    {
+    for( SizeValueType i = first; i < last; ++i )
+      {
+      str->Output[i] = ( str->Input[i] * str->Kernel1[i] )
+        * str->Kernel2[i];
+      }
+    }
 
-  m_ConvolvedImageFFT = multiplyFilter->GetOutput();
+  return ITK_THREAD_RETURN_VALUE;
 }
 
 template< typename TInputImage, typename TOutputImage >
@@ -138,6 +217,7 @@ FFTGaussianDerivativeIFFTFilter<TInputImage, TOutputImage>
 {
   typename InverseFFTFilterType::Pointer
     iFFTFilter = InverseFFTFilterType::New();
+  iFFTFilter->SetNumberOfThreads( this->GetNumberOfThreads() );
   iFFTFilter->SetInput( m_ConvolvedImageFFT );
   iFFTFilter->Update();
 
@@ -145,12 +225,264 @@ FFTGaussianDerivativeIFFTFilter<TInputImage, TOutputImage>
     RegionFromFilterType;
   typename RegionFromFilterType::Pointer regionFrom =
     RegionFromFilterType::New();
+  regionFrom->SetNumberOfThreads( this->GetNumberOfThreads() );
 
   regionFrom->SetInput1( iFFTFilter->GetOutput() );
   regionFrom->SetInput2( this->GetInput() );
   regionFrom->Update();
 
+  // m_ConvolvedImageFFT is overwritten by the next convolution
   m_ConvolvedImage = regionFrom->GetOutput();
+  m_ConvolvedImage->DisconnectPipeline();
+}
+
+template< typename TInputImage, typename TOutputImage >
+void
+FFTGaussianDerivativeIFFTFilter<TInputImage, TOutputImage>
+::GenerateInputRequestedRegion()
+{
+  Superclass::GenerateInputRequestedRegion();
+
+  InputImageType * input = const_cast< InputImageType * >(
+    this->GetInput() );
+  if( input == NULL )
+    {
+    return;
+    }
+
+  if( m_MaximumFFTMemoryInMegabytes > 0 )
+    {
+    typename InputImageType::RegionType region =
+      this->GetOutput()->GetRequestedRegion();
+    region.PadByRadius( this->GetTileMargin() );
+    region.Crop( input->GetLargestPossibleRegion() );
+    input->SetRequestedRegion( region );
+    }
+  else
+    {
+    input->SetRequestedRegionToLargestPossibleRegion();
+    }
+}
+
+template< typename TInputImage, typename TOutputImage >
+void
+FFTGaussianDerivativeIFFTFilter<TInputImage, TOutputImage>
+::EnlargeOutputRequestedRegion( DataObject * output )
+{
+  Superclass::EnlargeOutputRequestedRegion( output );
+
+  // Without tiling the whole image is convolved at once
+  if( m_MaximumFFTMemoryInMegabytes <= 0 )
+    {
+    output->SetRequestedRegionToLargestPossibleRegion();
+    }
+}
+
+template< typename TInputImage, typename TOutputImage >
+typename FFTGaussianDerivativeIFFTFilter<TInputImage, TOutputImage>
+::OutputImageRegionType::SizeType
+FFTGaussianDerivativeIFFTFilter<TInputImage, TOutputImage>
+::GetTileMargin( void ) const
+{
+  // Gaussian derivatives up to second order are negligible beyond five
+  //   sigma, so a margin that wide hides the tile boundaries
+  const typename InputImageType::SpacingType spacing =
+    this->GetInput()->GetSpacing();
+
+  typename OutputImageRegionType::SizeType margin;
+  for( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    margin[i] = static_cast< SizeValueType >(
+      std::ceil( 5 * this->m_Sigmas[i] / spacing[i] ) );
+    }
+  return margin;
+}
+
+template< typename TInputImage, typename TOutputImage >
+void
+FFTGaussianDerivativeIFFTFilter<TInputImage, TOutputImage>
+::ConvolveInTiles( const OutputImageRegionType & outputRegion,
+  OutputImageListType & outputs, bool computeNJet )
+{
+  const typename OutputImageRegionType::SizeType margin =
+    this->GetTileMargin();
+  const typename OutputImageRegionType::SizeType regionSize =
+    outputRegion.GetSize();
+  const typename OutputImageRegionType::IndexType regionIndex =
+    outputRegion.GetIndex();
+
+  // A tile holds the input, product and kernel spectra (one kernel, or
+  //   the zeroth and first order kernels for an N-jet) plus about one
+  //   more complex image worth of real-valued FFT buffers
+  unsigned int numSpectra = 4;
+  if( computeNJet )
+    {
+    numSpectra = ImageDimension + 4;
+    }
+  const unsigned int numThreads = this->GetNumberOfThreads();
+  const double tileBytes = m_MaximumFFTMemoryInMegabytes * 1024 * 1024
+    / numThreads;
+  const double tileLength = std::pow( tileBytes / ( numSpectra
+    * sizeof( typename ComplexImageType::PixelType ) ),
+    1.0 / ImageDimension );
+
+  typename OutputImageRegionType::SizeType coreSize;
+  typename OutputImageRegionType::SizeType numTiles;
+  SizeValueType totalTiles = 1;
+  for( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    // If the budget is too small for the sigmas, exceed it rather than
+    //   spend most of each tile on its margins
+    double core = tileLength - 2 * margin[i];
+    if( core < margin[i] )
+      {
+      core = margin[i];
+      }
+    if( core < 1 )
+      {
+      core = 1;
+      }
+    coreSize[i] = std::min( static_cast< SizeValueType >( core ),
+      regionSize[i] );
+    numTiles[i] = ( regionSize[i] + coreSize[i] - 1 ) / coreSize[i];
+    totalTiles *= numTiles[i];
+    }
+
+  TileThreadStruct str;
+  str.Filter = this;
+  str.Outputs = &outputs;
+  str.ComputeNJet = computeNJet;
+  str.Tiles.resize( totalTiles );
+  for( SizeValueType t = 0; t < totalTiles; ++t )
+    {
+    typename OutputImageRegionType::IndexType tileIndex;
+    typename OutputImageRegionType::SizeType tileSize;
+    SizeValueType remainder = t;
+    for( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      const SizeValueType tileNum = remainder % numTiles[i];
+      remainder /= numTiles[i];
+      tileIndex[i] = regionIndex[i] + tileNum * coreSize[i];
+      tileSize[i] = std::min( coreSize[i],
+        static_cast< SizeValueType >( regionIndex[i] + regionSize[i]
+          - tileIndex[i] ) );
+      }
+    str.Tiles[t].SetIndex( tileIndex );
+    str.Tiles[t].SetSize( tileSize );
+    }
+
+  MultiThreader::Pointer threader = MultiThreader::New();
+  threader->SetNumberOfThreads( std::min( static_cast< SizeValueType >(
+    numThreads ), totalTiles ) );
+  threader->SetSingleMethod( this->TileThreaderCallback, &str );
+  threader->SingleMethodExecute();
+}
+
+template< typename TInputImage, typename TOutputImage >
+ITK_THREAD_RETURN_TYPE
+FFTGaussianDerivativeIFFTFilter<TInputImage, TOutputImage>
+::TileThreaderCallback( void * arg )
+{
+  MultiThreader::ThreadInfoStruct * info =
+    static_cast< MultiThreader::ThreadInfoStruct * >( arg );
+  TileThreadStruct * str =
+    static_cast< TileThreadStruct * >( info->UserData );
+
+  const InputImageType * input = str->Filter->GetInput();
+  const typename OutputImageRegionType::SizeType margin =
+    str->Filter->GetTileMargin();
+  SigmasType sigmas = str->Filter->GetSigmas();
+  OrdersType orders = str->Filter->GetOrders();
+
+  for( SizeValueType t = info->ThreadID; t < str->Tiles.size();
+    t += info->NumberOfThreads )
+    {
+    const OutputImageRegionType & core = str->Tiles[t];
+    typename InputImageType::RegionType padded = core;
+    padded.PadByRadius( margin );
+
+    // The tile is copied, rather than extracted by a filter, so that no
+    //   thread updates the shared upstream pipeline.  Beyond the image
+    //   boundary the tile is extended by the nearest image value, so that
+    //   every tile sees the same zero-flux extension of the image and
+    //   the result does not depend on the tile layout.
+    typename InputImageType::Pointer tileImage = InputImageType::New();
+    typename InputImageType::RegionType tileRegion;
+    tileRegion.SetSize( padded.GetSize() );
+    typename InputImageType::PointType tileOrigin;
+    input->TransformIndexToPhysicalPoint( padded.GetIndex(), tileOrigin );
+    tileImage->SetRegions( tileRegion );
+    tileImage->SetOrigin( tileOrigin );
+    tileImage->SetSpacing( input->GetSpacing() );
+    tileImage->SetDirection( input->GetDirection() );
+    tileImage->Allocate();
+    const typename InputImageType::RegionType & inputRegion =
+      input->GetLargestPossibleRegion();
+    ImageRegionIteratorWithIndex< InputImageType > tileIt( tileImage,
+      tileRegion );
+    while( !tileIt.IsAtEnd() )
+      {
+      typename InputImageType::IndexType inputIndex;
+      for( unsigned int i = 0; i < ImageDimension; ++i )
+        {
+        inputIndex[i] = padded.GetIndex()[i] + tileIt.GetIndex()[i];
+        const IndexValueType minIndex = inputRegion.GetIndex()[i];
+        const IndexValueType maxIndex = minIndex
+          + static_cast< IndexValueType >( inputRegion.GetSize()[i] ) - 1;
+        inputIndex[i] = std::max( minIndex,
+          std::min( maxIndex, inputIndex[i] ) );
+        }
+      tileIt.Set( input->GetPixel( inputIndex ) );
+      ++tileIt;
+      }
+
+    typename Self::Pointer tileFilter = Self::New();
+    tileFilter->SetNumberOfThreads( 1 );
+    tileFilter->SetInput( tileImage );
+    tileFilter->SetSigmas( sigmas );
+
+    OutputImageListType tileOutputs;
+    if( str->ComputeNJet )
+      {
+      typename TOutputImage::Pointer d;
+      OutputImageListType dX;
+      OutputImageListType dXX;
+      tileFilter->GenerateNJet( d, dX, dXX );
+      tileOutputs.push_back( d );
+      tileOutputs.insert( tileOutputs.end(), dX.begin(), dX.end() );
+      tileOutputs.insert( tileOutputs.end(), dXX.begin(), dXX.end() );
+      }
+    else
+      {
+      tileFilter->SetOrders( orders );
+      tileFilter->Update();
+      tileOutputs.push_back( tileFilter->GetOutput() );
+      }
+
+    // Keep only the center of the tile
+    OutputImageRegionType tileCore = core;
+    typename OutputImageRegionType::IndexType tileCoreIndex;
+    for( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      tileCoreIndex[i] = core.GetIndex()[i] - padded.GetIndex()[i];
+      }
+    tileCore.SetIndex( tileCoreIndex );
+    for( unsigned int o = 0; o < tileOutputs.size(); ++o )
+      {
+      ImageRegionConstIterator< TOutputImage > fromIt( tileOutputs[o],
+        tileCore );
+      ImageRegionIterator< TOutputImage > toIt( ( *str->Outputs )[o],
+        core );
+      while( !fromIt.IsAtEnd() )
+        {
+        toIt.Set( fromIt.Get() );
+        ++fromIt;
+        ++toIt;
+        }
+      }
+    }
+
+  return ITK_THREAD_RETURN_VALUE;
 }
 
 template< typename TInputImage, typename TOutputImage >
@@ -158,9 +490,20 @@ void
 FFTGaussianDerivativeIFFTFilter<TInputImage, TOutputImage>
 ::GenerateData()
 {
-  if( m_LastInputImage != this->GetInput() )
+  if( m_MaximumFFTMemoryInMegabytes > 0 )
+    {
+    this->AllocateOutputs();
+    OutputImageListType outputs( 1, this->GetOutput() );
+    this->ConvolveInTiles( this->GetOutput()->GetRequestedRegion(),
+      outputs, false );
+    return;
+    }
+
+  if( m_LastInputImage != this->GetInput()
+    || m_LastInputImageMTime != this->GetInput()->GetMTime() )
     {
     m_LastInputImage = this->GetInput();
+    m_LastInputImageMTime = this->GetInput()->GetMTime();
     ComputeInputImageFFT();
     }
 
@@ -178,13 +521,6 @@ FFTGaussianDerivativeIFFTFilter<TInputImage, TOutputImage>
   std::vector< typename TOutputImage::Pointer > & dX,
   std::vector< typename TOutputImage::Pointer > & dXX )
 {
-
-  if( m_LastInputImage != this->GetInput() )
-    {
-    m_LastInputImage = this->GetInput();
-    ComputeInputImageFFT();
-    }
-
   if( dX.size() != ImageDimension )
     {
     dX.resize( ImageDimension );
@@ -202,6 +538,43 @@ FFTGaussianDerivativeIFFTFilter<TInputImage, TOutputImage>
     dXX.resize( ddxSize );
     }
 
+  if( m_MaximumFFTMemoryInMegabytes > 0 )
+    {
+    const OutputImageRegionType region =
+      this->GetInput()->GetLargestPossibleRegion();
+    OutputImageListType outputs( 1 + ImageDimension + ddxSize );
+    for( unsigned int o = 0; o < outputs.size(); ++o )
+      {
+      outputs[o] = TOutputImage::New();
+      outputs[o]->CopyInformation( this->GetInput() );
+      outputs[o]->SetRegions( region );
+      outputs[o]->Allocate();
+      }
+    this->ConvolveInTiles( region, outputs, true );
+
+    D = outputs[0];
+    for( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      dX[i] = outputs[1 + i];
+      }
+    for( unsigned int i = 0; i < ddxSize; ++i )
+      {
+      dXX[i] = outputs[1 + ImageDimension + i];
+      }
+    this->SetNthOutput( 0, D );
+    return;
+    }
+
+  // The input spectrum is kept between calls, so a multi-scale caller
+  //   only pays for the kernel spectra and inverse FFTs of each scale
+  if( m_LastInputImage != this->GetInput()
+    || m_LastInputImageMTime != this->GetInput()->GetMTime() )
+    {
+    m_LastInputImage = this->GetInput();
+    m_LastInputImageMTime = this->GetInput()->GetMTime();
+    ComputeInputImageFFT();
+    }
+
   this->m_Orders.Fill( 0 );
   this->ComputeKernelImageFFT();
   this->ComputeConvolvedImageFFT();
@@ -219,30 +592,18 @@ FFTGaussianDerivativeIFFTFilter<TInputImage, TOutputImage>
     this->m_Orders[i] = 0;
     }
 
-  typename ComplexImageType::Pointer tmpInputImageFFT = m_InputImageFFT;
-  typename ComplexImageType::Pointer tmpFirstConvolutionFFT;
   unsigned int count = 0;
   for( unsigned int i = 0; i<ImageDimension; ++i )
     {
-    m_InputImageFFT = tmpInputImageFFT;
-    m_KernelImageFFT = dXKernelImageFFT[i];
-    this->ComputeConvolvedImageFFT();
-    tmpFirstConvolutionFFT = m_ConvolvedImageFFT;
-
     for( unsigned int j = i; j<ImageDimension; ++j )
       {
-      m_InputImageFFT = tmpFirstConvolutionFFT;
-      m_KernelImageFFT = dXKernelImageFFT[j];
-      this->ComputeConvolvedImageFFT();
+      this->MultiplyInputImageFFT( dXKernelImageFFT[i],
+        dXKernelImageFFT[j] );
       this->ComputeConvolvedImage();
       dXX[ count++ ] = m_ConvolvedImage;
-      this->m_Orders[i] = 0;
-      this->m_Orders[j] = 0;
       }
     }
 
-  m_InputImageFFT = tmpInputImageFFT;
-
   this->SetNthOutput( 0, D );
 }
 
@@ -286,6 +647,10 @@ FFTGaussianDerivativeIFFTFilter<TInputImage, TOutputImage>
     os << indent << "Convolved Image   : NULL" << std::endl;
     }
   os << indent << "Last Input Image    : " << m_LastInputImage << std::endl;
+  os << indent << "Last Input MTime    : " << m_LastInputImageMTime
+    << std::endl;
+  os << indent << "Maximum FFT Memory (MB) : "
+    << m_MaximumFFTMemoryInMegabytes << std::endl;
 }
 
 } // End namespace tube
@@ -138,6 +138,44 @@ private:
     bool operator>( const ConnectionPointType & rhs ) const;
     };
 
+  typedef typename TubeType::PointType::VectorType
+                                          PositionVectorType;
+
+  /** Tube endpoint that other tubes may connect to */
+  struct TubeEndpointType
+    {
+    TubePointerType tube;
+    TubeIdType tubeId;
+    unsigned int tubeOrder;
+    int pointId;
+
+    PositionVectorType position;
+    // unit vector from the endpoint to its neighbor on the tube
+    PositionVectorType direction;
+    };
+
+  typedef std::vector< TubeEndpointType > TubeEndpointListType;
+
+  /** Orders endpoints along one dimension to build the k-d tree */
+  struct TubeEndpointCompare
+    {
+    unsigned int dimension;
+
+    bool operator()( const TubeEndpointType & lhs,
+      const TubeEndpointType & rhs ) const;
+    };
+
+  /** Sorts endpoints in place into an implicit k-d tree; the median of
+   *  every subrange is its node and splits along depth % VDimension */
+  void BuildEndpointTree( TubeEndpointListType & endpoints,
+    unsigned int begin, unsigned int end, unsigned int depth ) const;
+
+  /** Appends the endpoints within radius of the position */
+  void FindEndpoints( const TubeEndpointListType & endpoints,
+    const PositionVectorType & position, double radius,
+    unsigned int begin, unsigned int end, unsigned int depth,
+    std::vector< unsigned int > & found ) const;
+
   typedef itksys::hash_map< TubeIdType, GraphEdgeType >
   GraphEdgeListType;
   typedef itksys::hash_map< TubeIdType, GraphEdgeListType >
@@ -117,6 +117,71 @@ MinimumSpanningTreeVesselConnectivityFilter< VDimension >
   return m_RootTubeIdList;
 }
 
+template< unsigned int VDimension >
+bool
+MinimumSpanningTreeVesselConnectivityFilter< VDimension >
+::TubeEndpointCompare
+::operator()( const TubeEndpointType & lhs,
+  const TubeEndpointType & rhs ) const
+{
+  return lhs.position[dimension] < rhs.position[dimension];
+}
+
+template< unsigned int VDimension >
+void
+MinimumSpanningTreeVesselConnectivityFilter< VDimension >
+::BuildEndpointTree( TubeEndpointListType & endpoints,
+  unsigned int begin, unsigned int end, unsigned int depth ) const
+{
+  if( end - begin <= 1 )
+    {
+    return;
+    }
+
+  unsigned int mid = begin + ( end - begin ) / 2;
+  TubeEndpointCompare compare;
+  compare.dimension = depth % VDimension;
+  std::nth_element( endpoints.begin() + begin, endpoints.begin() + mid,
+    endpoints.begin() + end, compare );
+
+  BuildEndpointTree( endpoints, begin, mid, depth + 1 );
+  BuildEndpointTree( endpoints, mid + 1, end, depth + 1 );
+}
+
+template< unsigned int VDimension >
+void
+MinimumSpanningTreeVesselConnectivityFilter< VDimension >
+::FindEndpoints( const TubeEndpointListType & endpoints,
+  const PositionVectorType & position, double radius,
+  unsigned int begin, unsigned int end, unsigned int depth,
+  std::vector< unsigned int > & found ) const
+{
+  if( begin >= end )
+    {
+    return;
+    }
+
+  unsigned int mid = begin + ( end - begin ) / 2;
+  const PositionVectorType & midPosition = endpoints[mid].position;
+  if( ( midPosition - position ).GetNorm() <= radius )
+    {
+    found.push_back( mid );
+    }
+
+  unsigned int dimension = depth % VDimension;
+  double delta = position[dimension] - midPosition[dimension];
+  if( delta <= radius )
+    {
+    FindEndpoints( endpoints, position, radius, begin, mid, depth + 1,
+      found );
+    }
+  if( delta >= -radius )
+    {
+    FindEndpoints( endpoints, position, radius, mid + 1, end, depth + 1,
+      found );
+    }
+}
+
 template< unsigned int VDimension >
 void
 MinimumSpanningTreeVesselConnectivityFilter< VDimension >
@@ -149,11 +214,49 @@ MinimumSpanningTreeVesselConnectivityFilter< VDimension >
 
   typedef typename TubeType::PointListType  TubePointListType;
   typedef typename TubeType::TubePointType  TubePointType;
-  typedef typename TubeType::PointType      PositionType;
-  typedef typename PositionType::VectorType PositionVectorType;
 
   m_TubeGraph.clear();
 
+  // Only tube endpoints can be connected to, so index them spatially
+  TubeEndpointListType endpoints;
+  endpoints.reserve( 2 * pTubeList->size() );
+  unsigned int tubeOrder = 0;
+  for( typename TubeGroupType::ChildrenListType::iterator
+    itTargetTubes = pTubeList->begin();
+    itTargetTubes != pTubeList->end(); ++itTargetTubes, ++tubeOrder )
+    {
+    TubePointerType curTargetTube
+      = dynamic_cast< TubeType * >( itTargetTubes->GetPointer() );
+    const TubePointListType & targetPointList = curTargetTube->GetPoints();
+
+    if( targetPointList.size() <= 1 )
+      {
+      continue;
+      }
+
+    int ptCandidateIdList[] = {0, (int) targetPointList.size() - 1};
+    for( unsigned int i = 0; i < 2; i++ )
+      {
+      int curPtId = ptCandidateIdList[i];
+      int nextPtId = ( curPtId == 0 ) ? curPtId + 1 : curPtId - 1;
+
+      TubeEndpointType endpoint;
+      endpoint.tube = curTargetTube;
+      endpoint.tubeId = curTargetTube->GetId();
+      endpoint.tubeOrder = tubeOrder;
+      endpoint.pointId = curPtId;
+      endpoint.position = targetPointList[ curPtId ].GetPosition()
+        .GetVectorFromOrigin();
+      endpoint.direction = targetPointList[ nextPtId ].GetPosition()
+        .GetVectorFromOrigin() - endpoint.position;
+      endpoint.direction.Normalize();
+      endpoints.push_back( endpoint );
+      }
+    }
+  BuildEndpointTree( endpoints, 0, endpoints.size(), 0 );
+
+  std::vector< unsigned int > foundEndpoints;
+  std::vector< std::pair< unsigned int, unsigned int > > candidates;
   for( typename TubeGroupType::ChildrenListType::iterator
     itSourceTubes = pTubeList->begin();
     itSourceTubes != pTubeList->end(); ++itSourceTubes )
@@ -161,7 +264,7 @@ MinimumSpanningTreeVesselConnectivityFilter< VDimension >
     TubePointerType pCurSourceTube
       = dynamic_cast< TubeType * >( itSourceTubes->GetPointer() );
     TubeIdType curSourceTubeId = pCurSourceTube->GetId();
-    TubePointListType sourcePointList = pCurSourceTube->GetPoints();
+    const TubePointListType & sourcePointList = pCurSourceTube->GetPoints();
 
     m_TubeGraph[curSourceTubeId].clear();
 
@@ -170,31 +273,38 @@ MinimumSpanningTreeVesselConnectivityFilter< VDimension >
       itSourcePoints = sourcePointList.begin();
       itSourcePoints != sourcePointList.end(); ++itSourcePoints )
       {
-      TubePointType ptSource = *itSourcePoints;
+      const TubePointType & ptSource = *itSourcePoints;
       PositionVectorType ptSourcePos
         = ptSource.GetPosition().GetVectorFromOrigin();
+      double maxDist = m_MaxTubeDistanceToRadiusRatio
+        * ptSource.GetRadius();
 
-      for( typename TubeGroupType::ChildrenListType::iterator
-        itTargetTubes = pTubeList->begin();
-        itTargetTubes != pTubeList->end(); ++itTargetTubes )
-        {
-        TubePointerType curTargetTube
-          = dynamic_cast< TubeType * >( itTargetTubes->GetPointer() );
-        TubeIdType curTargetTubeId = curTargetTube->GetId();
+      foundEndpoints.clear();
+      FindEndpoints( endpoints, ptSourcePos, maxDist, 0, endpoints.size(),
+        0, foundEndpoints );
 
-        if( curSourceTubeId == curTargetTubeId )
+      // Visit the candidate endpoints in input tube order, so edges are
+      //   added as they were by the exhaustive search
+      candidates.clear();
+      for( unsigned int i = 0; i < foundEndpoints.size(); i++ )
+        {
+        const TubeEndpointType & endpoint = endpoints[ foundEndpoints[i] ];
+        if( endpoint.tubeId != curSourceTubeId )
           {
-          continue;
-          }
-
-        TubePointListType targetPointList = curTargetTube->GetPoints();
-
-        if( targetPointList.size() <= 1 )
-          {
-          continue;
+          candidates.push_back( std::make_pair( 2 * endpoint.tubeOrder
+            + ( endpoint.pointId == 0 ? 0 : 1 ), foundEndpoints[i] ) );
           }
+        }
+      std::sort( candidates.begin(), candidates.end() );
 
-        int ptCandidateIdList[] = {0, (int) targetPointList.size() - 1};
+      unsigned int candidateNum = 0;
+      while( candidateNum < candidates.size() )
+        {
+        unsigned int curTubeOrder = candidates[candidateNum].first / 2;
+        TubePointerType curTargetTube
+          = endpoints[ candidates[candidateNum].second ].tube;
+        TubeIdType curTargetTubeId
+          = endpoints[ candidates[candidateNum].second ].tubeId;
 
         std::priority_queue< ConnectionPointType,
           std::vector< ConnectionPointType >,
@@ -202,44 +312,27 @@ MinimumSpanningTreeVesselConnectivityFilter< VDimension >
         minpqConnPoint;
         ConnectionPointType ePtConn;
 
-        for( unsigned int i = 0; i < 2; i++ )
+        for( ; candidateNum < candidates.size()
+          && candidates[candidateNum].first / 2 == curTubeOrder;
+          ++candidateNum )
           {
-          int curPtId = ptCandidateIdList[i];
-          TubePointType ptCur = targetPointList[curPtId];
-
-          PositionVectorType ptCurPos
-            = ptCur.GetPosition().GetVectorFromOrigin();
+          const TubeEndpointType & endpoint
+            = endpoints[ candidates[candidateNum].second ];
 
-          PositionVectorType vecToCurPt = ptCurPos - ptSourcePos;
+          PositionVectorType vecToCurPt = endpoint.position - ptSourcePos;
 
           // compute and check distance
           double curDist = vecToCurPt.GetNorm();
 
-          if( curDist > m_MaxTubeDistanceToRadiusRatio * ptSource.GetRadius() )
+          if( curDist > maxDist )
             {
             continue;
             }
 
           // compute and check angular continuity
-          PositionVectorType ptNextPos;
-
-          if( curPtId == 0 )
-            {
-            ptNextPos = targetPointList[ curPtId + 1 ].GetPosition()
-              .GetVectorFromOrigin();
-            }
-            else
-            {
-            ptNextPos = targetPointList[ curPtId - 1 ].GetPosition()
-              .GetVectorFromOrigin();
-            }
-
-          PositionVectorType curVecToNextPt = ptNextPos - ptCurPos;
-
           vecToCurPt.Normalize();
-          curVecToNextPt.Normalize();
 
-          double curAngle = std::acos( vecToCurPt * curVecToNextPt );
+          double curAngle = std::acos( vecToCurPt * endpoint.direction );
           curAngle *= 180.0 / itk::Math::pi;
 
           if( curAngle > m_MaxContinuityAngleError )
@@ -250,7 +343,7 @@ MinimumSpanningTreeVesselConnectivityFilter< VDimension >
           // add to queue
           ePtConn.dist = curDist;
           ePtConn.angle = curAngle;
-          ePtConn.pointId = curPtId;
+          ePtConn.pointId = endpoint.pointId;
           minpqConnPoint.push( ePtConn );
           }
 
@@ -261,11 +354,6 @@ MinimumSpanningTreeVesselConnectivityFilter< VDimension >
 
         ePtConn = minpqConnPoint.top();
 
-        while( !minpqConnPoint.empty() )
-          {
-          minpqConnPoint.pop();
-          }
-
         GraphEdgeType e;
         e.sourceTube       = pCurSourceTube;
         e.sourceTubeId      = curSourceTubeId;
@@ -280,22 +368,20 @@ MinimumSpanningTreeVesselConnectivityFilter< VDimension >
         e.continuityAngleError = ePtConn.angle;
 
         // if edge to current target is present then update it, else add it
-        if( m_TubeGraph[curSourceTubeId].find( curTargetTubeId )
-          != m_TubeGraph[curSourceTubeId].end() )
+        typename GraphEdgeListType::iterator itEdge
+          = m_TubeGraph[curSourceTubeId].find( curTargetTubeId );
+        if( itEdge != m_TubeGraph[curSourceTubeId].end() )
           {
-          GraphEdgeType eOld = m_TubeGraph[curSourceTubeId][curTargetTubeId];
-
           // add only if current weight is better
-          if( e.weight < eOld.weight )
+          if( e.weight < itEdge->second.weight )
             {
-            m_TubeGraph[curSourceTubeId][curTargetTubeId] = e;
+            itEdge->second = e;
             }
           }
         else
           {
           m_TubeGraph[curSourceTubeId][curTargetTubeId] = e;
           }
-
         }
       ++curSourceTubePointId;
       }
@@ -0,0 +1,99 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright 2010 Kitware Inc. 28 Corporate Drive,
+Clifton Park, NY, 12065, USA.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#ifndef __itktubeNearestSiteFinder_h
+#define __itktubeNearestSiteFinder_h
+
+#include <itkMultiThreader.h>
+#include <itkSize.h>
+
+#include <vector>
+
+namespace itk
+{
+
+namespace tube
+{
+
+/** \class NearestSiteFinder
+ * \brief Finds the nearest site of every voxel of a grid.
+ *
+ * The sites are given in a vector holding one entry per voxel, in image
+ * buffer order: the site placed at that voxel, or a negative value.
+ * FindNearestSites replaces every entry by the site nearest to the voxel,
+ * in Euclidean distance measured in voxels.  It computes the exact
+ * distance transform of Felzenszwalb and Huttenlocher, one dimension at a
+ * time, and propagates the site rooting each parabola of the lower
+ * envelope.  Each pass is threaded over the image lines along its
+ * dimension.
+ *
+ * A site can be any non-negative label, e.g., an id or a buffer offset.
+ * TSiteCoordinateFunction maps it back to the voxel it was placed on.  It
+ * must define SiteType and
+ *   double operator()( SiteType site, unsigned int dimension ) const
+ * returning the index of that voxel along dimension.
+ */
+template< unsigned int VDimension, class TSiteCoordinateFunction >
+class NearestSiteFinder
+{
+public:
+
+  typedef NearestSiteFinder                         Self;
+
+  typedef TSiteCoordinateFunction                   SiteCoordinateFunctionType;
+  typedef typename TSiteCoordinateFunction::SiteType SiteType;
+  typedef std::vector< SiteType >                   SiteArrayType;
+
+  typedef Size< VDimension >                        SizeType;
+  typedef typename SizeType::SizeValueType          SizeValueType;
+
+  /** Replace the site of every voxel of a grid of the given size by its
+   *  nearest site, using the threads of threader.  Voxels stay without
+   *  a site only if there is no site at all. */
+  static void FindNearestSites( const SizeType & size,
+    const SiteCoordinateFunctionType & siteCoordinate,
+    SiteArrayType & sites, MultiThreader * threader );
+
+private:
+
+  struct FindThreadStruct
+    {
+    const SizeType *                          Size;
+    const SiteCoordinateFunctionType *        SiteCoordinate;
+    SiteArrayType *                           Sites;
+    unsigned int                              Dimension;
+    }; // End struct FindThreadStruct
+
+  static ITK_THREAD_RETURN_TYPE FindThreaderCallback( void * arg );
+
+}; // End class NearestSiteFinder
+
+} // End namespace tube
+
+} // End namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itktubeNearestSiteFinder.hxx"
+#endif
+
+#endif // End !defined(__itktubeNearestSiteFinder_h)
@@ -0,0 +1,170 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright 2010 Kitware Inc. 28 Corporate Drive,
+Clifton Park, NY, 12065, USA.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#ifndef __itktubeNearestSiteFinder_hxx
+#define __itktubeNearestSiteFinder_hxx
+
+#include "itktubeNearestSiteFinder.h"
+
+#include <limits>
+
+namespace itk
+{
+
+namespace tube
+{
+
+/** FindNearestSites */
+template< unsigned int VDimension, class TSiteCoordinateFunction >
+void
+NearestSiteFinder< VDimension, TSiteCoordinateFunction >
+::FindNearestSites( const SizeType & size,
+  const SiteCoordinateFunctionType & siteCoordinate,
+  SiteArrayType & sites, MultiThreader * threader )
+{
+  FindThreadStruct str;
+  str.Size = &size;
+  str.SiteCoordinate = &siteCoordinate;
+  str.Sites = &sites;
+
+  threader->SetSingleMethod( Self::FindThreaderCallback, &str );
+  for( unsigned int d = 0; d < VDimension; d++ )
+    {
+    str.Dimension = d;
+    threader->SingleMethodExecute();
+    }
+}
+
+
+/** FindThreaderCallback */
+template< unsigned int VDimension, class TSiteCoordinateFunction >
+ITK_THREAD_RETURN_TYPE
+NearestSiteFinder< VDimension, TSiteCoordinateFunction >
+::FindThreaderCallback( void * arg )
+{
+  MultiThreader::ThreadInfoStruct * info =
+    static_cast< MultiThreader::ThreadInfoStruct * >( arg );
+  FindThreadStruct * str =
+    static_cast< FindThreadStruct * >( info->UserData );
+
+  const unsigned int dim = str->Dimension;
+  const SizeType & size = *( str->Size );
+  const SiteCoordinateFunctionType & siteCoordinate =
+    *( str->SiteCoordinate );
+  SiteArrayType & sites = *( str->Sites );
+
+  SizeValueType stride = 1;
+  for( unsigned int i = 0; i < dim; i++ )
+    {
+    stride *= size[i];
+    }
+  const SizeValueType lineLength = size[dim];
+  const SizeValueType numberOfLines = sites.size() / lineLength;
+  const SizeValueType firstLine =
+    ( numberOfLines * info->ThreadID ) / info->NumberOfThreads;
+  const SizeValueType lastLine =
+    ( numberOfLines * ( info->ThreadID + 1 ) ) / info->NumberOfThreads;
+
+  // The parabola of the site at q has its minimum, the squared distance
+  //   to the site along the dimensions already processed, at q.  v holds
+  //   the voxels whose parabolas form the lower envelope, z the
+  //   boundaries between them.
+  SiteArrayType                lineSites( lineLength );
+  std::vector< double >        f( lineLength );
+  std::vector< SizeValueType > v( lineLength );
+  std::vector< double >        z( lineLength + 1 );
+
+  double lineIndex[VDimension];
+  for( SizeValueType line = firstLine; line < lastLine; line++ )
+    {
+    const SizeValueType base = ( line / stride ) * stride * lineLength
+      + line % stride;
+    SizeValueType offset = base;
+    for( unsigned int i = 0; i < VDimension; i++ )
+      {
+      lineIndex[i] = offset % size[i];
+      offset /= size[i];
+      }
+
+    int k = -1;
+    for( SizeValueType q = 0; q < lineLength; q++ )
+      {
+      const SiteType site = sites[ base + q * stride ];
+      lineSites[q] = site;
+      if( site < 0 )
+        {
+        continue;
+        }
+      f[q] = 0;
+      for( unsigned int i = 0; i < dim; i++ )
+        {
+        const double tf = lineIndex[i] - siteCoordinate( site, i );
+        f[q] += tf * tf;
+        }
+      const double fq = f[q] + double( q ) * q;
+      if( k < 0 )
+        {
+        k = 0;
+        v[0] = q;
+        z[0] = -std::numeric_limits< double >::max();
+        }
+      else
+        {
+        double intersection = ( fq - ( f[v[k]] + double( v[k] ) * v[k] ) )
+          / ( 2.0 * ( double( q ) - v[k] ) );
+        while( intersection <= z[k] )
+          {
+          --k;
+          intersection = ( fq - ( f[v[k]] + double( v[k] ) * v[k] ) )
+            / ( 2.0 * ( double( q ) - v[k] ) );
+          }
+        ++k;
+        v[k] = q;
+        z[k] = intersection;
+        }
+      z[k+1] = std::numeric_limits< double >::max();
+      }
+    if( k < 0 )
+      {
+      continue;
+      }
+
+    k = 0;
+    for( SizeValueType q = 0; q < lineLength; q++ )
+      {
+      while( z[k+1] < q )
+        {
+        ++k;
+        }
+      sites[ base + q * stride ] = lineSites[ v[k] ];
+      }
+    }
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+} // End namespace tube
+
+} // End namespace itk
+
+#endif // End !defined(__itktubeNearestSiteFinder_hxx)
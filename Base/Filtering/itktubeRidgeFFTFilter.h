@@ -22,6 +22,8 @@
 
 #include "itktubeGaussianDerivativeFilter.h"
 
+#include <itkMultiThreader.h>
+
 namespace itk
 {
 namespace tube
@@ -56,6 +58,11 @@ public:
   itkSetMacro( UseIntensityOnly, bool );
   itkGetMacro( UseIntensityOnly, bool );
 
+  /** Memory budget for the FFT-based derivatives; zero means unlimited.
+   *  \sa FFTGaussianDerivativeIFFTFilter::SetMaximumFFTMemoryInMegabytes */
+  itkSetMacro( MaximumFFTMemoryInMegabytes, double );
+  itkGetMacro( MaximumFFTMemoryInMegabytes, double );
+
   itkGetConstReferenceMacro( Intensity, typename OutputImageType::Pointer );
   itkGetConstReferenceMacro( Ridgeness, typename OutputImageType::Pointer );
   itkGetConstReferenceMacro( Curvature, typename OutputImageType::Pointer );
@@ -78,6 +85,24 @@ private:
   typedef GaussianDerivativeFilter< InputImageType, OutputImageType >
     DerivativeFilterType;
 
+  typedef typename OutputImageType::PixelType           OutputPixelType;
+
+  itkStaticConstMacro( HessianSize, unsigned int,
+    ImageDimension * ( ImageDimension + 1 ) / 2 );
+
+  struct RidgeThreadStruct
+    {
+    const OutputPixelType *   Dx[ ImageDimension ];
+    const OutputPixelType *   Ddx[ HessianSize ];
+    OutputPixelType *         Ridgeness;
+    OutputPixelType *         Roundness;
+    OutputPixelType *         Curvature;
+    OutputPixelType *         Levelness;
+    SizeValueType             NumberOfPixels;
+    }; // End struct RidgeThreadStruct
+
+  static ITK_THREAD_RETURN_TYPE RidgeThreaderCallback( void * arg );
+
   typename DerivativeFilterType::Pointer                m_DerivativeFilter;
 
   typename OutputImageType::Pointer                     m_Intensity;
@@ -88,6 +113,7 @@ private:
 
   double                                                m_Scale;
   bool                                                  m_UseIntensityOnly;
+  double                                       m_MaximumFFTMemoryInMegabytes;
 };
 
 
@@ -46,6 +46,7 @@ RidgeFFTFilter< TInputImage >
 
   m_Scale = 1;
   m_UseIntensityOnly = false;
+  m_MaximumFFTMemoryInMegabytes = 0;
 
   #if defined( TubeTK_USE_GPU_ARRAYFIRE )
   m_DerivativeFilter = GPUArrayFireGaussianDerivativeFilter< InputImageType,
@@ -67,22 +68,49 @@ RidgeFFTFilter< TInputImage >
   //timeCollector.Start( "RidgeFFT GenerateData" );
   m_DerivativeFilter->SetInput( this->GetInput() );
 
+  typedef FFTGaussianDerivativeIFFTFilter< InputImageType, OutputImageType >
+    FFTDerivativeFilterType;
+  FFTDerivativeFilterType * fftDerivativeFilter =
+    dynamic_cast< FFTDerivativeFilterType * >(
+      m_DerivativeFilter.GetPointer() );
+  if( fftDerivativeFilter != NULL )
+    {
+    fftDerivativeFilter->SetMaximumFFTMemoryInMegabytes(
+      m_MaximumFFTMemoryInMegabytes );
+    }
+
   typename DerivativeFilterType::OrdersType orders;
   typename DerivativeFilterType::SigmasType sigmas;
 
   sigmas.Fill( m_Scale );
   m_DerivativeFilter->SetSigmas( sigmas );
 
-  // Intensity
-  //timeCollector.Start( "RidgeFFT Intensity" );
-  orders.Fill( 0 );
-  m_DerivativeFilter->SetOrders( orders );
-  m_DerivativeFilter->Update();
-  m_Intensity = m_DerivativeFilter->GetOutput();
-  //timeCollector.Stop( "RidgeFFT Intensity" );
-
-  if( !m_UseIntensityOnly )
+  if( m_UseIntensityOnly )
+    {
+    // Intensity
+    //timeCollector.Start( "RidgeFFT Intensity" );
+    orders.Fill( 0 );
+    m_DerivativeFilter->SetOrders( orders );
+    m_DerivativeFilter->Update();
+    m_Intensity = m_DerivativeFilter->GetOutput();
+    //timeCollector.Stop( "RidgeFFT Intensity" );
+    }
+  else
     {
+    // The N-jet includes the intensity, so it is not computed separately
+    std::vector< typename OutputImageType::Pointer > dx( ImageDimension );
+
+    int ddxSize = 0;
+    for( unsigned int i=1; i<=ImageDimension; ++i )
+      {
+      ddxSize += i;
+      }
+    std::vector< typename OutputImageType::Pointer > ddx( ddxSize );
+
+    //timeCollector.Start( "RidgeFFT GenereateNJet" );
+    m_DerivativeFilter->GenerateNJet( m_Intensity, dx, ddx );
+    //timeCollector.Stop( "RidgeFFT GenereateNJet" );
+
     m_Ridgeness = OutputImageType::New();
     m_Ridgeness->CopyInformation( m_Intensity );
     m_Ridgeness->SetRegions( m_Intensity->GetLargestPossibleRegion() );
@@ -103,84 +131,31 @@ RidgeFFTFilter< TInputImage >
     m_Levelness->SetRegions( m_Intensity->GetLargestPossibleRegion() );
     m_Levelness->Allocate();
 
-    std::vector< typename OutputImageType::Pointer > dx( ImageDimension );
-
-    int ddxSize = 0;
-    for( unsigned int i=1; i<=ImageDimension; ++i )
-      {
-      ddxSize += i;
-      }
-    std::vector< typename OutputImageType::Pointer > ddx( ddxSize );
-
-    //timeCollector.Start( "RidgeFFT GenereateNJet" );
-    m_DerivativeFilter->GenerateNJet( m_Intensity, dx, ddx );
-    //timeCollector.Stop( "RidgeFFT GenereateNJet" );
-
-    ImageRegionIterator< OutputImageType > iterRidge( m_Ridgeness,
-      m_Ridgeness->GetLargestPossibleRegion() );
-    ImageRegionIterator< OutputImageType > iterRound( m_Roundness,
-      m_Roundness->GetLargestPossibleRegion() );
-    ImageRegionIterator< OutputImageType > iterCurve( m_Curvature,
-      m_Curvature->GetLargestPossibleRegion() );
-    ImageRegionIterator< OutputImageType > iterLevel( m_Levelness,
-      m_Levelness->GetLargestPossibleRegion() );
-
-    std::vector< ImageRegionIterator< OutputImageType > > iterDx(
-      ImageDimension );
-
-    std::vector< ImageRegionIterator< OutputImageType > > iterDdx(
-      ddxSize );
-
+    // Each voxel's Hessian is analysed with the fixed-size eigen solver,
+    //   so the voxels are split across threads without any locking
+    RidgeThreadStruct str;
     unsigned int count = 0;
     for( unsigned int i=0; i<ImageDimension; ++i )
       {
-      iterDx[i] = ImageRegionIterator< OutputImageType >( dx[i],
-        dx[i]->GetLargestPossibleRegion() );
+      str.Dx[i] = dx[i]->GetBufferPointer();
       for( unsigned int j=i; j<ImageDimension; ++j )
         {
-        iterDdx[count] = ImageRegionIterator< OutputImageType >( ddx[count],
-          ddx[count]->GetLargestPossibleRegion() );
+        str.Ddx[count] = ddx[count]->GetBufferPointer();
         ++count;
         }
       }
+    str.Ridgeness = m_Ridgeness->GetBufferPointer();
+    str.Roundness = m_Roundness->GetBufferPointer();
+    str.Curvature = m_Curvature->GetBufferPointer();
+    str.Levelness = m_Levelness->GetBufferPointer();
+    str.NumberOfPixels = m_Ridgeness->GetLargestPossibleRegion()
+      .GetNumberOfPixels();
 
-    double ridgeness = 0;
-    double roundness = 0;
-    double curvature = 0;
-    double levelness = 0;
-    vnl_matrix<double> H( ImageDimension, ImageDimension );
-    vnl_vector<double> D( ImageDimension );
-    vnl_matrix<double> HEVect( ImageDimension, ImageDimension );
-    vnl_vector<double> HEVal( ImageDimension );
     //timeCollector.Start( "RidgeFFT Compute" );
-    while( !iterRidge.IsAtEnd() )
-      {
-      count = 0;
-      for( unsigned int i=0; i<ImageDimension; ++i )
-        {
-        D[i] = iterDx[i].Get();
-        ++iterDx[i];
-        for( unsigned int j=i; j<ImageDimension; ++j )
-          {
-          H[i][j] = iterDdx[count].Get();
-          H[j][i] = H[i][j];
-          ++iterDdx[count];
-          ++count;
-          }
-        }
-      vnl_vector<double> prevTangent;
-      ::tube::ComputeRidgeness( H, D, prevTangent, ridgeness, roundness, curvature,
-        levelness, HEVect, HEVal );
-      iterRidge.Set( ridgeness );
-      iterRound.Set( roundness );
-      iterCurve.Set( curvature );
-      iterLevel.Set( levelness );
-
-      ++iterRidge;
-      ++iterRound;
-      ++iterCurve;
-      ++iterLevel;
-      }
+    MultiThreader::Pointer threader = MultiThreader::New();
+    threader->SetNumberOfThreads( this->GetNumberOfThreads() );
+    threader->SetSingleMethod( this->RidgeThreaderCallback, &str );
+    threader->SingleMethodExecute();
     //timeCollector.Stop( "RidgeFFT Compute" );
     }
 
@@ -189,6 +164,54 @@ RidgeFFTFilter< TInputImage >
   //timeCollector.Report();
 }
 
+template< typename TInputImage >
+ITK_THREAD_RETURN_TYPE
+RidgeFFTFilter< TInputImage >
+::RidgeThreaderCallback( void * arg )
+{
+  MultiThreader::ThreadInfoStruct * info =
+    static_cast< MultiThreader::ThreadInfoStruct * >( arg );
+  RidgeThreadStruct * str =
+    static_cast< RidgeThreadStruct * >( info->UserData );
+
+  const SizeValueType startPixel = ( str->NumberOfPixels * info->ThreadID )
+    / info->NumberOfThreads;
+  const SizeValueType endPixel = ( str->NumberOfPixels
+    * ( info->ThreadID + 1 ) ) / info->NumberOfThreads;
+
+  double ridgeness = 0;
+  double roundness = 0;
+  double curvature = 0;
+  double levelness = 0;
+  vnl_matrix_fixed< double, ImageDimension, ImageDimension > H;
+  vnl_vector_fixed< double, ImageDimension > D;
+  vnl_matrix_fixed< double, ImageDimension, ImageDimension > HEVect;
+  vnl_vector_fixed< double, ImageDimension > HEVal;
+  vnl_vector< double > prevTangent;
+  for( SizeValueType p = startPixel; p < endPixel; ++p )
+    {
+    unsigned int count = 0;
+    for( unsigned int i=0; i<ImageDimension; ++i )
+      {
+      D[i] = str->Dx[i][p];
+      for( unsigned int j=i; j<ImageDimension; ++j )
+        {
+        H( i, j ) = str->Ddx[count][p];
+        H( j, i ) = H( i, j );
+        ++count;
+        }
+      }
+    ::tube::ComputeRidgeness( H, D, prevTangent, ridgeness, roundness,
+      curvature, levelness, HEVect, HEVal );
+    str->Ridgeness[p] = ridgeness;
+    str->Roundness[p] = roundness;
+    str->Curvature[p] = curvature;
+    str->Levelness[p] = levelness;
+    }
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
 template< typename TInputImage >
 void
 RidgeFFTFilter< TInputImage >
@@ -243,6 +266,8 @@ RidgeFFTFilter< TInputImage >
 
   os << indent << "Scale             : " << m_Scale << std::endl;
   os << indent << "UseIntensityOnly  : " << m_UseIntensityOnly << std::endl;
+  os << indent << "MaximumFFTMemoryInMegabytes : "
+    << m_MaximumFFTMemoryInMegabytes << std::endl;
 }
 
 } // End namespace tube
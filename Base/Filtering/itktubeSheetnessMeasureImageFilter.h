@@ -121,15 +121,17 @@ protected:
   ~SheetnessMeasureImageFilter( void ) {}
   void PrintSelf(std::ostream & os, Indent indent) const;
 
-  /** Generate Data */
-  void GenerateData( void );
+  typedef typename OutputImageType::RegionType OutputImageRegionType;
+
+  /** Each voxel's Hessian eigenvalues are computed in place with a
+   *  fixed-size solver, so no eigenvalue image is stored. */
+  void ThreadedGenerateData( const OutputImageRegionType & outputRegion,
+    ThreadIdType threadId );
 
 private:
   SheetnessMeasureImageFilter(const Self &); //purposely not implemented
   void operator=(const Self &); //purposely not implemented
 
-  typename EigenAnalysisFilterType::Pointer m_SymmetricEigenValueFilter;
-
   double m_Alpha;
   double m_Beta;
   double m_Cfactor;
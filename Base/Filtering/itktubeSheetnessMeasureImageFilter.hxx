@@ -25,7 +25,9 @@ limitations under the License.
 #define __itktubeSheetnessMeasureImageFilter_hxx
 
 #include "itktubeSheetnessMeasureImageFilter.h"
+#include "tubeMatrixMath.h"
 
+#include <itkImageRegionConstIterator.h>
 #include <itkImageRegionIterator.h>
 
 #include <vnl/vnl_math.h>
@@ -46,48 +48,36 @@ SheetnessMeasureImageFilter< TPixel >
   m_Beta = 0.5;
   m_Cfactor = 2.0;
   m_DetectBrightSheets = true;
-
-  // Hessian( Image ) = Jacobian( Gradient ( Image ) )  is symmetric
-  m_SymmetricEigenValueFilter = EigenAnalysisFilterType::New();
-  m_SymmetricEigenValueFilter->SetDimension(ImageDimension);
-  m_SymmetricEigenValueFilter->OrderEigenValuesBy(
-    EigenAnalysisFilterType::FunctorType::OrderByValue);
 }
 
 template< class TPixel >
 void
 SheetnessMeasureImageFilter< TPixel >
-::GenerateData( void )
+::ThreadedGenerateData( const OutputImageRegionType & outputRegion,
+  ThreadIdType itkNotUsed( threadId ) )
 {
-  itkDebugMacro( << "SheetnessMeasureImageFilter generating data ." );
-
-  m_SymmetricEigenValueFilter->SetInput( this->GetInput() );
-
-  typename OutputImageType::Pointer output = this->GetOutput();
-
-  typedef typename EigenAnalysisFilterType::OutputImageType
-  EigenValueOutputImageType;
-
-  m_SymmetricEigenValueFilter->Update();
-
-  const typename EigenValueOutputImageType::ConstPointer eigenImage =
-    m_SymmetricEigenValueFilter->GetOutput();
-
-  // walk the region of eigenvalues and get the vesselness measure
-  EigenValueArrayType                                   eigenValue;
-  ImageRegionConstIterator< EigenValueOutputImageType > it;
-  it = ImageRegionConstIterator< EigenValueOutputImageType >(
-    eigenImage, eigenImage->GetRequestedRegion() );
-  ImageRegionIterator< OutputImageType > oit;
-  this->AllocateOutputs();
-  oit = ImageRegionIterator< OutputImageType >( output,
-                                                output->GetRequestedRegion() );
-  oit.GoToBegin();
-  it.GoToBegin();
+  // Hessian( Image ) = Jacobian( Gradient ( Image ) )  is symmetric
+  vnl_matrix_fixed< double, ImageDimension, ImageDimension > hessian;
+  vnl_matrix_fixed< double, ImageDimension, ImageDimension > eigenVector;
+  vnl_vector_fixed< double, ImageDimension >                 eigenValue;
+
+  // walk the region of hessians and get the sheetness measure
+  ImageRegionConstIterator< InputImageType > it( this->GetInput(),
+    outputRegion );
+  ImageRegionIterator< OutputImageType > oit( this->GetOutput(),
+    outputRegion );
   while( !it.IsAtEnd() )
     {
-    // Get the eigenvalue
-    eigenValue = it.Get();
+    // Get the eigenvalues, ordered by value
+    const InputPixelType & tensor = it.Get();
+    for( unsigned int r = 0; r < ImageDimension; ++r )
+      {
+      for( unsigned int c = 0; c < ImageDimension; ++c )
+        {
+        hessian( r, c ) = tensor( r, c );
+        }
+      }
+    ::tube::ComputeSymmetricEigen( hessian, eigenVector, eigenValue );
 
     double sheetness = 0.0;
 
@@ -293,6 +293,9 @@ private:
   // purposely not implemented
   TortuositySpatialObjectFilter( const Self & );
 
+  /** Set all metrics back to their "not computed" state */
+  void ResetMetrics( void );
+
   /** Input parameters */
   double                         m_EpsilonForSpacing;
   double                         m_EpsilonForZero;
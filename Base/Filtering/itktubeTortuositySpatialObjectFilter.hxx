@@ -53,28 +53,44 @@ TortuositySpatialObjectFilter< TPointBasedSpatialObject >
   this->m_SmoothingMethod = ::tube::SMOOTH_TUBE_USING_INDEX_GAUSSIAN;
   this->m_SmoothingScale = 5.0;
 
+  this->m_NumberOfPoints = 0;
+  this->m_TubeID = -1;
+
+  this->ResetMetrics();
+}
+
+//----------------------------------------------------------------------------
+template< class TPointBasedSpatialObject >
+TortuositySpatialObjectFilter< TPointBasedSpatialObject >
+::~TortuositySpatialObjectFilter( void )
+{
+}
+
+//----------------------------------------------------------------------------
+template< class TPointBasedSpatialObject >
+void
+TortuositySpatialObjectFilter< TPointBasedSpatialObject >
+::ResetMetrics( void )
+{
   // Setting vessel-wise metrics to -1.0
   this->m_AverageRadiusMetric = -1.0;
   this->m_ChordLengthMetric = -1.0;
   this->m_DistanceMetric = -1.0;
   this->m_InflectionCountMetric = -1.0;
   this->m_InflectionCount1Metric = -1.0;
-  this->m_InflectionCount1Metric = -1.0;
+  this->m_InflectionCount2Metric = -1.0;
   this->m_PathLengthMetric = -1.0;
   this->m_Percentile95Metric = -1.0;
   this->m_SumOfAnglesMetric = -1.0;
   this->m_TotalCurvatureMetric = -1.0;
   this->m_TotalSquaredCurvatureMetric = -1.0;
 
-  // Initializing point-wise metric arrays
+  // Clearing point-wise and other-wise metrics. The vectors keep their
+  // capacity so that a filter updated on many tubes does not reallocate.
+  this->m_CurvatureScalar.clear();
+  this->m_CurvatureVector.clear();
   this->m_InflectionPoints = itk::Array<double>();
-}
-
-//----------------------------------------------------------------------------
-template< class TPointBasedSpatialObject >
-TortuositySpatialObjectFilter< TPointBasedSpatialObject >
-::~TortuositySpatialObjectFilter( void )
-{
+  this->m_CurvatureHistogramMetrics.clear();
 }
 
 //----------------------------------------------------------------------------
@@ -276,8 +292,11 @@ TortuositySpatialObjectFilter< TPointBasedSpatialObject >
 {
   // Get I/O
   PointBasedSpatialObjectPointer output = this->GetOutput();
-  PointBasedSpatialObjectPointer originalInput = PointBasedSpatialObject::New();
-  originalInput = const_cast< PointBasedSpatialObject * >( this->GetInput() );
+  PointBasedSpatialObjectPointer originalInput =
+    const_cast< PointBasedSpatialObject * >( this->GetInput() );
+
+  // Metrics of a previous update must not leak into this one
+  this->ResetMetrics();
 
   // Safety check
   if ( originalInput->GetNumberOfPoints() < 2 )
@@ -322,13 +341,11 @@ TortuositySpatialObjectFilter< TPointBasedSpatialObject >
   double totalSquaredCurvature = 0.0;
   double sumOfRadius = 0.0;
 
-  // Preprocessing
-  PointBasedSpatialObjectPointer smoothedTube = PointBasedSpatialObject::New();
-
-  // Smooth the vessel
-  smoothedTube = ::tube::SmoothTube<PointBasedSpatialObject>(originalInput,
-                                                             this->m_SmoothingScale,
-                                                             this->m_SmoothingMethod);
+  // Preprocessing: smooth the vessel
+  PointBasedSpatialObjectPointer smoothedTube =
+    ::tube::SmoothTube<PointBasedSpatialObject>(originalInput,
+                                                this->m_SmoothingScale,
+                                                this->m_SmoothingMethod);
   if(!smoothedTube)
     {
     itkExceptionMacro( << "Cannot run Tortuosity on input. "
@@ -0,0 +1,180 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright 2010 Kitware Inc. 28 Corporate Drive,
+Clifton Park, NY, 12065, USA.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#ifndef __itktubeTortuosityTubeTreeSpatialObjectFilter_h
+#define __itktubeTortuosityTubeTreeSpatialObjectFilter_h
+
+#include "itktubeSpatialObjectToSpatialObjectFilter.h"
+#include "itktubeTortuositySpatialObjectFilter.h"
+
+#include <itkMultiThreader.h>
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace itk
+{
+
+namespace tube
+{
+
+/** \class TortuosityTubeTreeSpatialObjectFilter
+ * \brief Compute tortuosity metrics on every tube of a SpatialObject tree.
+ *
+ * All the tubes found under the input (the input included) are measured
+ * with a TortuositySpatialObjectFilter, in parallel.  Each thread reuses
+ * one filter for all of its tubes.  The results are stored in a table
+ * with one row per tube and one column per value: "TubeIDs" (the row
+ * index), "NumberOfPoints", the vessel-wise metrics of the MeasureFlag in
+ * bit order, "Tau4Metric" (total curvature over path length) when the
+ * total curvature is measured, and one column per bin of the curvature
+ * histogram.  Point-wise metrics are not stored.
+ *
+ * Tubes with less than 2 points keep their row, with -1 for every
+ * metric.  The histogram columns are named after the bin width only, as
+ * ComputeTubeTortuosityMeasures always did.  The output is a copy of the
+ * input without children.
+ *
+ * \sa TortuositySpatialObjectFilter
+ */
+template< class TSpatialObject, class TTubeSpatialObject >
+class TortuosityTubeTreeSpatialObjectFilter
+  : public SpatialObjectToSpatialObjectFilter< TSpatialObject, TSpatialObject >
+{
+public:
+  /** Standard class typedefs. */
+  typedef TortuosityTubeTreeSpatialObjectFilter     Self;
+  typedef SpatialObjectToSpatialObjectFilter< TSpatialObject,
+    TSpatialObject >                                Superclass;
+  typedef SmartPointer< Self >                      Pointer;
+  typedef SmartPointer< const Self >                ConstPointer;
+
+  typedef TSpatialObject     SpatialObjectType;
+  typedef TTubeSpatialObject TubeSpatialObjectType;
+
+  typedef TortuositySpatialObjectFilter< TubeSpatialObjectType >
+    TortuosityFilterType;
+
+  /** Run-time type information (and related methods).   */
+  itkTypeMacro( TortuosityTubeTreeSpatialObjectFilter,
+    SpatialObjectToSpatialObjectFilter );
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  itkStaticConstMacro( ObjectDimension, unsigned int,
+    SpatialObjectType::ObjectDimension );
+
+  /** Set/Get the metrics to compute, see
+   * TortuositySpatialObjectFilter::MeasureType. */
+  itkSetMacro( MeasureFlag, int );
+  itkGetConstMacro( MeasureFlag, int );
+
+  /** Set/Get the parameters given to TortuositySpatialObjectFilter */
+  itkSetMacro( SmoothingMethod, ::tube::SmoothTubeFunctionEnum );
+  itkGetConstMacro( SmoothingMethod, ::tube::SmoothTubeFunctionEnum );
+  itkSetMacro( SmoothingScale, double );
+  itkGetConstMacro( SmoothingScale, double );
+  itkSetMacro( NumberOfBins, size_t );
+  itkGetConstMacro( NumberOfBins, size_t );
+  itkSetMacro( HistogramMin, double );
+  itkGetConstMacro( HistogramMin, double );
+  itkSetMacro( HistogramMax, double );
+  itkGetConstMacro( HistogramMax, double );
+
+  /** Name of the column of a vessel-wise metric flag, empty otherwise */
+  static std::string GetMetricName( int metricFlag );
+
+  /** Access the table of metrics computed by the last update */
+  unsigned int GetNumberOfColumns( void ) const
+    { return static_cast< unsigned int >( m_ColumnNames.size() ); }
+  SizeValueType GetNumberOfRows( void ) const
+    { return m_Columns.empty() ? 0 : m_Columns[0].size(); }
+  const std::string & GetColumnName( unsigned int column ) const
+    { return m_ColumnNames[column]; }
+  const std::vector< double > & GetColumn( unsigned int column ) const
+    { return m_Columns[column]; }
+
+  /** Write the table as comma separated values, with a header line of
+   * quoted column names. */
+  void WriteCSV( std::ostream & os ) const;
+
+protected:
+  TortuosityTubeTreeSpatialObjectFilter( void );
+  virtual ~TortuosityTubeTreeSpatialObjectFilter( void );
+
+  virtual void GenerateData( void );
+
+private:
+  // purposely not implemented
+  TortuosityTubeTreeSpatialObjectFilter( const Self & );
+
+  // purposely not implemented
+  void operator=( const Self & );
+
+  /** Set up the columns for numberOfTubes rows */
+  void BuildColumns( SizeValueType numberOfTubes );
+
+  struct MeasureThreadStruct
+    {
+    Self *                                Filter;
+    std::vector< TubeSpatialObjectType * > Tubes;
+    std::vector< std::string >            Errors;
+    }; // End struct MeasureThreadStruct
+
+  static ITK_THREAD_RETURN_TYPE MeasureThreaderCallback( void * arg );
+
+  /** Value of a vessel-wise metric flag computed by filter */
+  static double GetMetricValue( const TortuosityFilterType * filter,
+    int metricFlag );
+
+  /** Store the metrics of the tube in a row of the table, only its ID
+   * and number of points when filter is NULL */
+  void FillRow( SizeValueType row, const TubeSpatialObjectType * tube,
+    const TortuosityFilterType * filter );
+
+  int                                     m_MeasureFlag;
+  ::tube::SmoothTubeFunctionEnum          m_SmoothingMethod;
+  double                                  m_SmoothingScale;
+  size_t                                  m_NumberOfBins;
+  double                                  m_HistogramMin;
+  double                                  m_HistogramMax;
+
+  /** Flags of the vessel-wise metric columns, which follow the
+   * "TubeIDs" and "NumberOfPoints" columns */
+  std::vector< int >                      m_MetricFlags;
+  std::vector< std::string >              m_ColumnNames;
+  std::vector< std::vector< double > >    m_Columns;
+
+}; // End class TortuosityTubeTreeSpatialObjectFilter
+
+} // End namespace tube
+
+} // End namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itktubeTortuosityTubeTreeSpatialObjectFilter.hxx"
+#endif
+
+#endif // End !defined(__itktubeTortuosityTubeTreeSpatialObjectFilter_h)
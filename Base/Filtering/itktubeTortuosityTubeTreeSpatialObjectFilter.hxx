@@ -0,0 +1,348 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright 2010 Kitware Inc. 28 Corporate Drive,
+Clifton Park, NY, 12065, USA.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#ifndef __itktubeTortuosityTubeTreeSpatialObjectFilter_hxx
+#define __itktubeTortuosityTubeTreeSpatialObjectFilter_hxx
+
+#include "itktubeTortuosityTubeTreeSpatialObjectFilter.h"
+
+#include <sstream>
+
+namespace itk
+{
+
+namespace tube
+{
+
+template< class TSpatialObject, class TTubeSpatialObject >
+TortuosityTubeTreeSpatialObjectFilter< TSpatialObject, TTubeSpatialObject >
+::TortuosityTubeTreeSpatialObjectFilter( void )
+  : m_MeasureFlag( TortuosityFilterType::BITMASK_ALL_METRICS ),
+    m_SmoothingMethod( ::tube::SMOOTH_TUBE_USING_INDEX_GAUSSIAN ),
+    m_SmoothingScale( 5.0 ),
+    m_NumberOfBins( 20 ),
+    m_HistogramMin( 0 ),
+    m_HistogramMax( 1 )
+{
+}
+
+template< class TSpatialObject, class TTubeSpatialObject >
+TortuosityTubeTreeSpatialObjectFilter< TSpatialObject, TTubeSpatialObject >
+::~TortuosityTubeTreeSpatialObjectFilter( void )
+{
+}
+
+template< class TSpatialObject, class TTubeSpatialObject >
+std::string
+TortuosityTubeTreeSpatialObjectFilter< TSpatialObject, TTubeSpatialObject >
+::GetMetricName( int metricFlag )
+{
+  switch( metricFlag )
+    {
+    case TortuosityFilterType::AVERAGE_RADIUS_METRIC:
+      return "AverageRadiusMetric";
+    case TortuosityFilterType::CHORD_LENGTH_METRIC:
+      return "ChordLengthMetric";
+    case TortuosityFilterType::DISTANCE_METRIC:
+      return "DistanceMetric";
+    case TortuosityFilterType::INFLECTION_COUNT_METRIC:
+      return "InflectionCountMetric";
+    case TortuosityFilterType::INFLECTION_COUNT_1_METRIC:
+      return "InflectionCount1Metric";
+    case TortuosityFilterType::INFLECTION_COUNT_2_METRIC:
+      return "InflectionCount2Metric";
+    case TortuosityFilterType::PATH_LENGTH_METRIC:
+      return "PathLengthMetric";
+    case TortuosityFilterType::PERCENTILE_95_METRIC:
+      return "Percentile95Metric";
+    case TortuosityFilterType::SUM_OF_ANGLES_METRIC:
+      return "SumOfAnglesMetric";
+    case TortuosityFilterType::TOTAL_CURVATURE_METRIC:
+      return "TotalCurvatureMetric";
+    case TortuosityFilterType::TOTAL_SQUARED_CURVATURE_METRIC:
+      return "TotalSquaredCurvatureMetric";
+    default:
+      return "";
+    }
+}
+
+template< class TSpatialObject, class TTubeSpatialObject >
+double
+TortuosityTubeTreeSpatialObjectFilter< TSpatialObject, TTubeSpatialObject >
+::GetMetricValue( const TortuosityFilterType * filter, int metricFlag )
+{
+  switch( metricFlag )
+    {
+    case TortuosityFilterType::AVERAGE_RADIUS_METRIC:
+      return filter->GetAverageRadiusMetric();
+    case TortuosityFilterType::CHORD_LENGTH_METRIC:
+      return filter->GetChordLengthMetric();
+    case TortuosityFilterType::DISTANCE_METRIC:
+      return filter->GetDistanceMetric();
+    case TortuosityFilterType::INFLECTION_COUNT_METRIC:
+      return filter->GetInflectionCountMetric();
+    case TortuosityFilterType::INFLECTION_COUNT_1_METRIC:
+      return filter->GetInflectionCount1Metric();
+    case TortuosityFilterType::INFLECTION_COUNT_2_METRIC:
+      return filter->GetInflectionCount2Metric();
+    case TortuosityFilterType::PATH_LENGTH_METRIC:
+      return filter->GetPathLengthMetric();
+    case TortuosityFilterType::PERCENTILE_95_METRIC:
+      return filter->GetPercentile95Metric();
+    case TortuosityFilterType::SUM_OF_ANGLES_METRIC:
+      return filter->GetSumOfAnglesMetric();
+    case TortuosityFilterType::TOTAL_CURVATURE_METRIC:
+      return filter->GetTotalCurvatureMetric();
+    case TortuosityFilterType::TOTAL_SQUARED_CURVATURE_METRIC:
+      return filter->GetTotalSquaredCurvatureMetric();
+    default:
+      return -1.0;
+    }
+}
+
+template< class TSpatialObject, class TTubeSpatialObject >
+void
+TortuosityTubeTreeSpatialObjectFilter< TSpatialObject, TTubeSpatialObject >
+::BuildColumns( SizeValueType numberOfTubes )
+{
+  m_MetricFlags.clear();
+  m_ColumnNames.clear();
+
+  m_ColumnNames.push_back( "TubeIDs" );
+  m_ColumnNames.push_back( "NumberOfPoints" );
+
+  for( int flag = 0x01; flag <= static_cast< int >(
+    TortuosityFilterType::BITMASK_VESSEL_WISE_METRICS ); flag <<= 1 )
+    {
+    if( m_MeasureFlag & flag &
+      TortuosityFilterType::BITMASK_VESSEL_WISE_METRICS )
+      {
+      m_MetricFlags.push_back( flag );
+      m_ColumnNames.push_back( GetMetricName( flag ) );
+      }
+    }
+
+  if( m_MeasureFlag & TortuosityFilterType::TOTAL_CURVATURE_METRIC )
+    {
+    m_ColumnNames.push_back( "Tau4Metric" );
+    }
+
+  if( m_MeasureFlag & TortuosityFilterType::CURVATURE_HISTOGRAM_METRICS )
+    {
+    double histStep = ( m_HistogramMax - m_HistogramMin ) / m_NumberOfBins;
+    for( size_t i = 0; i < m_NumberOfBins; i++ )
+      {
+      std::ostringstream oss;
+      oss << "Hist-Bin#" << i << ": " << i * histStep << " - "
+        << ( i + 1 ) * histStep;
+      m_ColumnNames.push_back( oss.str() );
+      }
+    }
+
+  m_Columns.assign( m_ColumnNames.size(),
+    std::vector< double >( numberOfTubes, -1.0 ) );
+}
+
+template< class TSpatialObject, class TTubeSpatialObject >
+void
+TortuosityTubeTreeSpatialObjectFilter< TSpatialObject, TTubeSpatialObject >
+::FillRow( SizeValueType row, const TubeSpatialObjectType * tube,
+  const TortuosityFilterType * filter )
+{
+  unsigned int column = 0;
+  m_Columns[column++][row] = static_cast< double >( row );
+  m_Columns[column++][row] = tube->GetNumberOfPoints();
+  if( filter == NULL )
+    {
+    return;
+    }
+
+  for( unsigned int i = 0; i < m_MetricFlags.size(); i++ )
+    {
+    m_Columns[column++][row] = GetMetricValue( filter, m_MetricFlags[i] );
+    }
+
+  if( m_MeasureFlag & TortuosityFilterType::TOTAL_CURVATURE_METRIC )
+    {
+    m_Columns[column++][row] = filter->GetTotalCurvatureMetric()
+      / filter->GetPathLengthMetric();
+    }
+
+  if( m_MeasureFlag & TortuosityFilterType::CURVATURE_HISTOGRAM_METRICS )
+    {
+    for( size_t i = 0; i < m_NumberOfBins; i++ )
+      {
+      m_Columns[column++][row] = filter->GetCurvatureHistogramMetric( i );
+      }
+    }
+}
+
+template< class TSpatialObject, class TTubeSpatialObject >
+ITK_THREAD_RETURN_TYPE
+TortuosityTubeTreeSpatialObjectFilter< TSpatialObject, TTubeSpatialObject >
+::MeasureThreaderCallback( void * arg )
+{
+  MultiThreader::ThreadInfoStruct * info =
+    static_cast< MultiThreader::ThreadInfoStruct * >( arg );
+  MeasureThreadStruct * str =
+    static_cast< MeasureThreadStruct * >( info->UserData );
+  Self * filter = str->Filter;
+
+  // Point-wise metrics are not stored, and Tau4 needs the path length
+  int measureFlag = filter->m_MeasureFlag
+    & ~TortuosityFilterType::BITMASK_POINT_WISE_METRICS;
+  if( measureFlag & TortuosityFilterType::TOTAL_CURVATURE_METRIC )
+    {
+    measureFlag |= TortuosityFilterType::PATH_LENGTH_METRIC;
+    }
+
+  // One filter per thread, updated on each of its tubes
+  typename TortuosityFilterType::Pointer tortuosityFilter =
+    TortuosityFilterType::New();
+  tortuosityFilter->SetMeasureFlag( measureFlag );
+  tortuosityFilter->SetSmoothingMethod( filter->m_SmoothingMethod );
+  tortuosityFilter->SetSmoothingScale( filter->m_SmoothingScale );
+  tortuosityFilter->SetNumberOfBins( filter->m_NumberOfBins );
+  tortuosityFilter->SetHistogramMin( filter->m_HistogramMin );
+  tortuosityFilter->SetHistogramMax( filter->m_HistogramMax );
+
+  // Tubes are dealt round-robin since their lengths vary a lot
+  for( SizeValueType row = info->ThreadID; row < str->Tubes.size();
+    row += info->NumberOfThreads )
+    {
+    if( str->Tubes[row]->GetNumberOfPoints() < 2 )
+      {
+      filter->FillRow( row, str->Tubes[row], NULL );
+      continue;
+      }
+    try
+      {
+      tortuosityFilter->SetInput( str->Tubes[row] );
+      tortuosityFilter->Update();
+      }
+    catch( ExceptionObject & err )
+      {
+      str->Errors[info->ThreadID] = err.GetDescription();
+      return ITK_THREAD_RETURN_VALUE;
+      }
+    filter->FillRow( row, str->Tubes[row], tortuosityFilter );
+    }
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+template< class TSpatialObject, class TTubeSpatialObject >
+void
+TortuosityTubeTreeSpatialObjectFilter< TSpatialObject, TTubeSpatialObject >
+::GenerateData( void )
+{
+  typename SpatialObjectType::Pointer output = this->GetOutput();
+  const SpatialObjectType * input = this->GetInput();
+
+  output->CopyInformation( input );
+
+  MeasureThreadStruct str;
+  str.Filter = this;
+
+  // The input can itself be a tube
+  TubeSpatialObjectType * inputAsTube = dynamic_cast<
+    TubeSpatialObjectType * >( const_cast< SpatialObjectType * >( input ) );
+  if( inputAsTube != NULL )
+    {
+    str.Tubes.push_back( inputAsTube );
+    }
+
+  typedef typename SpatialObjectType::ChildrenListType ChildrenListType;
+  char childName[] = "Tube";
+  ChildrenListType *children = input->GetChildren(
+    input->GetMaximumDepth(), childName );
+  typename ChildrenListType::const_iterator it = children->begin();
+  while( it != children->end() )
+    {
+    TubeSpatialObjectType * tube =
+      dynamic_cast< TubeSpatialObjectType * >( it->GetPointer() );
+    if( tube != NULL )
+      {
+      str.Tubes.push_back( tube );
+      }
+    ++it;
+    }
+  delete children;
+
+  this->BuildColumns( str.Tubes.size() );
+  if( str.Tubes.empty() )
+    {
+    return;
+    }
+
+  this->GetMultiThreader()->SetNumberOfThreads( this->GetNumberOfThreads() );
+  str.Errors.assign( this->GetMultiThreader()->GetNumberOfThreads(),
+    std::string() );
+  this->GetMultiThreader()->SetSingleMethod( this->MeasureThreaderCallback,
+    &str );
+  this->GetMultiThreader()->SingleMethodExecute();
+
+  for( unsigned int i = 0; i < str.Errors.size(); i++ )
+    {
+    if( !str.Errors[i].empty() )
+      {
+      itkExceptionMacro( << "Cannot compute tortuosity: " << str.Errors[i] );
+      }
+    }
+}
+
+template< class TSpatialObject, class TTubeSpatialObject >
+void
+TortuosityTubeTreeSpatialObjectFilter< TSpatialObject, TTubeSpatialObject >
+::WriteCSV( std::ostream & os ) const
+{
+  for( unsigned int column = 0; column < m_ColumnNames.size(); column++ )
+    {
+    if( column > 0 )
+      {
+      os << ",";
+      }
+    os << "\"" << m_ColumnNames[column] << "\"";
+    }
+  os << "\n";
+
+  const SizeValueType numberOfRows = this->GetNumberOfRows();
+  for( SizeValueType row = 0; row < numberOfRows; row++ )
+    {
+    for( unsigned int column = 0; column < m_Columns.size(); column++ )
+      {
+      if( column > 0 )
+        {
+        os << ",";
+        }
+      os << m_Columns[column][row];
+      }
+    os << "\n";
+    }
+}
+
+} // End namespace tube
+
+} // End namespace itk
+
+#endif // End !defined(__itktubeTortuosityTubeTreeSpatialObjectFilter_hxx)
@@ -24,15 +24,19 @@ limitations under the License.
 #ifndef __itktubeTubeSpatialObjectToDensityImageFilter_h
 #define __itktubeTubeSpatialObjectToDensityImageFilter_h
 
-#include "itktubeInverseIntensityImageFilter.h"
+#include "itktubeNearestSiteFinder.h"
 #include "itktubeTubeSpatialObjectToImageFilter.h"
 
-#include <itkDanielssonDistanceMapImageFilter.h>
 #include <itkGroupSpatialObject.h>
 #include <itkImage.h>
 #include <itkImageFileWriter.h>
+#include <itkMultiThreader.h>
 #include <itkVesselTubeSpatialObject.h>
 
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
 namespace itk
 {
 
@@ -76,12 +80,6 @@ public:
   typedef VesselTubeSpatialObject<
     itkGetStaticConstMacro( ImageDimension ) >  TubeType;
 
-  typedef typename DensityImageType::OffsetType VectorPixelType;
-  typedef Image<
-    VectorPixelType,
-    itkGetStaticConstMacro( ImageDimension ) >  VectorImageType;
-  typedef typename VectorImageType::Pointer     VectorImagePointer;
-
   typedef typename DensityImageType::SizeType     SizeType;
   typedef typename DensityImageType::SpacingType  SpacingType;
 
@@ -89,10 +87,7 @@ public:
     itkGetStaticConstMacro( ImageDimension ),
     DensityImageType > TubetoImageFilterType;
 
-  typedef DanielssonDistanceMapImageFilter<
-    DensityImageType, DensityImageType > DanielssonFilterType;
-
-  /** Retrieve Density map created by inverted Danielsson Distance Map */
+  /** Retrieve Density map created by inverted distance map */
   itkSetMacro( DensityMapImage, DensityImagePointer );
   itkGetMacro( DensityMapImage, DensityImagePointer );
   itkSetMacro( RadiusMapImage, RadiusImagePointer );
@@ -114,6 +109,11 @@ public:
   /** Sets the element spacing */
   void SetSpacing( SpacingType );
   itkGetMacro( Spacing, SpacingType );
+
+  /** Number of threads used to compute the maps */
+  itkSetMacro( NumberOfThreads, ThreadIdType );
+  itkGetMacro( NumberOfThreads, ThreadIdType );
+
   void Update( void );
 
 protected:
@@ -121,6 +121,14 @@ protected:
   TubeSpatialObjectToDensityImageFilter( void );
   ~TubeSpatialObjectToDensityImageFilter( void );
 
+  /** Turn the rasterized tubes held by m_DensityMapImage into the inverted
+   *  distance map, and copy the radius and tangent of the nearest tube
+   *  voxel to every voxel of m_RadiusMapImage and m_TangentMapImage.
+   *  Distances are exact and in voxels.  The nearest tube voxel of each
+   *  voxel is found by NearestSiteFinder, using the buffer offsets of the
+   *  tube voxels as sites. */
+  void ComputeMaps( void );
+
 private:
 
   TubeGroupPointer                  m_InputTubeGroup;
@@ -134,6 +142,36 @@ private:
   DensityPixelType                  m_MaxDensityIntensity;
   bool                              m_UseSquareDistance;
 
+  ThreadIdType                      m_NumberOfThreads;
+
+  /** Maps the buffer offset of a tube voxel to its index */
+  struct OffsetIndexFunction
+    {
+    typedef OffsetValueType                   SiteType;
+
+    SizeType                                  Size;
+    OffsetValueType                           Stride[ImageDimension];
+
+    double operator()( OffsetValueType site, unsigned int dimension ) const
+      {
+      return ( site / Stride[dimension] ) % Size[dimension];
+      }
+    }; // End struct OffsetIndexFunction
+
+  struct MapsThreadStruct
+    {
+    Self *                                    Filter;
+    std::vector< OffsetValueType > *          Sites;
+    SizeType                                  Size;
+    bool                                      Invert;
+    DensityPixelType                          Minimum;
+    DensityPixelType                          Maximum;
+    std::vector< DensityPixelType >           ThreadMaximum;
+    }; // End struct MapsThreadStruct
+
+  static ITK_THREAD_RETURN_TYPE FillThreaderCallback( void * arg );
+  static ITK_THREAD_RETURN_TYPE InvertThreaderCallback( void * arg );
+
 }; // End class TubeSpatialObjectToDensityImageFilter
 
 #ifndef ITK_MANUAL_INSTANTIATION
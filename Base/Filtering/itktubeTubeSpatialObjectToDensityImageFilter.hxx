@@ -40,6 +40,7 @@ TubeSpatialObjectToDensityImageFilter< TDensityImageType, TRadiusImageType,
     }
   m_MaxDensityIntensity = 255;   //NumericTraits<DensityPixelType>::max();
   m_UseSquareDistance = false;
+  m_NumberOfThreads = MultiThreader::GetGlobalDefaultNumberOfThreads();
 }
 
 /** Destructor */
@@ -98,105 +99,209 @@ TubeSpatialObjectToDensityImageFilter< TDensityImageType, TRadiusImageType,
     tubefilter->SetSpacing( m_Spacing );
     tubefilter->Update();
 
-    typename DanielssonFilterType::Pointer
-                danFilter = DanielssonFilterType::New();
-
-    danFilter->SetInput( tubefilter->GetOutput() );
-
-    danFilter->Update();
-
-    VectorImagePointer  vectorImage = danFilter->GetVectorDistanceMap();
+    m_DensityMapImage  = tubefilter->GetOutput();
     m_RadiusMapImage   = tubefilter->GetRadiusImage();
     m_TangentMapImage  = tubefilter->GetTangentImage();
-    m_DensityMapImage  = danFilter->GetDistanceMap();
 
-    // ** If Requested: Square the Dan.Dis. image values to get the
-    //      Squared distance image ** //
-    if( m_UseSquareDistance )
+    this->ComputeMaps();
+    }
+  catch( itk::ExceptionObject &e )
+    {
+    std::cerr << "\n Error caught in TubeSpatialObjectToDensityImageFilter Class"
+              << std::endl;
+    std::cerr << e.GetDescription() <<std::endl;
+    }
+}
+
+
+/** ComputeMaps */
+template< class TDensityImageType, class TRadiusImageType,
+          class TTangentImageType >
+void
+TubeSpatialObjectToDensityImageFilter< TDensityImageType, TRadiusImageType,
+                                 TTangentImageType >
+::ComputeMaps( void )
+{
+  const SizeType size =
+    m_DensityMapImage->GetLargestPossibleRegion().GetSize();
+  const SizeValueType numberOfPixels =
+    m_DensityMapImage->GetLargestPossibleRegion().GetNumberOfPixels();
+
+  // The site of each voxel is the offset of the closest tube voxel, or
+  //   -1 before it is found.  Each tube voxel is its own site.
+  std::vector< OffsetValueType > sites( numberOfPixels, -1 );
+  const DensityPixelType * densityBuffer =
+    m_DensityMapImage->GetBufferPointer();
+  bool hasTubes = false;
+  for( SizeValueType p = 0; p < numberOfPixels; p++ )
+    {
+    if( densityBuffer[p] != 0 )
       {
-      typedef ImageRegionIterator<DensityImageType>   DistanceIteratorType;
-      DistanceIteratorType  it_dis( m_DensityMapImage,
-                                    m_DensityMapImage->GetLargestPossibleRegion());
-      it_dis.GoToBegin();
-      while( !it_dis.IsAtEnd() )
-        {
-        DensityPixelType number = it_dis.Get();
-        DensityPixelType square = number*number;
-        it_dis.Set( square );
-        ++it_dis;
-        }
+      sites[p] = p;
+      hasTubes = true;
       }
+    }
+  if( !hasTubes )
+    {
+    m_DensityMapImage->FillBuffer( 0 );
+    return;
+    }
 
-    typedef ImageRegionIterator<VectorImageType>   VectorIteratorType;
-    typedef ImageRegionIterator<RadiusImageType>   RadiusIteratorType;
+  MultiThreader::Pointer threader = MultiThreader::New();
+  threader->SetNumberOfThreads( m_NumberOfThreads );
 
-    VectorIteratorType it_vector( vectorImage,
-                                  vectorImage->GetLargestPossibleRegion() );
-    RadiusIteratorType it_radius( m_RadiusMapImage,
-                                  m_RadiusMapImage->GetLargestPossibleRegion() );
+  OffsetIndexFunction offsetIndex;
+  offsetIndex.Size = size;
+  OffsetValueType stride = 1;
+  for( unsigned int i = 0; i < ImageDimension; i++ )
+    {
+    offsetIndex.Stride[i] = stride;
+    stride *= size[i];
+    }
+  NearestSiteFinder< ImageDimension, OffsetIndexFunction >::FindNearestSites(
+    size, offsetIndex, sites, threader );
+
+  MapsThreadStruct str;
+  str.Filter = this;
+  str.Sites = &sites;
+  str.Size = size;
+
+  // The distance map is zero at the tubes, so its minimum is known.  If
+  //   the maximum used for the inversion is given too, the inverted
+  //   distances are written directly.
+  str.Minimum = 0;
+  str.Maximum = m_MaxDensityIntensity;
+  str.Invert = ( m_MaxDensityIntensity != 0 );
+  str.ThreadMaximum.assign( threader->GetNumberOfThreads(), 0 );
+  threader->SetSingleMethod( this->FillThreaderCallback, &str );
+  threader->SingleMethodExecute();
+
+  if( !str.Invert )
+    {
+    str.Maximum = *std::max_element( str.ThreadMaximum.begin(),
+      str.ThreadMaximum.end() );
+    threader->SetSingleMethod( this->InvertThreaderCallback, &str );
+    threader->SingleMethodExecute();
+    }
+}
+
+
+/** FillThreaderCallback */
+template< class TDensityImageType, class TRadiusImageType,
+          class TTangentImageType >
+ITK_THREAD_RETURN_TYPE
+TubeSpatialObjectToDensityImageFilter< TDensityImageType, TRadiusImageType,
+                                 TTangentImageType >
+::FillThreaderCallback( void * arg )
+{
+  MultiThreader::ThreadInfoStruct * info =
+    static_cast< MultiThreader::ThreadInfoStruct * >( arg );
+  MapsThreadStruct * str =
+    static_cast< MapsThreadStruct * >( info->UserData );
+
+  Self * filter = str->Filter;
+  const SizeType & size = str->Size;
+  const std::vector< OffsetValueType > & sites = *( str->Sites );
+
+  DensityPixelType * densityBuffer =
+    filter->m_DensityMapImage->GetBufferPointer();
+  RadiusPixelType * radiusBuffer =
+    filter->m_RadiusMapImage->GetBufferPointer();
+  TangentPixelType * tangentBuffer =
+    filter->m_TangentMapImage->GetBufferPointer();
+
+  const SizeValueType numberOfPixels = sites.size();
+  const SizeValueType firstPixel =
+    ( numberOfPixels * info->ThreadID ) / info->NumberOfThreads;
+  const SizeValueType lastPixel =
+    ( numberOfPixels * ( info->ThreadID + 1 ) ) / info->NumberOfThreads;
+
+  DensityPixelType maximum = 0;
+  for( SizeValueType p = firstPixel; p < lastPixel; p++ )
+    {
+    const SizeValueType site = sites[p];
 
-    it_vector.GoToBegin();
-    it_radius.GoToBegin();
+    double distance = 0;
+    SizeValueType pixelOffset = p;
+    SizeValueType siteOffset = site;
+    for( unsigned int i = 0; i < ImageDimension; i++ )
+      {
+      const double tf = double( pixelOffset % size[i] )
+        - double( siteOffset % size[i] );
+      distance += tf * tf;
+      pixelOffset /= size[i];
+      siteOffset /= size[i];
+      }
+    if( !filter->m_UseSquareDistance )
+      {
+      distance = std::sqrt( distance );
+      }
 
-    //Use Vector Image to add the radius values
-    while( !it_vector.IsAtEnd() )
+    const DensityPixelType value = static_cast< DensityPixelType >(
+      distance );
+    if( str->Invert )
       {
-      VectorPixelType v = it_vector.Value();
-      typename DensityImageType::IndexType index = it_vector.GetIndex();
-      for( unsigned int i = 0; i < ImageDimension; i++ )
+      // As done by InverseIntensityImageFilter
+      if( value > str->Maximum )
         {
-        index[i] += v[i];
+        densityBuffer[p] = str->Minimum;
+        }
+      else
+        {
+        densityBuffer[p] = ( str->Maximum + str->Minimum ) - value;
         }
-      RadiusPixelType radius = m_RadiusMapImage->GetPixel( index );
-
-      it_radius.Set( radius );
-
-      ++it_vector;
-      ++it_radius;
       }
-
-    // Use Vector Image to find the closest vessel and add the tangent direction
-    typedef ImageRegionIterator<TangentImageType>   TangentIteratorType;
-    TangentIteratorType it_tangent( m_TangentMapImage,
-                                    m_TangentMapImage->GetLargestPossibleRegion());
-
-    it_vector.GoToBegin();
-    it_tangent.GoToBegin();
-
-    //Use Vector Image to add the radius values
-    while( !it_vector.IsAtEnd() )
+    else
       {
-      VectorPixelType v = it_vector.Value();
-      typename DensityImageType::IndexType index = it_vector.GetIndex();
-      for( unsigned int i = 0; i < ImageDimension; i++ )
+      densityBuffer[p] = value;
+      if( value > maximum )
         {
-        index[i] += v[i];
+        maximum = value;
         }
-      TangentPixelType tangent = m_TangentMapImage->GetPixel( index );
-
-      it_tangent.Set( tangent );
+      }
 
-      ++it_vector;
-      ++it_tangent;
+    // Tube voxels keep their own radius and tangent, and are the only
+    //   ones read
+    if( site != p )
+      {
+      radiusBuffer[p] = radiusBuffer[site];
+      tangentBuffer[p] = tangentBuffer[site];
       }
+    }
+  str->ThreadMaximum[info->ThreadID] = maximum;
 
-    //**** Invert the Distance Map image
-    typename InverseIntensityImageFilter<DensityImageType>::Pointer
-             InverseFilter;
-    InverseFilter = InverseIntensityImageFilter<DensityImageType>::New();
+  return ITK_THREAD_RETURN_VALUE;
+}
 
-    InverseFilter->SetInput( m_DensityMapImage );  //  inverse intensity
-    InverseFilter->SetInverseMaximumIntensity( m_MaxDensityIntensity );
-    InverseFilter->Update();
 
-    m_DensityMapImage = InverseFilter->GetOutput();
-    }
-  catch( itk::ExceptionObject &e )
+/** InvertThreaderCallback */
+template< class TDensityImageType, class TRadiusImageType,
+          class TTangentImageType >
+ITK_THREAD_RETURN_TYPE
+TubeSpatialObjectToDensityImageFilter< TDensityImageType, TRadiusImageType,
+                                 TTangentImageType >
+::InvertThreaderCallback( void * arg )
+{
+  MultiThreader::ThreadInfoStruct * info =
+    static_cast< MultiThreader::ThreadInfoStruct * >( arg );
+  MapsThreadStruct * str =
+    static_cast< MapsThreadStruct * >( info->UserData );
+
+  DensityPixelType * densityBuffer =
+    str->Filter->m_DensityMapImage->GetBufferPointer();
+
+  const SizeValueType numberOfPixels = str->Sites->size();
+  const SizeValueType firstPixel =
+    ( numberOfPixels * info->ThreadID ) / info->NumberOfThreads;
+  const SizeValueType lastPixel =
+    ( numberOfPixels * ( info->ThreadID + 1 ) ) / info->NumberOfThreads;
+
+  for( SizeValueType p = firstPixel; p < lastPixel; p++ )
     {
-    std::cerr << "\n Error caught in TubeSpatialObjectToDensityImageFilter Class"
-              << std::endl;
-    std::cerr << e.GetDescription() <<std::endl;
+    densityBuffer[p] = ( str->Maximum + str->Minimum ) - densityBuffer[p];
     }
+
+  return ITK_THREAD_RETURN_VALUE;
 }
 
 #endif // End !defined(__itktubeTubeSpatialObjectToDensityImageFilter_hxx)
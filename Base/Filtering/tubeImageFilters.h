@@ -25,6 +25,9 @@ limitations under the License.
 #define __tubeImageFilters_h
 
 #include <itkImageFileReader.h>
+#include <itkMultiThreader.h>
+
+#include <vector>
 
 namespace tube
 {
@@ -36,6 +39,20 @@ public:
   typedef itk::Image< PixelType, VDimension >      ImageType;
   typedef itk::ImageFileReader< ImageType >        VolumeReaderType;
 
+  /** Pointwise operation that ApplyPointwiseOperations can fuse with
+   *  its neighbours into a single pass over the image */
+  struct PointwiseOperationType
+    {
+    typedef enum { INTENSITY_WINDOWING, THRESHOLD, MASK, ADD, MULTIPLY,
+      ABSOLUTE } OperationEnum;
+
+    OperationEnum                 Operation;
+    float                         Parameters[4];
+    typename ImageType::Pointer   Image2;
+    };
+
+  typedef std::vector< PointwiseOperationType > PointwiseOperationListType;
+
   /** Intensity window inVal range to outValRange. */
   static void ApplyIntensityWindowing( typename ImageType::Pointer imIn,
     float inValMin, float inValMax, float outMin, float outMax );
@@ -166,10 +183,57 @@ public:
     unsigned int numberOfIterations, unsigned int numberOfSamples,
     const std::string & centroidOutFilePath );
 
+  /** Queue ApplyIntensityWindowing */
+  static void AddIntensityWindowingOperation(
+    PointwiseOperationListType & operations, float inValMin,
+    float inValMax, float outMin, float outMax );
+
+  /** Queue ThresholdImage */
+  static void AddThresholdOperation(
+    PointwiseOperationListType & operations, float threshLow,
+    float threshHigh, float valTrue, float valFalse );
+
+  /** Queue MaskImageWithValueIfNotWithinSecondImageRange.  The mask is
+   *  read and resampled to imIn now. */
+  static bool AddMaskOperation( PointwiseOperationListType & operations,
+    typename ImageType::Pointer imIn, const std::string & imIn2FilePath,
+    float threshLow, float threshHigh, float valFalse );
+
+  /** Queue AddImages.  The second image is read now. */
+  static bool AddAddImagesOperation(
+    PointwiseOperationListType & operations,
+    const std::string & imIn2FilePath, float weight1, float weight2 );
+
+  /** Queue MultiplyImages.  The second image is read now. */
+  static bool AddMultiplyImagesOperation(
+    PointwiseOperationListType & operations,
+    const std::string & imIn2FilePath );
+
+  /** Queue AbsoluteImage */
+  static void AddAbsoluteOperation(
+    PointwiseOperationListType & operations );
+
+  /** Apply the queued operations, in order, in one multithreaded pass
+   *  over the image, then clear the queue.  Gives the same result as
+   *  calling the individual filters one after the other. */
+  static void ApplyPointwiseOperations( typename ImageType::Pointer imIn,
+    PointwiseOperationListType & operations );
+
 private:
   ImageFilters();
   ~ImageFilters();
 
+  struct PointwiseThreadStruct
+    {
+    ImageType *                         Image;
+    const PointwiseOperationListType *  Operations;
+    }; // End struct PointwiseThreadStruct
+
+  static ITK_THREAD_RETURN_TYPE PointwiseThreaderCallback( void * arg );
+
+  static bool ReadSecondImage( const std::string & imIn2FilePath,
+    typename ImageType::Pointer & imIn2 );
+
 }; // End class ImageFilters
 
 } // End namespace tube
@@ -1461,6 +1461,283 @@ ImageFilters<VDimension>
   return true;
 }
 
+//----------------------------------------------------------------------------
+template< unsigned int VDimension >
+bool
+ImageFilters<VDimension>
+::ReadSecondImage( const std::string & imIn2FilePath,
+  typename ImageType::Pointer & imIn2 )
+{
+  typename VolumeReaderType::Pointer reader2 = VolumeReaderType::New();
+  reader2->SetFileName( imIn2FilePath.c_str() );
+  imIn2 = reader2->GetOutput();
+  try
+    {
+    reader2->Update();
+    }
+  catch( ... )
+    {
+    std::cout << "Problems reading file format of inFile2."
+              << std::endl;
+    return false;
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+template< unsigned int VDimension >
+void
+ImageFilters<VDimension>
+::AddIntensityWindowingOperation( PointwiseOperationListType & operations,
+  float inValMin, float inValMax, float outMin, float outMax )
+{
+  PointwiseOperationType op;
+  op.Operation = PointwiseOperationType::INTENSITY_WINDOWING;
+  op.Parameters[0] = inValMin;
+  op.Parameters[1] = inValMax;
+  op.Parameters[2] = outMin;
+  op.Parameters[3] = outMax;
+  operations.push_back( op );
+}
+
+//----------------------------------------------------------------------------
+template< unsigned int VDimension >
+void
+ImageFilters<VDimension>
+::AddThresholdOperation( PointwiseOperationListType & operations,
+  float threshLow, float threshHigh, float valTrue, float valFalse )
+{
+  PointwiseOperationType op;
+  op.Operation = PointwiseOperationType::THRESHOLD;
+  op.Parameters[0] = threshLow;
+  op.Parameters[1] = threshHigh;
+  op.Parameters[2] = valTrue;
+  op.Parameters[3] = valFalse;
+  operations.push_back( op );
+}
+
+//----------------------------------------------------------------------------
+template< unsigned int VDimension >
+bool
+ImageFilters<VDimension>
+::AddMaskOperation( PointwiseOperationListType & operations,
+  typename ImageType::Pointer imIn, const std::string & imIn2FilePath,
+  float threshLow, float threshHigh, float valFalse )
+{
+  PointwiseOperationType op;
+  if( !ReadSecondImage( imIn2FilePath, op.Image2 ) )
+    {
+    return false;
+    }
+  op.Image2 = ResampleImage( op.Image2, imIn );
+  op.Operation = PointwiseOperationType::MASK;
+  op.Parameters[0] = threshLow;
+  op.Parameters[1] = threshHigh;
+  op.Parameters[2] = valFalse;
+  op.Parameters[3] = 0;
+  operations.push_back( op );
+  return true;
+}
+
+//----------------------------------------------------------------------------
+template< unsigned int VDimension >
+bool
+ImageFilters<VDimension>
+::AddAddImagesOperation( PointwiseOperationListType & operations,
+  const std::string & imIn2FilePath, float weight1, float weight2 )
+{
+  PointwiseOperationType op;
+  if( !ReadSecondImage( imIn2FilePath, op.Image2 ) )
+    {
+    return false;
+    }
+  op.Operation = PointwiseOperationType::ADD;
+  op.Parameters[0] = weight1;
+  op.Parameters[1] = weight2;
+  op.Parameters[2] = 0;
+  op.Parameters[3] = 0;
+  operations.push_back( op );
+  return true;
+}
+
+//----------------------------------------------------------------------------
+template< unsigned int VDimension >
+bool
+ImageFilters<VDimension>
+::AddMultiplyImagesOperation( PointwiseOperationListType & operations,
+  const std::string & imIn2FilePath )
+{
+  PointwiseOperationType op;
+  if( !ReadSecondImage( imIn2FilePath, op.Image2 ) )
+    {
+    return false;
+    }
+  op.Operation = PointwiseOperationType::MULTIPLY;
+  op.Parameters[0] = 0;
+  op.Parameters[1] = 0;
+  op.Parameters[2] = 0;
+  op.Parameters[3] = 0;
+  operations.push_back( op );
+  return true;
+}
+
+//----------------------------------------------------------------------------
+template< unsigned int VDimension >
+void
+ImageFilters<VDimension>
+::AddAbsoluteOperation( PointwiseOperationListType & operations )
+{
+  PointwiseOperationType op;
+  op.Operation = PointwiseOperationType::ABSOLUTE;
+  op.Parameters[0] = 0;
+  op.Parameters[1] = 0;
+  op.Parameters[2] = 0;
+  op.Parameters[3] = 0;
+  operations.push_back( op );
+}
+
+//----------------------------------------------------------------------------
+template< unsigned int VDimension >
+ITK_THREAD_RETURN_TYPE
+ImageFilters<VDimension>
+::PointwiseThreaderCallback( void * arg )
+{
+  itk::MultiThreader::ThreadInfoStruct * info =
+    static_cast< itk::MultiThreader::ThreadInfoStruct * >( arg );
+  PointwiseThreadStruct * str =
+    static_cast< PointwiseThreadStruct * >( info->UserData );
+
+  const itk::SizeValueType numPixels = str->Image->
+    GetLargestPossibleRegion().GetNumberOfPixels();
+  const itk::SizeValueType startPixel = ( numPixels * info->ThreadID )
+    / info->NumberOfThreads;
+  const itk::SizeValueType endPixel = ( numPixels * ( info->ThreadID + 1 ) )
+    / info->NumberOfThreads;
+
+  const PointwiseOperationListType & operations = *( str->Operations );
+  const unsigned int numOperations = operations.size();
+
+  // Each operation casts its result back to PixelType, as the
+  //   individual filters do when they write the image
+  std::vector< const PixelType * > image2( numOperations );
+  std::vector< itk::SizeValueType > image2Size( numOperations );
+  for( unsigned int o = 0; o < numOperations; ++o )
+    {
+    image2[o] = NULL;
+    image2Size[o] = 0;
+    if( operations[o].Image2.IsNotNull() )
+      {
+      image2[o] = operations[o].Image2->GetBufferPointer();
+      image2Size[o] = operations[o].Image2->GetLargestPossibleRegion()
+        .GetNumberOfPixels();
+      }
+    }
+
+  PixelType * buffer = str->Image->GetBufferPointer();
+  for( itk::SizeValueType i = startPixel; i < endPixel; ++i )
+    {
+    PixelType v = buffer[i];
+    for( unsigned int o = 0; o < numOperations; ++o )
+      {
+      const float * param = operations[o].Parameters;
+      switch( operations[o].Operation )
+        {
+        case PointwiseOperationType::INTENSITY_WINDOWING:
+          {
+          double tf = v;
+          tf = ( tf-param[0] )/( param[1]-param[0] );
+          if( tf<0 )
+            {
+            tf = 0;
+            }
+          if( tf>1 )
+            {
+            tf = 1;
+            }
+          tf = ( tf * ( param[3]-param[2] ) ) + param[2];
+          v = ( PixelType )tf;
+          break;
+          }
+        case PointwiseOperationType::THRESHOLD:
+          {
+          double tf = v;
+          if( tf >= param[0] && tf <= param[1] )
+            {
+            v = ( PixelType )param[2];
+            }
+          else
+            {
+            v = ( PixelType )param[3];
+            }
+          break;
+          }
+        case PointwiseOperationType::MASK:
+          {
+          if( i < image2Size[o] )
+            {
+            double tf2 = image2[o][i];
+            if( !( tf2 >= param[0] && tf2 <= param[1] ) )
+              {
+              v = ( PixelType )param[2];
+              }
+            }
+          break;
+          }
+        case PointwiseOperationType::ADD:
+          {
+          if( i < image2Size[o] )
+            {
+            double tf1 = v;
+            double tf2 = image2[o][i];
+            double tf = param[0]*tf1 + param[1]*tf2;
+            v = ( PixelType )tf;
+            }
+          break;
+          }
+        case PointwiseOperationType::MULTIPLY:
+          {
+          if( i < image2Size[o] )
+            {
+            v = v * image2[o][i];
+            }
+          break;
+          }
+        case PointwiseOperationType::ABSOLUTE:
+          {
+          v = vnl_math_abs( v );
+          break;
+          }
+        }
+      }
+    buffer[i] = v;
+    }
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+//----------------------------------------------------------------------------
+template< unsigned int VDimension >
+void
+ImageFilters<VDimension>
+::ApplyPointwiseOperations( typename ImageType::Pointer imIn,
+  PointwiseOperationListType & operations )
+{
+  if( operations.empty() )
+    {
+    return;
+    }
+
+  PointwiseThreadStruct str;
+  str.Image = imIn.GetPointer();
+  str.Operations = &operations;
+
+  itk::MultiThreader::Pointer threader = itk::MultiThreader::New();
+  threader->SetSingleMethod( PointwiseThreaderCallback, &str );
+  threader->SingleMethodExecute();
+
+  operations.clear();
+}
+
 } // End namespace tube
 
 #endif // End !defined(__tubeImageFilters_hxx)
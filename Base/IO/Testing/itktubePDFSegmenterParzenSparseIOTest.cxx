@@ -0,0 +1,227 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright 2010 Kitware Inc. 28 Corporate Drive,
+Clifton Park, NY, 12065, USA.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "itktubePDFSegmenterParzenIO.h"
+
+#include <itkImageRegionConstIterator.h>
+#include <itkImageRegionConstIteratorWithIndex.h>
+#include <itkImageRegionIteratorWithIndex.h>
+
+namespace
+{
+
+typedef itk::Image< float, 2 > ParzenIOTestImageType;
+
+// The left half of the image is object 255, the right half object 127
+unsigned int CountMisclassifiedPixels( const ParzenIOTestImageType * labelMap )
+{
+  unsigned int numErrors = 0;
+  itk::ImageRegionConstIteratorWithIndex< ParzenIOTestImageType > it(
+    labelMap, labelMap->GetLargestPossibleRegion() );
+  while( !it.IsAtEnd() )
+    {
+    if( it.Get() != ( it.GetIndex()[0] < 32 ? 255 : 127 ) )
+      {
+      ++numErrors;
+      }
+    ++it;
+    }
+  return numErrors;
+}
+
+} // End namespace
+
+// Trains sparse PDFs on more features than dense PDFs support, classifies,
+//   and checks that the PDFs survive a write and read.
+int itktubePDFSegmenterParzenSparseIOTest( int argc, char * argv[] )
+{
+  if( argc != 2 )
+    {
+    std::cout << "Missing arguments." << std::endl;
+    std::cout << "Usage: " << std::endl;
+    std::cout << argv[0] << " pdfFile" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  const unsigned int numFeatures = 6;
+
+  typedef ParzenIOTestImageType           ImageType;
+
+  typedef itk::tube::PDFSegmenterParzen< ImageType, ImageType >
+    FilterType;
+
+  ImageType::SizeType size;
+  size.Fill( 64 );
+
+  // Left half is object 255, right half is object 127.  Each feature
+  //   separates them, with a deterministic noise that spreads the samples
+  //   over several bins.
+  FilterType::FeatureVectorGeneratorType::Pointer fvGen =
+    FilterType::FeatureVectorGeneratorType::New();
+  for( unsigned int f = 0; f < numFeatures; ++f )
+    {
+    ImageType::Pointer featureImage = ImageType::New();
+    featureImage->SetRegions( size );
+    featureImage->Allocate();
+    itk::ImageRegionIteratorWithIndex< ImageType > it( featureImage,
+      featureImage->GetLargestPossibleRegion() );
+    while( !it.IsAtEnd() )
+      {
+      const ImageType::IndexType & index = it.GetIndex();
+      const int noise = ( index[0] * 7 + index[1] * 13 + f * 5 ) % 11 - 5;
+      it.Set( ( index[0] < 32 ? 10 : 50 ) + 3 * f + noise );
+      ++it;
+      }
+    if( f == 0 )
+      {
+      fvGen->SetInput( featureImage );
+      }
+    else
+      {
+      fvGen->AddInput( featureImage );
+      }
+    }
+
+  // Train on one block of each object
+  ImageType::Pointer labelmapImage = ImageType::New();
+  labelmapImage->SetRegions( size );
+  labelmapImage->Allocate();
+  itk::ImageRegionIteratorWithIndex< ImageType > labelIt( labelmapImage,
+    labelmapImage->GetLargestPossibleRegion() );
+  while( !labelIt.IsAtEnd() )
+    {
+    const ImageType::IndexType & index = labelIt.GetIndex();
+    float label = 0;
+    if( index[1] >= 20 && index[1] < 40 )
+      {
+      if( index[0] >= 8 && index[0] < 24 )
+        {
+        label = 255;
+        }
+      else if( index[0] >= 40 && index[0] < 56 )
+        {
+        label = 127;
+        }
+      }
+    labelIt.Set( label );
+    ++labelIt;
+    }
+
+  FilterType::Pointer filter = FilterType::New();
+  filter->SetFeatureVectorGenerator( fvGen );
+  filter->SetLabelMap( labelmapImage );
+  filter->SetObjectId( 255 );
+  filter->AddObjectId( 127 );
+  filter->SetVoidId( 0 );
+  filter->SetErodeRadius( 0 );
+  filter->SetHoleFillIterations( 0 );
+  filter->SetProbabilityImageSmoothingStandardDeviation( 0 );
+  filter->SetHistogramSmoothingStandardDeviation( 2 );
+  filter->SetOutlierRejectPortion( 0 );
+  filter->SetReclassifyObjectLabels( true );
+  filter->SetReclassifyNotObjectLabels( true );
+  filter->SetForceClassification( true );
+  filter->Update();
+  if( !filter->GetPDFsAreSparse() )
+    {
+    std::cout << "Expected sparse PDFs for " << numFeatures
+      << " features." << std::endl;
+    return EXIT_FAILURE;
+    }
+  filter->ClassifyImages();
+
+  const unsigned int maxNumErrors = 64 * 64 / 20;
+  unsigned int numErrors = CountMisclassifiedPixels( filter->GetLabelMap() );
+  std::cout << "Misclassified pixels = " << numErrors << std::endl;
+  if( numErrors > maxNumErrors )
+    {
+    std::cout << "Too many misclassified pixels." << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  itk::tube::PDFSegmenterParzenIO< ImageType, ImageType > PDFIO( filter );
+  if( !PDFIO.Write( argv[1] ) )
+    {
+    std::cout << "Error in writing PDF file." << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  FilterType::Pointer filter2 = FilterType::New();
+  filter2->SetFeatureVectorGenerator( fvGen );
+
+  itk::tube::PDFSegmenterParzenIO< ImageType, ImageType > PDFIO2( filter2 );
+  try
+    {
+    if( !PDFIO2.Read( argv[1] ) )
+      {
+      std::cout << "Error in reading PDF file." << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+  catch( ... )
+    {
+    std::cout << "Exception caught during pdf read." << std::endl;
+    return EXIT_FAILURE;
+    }
+  if( !filter2->GetPDFsAreSparse() )
+    {
+    std::cout << "Read PDFs are not sparse." << std::endl;
+    return EXIT_FAILURE;
+    }
+  filter2->ClassifyImages();
+
+  // The bins are stored in a different order, so the probabilities only
+  //   agree up to the order of the summation
+  for( unsigned int c = 0; c < 2; ++c )
+    {
+    itk::ImageRegionConstIterator< FilterType::ProbabilityImageType > it1(
+      filter->GetClassProbabilityImage( c ),
+      filter->GetClassProbabilityImage( c )->GetLargestPossibleRegion() );
+    itk::ImageRegionConstIterator< FilterType::ProbabilityImageType > it2(
+      filter2->GetClassProbabilityImage( c ),
+      filter2->GetClassProbabilityImage( c )->GetLargestPossibleRegion() );
+    while( !it1.IsAtEnd() )
+      {
+      if( vnl_math_abs( it1.Get() - it2.Get() )
+        > 1e-5 * vnl_math_abs( it1.Get() ) + 1e-12 )
+        {
+        std::cout << "Class " << c << " probabilities differ after IO: "
+          << it1.Get() << " != " << it2.Get() << std::endl;
+        return EXIT_FAILURE;
+        }
+      ++it1;
+      ++it2;
+      }
+    }
+
+  // Without a training label map every pixel is classified by the PDFs
+  numErrors = CountMisclassifiedPixels( filter2->GetLabelMap() );
+  std::cout << "Misclassified pixels after IO = " << numErrors << std::endl;
+  if( numErrors > maxNumErrors )
+    {
+    std::cout << "Too many misclassified pixels after IO." << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -35,6 +35,7 @@ void RegisterTests( void )
   REGISTER_TEST( itktubeMetaRidgeSeedTest );
   REGISTER_TEST( itktubeMetaTubeExtractorTest );
   REGISTER_TEST( itktubePDFSegmenterParzenIOTest );
+  REGISTER_TEST( itktubePDFSegmenterParzenSparseIOTest );
 #ifdef TubeTK_USE_LIBSVM
   REGISTER_TEST( itktubeRidgeSeedFilterIOTest );
   REGISTER_TEST( itktubePDFSegmenterSVMIOTest );
@@ -84,6 +84,14 @@ public:
 
 protected:
 
+  /** Sparse class PDFs are stored as a MetaIO header followed by the
+   *   occupied bins (unsigned short) and their counts (float) */
+  bool ReadSparseClassPDF( const std::string & _fileName,
+    unsigned int _classNum );
+
+  bool WriteSparseClassPDF( const std::string & _fileName,
+    unsigned int _classNum ) const;
+
   typename PDFSegmenterType::Pointer  m_PDFSegmenter;
 
 }; // End class PDFSegmenterParzenIO
@@ -277,6 +277,10 @@ Read( const char * _headerName )
   MET_InitReadField( mF, "ForceClassification", MET_STRING, true );
   metaFields.push_back( mF );
 
+  mF = new MET_FieldRecordType;
+  MET_InitReadField( mF, "SparsePDFs", MET_STRING, false );
+  metaFields.push_back( mF );
+
   mF = new MET_FieldRecordType;
   MET_InitReadField( mF, "ObjectPDFFile", MET_STRING, true );
   metaFields.push_back( mF );
@@ -433,6 +437,14 @@ Read( const char * _headerName )
     m_PDFSegmenter->SetForceClassification( false );
     }
 
+  bool sparsePDFs = false;
+  mF = MET_GetFieldRecord( "SparsePDFs", &metaFields );
+  if( mF->defined && ( ((char *)( mF->value))[0] == 'T'
+    || ((char *)( mF->value))[0] == 't' ) )
+    {
+    sparsePDFs = true;
+    }
+
   mF = MET_GetFieldRecord( "ObjectPDFFile", &metaFields );
   std::string str = (char *)(mF->value);
   std::vector< std::string > fileName;
@@ -459,6 +471,21 @@ Read( const char * _headerName )
     MET_GetFilePath( _headerName, filePath );
     std::string fullFileName = filePath + fileName[i];
 
+    if( sparsePDFs )
+      {
+      if( !this->ReadSparseClassPDF( fullFileName, i ) )
+        {
+        m_PDFSegmenter = NULL;
+        for( unsigned int f=0; f<metaFields.size(); ++f )
+          {
+          delete metaFields[f];
+          }
+        metaFields.clear();
+        return false;
+        }
+      continue;
+      }
+
     MetaClassPDF pdfClassReader( fullFileName.c_str() );
 
     typename pdfImageType::Pointer img = pdfImageType::New();
@@ -550,6 +577,8 @@ Write( const char * _headerName )
     return false;
     }
 
+  bool sparsePDFs = m_PDFSegmenter->GetPDFsAreSparse();
+
   std::vector< MET_FieldRecordType * > metaFields;
 
   unsigned int numFeatures = m_PDFSegmenter->GetNumberOfFeatures();
@@ -680,6 +709,19 @@ Write( const char * _headerName )
     strlen(tmpC), tmpC );
   metaFields.push_back( mF );
 
+  if( sparsePDFs )
+    {
+    strcpy( tmpC, "True" );
+    }
+  else
+    {
+    strcpy( tmpC, "False" );
+    }
+  mF = new MET_FieldRecordType;
+  MET_InitWriteField< const char >( mF, "SparsePDFs", MET_STRING,
+    strlen(tmpC), tmpC );
+  metaFields.push_back( mF );
+
   char filePath[255];
   MET_GetFilePath( _headerName, filePath );
   int skip = strlen( filePath );
@@ -693,7 +735,8 @@ Write( const char * _headerName )
   for( unsigned int i = 0; i < nObjects; ++i )
     {
     char objectFileName[4096];
-    sprintf( objectFileName, "%s.%02d.mha", shortFileName, i );
+    sprintf( objectFileName, "%s.%02d.%s", shortFileName, i,
+      sparsePDFs ? "spd" : "mha" );
     tmpString = tmpString + objectFileName;
     if( i < nObjects-1 )
       {
@@ -728,6 +771,22 @@ Write( const char * _headerName )
 
   for( unsigned int i = 0; i < nObjects; ++i )
     {
+    if( sparsePDFs )
+      {
+      char objectFileName[4096];
+      sprintf( objectFileName, "%s.%02d.spd", fullFileName.c_str(), i );
+      if( !this->WriteSparseClassPDF( objectFileName, i ) )
+        {
+        for( unsigned int f=0; f<metaFields.size(); ++f )
+          {
+          delete metaFields[f];
+          }
+        metaFields.clear();
+        return false;
+        }
+      continue;
+      }
+
     MetaClassPDF pdfClassWriter( m_PDFSegmenter->GetNumberOfFeatures(),
       m_PDFSegmenter->GetNumberOfBinsPerFeature(),
       m_PDFSegmenter->GetBinMin(),
@@ -770,6 +829,167 @@ Write( const char * _headerName )
   return true;
 }
 
+template< class TImage, class TLabelMap >
+bool PDFSegmenterParzenIO< TImage, TLabelMap >::
+ReadSparseClassPDF( const std::string & _fileName, unsigned int _classNum )
+{
+  std::vector< MET_FieldRecordType * > metaFields;
+
+  MET_FieldRecordType * mF;
+
+  mF = new MET_FieldRecordType;
+  MET_InitReadField( mF, "NFeatures", MET_INT, true );
+  metaFields.push_back( mF );
+
+  mF = new MET_FieldRecordType;
+  MET_InitReadField( mF, "NOccupiedBins", MET_INT, true );
+  metaFields.push_back( mF );
+
+  mF = new MET_FieldRecordType;
+  MET_InitReadField( mF, "BinaryDataByteOrderMSB", MET_STRING, true );
+  metaFields.push_back( mF );
+
+  mF = new MET_FieldRecordType;
+  MET_InitReadField( mF, "ElementDataFile", MET_STRING, true );
+  mF->terminateRead = true;
+  metaFields.push_back( mF );
+
+  METAIO_STREAM::ifstream readStream;
+  readStream.open( _fileName.c_str(), METAIO_STREAM::ios::binary |
+    METAIO_STREAM::ios::in );
+
+  bool success = readStream.rdbuf()->is_open()
+    && MET_Read( readStream, &metaFields );
+
+  unsigned int numFeatures = m_PDFSegmenter->GetNumberOfFeatures();
+  int numBins = 0;
+  if( success )
+    {
+    mF = MET_GetFieldRecord( "NFeatures", &metaFields );
+    success = ( static_cast< unsigned int >( mF->value[0] )
+      == numFeatures );
+
+    mF = MET_GetFieldRecord( "NOccupiedBins", &metaFields );
+    numBins = static_cast< int >( mF->value[0] );
+
+    mF = MET_GetFieldRecord( "BinaryDataByteOrderMSB", &metaFields );
+    bool msb = ( ((char *)( mF->value))[0] == 'T'
+      || ((char *)( mF->value))[0] == 't' );
+
+    mF = MET_GetFieldRecord( "ElementDataFile", &metaFields );
+    success = success && numBins >= 0 && msb == MET_SystemByteOrderMSB()
+      && strcmp( (char *)( mF->value ), "LOCAL" ) == 0;
+    }
+
+  for( unsigned int i=0; i<metaFields.size(); ++i )
+    {
+    delete metaFields[i];
+    }
+  metaFields.clear();
+
+  if( !success )
+    {
+    std::cerr << "PDFSegmenterParzenIO: Read: cannot read sparse PDF "
+      << _fileName << std::endl;
+    return false;
+    }
+
+  typename PDFSegmenterType::SparseBinListType bins( numBins * numFeatures );
+  typename PDFSegmenterType::SparseCountListType counts( numBins );
+  if( numBins > 0 )
+    {
+    readStream.read( reinterpret_cast< char * >( &( bins[0] ) ),
+      bins.size() * sizeof( bins[0] ) );
+    readStream.read( reinterpret_cast< char * >( &( counts[0] ) ),
+      counts.size() * sizeof( counts[0] ) );
+    if( readStream.fail() )
+      {
+      std::cerr << "PDFSegmenterParzenIO: Read: sparse PDF "
+        << _fileName << " is truncated" << std::endl;
+      return false;
+      }
+    }
+  readStream.close();
+
+  m_PDFSegmenter->SetSparseClassPDF( _classNum, bins, counts );
+
+  return true;
+}
+
+template< class TImage, class TLabelMap >
+bool PDFSegmenterParzenIO< TImage, TLabelMap >::
+WriteSparseClassPDF( const std::string & _fileName,
+  unsigned int _classNum ) const
+{
+  typename PDFSegmenterType::SparseBinListType bins;
+  typename PDFSegmenterType::SparseCountListType counts;
+  if( !m_PDFSegmenter->GetSparseClassPDF( _classNum, bins, counts ) )
+    {
+    return false;
+    }
+
+  std::vector< MET_FieldRecordType * > metaFields;
+
+  MET_FieldRecordType * mF = new MET_FieldRecordType;
+  MET_InitWriteField( mF, "NFeatures", MET_INT,
+    m_PDFSegmenter->GetNumberOfFeatures() );
+  metaFields.push_back( mF );
+
+  mF = new MET_FieldRecordType;
+  MET_InitWriteField( mF, "NOccupiedBins", MET_INT, counts.size() );
+  metaFields.push_back( mF );
+
+  char tmpC[4096];
+  if( MET_SystemByteOrderMSB() )
+    {
+    strcpy( tmpC, "True" );
+    }
+  else
+    {
+    strcpy( tmpC, "False" );
+    }
+  mF = new MET_FieldRecordType;
+  MET_InitWriteField< const char >( mF, "BinaryDataByteOrderMSB",
+    MET_STRING, strlen(tmpC), tmpC );
+  metaFields.push_back( mF );
+
+  strcpy( tmpC, "LOCAL" );
+  mF = new MET_FieldRecordType;
+  MET_InitWriteField< const char >( mF, "ElementDataFile", MET_STRING,
+    strlen(tmpC), tmpC );
+  metaFields.push_back( mF );
+
+  METAIO_STREAM::ofstream writeStream;
+  writeStream.open( _fileName.c_str(), METAIO_STREAM::ios::binary |
+    METAIO_STREAM::ios::out );
+
+  bool success = MET_Write( writeStream, &metaFields );
+
+  for( unsigned int i=0; i<metaFields.size(); ++i )
+    {
+    delete metaFields[i];
+    }
+  metaFields.clear();
+
+  if( success && !counts.empty() )
+    {
+    writeStream.write( reinterpret_cast< const char * >( &( bins[0] ) ),
+      bins.size() * sizeof( bins[0] ) );
+    writeStream.write( reinterpret_cast< const char * >( &( counts[0] ) ),
+      counts.size() * sizeof( counts[0] ) );
+    success = !writeStream.fail();
+    }
+  writeStream.close();
+
+  if( !success )
+    {
+    METAIO_STREAM::cerr << "PDFSegmenterParzenIO: Write: cannot write "
+      << "sparse PDF " << _fileName << METAIO_STREAM::endl;
+    }
+
+  return success;
+}
+
 } // End namespace tube
 
 } // End namespace itk
@@ -23,6 +23,13 @@ limitations under the License.
 
 #include "itktubeNJetFeatureVectorGenerator.h"
 
+#include <itkImageRegionConstIteratorWithIndex.h>
+
+#include <vnl/vnl_math.h>
+
+#include <algorithm>
+#include <cmath>
+
 int itktubeNJetFeatureVectorGeneratorTest( int argc, char * argv[] )
 {
   if( argc != 5 )
@@ -121,6 +128,183 @@ int itktubeNJetFeatureVectorGeneratorTest( int argc, char * argv[] )
     return EXIT_FAILURE;
     }
 
+  // The batch API must reproduce the per-voxel feature vectors
+  filter->SetNumberOfThreads( 3 );
+  const unsigned int numFeatures = filter->GetNumberOfFeatures();
+  ImageType::RegionType region = inputImage->GetLargestPossibleRegion();
+  ImageType::IndexType regionIndex = region.GetIndex();
+  ImageType::SizeType regionSize = region.GetSize();
+  for( unsigned int d = 0; d < Dimension; ++d )
+    {
+    regionIndex[d] += regionSize[d] / 2 - 4;
+    regionSize[d] = 9;
+    }
+  region.SetIndex( regionIndex );
+  region.SetSize( regionSize );
+  std::vector< FilterType::FeatureValueType > featureBuffer(
+    region.GetNumberOfPixels() * numFeatures );
+  filter->GetFeatureVectors( region, &( featureBuffer[0] ) );
+
+  itk::ImageRegionConstIteratorWithIndex< ImageType > iter( inputImage,
+    region );
+  unsigned int pixelCount = 0;
+  while( !iter.IsAtEnd() )
+    {
+    FilterType::FeatureVectorType fv = filter->GetFeatureVector(
+      iter.GetIndex() );
+    for( unsigned int f = 0; f < numFeatures; ++f )
+      {
+      const double batchValue = featureBuffer[ pixelCount * numFeatures
+        + f ];
+      if( std::fabs( batchValue - fv[f] ) > 1e-4
+        || std::fabs( batchValue - filter->GetFeatureVectorValue(
+          iter.GetIndex(), f ) ) > 1e-4 )
+        {
+        std::cout << "Batch feature " << f << " at " << iter.GetIndex()
+          << " = " << batchValue << " but per-voxel feature = " << fv[f]
+          << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    ++pixelCount;
+    ++iter;
+    }
+
+  // The dense recursive-Gaussian stack must agree with the pointwise jets
+  //   away from the image boundary, where the sampled kernels of the
+  //   pointwise jets are not truncated.
+  FilterType::Pointer denseFilter = FilterType::New();
+  denseFilter->SetInput( inputImage );
+  denseFilter->SetZeroScales( scales );
+  denseFilter->SetFirstScales( scales );
+  denseFilter->SetSecondScales( scales2 );
+  denseFilter->SetRidgeScales( scales2 );
+  denseFilter->SetUseDenseFeatures( true );
+  denseFilter->SetNumberOfThreads( 3 );
+  if( denseFilter->GetFeatureVectorImage()->GetNumberOfComponentsPerPixel()
+    != numFeatures )
+    {
+    std::cout << "Dense feature image has the wrong number of components"
+      << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  const double extent = FilterType::NJetFunctionType::New()->GetExtent();
+  const double maxScale = *std::max_element( scales.begin(),
+    scales.end() );
+  ImageType::RegionType interior = inputImage->GetLargestPossibleRegion();
+  ImageType::IndexType interiorIndex = interior.GetIndex();
+  ImageType::SizeType interiorSize = interior.GetSize();
+  for( unsigned int d = 0; d < Dimension; ++d )
+    {
+    const long margin = static_cast< long >( std::ceil( maxScale * extent
+      / inputImage->GetSpacing()[d] ) ) + 1;
+    if( static_cast< long >( interiorSize[d] ) <= 2 * margin )
+      {
+      std::cout << "Input image too small for an interior region"
+        << std::endl;
+      return EXIT_FAILURE;
+      }
+    // At most 41 voxels wide, centered
+    const long width = std::min( 41L,
+      static_cast< long >( interiorSize[d] ) - 2 * margin );
+    interiorIndex[d] += ( interiorSize[d] - width ) / 2;
+    interiorSize[d] = width;
+    }
+  interior.SetIndex( interiorIndex );
+  interior.SetSize( interiorSize );
+  const unsigned int numInteriorPixels = interior.GetNumberOfPixels();
+
+  std::vector< FilterType::FeatureValueType > pointBuffer(
+    numInteriorPixels * numFeatures );
+  filter->GetFeatureVectors( interior, &( pointBuffer[0] ) );
+  std::vector< FilterType::FeatureValueType > denseBuffer(
+    numInteriorPixels * numFeatures );
+  denseFilter->GetFeatureVectors( interior, &( denseBuffer[0] ) );
+
+  // Jet features are linear in the image and must match closely
+  const unsigned int numJetFeatures = numFeatures - 4 * scales2.size();
+  for( unsigned int f = 0; f < numJetFeatures; ++f )
+    {
+    double range = 0;
+    double maxError = 0;
+    for( unsigned int p = 0; p < numInteriorPixels; ++p )
+      {
+      const double pointValue = pointBuffer[ p * numFeatures + f ];
+      const double denseValue = denseBuffer[ p * numFeatures + f ];
+      range = std::max( range, std::fabs( pointValue ) );
+      maxError = std::max( maxError, std::fabs( pointValue - denseValue ) );
+      }
+    if( maxError > 0.02 * range + 1e-4 )
+      {
+      std::cout << "Dense feature " << f << " differs from pointwise "
+        << "feature by " << maxError << " (range " << range << ")"
+        << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // Ridge features are nonlinear in the jet, so small jet differences can
+  //   be amplified; they must be finite and follow the pointwise values.
+  for( unsigned int f = numJetFeatures; f < numFeatures; ++f )
+    {
+    double pointMean = 0;
+    double denseMean = 0;
+    for( unsigned int p = 0; p < numInteriorPixels; ++p )
+      {
+      const double pointValue = pointBuffer[ p * numFeatures + f ];
+      const double denseValue = denseBuffer[ p * numFeatures + f ];
+      if( !vnl_math_isfinite( denseValue ) )
+        {
+        std::cout << "Dense ridge feature " << f << " is not finite"
+          << std::endl;
+        return EXIT_FAILURE;
+        }
+      pointMean += pointValue;
+      denseMean += denseValue;
+      }
+    pointMean /= numInteriorPixels;
+    denseMean /= numInteriorPixels;
+    double covariance = 0;
+    double pointVariance = 0;
+    double denseVariance = 0;
+    for( unsigned int p = 0; p < numInteriorPixels; ++p )
+      {
+      const double pointValue = pointBuffer[ p * numFeatures + f ]
+        - pointMean;
+      const double denseValue = denseBuffer[ p * numFeatures + f ]
+        - denseMean;
+      covariance += pointValue * denseValue;
+      pointVariance += pointValue * pointValue;
+      denseVariance += denseValue * denseValue;
+      }
+    if( pointVariance <= 0 || denseVariance <= 0
+      || covariance / std::sqrt( pointVariance * denseVariance ) < 0.9 )
+      {
+      std::cout << "Dense ridge feature " << f << " does not follow the "
+        << "pointwise feature (covariance " << covariance
+        << ", variances " << pointVariance << " and " << denseVariance
+        << ")" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // Changing the pixels of the input must update the dense features
+  const FilterType::FeatureVectorImageType * denseImage =
+    denseFilter->GetFeatureVectorImage();
+  const FilterType::FeatureValueType before =
+    denseImage->GetPixel( interiorIndex )[0];
+  inputImage->SetPixel( interiorIndex,
+    inputImage->GetPixel( interiorIndex ) + 1000 );
+  inputImage->Modified();
+  denseImage = denseFilter->GetFeatureVectorImage();
+  if( denseImage->GetPixel( interiorIndex )[0] == before )
+    {
+    std::cout << "Dense features were not updated after the input changed"
+      << std::endl;
+    return EXIT_FAILURE;
+    }
+
   // All objects should be automatically destroyed at this point
   return EXIT_SUCCESS;
 }
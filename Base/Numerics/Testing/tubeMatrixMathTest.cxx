@@ -25,7 +25,7 @@ limitations under the License.
 
 #include <itkMersenneTwisterRandomVariateGenerator.h>
 
-template< int VDimension >
+template< unsigned int VDimension >
 int Test( void )
 {
   double epsilon = 0.00001;
@@ -115,6 +115,32 @@ int Test( void )
         returnStatus = EXIT_FAILURE;
         }
       }
+
+    vnl_matrix_fixed<float, VDimension, VDimension> m2( m1.data_block() );
+    vnl_matrix_fixed<float, VDimension, VDimension> eVectsFixed;
+    vnl_vector_fixed<float, VDimension> eValsFixed;
+    tube::ComputeSymmetricEigen( m2, eVectsFixed, eValsFixed, true );
+    for( unsigned int d=0; d<VDimension; d++ )
+      {
+      vnl_vector_fixed<float, VDimension> v5 = m2
+        * eVectsFixed.get_column(d);
+      float err = 0;
+      for( unsigned int i=0; i<VDimension; i++ )
+        {
+        err += vnl_math_abs( v5[i] - eValsFixed[d] * eVectsFixed(i, d) );
+        }
+      if( err > 10 * epsilon
+        || vnl_math_abs( eValsFixed[d] - eVals[d] ) > 10 * epsilon )
+        {
+        std::cout << count << " : ";
+        std::cout << "FAILURE: ComputeSymmetricEigen : "
+          << " M2 * v = " << v5
+          << " != " << eValsFixed[d] << " * v"
+          << " (ComputeEigen = " << eVals[d] << ")"
+          << std::endl;
+        returnStatus = EXIT_FAILURE;
+        }
+      }
     }
 
   return returnStatus;
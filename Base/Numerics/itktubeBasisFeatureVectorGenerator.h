@@ -62,10 +62,13 @@ public:
     TImage::ImageDimension );
 
   typedef typename Superclass::IndexType         IndexType;
+  typedef typename Superclass::IndexListType     IndexListType;
+  typedef typename Superclass::RegionType        RegionType;
 
   typedef typename Superclass::FeatureValueType  FeatureValueType;
   typedef typename Superclass::FeatureVectorType FeatureVectorType;
   typedef typename Superclass::FeatureImageType  FeatureImageType;
+  typedef typename Superclass::FeatureImageListType FeatureImageListType;
 
   typedef FeatureVectorGenerator< TImage >       FeatureVectorGeneratorType;
 
@@ -125,6 +128,8 @@ public:
   virtual typename FeatureImageType::Pointer GetFeatureImage(
                                        unsigned int fNum ) const;
 
+  virtual FeatureImageListType GetFeatureImages( void ) const;
+
   void   SetInputWhitenMeans( const ValueListType & means );
   const  ValueListType & GetInputWhitenMeans( void ) const;
   void   SetInputWhitenStdDevs( const ValueListType & stdDevs );
@@ -144,6 +149,15 @@ public:
   virtual FeatureValueType  GetFeatureVectorValue( const IndexType & indx,
                               unsigned int fNum ) const;
 
+  virtual void PrepareThreadedFeatures( unsigned int numberOfThreads ) const;
+
+  virtual void ThreadedGetFeatureVector( const IndexType & indx,
+    FeatureValueType * featureVector, ThreadIdType threadId ) const;
+
+  virtual FeatureValueType ThreadedGetFeatureVectorValue(
+    const IndexType & indx, unsigned int fNum,
+    ThreadIdType threadId ) const;
+
 protected:
 
   BasisFeatureVectorGenerator( void );
@@ -151,12 +165,22 @@ protected:
 
   void PrintSelf( std::ostream & os, Indent indent ) const;
 
+  /** Compute one feature image (or every feature image when
+   *   featureNum < 0), evaluating only the voxels in a labeled object;
+   *   the other voxels are zero */
+  void ComputeLabeledFeatureImages( int featureNum,
+    FeatureImageListType & featureImageList ) const;
+
 private:
 
   // Purposely not implemented
   BasisFeatureVectorGenerator( const Self & );
   void operator = ( const Self & );      // Purposely not implemented
 
+  /** Project and whiten an input feature vector onto one basis vector */
+  FeatureValueType ProjectFeatureVector( const FeatureValueType * vInput,
+    unsigned int featureNum ) const;
+
   //  Data
   typename FeatureVectorGeneratorType::Pointer m_InputFeatureVectorGenerator;
 
@@ -174,6 +198,10 @@ private:
 
   MatrixType                      m_BasisMatrix;
   VectorType                      m_BasisValues;
+
+  /** Per-thread buffers holding the input feature vector */
+  mutable std::vector< std::vector< FeatureValueType > >
+                                  m_ThreadInputFeatures;
 }; // End class BasisFeatureVectorGenerator
 
 } // End namespace tube
@@ -30,8 +30,9 @@ limitations under the License.
 #include <itkImage.h>
 #include <itkImageFileReader.h>
 #include <itkImageFileWriter.h>
+#include <itkImageRegionConstIterator.h>
 #include <itkImageRegionConstIteratorWithIndex.h>
-#include <itkImageRegionIteratorWithIndex.h>
+#include <itkImageRegionIterator.h>
 
 #include <iostream>
 #include <limits>
@@ -311,77 +312,107 @@ BasisFeatureVectorGenerator< TImage, TLabelMap >
 }
 
 template< class TImage, class TLabelMap >
-typename BasisFeatureVectorGenerator< TImage, TLabelMap >::FeatureImageType::Pointer
+void
 BasisFeatureVectorGenerator< TImage, TLabelMap >
-::GetFeatureImage( unsigned int featureNum ) const
+::ComputeLabeledFeatureImages( int featureNum,
+  FeatureImageListType & featureImageList ) const
 {
-  if( featureNum < m_InputFeatureVectorGenerator->GetNumberOfFeatures() )
-    {
-    typedef itk::ImageRegionIteratorWithIndex< FeatureImageType >
-      ImageIteratorType;
-
-    typename FeatureImageType::RegionType region;
-    region = this->m_InputImageList[0]->GetLargestPossibleRegion();
-
-    typename FeatureImageType::Pointer featureImage =
-      FeatureImageType::New();
-    featureImage->SetRegions( region );
-    featureImage->CopyInformation( this->m_InputImageList[0] );
-    featureImage->Allocate();
+  const unsigned int numClasses = this->GetNumberOfObjectIds();
+  const unsigned int numValues = ( featureNum < 0 )
+    ? this->GetNumberOfFeatures() : 1;
+  const RegionType region = m_LabelMap->GetLargestPossibleRegion();
 
-    ImageIteratorType itBasisIm( featureImage,
-      featureImage->GetLargestPossibleRegion() );
+  featureImageList.resize( numValues );
+  for( unsigned int f = 0; f < numValues; ++f )
+    {
+    featureImageList[f] = FeatureImageType::New();
+    featureImageList[f]->SetRegions( region );
+    featureImageList[f]->CopyInformation( this->m_InputImageList[ 0 ] );
+    featureImageList[f]->Allocate();
+    featureImageList[f]->FillBuffer( 0 );
+    }
+  if( numValues == 0 )
+    {
+    return;
+    }
 
-    if( m_LabelMap.IsNotNull() )
+  // The labeled voxels of each slice are gathered and their features
+  //   computed in one batch
+  typedef itk::ImageRegionConstIteratorWithIndex< LabelMapType >
+    ConstLabelMapIteratorType;
+  IndexListType indices;
+  std::vector< OffsetValueType > offsets;
+  std::vector< FeatureValueType > features;
+  bool found = false;
+  ObjectIdType previousMaskValue = 0;
+  bool hasPreviousMaskValue = false;
+  const unsigned int numSlices = region.GetSize()[ ImageDimension - 1 ];
+  for( unsigned int slice = 0; slice < numSlices; ++slice )
+    {
+    indices.clear();
+    offsets.clear();
+    ConstLabelMapIteratorType itInMask( m_LabelMap,
+      this->GetSliceRegion( region, slice ) );
+    while( !itInMask.IsAtEnd() )
       {
-      const unsigned int numClasses = this->GetNumberOfObjectIds();
-      typedef itk::ImageRegionConstIteratorWithIndex< LabelMapType >
-        ConstLabelMapIteratorType;
-      ConstLabelMapIteratorType itInMask( m_LabelMap,
-        m_LabelMap->GetLargestPossibleRegion() );
-      bool found = false;
-      ObjectIdType previousMaskValue =
-        static_cast<ObjectIdType>( itInMask.Get() ) + 1;
-      while( !itBasisIm.IsAtEnd() )
+      ObjectIdType maskVal = static_cast<ObjectIdType>( itInMask.Get() );
+      if( !hasPreviousMaskValue || maskVal != previousMaskValue )
         {
-        ObjectIdType maskVal = static_cast<ObjectIdType>( itInMask.Get() );
-        if( maskVal != previousMaskValue )
+        hasPreviousMaskValue = true;
+        previousMaskValue = maskVal;
+        found = false;
+        for( unsigned int c = 0; c < numClasses; c++ )
           {
-          found = false;
-          previousMaskValue = maskVal;
-          for( unsigned int c = 0; c < numClasses; c++ )
+          if( maskVal == m_ObjectIdList[c] )
             {
-            if( maskVal == m_ObjectIdList[c] )
-              {
-              found = true;
-              break;
-              }
+            found = true;
+            break;
             }
           }
-        if( !found )
-          {
-          itBasisIm.Set( 0 );
-          }
-        else
-          {
-          IndexType indx = itBasisIm.GetIndex();
-          itBasisIm.Set( this->GetFeatureVectorValue( indx, featureNum ) );
-          }
-        ++itBasisIm;
-        ++itInMask;
         }
+      if( found )
+        {
+        indices.push_back( itInMask.GetIndex() );
+        offsets.push_back( m_LabelMap->ComputeOffset(
+          itInMask.GetIndex() ) );
+        }
+      ++itInMask;
       }
-    else
+    if( indices.empty() )
       {
-      while( !itBasisIm.IsAtEnd() )
+      continue;
+      }
+
+    features.resize( indices.size() * numValues );
+    this->ExecuteFeatureThreads( region, &indices, &( features[0] ),
+      featureNum );
+    for( unsigned int f = 0; f < numValues; ++f )
+      {
+      FeatureValueType * buffer = featureImageList[f]->GetBufferPointer();
+      for( SizeValueType p = 0; p < indices.size(); ++p )
         {
-        IndexType indx = itBasisIm.GetIndex();
-        itBasisIm.Set( this->GetFeatureVectorValue( indx, featureNum ) );
-        ++itBasisIm;
+        buffer[ offsets[p] ] = features[ p * numValues + f ];
         }
       }
+    }
+}
+
+template< class TImage, class TLabelMap >
+typename BasisFeatureVectorGenerator< TImage, TLabelMap >::FeatureImageType::Pointer
+BasisFeatureVectorGenerator< TImage, TLabelMap >
+::GetFeatureImage( unsigned int featureNum ) const
+{
+  if( featureNum < m_InputFeatureVectorGenerator->GetNumberOfFeatures() )
+    {
+    if( m_LabelMap.IsNull() )
+      {
+      return Superclass::GetFeatureImage( featureNum );
+      }
 
-    return featureImage;
+    FeatureImageListType featureImageList;
+    this->ComputeLabeledFeatureImages( featureNum, featureImageList );
+
+    return featureImageList[0];
     }
   else
     {
@@ -389,6 +420,22 @@ BasisFeatureVectorGenerator< TImage, TLabelMap >
     }
 }
 
+template< class TImage, class TLabelMap >
+typename BasisFeatureVectorGenerator< TImage, TLabelMap >::FeatureImageListType
+BasisFeatureVectorGenerator< TImage, TLabelMap >
+::GetFeatureImages( void ) const
+{
+  if( m_LabelMap.IsNull() )
+    {
+    return Superclass::GetFeatureImages();
+    }
+
+  FeatureImageListType featureImageList;
+  this->ComputeLabeledFeatureImages( -1, featureImageList );
+
+  return featureImageList;
+}
+
 template< class TImage, class TLabelMap >
 void
 BasisFeatureVectorGenerator< TImage, TLabelMap >
@@ -515,6 +562,9 @@ BasisFeatureVectorGenerator< TImage, TLabelMap >
 
   m_InputFeatureVectorGenerator->Update();
 
+  m_InputFeatureVectorGenerator->PrepareThreadedFeatures( 1 );
+  FeatureVectorType v( numInputFeatures );
+
   unsigned int valC = 0;
   bool found = false;
   itInMask.GoToBegin();
@@ -540,8 +590,8 @@ BasisFeatureVectorGenerator< TImage, TLabelMap >
     if( found )
       {
       IndexType indx = itInMask.GetIndex();
-      FeatureVectorType v = m_InputFeatureVectorGenerator->
-        GetFeatureVector( indx );
+      m_InputFeatureVectorGenerator->ThreadedGetFeatureVector( indx,
+        v.data_block(), 0 );
 
       // Using method from:
       // https://en.wikipedia.org/wiki/Algorithms_for_calculating_variance
@@ -772,63 +822,114 @@ typename BasisFeatureVectorGenerator< TImage, TLabelMap >::FeatureVectorType
 BasisFeatureVectorGenerator< TImage, TLabelMap >
 ::GetFeatureVector( const IndexType & indx ) const
 {
+  // The input generator evaluates a single voxel with its own state, so
+  //   the per-thread buffers are not used
+  const FeatureVectorType vInput =
+    m_InputFeatureVectorGenerator->GetFeatureVector( indx );
+
+  FeatureVectorType featureVector( this->GetNumberOfFeatures() );
+  for( unsigned int i = 0; i < featureVector.size(); ++i )
+    {
+    featureVector[i] = this->ProjectFeatureVector( vInput.data_block(),
+      i );
+    }
+
+  return featureVector;
+}
+
+template< class TImage, class TLabelMap >
+typename BasisFeatureVectorGenerator< TImage, TLabelMap >::FeatureValueType
+BasisFeatureVectorGenerator< TImage, TLabelMap >
+::GetFeatureVectorValue( const IndexType & indx,
+  unsigned int featureNum ) const
+{
+  if( featureNum < this->GetNumberOfFeatures() )
+    {
+    const FeatureVectorType vInput =
+      m_InputFeatureVectorGenerator->GetFeatureVector( indx );
+    return this->ProjectFeatureVector( vInput.data_block(), featureNum );
+    }
+  else
+    {
+    std::cerr << "Basis feature " << featureNum << " does not exist."
+      << std::endl;
+    FeatureValueType featureValue = 0;
+    return featureValue;
+    }
+}
+
+template< class TImage, class TLabelMap >
+void
+BasisFeatureVectorGenerator< TImage, TLabelMap >
+::PrepareThreadedFeatures( unsigned int numberOfThreads ) const
+{
+  m_InputFeatureVectorGenerator->PrepareThreadedFeatures( numberOfThreads );
+
   const unsigned int numInputFeatures =
     m_InputFeatureVectorGenerator->GetNumberOfFeatures();
+  if( m_ThreadInputFeatures.size() < numberOfThreads )
+    {
+    m_ThreadInputFeatures.resize( numberOfThreads );
+    }
+  for( unsigned int t = 0; t < numberOfThreads; ++t )
+    {
+    m_ThreadInputFeatures[t].resize( numInputFeatures );
+    }
+}
 
+template< class TImage, class TLabelMap >
+void
+BasisFeatureVectorGenerator< TImage, TLabelMap >
+::ThreadedGetFeatureVector( const IndexType & indx,
+  FeatureValueType * featureVector, ThreadIdType threadId ) const
+{
   const unsigned int numFeatures = this->GetNumberOfFeatures();
 
-  FeatureVectorType featureVector;
-  featureVector.set_size( numFeatures );
-
-  VectorType vBasis;
-  FeatureVectorType vInput;
+  FeatureValueType * vInput = &( m_ThreadInputFeatures[threadId][0] );
+  m_InputFeatureVectorGenerator->ThreadedGetFeatureVector( indx, vInput,
+    threadId );
 
   for( unsigned int i = 0; i < numFeatures; ++i )
     {
-    vBasis = this->GetBasisVector( i );
-    vInput = m_InputFeatureVectorGenerator->GetFeatureVector( indx );
-    featureVector[i] = 0;
-    for( unsigned int j = 0; j < numInputFeatures; j++ )
-      {
-      featureVector[i] += vBasis[j] * vInput[j];
-      }
-    if( this->GetWhitenStdDev( i ) > 0 )
-      {
-      featureVector[i] = ( featureVector[i] - this->GetWhitenMean( i ) )
-        / this->GetWhitenStdDev( i );
-      }
+    featureVector[i] = this->ProjectFeatureVector( vInput, i );
     }
-  return featureVector;
 }
 
 template< class TImage, class TLabelMap >
 typename BasisFeatureVectorGenerator< TImage, TLabelMap >::FeatureValueType
 BasisFeatureVectorGenerator< TImage, TLabelMap >
-::GetFeatureVectorValue( const IndexType & indx,
+::ProjectFeatureVector( const FeatureValueType * vInput,
   unsigned int featureNum ) const
 {
   const unsigned int numInputFeatures =
     m_InputFeatureVectorGenerator->GetNumberOfFeatures();
 
-  VectorType vBasis;
-  FeatureVectorType vInput;
+  double featureValue = 0;
+  for( unsigned int j = 0; j < numInputFeatures; j++ )
+    {
+    featureValue += m_BasisMatrix( j, featureNum ) * vInput[j];
+    }
+  if( this->GetWhitenStdDev( featureNum ) > 0 )
+    {
+    featureValue = ( featureValue - this->GetWhitenMean( featureNum ) )
+      / this->GetWhitenStdDev( featureNum );
+    }
+  return static_cast< FeatureValueType >( featureValue );
+}
 
+template< class TImage, class TLabelMap >
+typename BasisFeatureVectorGenerator< TImage, TLabelMap >::FeatureValueType
+BasisFeatureVectorGenerator< TImage, TLabelMap >
+::ThreadedGetFeatureVectorValue( const IndexType & indx,
+  unsigned int featureNum, ThreadIdType threadId ) const
+{
   if( featureNum < this->GetNumberOfFeatures() )
     {
-    vBasis = this->GetBasisVector( featureNum );
-    vInput = m_InputFeatureVectorGenerator->GetFeatureVector( indx );
+    FeatureValueType * vInput = &( m_ThreadInputFeatures[threadId][0] );
+    m_InputFeatureVectorGenerator->ThreadedGetFeatureVector( indx, vInput,
+      threadId );
 
-    FeatureValueType featureValue = 0;
-    for( unsigned int j = 0; j < numInputFeatures; j++ )
-      {
-      featureValue += vBasis[j] * vInput[j];
-      }
-    if( this->GetWhitenStdDev( featureNum ) > 0 )
-      {
-      featureValue = ( featureValue - this->GetWhitenMean( featureNum ) )
-        / this->GetWhitenStdDev( featureNum );
-      }
-    return featureValue;
+    return this->ProjectFeatureVector( vInput, featureNum );
     }
   else
     {
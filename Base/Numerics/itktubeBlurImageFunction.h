@@ -27,6 +27,10 @@ limitations under the License.
 #include <itkImageFunction.h>
 #include <itkIndex.h>
 
+#include <list>
+#include <map>
+#include <vector>
+
 namespace itk
 {
 
@@ -37,6 +41,9 @@ namespace tube
  * \brief Calculate the Gaussian blurred value at point
  *        given a scale and extent of the Gaussian.
  * This class is templated over the input image type.
+ *
+ * The Gaussian is stored as one contiguous array of 1D weights per
+ * dimension, and EvaluateAtIndex applies them separably along image rows.
  */
 template< class TInputImage >
 class BlurImageFunction
@@ -117,6 +124,34 @@ public:
    * Get the Spacing */
   itkGetMacro( UseRelativeSpacing, bool );
 
+  /**
+   * Cache the values returned by EvaluateAtIndex in tiles.  A tile is
+   * computed, using a separable Gaussian, the first time one of its
+   * indices is requested at a given scale and extent, and tiles are
+   * discarded least-recently-used first once the cache exceeds its
+   * memory budget.  Off by default.
+   *
+   * The cache is updated by the const Evaluate methods without any
+   * locking, so while it is on a function must not be evaluated by
+   * several threads at once.  Threaded callers should give each thread
+   * its own function, and so its own cache. */
+  void SetUseTileCache( bool useTileCache );
+  itkGetMacro( UseTileCache, bool );
+
+  /**
+   * Set/Get the number of indexes along each side of a cache tile */
+  void SetTileSize( unsigned int tileSize );
+  itkGetMacro( TileSize, unsigned int );
+
+  /**
+   * Set/Get the maximum number of bytes used by the tile cache */
+  itkSetMacro( TileCacheMemoryBudget, SizeValueType );
+  itkGetMacro( TileCacheMemoryBudget, SizeValueType );
+
+  /**
+   * Discard all cached tiles */
+  void ClearTileCache( void );
+
 protected:
 
   BlurImageFunction( void );
@@ -126,22 +161,23 @@ protected:
 
   void RecomputeKernel( void );
 
+  /** Return the value at an index inside the image from the tile cache */
+  double EvaluateAtIndexUsingTileCache( const IndexType & index ) const;
+
 private:
 
   BlurImageFunction( const Self& );
   void operator=( const Self& );
 
-  typedef std::list< double > KernelWeightsListType;
-
-  typedef std::list< typename InputImageType::IndexType > KernelXListType;
+  typedef std::vector< double > KernelWeightsType;
 
   bool                    m_UseRelativeSpacing;
   SpacingType             m_Spacing;
   SpacingType             m_OriginalSpacing;
   double                  m_Scale;
   double                  m_Extent;
-  KernelWeightsListType   m_KernelWeights;
-  KernelXListType         m_KernelX;
+  KernelWeightsType       m_KernelWeights[ImageDimension];
+  double                  m_KernelCornerWeight;
   IndexType               m_KernelMin;
   IndexType               m_KernelMax;
   SizeType                m_KernelSize;
@@ -150,6 +186,39 @@ private:
   IndexType               m_ImageIndexMin;
   IndexType               m_ImageIndexMax;
 
+  /** Tiles are identified by the scale and extent used to compute them and
+   *  by their position, in tiles, from the image's first index */
+  struct TileKeyType
+    {
+    double    Scale;
+    double    Extent;
+    IndexType TileIndex;
+
+    bool operator<( const TileKeyType & key ) const;
+    };
+
+  typedef std::vector< double >                         TileType;
+  typedef std::list< std::pair< TileKeyType, TileType > >
+                                                        TileListType;
+  typedef std::map< TileKeyType, typename TileListType::iterator >
+                                                        TileMapType;
+
+  /** Return a tile, computing it if it is not in the cache */
+  const TileType & GetTile( const IndexType & tileIndex ) const;
+
+  /** Blur the region of a tile using one 1D Gaussian pass per dimension */
+  void ComputeTile( const IndexType & tileIndex, TileType & tile ) const;
+
+  bool                    m_UseTileCache;
+  unsigned int            m_TileSize;
+  SizeValueType           m_TileCacheMemoryBudget;
+
+  /** Most recently used tiles are at the front of the list.  Not
+   *  thread-safe, see SetUseTileCache. */
+  mutable TileListType    m_TileList;
+  mutable TileMapType     m_TileMap;
+  mutable SizeValueType   m_TileCacheMemoryUsed;
+
 }; // End class BlurImageFunction
 
 } // End namespace tube
@@ -58,11 +58,19 @@ BlurImageFunction<TInputImage>
   m_KernelMin.Fill( 0 );
   m_KernelMax.Fill( 0 );
   m_KernelSize.Fill( 0 );
-  m_KernelX.clear();
-  m_KernelWeights.clear();
+  for( unsigned int i=0; i<ImageDimension; i++ )
+    {
+    m_KernelWeights[i].clear();
+    }
+  m_KernelCornerWeight = 0;
 
   m_ImageIndexMin.Fill( 0 );
   m_ImageIndexMax.Fill( 0 );
+
+  m_UseTileCache = false;
+  m_TileSize = 16;
+  m_TileCacheMemoryBudget = 256 * 1024 * 1024;
+  m_TileCacheMemoryUsed = 0;
 }
 
 /**
@@ -95,6 +103,7 @@ BlurImageFunction<TInputImage>
   /* Values by default */
   this->RecomputeKernel();
 
+  this->ClearTileCache();
 }
 
 
@@ -121,6 +130,51 @@ BlurImageFunction<TInputImage>
       }
     }
 
+  this->ClearTileCache();
+}
+
+/**
+ * Enable or disable the tile cache */
+template< class TInputImage >
+void
+BlurImageFunction<TInputImage>
+::SetUseTileCache( bool useTileCache )
+{
+  if( m_UseTileCache != useTileCache )
+    {
+    m_UseTileCache = useTileCache;
+    this->ClearTileCache();
+    }
+}
+
+/**
+ * Set the tile size of the cache */
+template< class TInputImage >
+void
+BlurImageFunction<TInputImage>
+::SetTileSize( unsigned int tileSize )
+{
+  if( tileSize < 1 )
+    {
+    tileSize = 1;
+    }
+  if( m_TileSize != tileSize )
+    {
+    m_TileSize = tileSize;
+    this->ClearTileCache();
+    }
+}
+
+/**
+ * Discard the cached tiles */
+template< class TInputImage >
+void
+BlurImageFunction<TInputImage>
+::ClearTileCache( void )
+{
+  m_TileList.clear();
+  m_TileMap.clear();
+  m_TileCacheMemoryUsed = 0;
 }
 
 /**
@@ -140,9 +194,13 @@ BlurImageFunction<TInputImage>
   os << indent << "Scale = " << m_Scale << std::endl;
   os << indent << "Extent = " << m_Extent << std::endl;
 
-  os << indent << "KernelWeights.size = " << m_KernelWeights.size()
+  for( unsigned int i=0; i<ImageDimension; i++ )
+    {
+    os << indent << "KernelWeights[" << i << "].size = "
+      << m_KernelWeights[i].size() << std::endl;
+    }
+  os << indent << "KernelCornerWeight = " << m_KernelCornerWeight
     << std::endl;
-  os << indent << "KernelX.size = " << m_KernelX.size() << std::endl;
   os << indent << "KernelMin = " << m_KernelMin << std::endl;
   os << indent << "KernelMax = " << m_KernelMax << std::endl;
   os << indent << "KernelSize = " << m_KernelSize << std::endl;
@@ -150,6 +208,15 @@ BlurImageFunction<TInputImage>
 
   os << indent << "ImageIndexMin = " << m_ImageIndexMin << std::endl;
   os << indent << "ImageIndexMax = " << m_ImageIndexMax << std::endl;
+
+  os << indent << "UseTileCache = " << m_UseTileCache << std::endl;
+  os << indent << "TileSize = " << m_TileSize << std::endl;
+  os << indent << "TileCacheMemoryBudget = " << m_TileCacheMemoryBudget
+    << std::endl;
+  os << indent << "TileCacheMemoryUsed = " << m_TileCacheMemoryUsed
+    << std::endl;
+  os << indent << "Number of cached tiles = " << m_TileList.size()
+    << std::endl;
 }
 
 
@@ -186,49 +253,22 @@ BlurImageFunction<TInputImage>
     std::cout << "  KernelSize = " << m_KernelSize << std::endl;
     }
 
-  m_KernelWeights.clear();
-  m_KernelX.clear();
-
-  IndexType index;
-  m_KernelTotal = 0;
-  if( ImageDimension == 3 )
-    {
-    for( index[2] = m_KernelMin[2]; index[2]<=m_KernelMax[2]; index[2]++ )
-      {
-      double distZ = index[2] * m_Spacing[2];
-      distZ = distZ * distZ;
-      for( index[1] = m_KernelMin[1]; index[1]<=m_KernelMax[1]; index[1]++ )
-        {
-        double distY = index[1] * m_Spacing[1];
-        distY = distY * distY + distZ;
-        for( index[0] = m_KernelMin[0]; index[0]<=m_KernelMax[0]; index[0]++ )
-          {
-          double dist = index[0] * m_Spacing[0];
-          dist = dist * dist + distY;
-          double w = std::exp( gfact*( dist ) );
-          m_KernelWeights.push_back( w );
-          m_KernelX.push_back( index );
-          m_KernelTotal += w;
-          }
-        }
-      }
-    }
-  else if( ImageDimension == 2 )
+  // The ND Gaussian is the product of one 1D Gaussian per dimension
+  m_KernelTotal = 1;
+  m_KernelCornerWeight = 1;
+  for( unsigned int i=0; i<ImageDimension; i++ )
     {
-    for( index[1] = m_KernelMin[1]; index[1]<=m_KernelMax[1]; index[1]++ )
+    m_KernelWeights[i].resize( m_KernelMax[i] - m_KernelMin[i] + 1 );
+    double total = 0;
+    for( int k = m_KernelMin[i]; k<=m_KernelMax[i]; k++ )
       {
-      double distY = index[1] * m_Spacing[1];
-      distY = distY * distY;
-      for( index[0] = m_KernelMin[0]; index[0]<=m_KernelMax[0]; index[0]++ )
-        {
-        double dist = index[0] * m_Spacing[0];
-        dist = dist * dist + distY;
-        double w = std::exp( gfact*( dist ) );
-        m_KernelWeights.push_back( w );
-        m_KernelX.push_back( index );
-        m_KernelTotal += w;
-        }
+      double dist = k * m_Spacing[i];
+      double w = std::exp( gfact*( dist * dist ) );
+      m_KernelWeights[i][ k - m_KernelMin[i] ] = w;
+      total += w;
       }
+    m_KernelTotal *= total;
+    m_KernelCornerWeight *= m_KernelWeights[i][0];
     }
 }
 
@@ -310,88 +350,132 @@ BlurImageFunction<TInputImage>
     return 0.0;
     }
 
-  double res = 0;
-  double wTotal;
-
-  IndexType kernelX;
+  if( m_UseTileCache )
+    {
+    bool inside = true;
+    for( unsigned int i=0; i<ImageDimension; i++ )
+      {
+      if( point[i]<m_ImageIndexMin[i] || point[i]>m_ImageIndexMax[i] )
+        {
+        inside = false;
+        break;
+        }
+      }
+    if( inside )
+      {
+      return this->EvaluateAtIndexUsingTileCache( point );
+      }
+    }
 
+  // Range of kernel offsets to apply along each dimension.  Points whose
+  //   kernel lies inside of the image skip all bounds tests.  At the
+  //   boundary, the range is clipped, and since the ND weights are
+  //   products of 1D weights, so is their normalization.
+  int kMin[ImageDimension];
+  int kMax[ImageDimension];
   bool boundary = false;
   for( unsigned int i=0; i<ImageDimension; i++ )
     {
+    kMin[i] = m_KernelMin[i];
+    kMax[i] = m_KernelMax[i];
     if( point[i]+m_KernelMin[i]<m_ImageIndexMin[i]
        || point[i]+m_KernelMax[i]>m_ImageIndexMax[i] )
       {
       boundary = true;
-      break;
       }
     }
 
-  if( !boundary )
-    {
-    itk::ImageRegionConstIterator< InputImageType > imIt( this->m_Image,
-      this->m_Image->GetLargestPossibleRegion() );
-    imIt.GoToBegin();
-    KernelWeightsListType::const_iterator it = m_KernelWeights.begin();
-    KernelWeightsListType::const_iterator itEnd = m_KernelWeights.end();
-    typename KernelXListType::const_iterator  itX = m_KernelX.begin();
-    int skipX = (*itX)[0];
-    while( it != itEnd )
-      {
-      if( (*itX)[0] == skipX )
-        {
-        for( unsigned int i=0; i<ImageDimension; i++ )
-          {
-          kernelX[i] = point[i] + ( *itX )[i];
-          }
-        imIt.SetIndex( kernelX );
-        }
-      res += ( imIt.Get() ) * ( *it );
-      ++imIt;
-      ++it;
-      ++itX;
-      ++kernelX[0];
-      }
-    wTotal = m_KernelTotal;
-    }
-  else
+  double wTotal = m_KernelTotal;
+  if( boundary )
     {
     if( this->GetDebug() )
       {
       std::cout << "  Boundary point" << std::endl;
       }
-    KernelWeightsListType::const_iterator it;
-    KernelWeightsListType::const_iterator itEnd;
-    typename KernelXListType::const_iterator  itX;
-    it = m_KernelWeights.begin();
-    itEnd = m_KernelWeights.end();
-    itX = m_KernelX.begin();
-    wTotal = 0;
-    double w;
-    while( it != itEnd )
+    wTotal = 1;
+    for( unsigned int i=0; i<ImageDimension; i++ )
       {
-      bool valid = true;
-      for( unsigned int i=0; i<ImageDimension; i++ )
+      kMin[i] = vnl_math_max( kMin[i],
+        ( int )( m_ImageIndexMin[i] - point[i] ) );
+      kMax[i] = vnl_math_min( kMax[i],
+        ( int )( m_ImageIndexMax[i] - point[i] ) );
+      if( kMin[i] > kMax[i] )
         {
-        kernelX[i] = point[i] + ( *itX )[i];
-        if( kernelX[i] < m_ImageIndexMin[i] ||
-            kernelX[i] > m_ImageIndexMax[i] )
-          {
-          valid = false;
-          break;
-          }
+        return 0;
         }
-      if( valid )
+      double total = 0;
+      for( int k=kMin[i]; k<=kMax[i]; k++ )
         {
-        w = *it;
-        res += this->m_Image->GetPixel( kernelX ) * w;
-        wTotal += w;
+        total += m_KernelWeights[i][ k - m_KernelMin[i] ];
         }
-      ++it;
-      ++itX;
+      wTotal *= total;
       }
     }
 
-  if( wTotal < *( m_KernelWeights.begin() ) )
+  typedef typename InputImageType::PixelType       PixelType;
+  typedef typename InputImageType::OffsetValueType OffsetValueType;
+
+  const PixelType * buffer = this->m_Image->GetBufferPointer();
+  const OffsetValueType * offsetTable = this->m_Image->GetOffsetTable();
+  const IndexType & bufferIndex =
+    this->m_Image->GetBufferedRegion().GetIndex();
+
+  // Each row along x is a dot product of contiguous pixels and
+  //   contiguous weights; rows are weighted by the remaining 1D weights.
+  //   The dot product keeps four partial sums: a single double sum is a
+  //   dependency chain that compilers may not reorder, so it neither
+  //   pipelines nor vectorizes.
+  const int rowLength = kMax[0] - kMin[0] + 1;
+  const double * wX = &( m_KernelWeights[0][ kMin[0] - m_KernelMin[0] ] );
+  int k[ImageDimension];
+  for( unsigned int i=0; i<ImageDimension; i++ )
+    {
+    k[i] = kMin[i];
+    }
+
+  double res = 0;
+  while( true )
+    {
+    double wRow = 1;
+    OffsetValueType offset = point[0] + kMin[0] - bufferIndex[0];
+    for( unsigned int i=1; i<ImageDimension; i++ )
+      {
+      wRow *= m_KernelWeights[i][ k[i] - m_KernelMin[i] ];
+      offset += ( point[i] + k[i] - bufferIndex[i] ) * offsetTable[i];
+      }
+
+    const PixelType * row = buffer + offset;
+    double rowSum0 = 0;
+    double rowSum1 = 0;
+    double rowSum2 = 0;
+    double rowSum3 = 0;
+    int x = 0;
+    for( ; x+3<rowLength; x+=4 )
+      {
+      rowSum0 += wX[x] * row[x];
+      rowSum1 += wX[x+1] * row[x+1];
+      rowSum2 += wX[x+2] * row[x+2];
+      rowSum3 += wX[x+3] * row[x+3];
+      }
+    for( ; x<rowLength; x++ )
+      {
+      rowSum0 += wX[x] * row[x];
+      }
+    res += wRow * ( ( rowSum0 + rowSum1 ) + ( rowSum2 + rowSum3 ) );
+
+    unsigned int i = 1;
+    while( i<ImageDimension && ++k[i] > kMax[i] )
+      {
+      k[i] = kMin[i];
+      ++i;
+      }
+    if( i >= ImageDimension )
+      {
+      break;
+      }
+    }
+
+  if( wTotal < m_KernelCornerWeight )
     {
     return 0;
     }
@@ -551,7 +635,7 @@ BlurImageFunction<TInputImage>
       }
     }
 
-  if( wTotal < *( m_KernelWeights.begin() ) )
+  if( wTotal < m_KernelCornerWeight )
     {
     return 0;
     }
@@ -562,6 +646,184 @@ BlurImageFunction<TInputImage>
   return res/wTotal;
 }
 
+template< class TInputImage >
+bool
+BlurImageFunction<TInputImage>
+::TileKeyType::operator<( const TileKeyType & key ) const
+{
+  if( Scale != key.Scale )
+    {
+    return Scale < key.Scale;
+    }
+  if( Extent != key.Extent )
+    {
+    return Extent < key.Extent;
+    }
+  for( unsigned int i=0; i<ImageDimension; i++ )
+    {
+    if( TileIndex[i] != key.TileIndex[i] )
+      {
+      return TileIndex[i] < key.TileIndex[i];
+      }
+    }
+  return false;
+}
+
+template< class TInputImage >
+double
+BlurImageFunction<TInputImage>
+::EvaluateAtIndexUsingTileCache( const IndexType & point ) const
+{
+  IndexType tileIndex;
+  for( unsigned int i=0; i<ImageDimension; i++ )
+    {
+    tileIndex[i] = ( point[i] - m_ImageIndexMin[i] ) / m_TileSize;
+    }
+
+  const TileType & tile = this->GetTile( tileIndex );
+
+  // Tiles on the upper image boundary may be smaller than m_TileSize
+  long offset = 0;
+  long stride = 1;
+  for( unsigned int i=0; i<ImageDimension; i++ )
+    {
+    long tileStart = m_ImageIndexMin[i] + tileIndex[i] * m_TileSize;
+    long tileSize = vnl_math_min( ( long )( m_TileSize ),
+      ( long )( m_ImageIndexMax[i] - tileStart + 1 ) );
+    offset += ( point[i] - tileStart ) * stride;
+    stride *= tileSize;
+    }
+
+  return tile[ offset ];
+}
+
+template< class TInputImage >
+const typename BlurImageFunction<TInputImage>::TileType &
+BlurImageFunction<TInputImage>
+::GetTile( const IndexType & tileIndex ) const
+{
+  TileKeyType key;
+  key.Scale = m_Scale;
+  key.Extent = m_Extent;
+  key.TileIndex = tileIndex;
+
+  typename TileMapType::iterator mapIt = m_TileMap.find( key );
+  if( mapIt != m_TileMap.end() )
+    {
+    // Move the tile to the front of the list; its iterator stays valid
+    m_TileList.splice( m_TileList.begin(), m_TileList, mapIt->second );
+    return mapIt->second->second;
+    }
+
+  m_TileList.push_front( std::make_pair( key, TileType() ) );
+  this->ComputeTile( tileIndex, m_TileList.front().second );
+  m_TileMap[ key ] = m_TileList.begin();
+  m_TileCacheMemoryUsed += m_TileList.front().second.size()
+    * sizeof( double );
+
+  while( m_TileCacheMemoryUsed > m_TileCacheMemoryBudget
+    && m_TileList.size() > 1 )
+    {
+    m_TileCacheMemoryUsed -= m_TileList.back().second.size()
+      * sizeof( double );
+    m_TileMap.erase( m_TileList.back().first );
+    m_TileList.pop_back();
+    }
+
+  return m_TileList.front().second;
+}
+
+template< class TInputImage >
+void
+BlurImageFunction<TInputImage>
+::ComputeTile( const IndexType & tileIndex, TileType & tile ) const
+{
+  // The tile, and the region of the image that contributes to it
+  long tileStart[ImageDimension];
+  long tileSize[ImageDimension];
+  typename InputImageType::RegionType bufRegion;
+  for( unsigned int i=0; i<ImageDimension; i++ )
+    {
+    tileStart[i] = m_ImageIndexMin[i] + tileIndex[i] * m_TileSize;
+    tileSize[i] = vnl_math_min( ( long )( m_TileSize ),
+      ( long )( m_ImageIndexMax[i] - tileStart[i] + 1 ) );
+    long bufStart = vnl_math_max( ( long )( m_ImageIndexMin[i] ),
+      tileStart[i] + m_KernelMin[i] );
+    long bufEnd = vnl_math_min( ( long )( m_ImageIndexMax[i] ),
+      tileStart[i] + tileSize[i] - 1 + m_KernelMax[i] );
+    bufRegion.SetIndex( i, bufStart );
+    bufRegion.SetSize( i, bufEnd - bufStart + 1 );
+    }
+
+  TileType buf( bufRegion.GetNumberOfPixels() );
+  itk::ImageRegionConstIterator< InputImageType > imIt( this->m_Image,
+    bufRegion );
+  typename TileType::iterator bufIt = buf.begin();
+  for( imIt.GoToBegin(); !imIt.IsAtEnd(); ++imIt, ++bufIt )
+    {
+    *bufIt = imIt.Get();
+    }
+
+  // One 1D pass per dimension, each shrinking that dimension of the
+  // buffer to the tile.  Taps outside of the buffer are outside of the
+  // image, so normalizing each pass by its valid weights reproduces the
+  // normalization of the ND kernel at the image boundary.
+  long curSize[ImageDimension];
+  for( unsigned int i=0; i<ImageDimension; i++ )
+    {
+    curSize[i] = bufRegion.GetSize()[i];
+    }
+  TileType out;
+  for( unsigned int d=0; d<ImageDimension; d++ )
+    {
+    const KernelWeightsType & w = m_KernelWeights[d];
+
+    long inner = 1;
+    for( unsigned int i=0; i<d; i++ )
+      {
+      inner *= curSize[i];
+      }
+    long outer = 1;
+    for( unsigned int i=d+1; i<ImageDimension; i++ )
+      {
+      outer *= curSize[i];
+      }
+    long offset = tileStart[d] - bufRegion.GetIndex()[d];
+
+    out.assign( inner * tileSize[d] * outer, 0 );
+    for( long o=0; o<outer; o++ )
+      {
+      for( long j=0; j<tileSize[d]; j++ )
+        {
+        long jb = offset + j;
+        long kMin = vnl_math_max( ( long )( m_KernelMin[d] ), -jb );
+        long kMax = vnl_math_min( ( long )( m_KernelMax[d] ),
+          curSize[d] - 1 - jb );
+        double wTotal = 0;
+        for( long k=kMin; k<=kMax; k++ )
+          {
+          wTotal += w[ k - m_KernelMin[d] ];
+          }
+        double * outP = &( out[ ( o * tileSize[d] + j ) * inner ] );
+        for( long k=kMin; k<=kMax; k++ )
+          {
+          double wk = w[ k - m_KernelMin[d] ] / wTotal;
+          const double * curP = &( buf[ ( o * curSize[d] + jb + k )
+            * inner ] );
+          for( long i=0; i<inner; i++ )
+            {
+            outP[i] += wk * curP[i];
+            }
+          }
+        }
+      }
+    buf.swap( out );
+    curSize[d] = tileSize[d];
+    }
+
+  tile.swap( buf );
+}
+
 } // End namespace tube
 
 } // End namespace itk
@@ -26,6 +26,7 @@ limitations under the License.
 
 #include <itkImage.h>
 #include <itkLightProcessObject.h>
+#include <itkMultiThreader.h>
 
 #include <vnl/vnl_vector.h>
 #include <vnl/vnl_matrix.h>
@@ -56,6 +57,8 @@ public:
   typedef std::vector< typename ImageType::Pointer >    ImageListType;
 
   typedef typename TImage::IndexType                    IndexType;
+  typedef typename TImage::RegionType                   RegionType;
+  typedef std::vector< IndexType >                      IndexListType;
 
   itkStaticConstMacro( ImageDimension, unsigned int,
     TImage::ImageDimension );
@@ -64,6 +67,8 @@ public:
   typedef vnl_vector< FeatureValueType >                FeatureVectorType;
 
   typedef Image< FeatureValueType, TImage::ImageDimension > FeatureImageType;
+  typedef std::vector< typename FeatureImageType::Pointer >
+                                                        FeatureImageListType;
 
   typedef double                                        ValueType;
   typedef std::vector< ValueType >                      ValueListType;
@@ -102,6 +107,42 @@ public:
   virtual typename FeatureImageType::Pointer GetFeatureImage(
     unsigned int num ) const;
 
+  /** Compute every feature image in one pass over the input images */
+  virtual FeatureImageListType GetFeatureImages( void ) const;
+
+  /**
+   * Fill a caller-provided buffer with the feature vectors of every
+   *   voxel in region.  GetNumberOfFeatures() values are written per
+   *   voxel, in region iteration order.  The work is split among
+   *   NumberOfThreads threads. */
+  void GetFeatureVectors( const RegionType & region,
+    FeatureValueType * featureBuffer ) const;
+
+  /**
+   * Fill a caller-provided buffer with the feature vectors of the listed
+   *   voxels, in list order.  Threaded like the region version. */
+  void GetFeatureVectors( const IndexListType & indices,
+    FeatureValueType * featureBuffer ) const;
+
+  /** Number of threads used by GetFeatureVectors and GetFeatureImage */
+  itkSetMacro( NumberOfThreads, unsigned int );
+  itkGetConstMacro( NumberOfThreads, unsigned int );
+
+  /**
+   * Allocate the per-thread state needed by the Threaded* methods below.
+   *   Must be called before they are used with threadId < numberOfThreads.
+   */
+  virtual void PrepareThreadedFeatures( unsigned int numberOfThreads ) const;
+
+  /** Write the feature vector at indx into featureVector.  Safe to call
+   *   concurrently from different threadIds. */
+  virtual void ThreadedGetFeatureVector( const IndexType & indx,
+    FeatureValueType * featureVector, ThreadIdType threadId ) const;
+
+  virtual FeatureValueType ThreadedGetFeatureVectorValue(
+    const IndexType & indx, unsigned int fNum,
+    ThreadIdType threadId ) const;
+
   virtual void Update( void );
 
 protected:
@@ -113,6 +154,17 @@ protected:
 
   void UpdateWhitenStatistics( void );
 
+  /** Threaded evaluation of one feature (or of all features when
+   *   featureNum < 0) into buffer, for the listed voxels if indices is
+   *   not NULL and for the voxels of region otherwise */
+  void ExecuteFeatureThreads( const RegionType & region,
+    const IndexListType * indices, FeatureValueType * buffer,
+    int featureNum ) const;
+
+  /** Return the region covering one slab of the outermost dimension */
+  static RegionType GetSliceRegion( const RegionType & region,
+    unsigned int slice );
+
   void PrintSelf( std::ostream & os, Indent indent ) const;
 
 private:
@@ -121,7 +173,20 @@ private:
   FeatureVectorGenerator( const Self & );
   void operator = ( const Self & );      // Purposely not implemented
 
+  struct FeatureThreadStruct
+    {
+    const Self *          Generator;
+    RegionType            Region;
+    const IndexListType * Indices;
+    FeatureValueType *    Buffer;
+    int                   FeatureNum;
+    }; // End struct FeatureThreadStruct
+
+  static ITK_THREAD_RETURN_TYPE FeatureThreaderCallback( void * arg );
+
   //  Data
+  unsigned int                    m_NumberOfThreads;
+
   bool                            m_UpdateWhitenStatisticsOnUpdate;
   ValueListType                   m_WhitenMean;
   ValueListType                   m_WhitenStdDev;
@@ -50,6 +50,8 @@ FeatureVectorGenerator< TImage >
 {
   m_InputImageList.clear();
 
+  m_NumberOfThreads = MultiThreader::GetGlobalDefaultNumberOfThreads();
+
   m_UpdateWhitenStatisticsOnUpdate = false;
   m_WhitenMean.clear();
   m_WhitenStdDev.clear();
@@ -246,6 +248,188 @@ FeatureVectorGenerator< TImage >
     }
 }
 
+template< class TImage >
+void
+FeatureVectorGenerator< TImage >
+::PrepareThreadedFeatures( unsigned int itkNotUsed( numberOfThreads ) ) const
+{
+}
+
+template< class TImage >
+void
+FeatureVectorGenerator< TImage >
+::ThreadedGetFeatureVector( const IndexType & indx,
+  FeatureValueType * featureVector, ThreadIdType threadId ) const
+{
+  const unsigned int numFeatures = this->GetNumberOfFeatures();
+
+  for( unsigned int i = 0; i < numFeatures; i++ )
+    {
+    featureVector[i] = this->ThreadedGetFeatureVectorValue( indx, i,
+      threadId );
+    }
+}
+
+template< class TImage >
+typename FeatureVectorGenerator< TImage >::FeatureValueType
+FeatureVectorGenerator< TImage >
+::ThreadedGetFeatureVectorValue( const IndexType & indx, unsigned int fNum,
+  ThreadIdType itkNotUsed( threadId ) ) const
+{
+  return this->GetFeatureVectorValue( indx, fNum );
+}
+
+template< class TImage >
+ITK_THREAD_RETURN_TYPE
+FeatureVectorGenerator< TImage >
+::FeatureThreaderCallback( void * arg )
+{
+  MultiThreader::ThreadInfoStruct * info =
+    static_cast< MultiThreader::ThreadInfoStruct * >( arg );
+  const ThreadIdType threadId = info->ThreadID;
+  const ThreadIdType numThreads = info->NumberOfThreads;
+  FeatureThreadStruct * str =
+    static_cast< FeatureThreadStruct * >( info->UserData );
+
+  const RegionType & region = str->Region;
+  const SizeValueType numPixels = ( str->Indices != NULL )
+    ? str->Indices->size() : region.GetNumberOfPixels();
+  const SizeValueType startPixel = ( numPixels * threadId ) / numThreads;
+  const SizeValueType endPixel = ( numPixels * ( threadId + 1 ) )
+    / numThreads;
+  if( startPixel >= endPixel )
+    {
+    return ITK_THREAD_RETURN_VALUE;
+    }
+
+  const unsigned int numFeatures = str->Generator->GetNumberOfFeatures();
+  if( str->Indices != NULL )
+    {
+    const IndexListType & indices = *( str->Indices );
+    for( SizeValueType p = startPixel; p < endPixel; ++p )
+      {
+      if( str->FeatureNum < 0 )
+        {
+        str->Generator->ThreadedGetFeatureVector( indices[p],
+          str->Buffer + p * numFeatures, threadId );
+        }
+      else
+        {
+        str->Buffer[p] = str->Generator->ThreadedGetFeatureVectorValue(
+          indices[p], str->FeatureNum, threadId );
+        }
+      }
+    return ITK_THREAD_RETURN_VALUE;
+    }
+
+  const IndexType & regionIndex = region.GetIndex();
+  const typename RegionType::SizeType & regionSize = region.GetSize();
+
+  // Index of the first voxel assigned to this thread
+  IndexType indx;
+  SizeValueType remainder = startPixel;
+  for( unsigned int d = 0; d < ImageDimension; ++d )
+    {
+    indx[d] = regionIndex[d] + remainder % regionSize[d];
+    remainder /= regionSize[d];
+    }
+
+  for( SizeValueType p = startPixel; p < endPixel; ++p )
+    {
+    if( str->FeatureNum < 0 )
+      {
+      str->Generator->ThreadedGetFeatureVector( indx,
+        str->Buffer + p * numFeatures, threadId );
+      }
+    else
+      {
+      str->Buffer[p] = str->Generator->ThreadedGetFeatureVectorValue( indx,
+        str->FeatureNum, threadId );
+      }
+
+    unsigned int d = 0;
+    ++indx[0];
+    while( d + 1 < ImageDimension
+      && indx[d] >= regionIndex[d]
+        + static_cast< IndexValueType >( regionSize[d] ) )
+      {
+      indx[d] = regionIndex[d];
+      ++d;
+      ++indx[d];
+      }
+    }
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+template< class TImage >
+void
+FeatureVectorGenerator< TImage >
+::ExecuteFeatureThreads( const RegionType & region,
+  const IndexListType * indices, FeatureValueType * buffer,
+  int featureNum ) const
+{
+  const SizeValueType numPixels = ( indices != NULL )
+    ? indices->size() : region.GetNumberOfPixels();
+
+  unsigned int numThreads = m_NumberOfThreads;
+  if( numThreads < 1 )
+    {
+    numThreads = 1;
+    }
+  if( numThreads > numPixels )
+    {
+    numThreads = numPixels;
+    }
+  if( numThreads < 1 )
+    {
+    return;
+    }
+
+  FeatureThreadStruct str;
+  str.Generator = this;
+  str.Region = region;
+  str.Indices = indices;
+  str.Buffer = buffer;
+  str.FeatureNum = featureNum;
+
+  MultiThreader::Pointer threader = MultiThreader::New();
+  threader->SetNumberOfThreads( numThreads );
+  this->PrepareThreadedFeatures( threader->GetNumberOfThreads() );
+  threader->SetSingleMethod( this->FeatureThreaderCallback, &str );
+  threader->SingleMethodExecute();
+}
+
+template< class TImage >
+void
+FeatureVectorGenerator< TImage >
+::GetFeatureVectors( const RegionType & region,
+  FeatureValueType * featureBuffer ) const
+{
+  this->ExecuteFeatureThreads( region, NULL, featureBuffer, -1 );
+}
+
+template< class TImage >
+void
+FeatureVectorGenerator< TImage >
+::GetFeatureVectors( const IndexListType & indices,
+  FeatureValueType * featureBuffer ) const
+{
+  this->ExecuteFeatureThreads( RegionType(), &indices, featureBuffer, -1 );
+}
+
+template< class TImage >
+typename FeatureVectorGenerator< TImage >::RegionType
+FeatureVectorGenerator< TImage >
+::GetSliceRegion( const RegionType & region, unsigned int slice )
+{
+  RegionType sliceRegion = region;
+  sliceRegion.SetIndex( ImageDimension - 1,
+    region.GetIndex()[ImageDimension - 1] + slice );
+  sliceRegion.SetSize( ImageDimension - 1, 1 );
+  return sliceRegion;
+}
+
 template< class TImage >
 typename FeatureVectorGenerator< TImage >::FeatureImageType::Pointer
 FeatureVectorGenerator< TImage >
@@ -254,9 +438,6 @@ FeatureVectorGenerator< TImage >
   const unsigned int numFeatures = this->GetNumberOfFeatures();
   if( featureNum < numFeatures )
     {
-    typedef itk::ImageRegionIteratorWithIndex< FeatureImageType >
-      ImageIteratorType;
-
     typename FeatureImageType::Pointer fi;
 
     typename FeatureImageType::RegionType region;
@@ -267,19 +448,8 @@ FeatureVectorGenerator< TImage >
     fi->CopyInformation( m_InputImageList[ 0 ] );
     fi->Allocate();
 
-    ImageIteratorType itFeatureIm( fi, fi->GetLargestPossibleRegion() );
-
-    FeatureValueType v;
-    while( !itFeatureIm.IsAtEnd() )
-      {
-      IndexType indx = itFeatureIm.GetIndex();
-
-      v = this->GetFeatureVectorValue( indx, featureNum );
-
-      itFeatureIm.Set( v );
-
-      ++itFeatureIm;
-      }
+    this->ExecuteFeatureThreads( region, NULL, fi->GetBufferPointer(),
+      featureNum );
 
     return fi;
     }
@@ -289,6 +459,51 @@ FeatureVectorGenerator< TImage >
     }
 }
 
+template< class TImage >
+typename FeatureVectorGenerator< TImage >::FeatureImageListType
+FeatureVectorGenerator< TImage >
+::GetFeatureImages( void ) const
+{
+  const unsigned int numFeatures = this->GetNumberOfFeatures();
+
+  const RegionType region = m_InputImageList[ 0 ]->
+    GetLargestPossibleRegion();
+
+  FeatureImageListType featureImageList( numFeatures );
+  for( unsigned int f = 0; f < numFeatures; ++f )
+    {
+    featureImageList[f] = FeatureImageType::New();
+    featureImageList[f]->SetRegions( region );
+    featureImageList[f]->CopyInformation( m_InputImageList[ 0 ] );
+    featureImageList[f]->Allocate();
+    }
+  if( numFeatures == 0 )
+    {
+    return featureImageList;
+    }
+
+  // Features are generated a slice at a time to bound the buffer size
+  const unsigned int numSlices = region.GetSize()[ ImageDimension - 1 ];
+  const SizeValueType sliceSize = GetSliceRegion( region, 0 )
+    .GetNumberOfPixels();
+  std::vector< FeatureValueType > sliceFeatures( sliceSize * numFeatures );
+  for( unsigned int slice = 0; slice < numSlices; ++slice )
+    {
+    this->GetFeatureVectors( GetSliceRegion( region, slice ),
+      &( sliceFeatures[0] ) );
+    for( unsigned int f = 0; f < numFeatures; ++f )
+      {
+      FeatureValueType * fiPtr = featureImageList[f]->GetBufferPointer()
+        + slice * sliceSize;
+      for( SizeValueType p = 0; p < sliceSize; ++p )
+        {
+        fiPtr[p] = sliceFeatures[ p * numFeatures + f ];
+        }
+      }
+    }
+
+  return featureImageList;
+}
 
 template< class TImage >
 void
@@ -325,28 +540,35 @@ UpdateWhitenStatistics( void )
     imStdDev[i] = 0;
     }
   unsigned int imCount = 0;
+  if( numFeatures == 0 )
+    {
+    return;
+    }
 
-  typedef itk::ImageRegionIteratorWithIndex< TImage >
-    ImageIteratorType;
-  ImageIteratorType itIm( m_InputImageList[0],
-    m_InputImageList[0]->GetLargestPossibleRegion() );
+  const RegionType region = m_InputImageList[0]->
+    GetLargestPossibleRegion();
+  const unsigned int numSlices = region.GetSize()[ ImageDimension - 1 ];
+  const SizeValueType sliceSize = GetSliceRegion( region, 0 )
+    .GetNumberOfPixels();
+  std::vector< FeatureValueType > sliceFeatures( sliceSize * numFeatures );
 
-  IndexType indx;
   double imVal;
-  FeatureVectorType fv;
-  while( !itIm.IsAtEnd() )
+  for( unsigned int slice = 0; slice < numSlices; ++slice )
     {
-    indx = itIm.GetIndex();
-    fv = this->GetFeatureVector( indx );
-    ++imCount;
-    for( unsigned int i = 0; i < numFeatures; i++ )
+    this->GetFeatureVectors( GetSliceRegion( region, slice ),
+      &( sliceFeatures[0] ) );
+    const FeatureValueType * fv = &( sliceFeatures[0] );
+    for( SizeValueType p = 0; p < sliceSize; ++p, fv += numFeatures )
       {
-      imVal = fv[i];
-      delta[i] = imVal - imMean[i];
-      imMean[i] += delta[i] / imCount;
-      imStdDev[i] += delta[i] * ( imVal - imMean[i] );
+      ++imCount;
+      for( unsigned int i = 0; i < numFeatures; i++ )
+        {
+        imVal = fv[i];
+        delta[i] = imVal - imMean[i];
+        imMean[i] += delta[i] / imCount;
+        imStdDev[i] += delta[i] * ( imVal - imMean[i] );
+        }
       }
-    ++itIm;
     }
   if( imCount > 1 )
     {
@@ -379,6 +601,7 @@ FeatureVectorGenerator< TImage >
 
   os << indent << "InputImageList.size = " << m_InputImageList.size()
     << std::endl;
+  os << indent << "NumberOfThreads = " << m_NumberOfThreads << std::endl;
 }
 
 } // End namespace tube
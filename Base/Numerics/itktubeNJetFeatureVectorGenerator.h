@@ -25,8 +25,10 @@ limitations under the License.
 #define __itktubeNJetFeatureVectorGenerator_h
 
 #include "itktubeFeatureVectorGenerator.h"
+#include "itktubeNJetImageFunction.h"
 
 #include <itkImage.h>
+#include <itkVectorImage.h>
 
 #include <vnl/vnl_matrix.h>
 #include <vnl/vnl_vector.h>
@@ -66,8 +68,19 @@ public:
 
   typedef typename Superclass::IndexType          IndexType;
 
+  typedef typename Superclass::FeatureImageType   FeatureImageType;
+
+  /** Multi-component image holding the (unwhitened) features of every
+   *   voxel, GetNumberOfFeatures() components per voxel */
+  typedef VectorImage< FeatureValueType, TImage::ImageDimension >
+                                                  FeatureVectorImageType;
+
   typedef std::vector< double >                   NJetScalesType;
 
+  typedef NJetImageFunction< ImageType >          NJetFunctionType;
+  typedef std::vector< typename NJetFunctionType::Pointer >
+                                                  NJetFunctionListType;
+
   virtual unsigned int GetNumberOfFeatures( void ) const;
 
   void SetZeroScales( const NJetScalesType & scales );
@@ -83,9 +96,32 @@ public:
   virtual FeatureVectorType GetFeatureVector(
     const IndexType & indx ) const;
 
+  /** Single-voxel evaluation uses its own jet functions; to evaluate many
+   *   voxels, GetFeatureVectors() is much faster. */
   virtual FeatureValueType  GetFeatureVectorValue( const IndexType & indx,
     unsigned int fNum ) const;
 
+  /**
+   * If set, the features of every voxel are computed at once using
+   *   recursive Gaussian derivative filters, and then read from the
+   *   resulting multi-component image.  The values match the pointwise
+   *   jets away from the image boundary, up to discretization. */
+  itkSetMacro( UseDenseFeatures, bool );
+  itkGetConstMacro( UseDenseFeatures, bool );
+  itkBooleanMacro( UseDenseFeatures );
+
+  /** Return the dense, unwhitened feature stack, computing it if needed */
+  const FeatureVectorImageType * GetFeatureVectorImage( void ) const;
+
+  virtual void PrepareThreadedFeatures( unsigned int numberOfThreads ) const;
+
+  virtual void ThreadedGetFeatureVector( const IndexType & indx,
+    FeatureValueType * featureVector, ThreadIdType threadId ) const;
+
+  virtual FeatureValueType ThreadedGetFeatureVectorValue(
+    const IndexType & indx, unsigned int fNum,
+    ThreadIdType threadId ) const;
+
 protected:
 
   NJetFeatureVectorGenerator( void );
@@ -104,6 +140,58 @@ private:
   NJetScalesType m_SecondScales;
   NJetScalesType m_RidgeScales;
 
+  /** One jet function per input image, per thread */
+  mutable std::vector< NJetFunctionListType > m_ThreadNJetFunctions;
+
+  typedef std::vector< typename FeatureImageType::Pointer > JetImageListType;
+
+  struct DenseFeatureThreadStruct
+    {
+    const JetImageListType *       Jet;
+    double                         Scale;
+    double                         DerivativeNorm[ImageDimension];
+    double                         HessianNorm[ImageDimension][ImageDimension];
+    std::vector< unsigned int >    ZeroComponents;
+    std::vector< unsigned int >    FirstComponents;
+    std::vector< unsigned int >    SecondComponents;
+    std::vector< unsigned int >    RidgeComponents;
+    FeatureValueType *             Buffer;
+    unsigned int                   NumberOfComponents;
+    SizeValueType                  NumberOfPixels;
+    }; // End struct DenseFeatureThreadStruct
+
+  static ITK_THREAD_RETURN_TYPE DenseFeatureThreaderCallback( void * arg );
+
+  /** Make sure the first numberOfThreads threads have a jet function per
+   *   input image */
+  void PrepareNJetFunctions( unsigned int numberOfThreads ) const;
+
+  /** Give njetList a jet function per input image, bound to that image */
+  void InitializeNJetFunctions( NJetFunctionListType & njetList ) const;
+
+  /** Compute the features at indx using the given jet functions, or
+   *   read them from the dense features if they are used */
+  void ComputeFeatureVector( const IndexType & indx,
+    FeatureValueType * featureVector,
+    const NJetFunctionListType & njetList ) const;
+
+  FeatureValueType ComputeFeatureVectorValue( const IndexType & indx,
+    unsigned int fNum, const NJetFunctionListType & njetList ) const;
+
+  /** (Re)compute m_DenseFeatureImage if the inputs or scales changed */
+  void UpdateDenseFeatures( void ) const;
+
+  /** Compute the Gaussian derivatives of image up to maxOrder at scale.
+   *   Slot 0 holds the blurred image, slots 1..D the first derivatives and
+   *   slot 1+D+i*D+j the (i,j) second derivative. */
+  void ComputeDenseJet( const ImageType * image, double scale,
+    unsigned int maxOrder, JetImageListType & jet ) const;
+
+  bool                                             m_UseDenseFeatures;
+  mutable typename FeatureVectorImageType::Pointer m_DenseFeatureImage;
+  mutable std::vector< const ImageType * >         m_DenseFeatureInputs;
+  mutable std::vector< unsigned long >             m_DenseFeatureInputMTimes;
+
 }; // End class NJetFeatureVectorGenerator
 
 }  // End namespace tube
@@ -28,10 +28,13 @@ limitations under the License.
 #include "itktubeNJetImageFunction.h"
 #include "tubeMatrixMath.h"
 
+#include <itkCastImageFilter.h>
 #include <itkImage.h>
+#include <itkRecursiveGaussianImageFilter.h>
 #include <itkTimeProbesCollectorBase.h>
 
 #include <limits>
+#include <map>
 
 namespace itk
 {
@@ -47,6 +50,11 @@ NJetFeatureVectorGenerator< TImage >
   m_FirstScales.clear();
   m_SecondScales.clear();
   m_RidgeScales.clear();
+
+  m_UseDenseFeatures = false;
+  m_DenseFeatureImage = NULL;
+  m_DenseFeatureInputs.clear();
+  m_DenseFeatureInputMTimes.clear();
 }
 
 template< class TImage >
@@ -75,28 +83,171 @@ NJetFeatureVectorGenerator< TImage >
   return numFeatures;
 }
 
+template< class TImage >
+void
+NJetFeatureVectorGenerator< TImage >
+::PrepareThreadedFeatures( unsigned int numberOfThreads ) const
+{
+  if( m_UseDenseFeatures )
+    {
+    this->UpdateDenseFeatures();
+    }
+  else
+    {
+    this->PrepareNJetFunctions( numberOfThreads );
+    }
+}
+
+template< class TImage >
+void
+NJetFeatureVectorGenerator< TImage >
+::PrepareNJetFunctions( unsigned int numberOfThreads ) const
+{
+  if( m_ThreadNJetFunctions.size() < numberOfThreads )
+    {
+    m_ThreadNJetFunctions.resize( numberOfThreads );
+    }
+  for( unsigned int t = 0; t < numberOfThreads; t++ )
+    {
+    this->InitializeNJetFunctions( m_ThreadNJetFunctions[t] );
+    }
+}
+
+template< class TImage >
+void
+NJetFeatureVectorGenerator< TImage >
+::InitializeNJetFunctions( NJetFunctionListType & njetList ) const
+{
+  const unsigned int numInputImages = this->GetNumberOfInputImages();
+
+  njetList.resize( numInputImages );
+  for( unsigned int inputImageNum = 0; inputImageNum < numInputImages;
+    inputImageNum++ )
+    {
+    if( njetList[inputImageNum].IsNull() )
+      {
+      njetList[inputImageNum] = NJetFunctionType::New();
+      }
+    if( njetList[inputImageNum]->GetInputImage()
+      != this->m_InputImageList[inputImageNum].GetPointer() )
+      {
+      njetList[inputImageNum]->SetInputImage(
+        this->m_InputImageList[inputImageNum] );
+      }
+    }
+}
+
 template< class TImage >
 typename NJetFeatureVectorGenerator< TImage >::FeatureVectorType
 NJetFeatureVectorGenerator< TImage >
 ::GetFeatureVector( const IndexType & indx ) const
+{
+  // Local jet functions, so that the per-thread ones are never shared
+  NJetFunctionListType njetList;
+  if( m_UseDenseFeatures )
+    {
+    this->UpdateDenseFeatures();
+    }
+  else
+    {
+    this->InitializeNJetFunctions( njetList );
+    }
+
+  FeatureVectorType featureVector( this->GetNumberOfFeatures() );
+  this->ComputeFeatureVector( indx, featureVector.data_block(), njetList );
+
+  return featureVector;
+}
+
+template< class TImage >
+typename NJetFeatureVectorGenerator< TImage >::FeatureValueType
+NJetFeatureVectorGenerator< TImage >
+::GetFeatureVectorValue( const IndexType & indx, unsigned int fNum ) const
+{
+  NJetFunctionListType njetList;
+  if( m_UseDenseFeatures )
+    {
+    this->UpdateDenseFeatures();
+    }
+  else
+    {
+    this->InitializeNJetFunctions( njetList );
+    }
+
+  return this->ComputeFeatureVectorValue( indx, fNum, njetList );
+}
+
+template< class TImage >
+void
+NJetFeatureVectorGenerator< TImage >
+::ThreadedGetFeatureVector( const IndexType & indx,
+  FeatureValueType * featureVector, ThreadIdType threadId ) const
+{
+  // Dense features do not use jet functions
+  if( m_UseDenseFeatures )
+    {
+    this->ComputeFeatureVector( indx, featureVector,
+      NJetFunctionListType() );
+    }
+  else
+    {
+    this->ComputeFeatureVector( indx, featureVector,
+      m_ThreadNJetFunctions[threadId] );
+    }
+}
+
+template< class TImage >
+typename NJetFeatureVectorGenerator< TImage >::FeatureValueType
+NJetFeatureVectorGenerator< TImage >
+::ThreadedGetFeatureVectorValue( const IndexType & indx, unsigned int fNum,
+  ThreadIdType threadId ) const
+{
+  if( m_UseDenseFeatures )
+    {
+    return this->ComputeFeatureVectorValue( indx, fNum,
+      NJetFunctionListType() );
+    }
+  return this->ComputeFeatureVectorValue( indx, fNum,
+    m_ThreadNJetFunctions[threadId] );
+}
+
+template< class TImage >
+void
+NJetFeatureVectorGenerator< TImage >
+::ComputeFeatureVector( const IndexType & indx,
+  FeatureValueType * featureVector,
+  const NJetFunctionListType & njetList ) const
 {
   const unsigned int numFeatures = this->GetNumberOfFeatures();
 
+  if( m_UseDenseFeatures )
+    {
+    const FeatureValueType * denseFeatures =
+      m_DenseFeatureImage->GetBufferPointer()
+      + m_DenseFeatureImage->ComputeOffset( indx ) * numFeatures;
+    for( unsigned int i=0; i<numFeatures; ++i )
+      {
+      featureVector[i] = denseFeatures[i];
+      if( this->GetWhitenStdDev( i ) > 0 )
+        {
+        featureVector[i] = ( featureVector[i] - this->GetWhitenMean(i) )
+          / this->GetWhitenStdDev( i );
+        }
+      }
+    return;
+    }
+
   const unsigned int numInputImages = this->GetNumberOfInputImages();
 
-  typedef NJetImageFunction< ImageType > NJetFunctionType;
-  typename NJetFunctionType::Pointer njet = NJetFunctionType::New();
   typename NJetFunctionType::VectorType v;
   typename NJetFunctionType::MatrixType m;
 
   double val = 0.0;
-  FeatureVectorType featureVector;
-  featureVector.set_size( numFeatures );
   unsigned int featureCount = 0;
   for( unsigned int inputImageNum = 0; inputImageNum < numInputImages;
     inputImageNum++ )
     {
-    njet->SetInputImage( this->m_InputImageList[inputImageNum] );
+    const NJetFunctionType * njet = njetList[inputImageNum];
 
     for( unsigned int s = 0; s < m_ZeroScales.size(); s++ )
       {
@@ -152,21 +303,19 @@ NJetFeatureVectorGenerator< TImage >
         / this->GetWhitenStdDev( i );
       }
     }
-
-  return featureVector;
 }
 
 template< class TImage >
 typename NJetFeatureVectorGenerator< TImage >::FeatureValueType
 NJetFeatureVectorGenerator< TImage >
-::GetFeatureVectorValue( const IndexType & indx, unsigned int fNum ) const
+::ComputeFeatureVectorValue( const IndexType & indx, unsigned int fNum,
+  const NJetFunctionListType & njetList ) const
 {
-  const unsigned int numInputImages = this->GetNumberOfInputImages();
-
-  typedef NJetImageFunction< ImageType > NJetFunctionType;
-  typename NJetFunctionType::Pointer njet = NJetFunctionType::New();
-  typename NJetFunctionType::VectorType v;
-  typename NJetFunctionType::MatrixType m;
+  const unsigned int numFeatures = this->GetNumberOfFeatures();
+  if( fNum >= numFeatures )
+    {
+    itkExceptionMacro( << "Requested non-existent FeatureVectorValue." );
+    }
 
   double fNumMean = this->GetWhitenMean( fNum );
   double fNumStdDev = this->GetWhitenStdDev( fNum );
@@ -175,114 +324,509 @@ NJetFeatureVectorGenerator< TImage >
     fNumMean = 0;
     fNumStdDev = 1;
     }
+
+  if( m_UseDenseFeatures )
+    {
+    const FeatureValueType * denseFeatures =
+      m_DenseFeatureImage->GetBufferPointer()
+      + m_DenseFeatureImage->ComputeOffset( indx ) * numFeatures;
+    return ( denseFeatures[fNum] - fNumMean ) / fNumStdDev;
+    }
+
+  const unsigned int featuresPerImage = numFeatures
+    / this->GetNumberOfInputImages();
+  const NJetFunctionType * njet = njetList[fNum / featuresPerImage];
+  typename NJetFunctionType::VectorType v;
+  typename NJetFunctionType::MatrixType m;
+
+  unsigned int f = fNum % featuresPerImage;
   double val = 0.0;
-  unsigned int featureCount = 0;
-  for( unsigned int inputImageNum = 0; inputImageNum < numInputImages;
-    inputImageNum++ )
+  if( f < m_ZeroScales.size() )
+    {
+    val = njet->EvaluateAtIndex( indx, m_ZeroScales[f] );
+    return ( val - fNumMean ) / fNumStdDev;
+    }
+  f -= m_ZeroScales.size();
+
+  if( f < m_FirstScales.size() * (ImageDimension + 1) )
+    {
+    const unsigned int d = f % (ImageDimension + 1);
+    njet->DerivativeAtIndex( indx, m_FirstScales[f / (ImageDimension + 1)],
+      v );
+    if( d < ImageDimension )
+      {
+      val = v[d];
+      }
+    else
+      {
+      val = v.GetNorm();
+      }
+    return ( val - fNumMean ) / fNumStdDev;
+    }
+  f -= m_FirstScales.size() * (ImageDimension + 1);
+
+  if( f < m_SecondScales.size() * (ImageDimension + 1) )
+    {
+    const unsigned int d = f % (ImageDimension + 1);
+    njet->HessianAtIndex( indx, m_SecondScales[f / (ImageDimension + 1)],
+      m );
+    if( d < ImageDimension )
+      {
+      val = m[d][d];
+      }
+    else
+      {
+      for( unsigned int i = 0; i < ImageDimension; i++ )
+        {
+        val += m[i][i]*m[i][i];
+        }
+      val = std::sqrt( val );
+      }
+    return ( val - fNumMean ) / fNumStdDev;
+    }
+  f -= m_SecondScales.size() * (ImageDimension + 1);
+
+  njet->RidgenessAtIndex( indx, m_RidgeScales[f / 4] );
+  switch( f % 4 )
+    {
+    case 0:
+      val = njet->GetMostRecentRidgeness();
+      break;
+    case 1:
+      val = njet->GetMostRecentRidgeRoundness();
+      break;
+    case 2:
+      val = njet->GetMostRecentRidgeCurvature();
+      break;
+    default:
+      val = njet->GetMostRecentRidgeLevelness();
+      break;
+    }
+  return ( val - fNumMean ) / fNumStdDev;
+}
+
+template< class TImage >
+const typename NJetFeatureVectorGenerator< TImage >::FeatureVectorImageType *
+NJetFeatureVectorGenerator< TImage >
+::GetFeatureVectorImage( void ) const
+{
+  this->UpdateDenseFeatures();
+
+  return m_DenseFeatureImage.GetPointer();
+}
+
+template< class TImage >
+void
+NJetFeatureVectorGenerator< TImage >
+::ComputeDenseJet( const ImageType * image, double scale,
+  unsigned int maxOrder, JetImageListType & jet ) const
+{
+  typedef CastImageFilter< ImageType, FeatureImageType > CastFilterType;
+  typedef RecursiveGaussianImageFilter< FeatureImageType, FeatureImageType >
+    DerivativeFilterType;
+
+  typename CastFilterType::Pointer castFilter = CastFilterType::New();
+  castFilter->SetInput( image );
+  castFilter->Update();
+
+  // Filter along the last dimension first.  Every partial result is
+  //   shared by all of the derivatives whose orders begin with it.
+  typedef std::pair< Index< ImageDimension >,
+    typename FeatureImageType::Pointer > PartialJetType;
+  std::vector< PartialJetType > partialJet( 1 );
+  partialJet[0].first.Fill( 0 );
+  partialJet[0].second = castFilter->GetOutput();
+  for( int d = ImageDimension - 1; d >= 0; --d )
     {
-    njet->SetInputImage( this->m_InputImageList[inputImageNum] );
+    std::vector< PartialJetType > nextPartialJet;
+    for( unsigned int p = 0; p < partialJet.size(); ++p )
+      {
+      unsigned int order = 0;
+      for( unsigned int i = 0; i < ImageDimension; ++i )
+        {
+        order += partialJet[p].first[i];
+        }
+      for( unsigned int k = 0; order + k <= maxOrder; ++k )
+        {
+        typename DerivativeFilterType::Pointer filter =
+          DerivativeFilterType::New();
+        filter->SetInput( partialJet[p].second );
+        filter->SetDirection( d );
+        filter->SetSigma( scale );
+        filter->SetNormalizeAcrossScale( false );
+        filter->SetOrder( static_cast< typename
+          DerivativeFilterType::OrderEnumType >( k ) );
+        filter->Update();
+
+        PartialJetType next = partialJet[p];
+        next.first[d] = k;
+        next.second = filter->GetOutput();
+        nextPartialJet.push_back( next );
+        }
+      }
+    partialJet = nextPartialJet;
+    }
 
-    if( fNum < m_ZeroScales.size() )
+  jet.clear();
+  jet.resize( 1 + ImageDimension + ImageDimension * ImageDimension );
+  for( unsigned int p = 0; p < partialJet.size(); ++p )
+    {
+    int first = -1;
+    int second = -1;
+    for( unsigned int i = 0; i < ImageDimension; ++i )
       {
-      for( unsigned int s = 0; s < m_ZeroScales.size(); s++ )
+      for( long k = 0; k < partialJet[p].first[i]; ++k )
         {
-        if( featureCount == fNum )
+        if( first < 0 )
+          {
+          first = i;
+          }
+        else
           {
-          return ( njet->EvaluateAtIndex( indx, m_ZeroScales[s] )
-            - fNumMean ) / fNumStdDev;
+          second = i;
           }
-        featureCount++;
         }
       }
-    else if( fNum < ( m_ZeroScales.size()
-      + m_FirstScales.size() * (ImageDimension + 1) ) )
+    if( first < 0 )
+      {
+      jet[0] = partialJet[p].second;
+      }
+    else if( second < 0 )
+      {
+      jet[1 + first] = partialJet[p].second;
+      }
+    else
+      {
+      jet[1 + ImageDimension + first * ImageDimension + second] =
+        partialJet[p].second;
+      jet[1 + ImageDimension + second * ImageDimension + first] =
+        partialJet[p].second;
+      }
+    }
+}
+
+template< class TImage >
+ITK_THREAD_RETURN_TYPE
+NJetFeatureVectorGenerator< TImage >
+::DenseFeatureThreaderCallback( void * arg )
+{
+  MultiThreader::ThreadInfoStruct * info =
+    static_cast< MultiThreader::ThreadInfoStruct * >( arg );
+  const ThreadIdType threadId = info->ThreadID;
+  const ThreadIdType numThreads = info->NumberOfThreads;
+  DenseFeatureThreadStruct * str =
+    static_cast< DenseFeatureThreadStruct * >( info->UserData );
+
+  const SizeValueType startPixel = ( str->NumberOfPixels * threadId )
+    / numThreads;
+  const SizeValueType endPixel = ( str->NumberOfPixels * ( threadId + 1 ) )
+    / numThreads;
+
+  const JetImageListType & jet = *( str->Jet );
+  const double scale2 = str->Scale * str->Scale;
+
+  vnl_vector< double > d( ImageDimension );
+  vnl_matrix< double > h( ImageDimension, ImageDimension );
+  vnl_vector< double > prevTangent;
+  vnl_matrix< double > eVect( ImageDimension, ImageDimension );
+  vnl_vector< double > eVal( ImageDimension );
+  for( SizeValueType p = startPixel; p < endPixel; ++p )
+    {
+    FeatureValueType * pixelFeatures = str->Buffer
+      + p * str->NumberOfComponents;
+
+    for( unsigned int c = 0; c < str->ZeroComponents.size(); ++c )
+      {
+      pixelFeatures[ str->ZeroComponents[c] ] =
+        jet[0]->GetBufferPointer()[p];
+      }
+
+    if( str->FirstComponents.empty() && str->SecondComponents.empty()
+      && str->RidgeComponents.empty() )
+      {
+      continue;
+      }
+
+    // Express the Gaussian derivatives in the normalization used by
+    //   NJetImageFunction
+    for( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      d[i] = -scale2 * jet[1 + i]->GetBufferPointer()[p]
+        * str->DerivativeNorm[i];
+      }
+    for( unsigned int c = 0; c < str->FirstComponents.size(); ++c )
+      {
+      FeatureValueType * f = pixelFeatures + str->FirstComponents[c];
+      for( unsigned int i = 0; i < ImageDimension; ++i )
+        {
+        f[i] = d[i];
+        }
+      f[ImageDimension] = d.magnitude();
+      }
+
+    if( str->SecondComponents.empty() && str->RidgeComponents.empty() )
+      {
+      continue;
+      }
+
+    for( unsigned int i = 0; i < ImageDimension; ++i )
       {
-      featureCount = m_ZeroScales.size();
-      for( unsigned int s = 0; s < m_FirstScales.size(); s++ )
+      for( unsigned int j = i; j < ImageDimension; ++j )
         {
-        val = 0.0;
-        njet->DerivativeAtIndex( indx, m_FirstScales[s], v );
-        for( unsigned int d = 0; d < ImageDimension; d++ )
+        const double dij = jet[1 + ImageDimension + i * ImageDimension + j]
+          ->GetBufferPointer()[p];
+        if( i == j )
           {
-          if( featureCount == fNum )
-            {
-            return ( v[d] - fNumMean ) / fNumStdDev;
-            }
-          featureCount++;
-          val += v[d]*v[d];
+          h[i][i] = scale2 * dij * str->HessianNorm[i][i];
           }
-        if( featureCount == fNum )
+        else
           {
-          return ( std::sqrt( val ) - fNumMean ) / fNumStdDev;
+          h[i][j] = scale2 * scale2 * dij * str->HessianNorm[i][j];
+          h[j][i] = h[i][j];
           }
-        featureCount++;
         }
       }
-    else if( fNum < m_ZeroScales.size()
-      + m_FirstScales.size() * (ImageDimension + 1)
-      + m_SecondScales.size() * (ImageDimension + 1) )
+    for( unsigned int c = 0; c < str->SecondComponents.size(); ++c )
+      {
+      FeatureValueType * f = pixelFeatures + str->SecondComponents[c];
+      double val = 0;
+      for( unsigned int i = 0; i < ImageDimension; ++i )
+        {
+        f[i] = h[i][i];
+        val += h[i][i] * h[i][i];
+        }
+      f[ImageDimension] = std::sqrt( val );
+      }
+
+    if( !str->RidgeComponents.empty() )
       {
-      featureCount = m_ZeroScales.size()
-        + m_FirstScales.size() * (ImageDimension + 1);
-      for( unsigned int s = 0; s < m_SecondScales.size(); s++ )
+      double ridgeness = 0;
+      double roundness = 0;
+      double curvature = 0;
+      double levelness = 0;
+      ::tube::ComputeRidgeness< double >( h, d, prevTangent, ridgeness,
+        roundness, curvature, levelness, eVect, eVal );
+      for( unsigned int c = 0; c < str->RidgeComponents.size(); ++c )
         {
-        val = 0.0;
-        njet->HessianAtIndex( indx, m_SecondScales[s], m );
-        for( unsigned int d = 0; d < ImageDimension; d++ )
+        FeatureValueType * f = pixelFeatures + str->RidgeComponents[c];
+        f[0] = ridgeness;
+        f[1] = roundness;
+        f[2] = curvature;
+        f[3] = levelness;
+        }
+      }
+    }
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+template< class TImage >
+void
+NJetFeatureVectorGenerator< TImage >
+::UpdateDenseFeatures( void ) const
+{
+  const unsigned int numInputImages = this->GetNumberOfInputImages();
+
+  bool upToDate = m_DenseFeatureImage.IsNotNull()
+    && m_DenseFeatureInputs.size() == numInputImages;
+  for( unsigned int i = 0; upToDate && i < numInputImages; ++i )
+    {
+    upToDate = ( m_DenseFeatureInputs[i]
+      == this->m_InputImageList[i].GetPointer()
+      && m_DenseFeatureInputMTimes[i]
+      == this->m_InputImageList[i]->GetMTime() );
+    }
+  if( upToDate || numInputImages == 0 )
+    {
+    return;
+    }
+
+  const unsigned int numFeatures = this->GetNumberOfFeatures();
+  const unsigned int featuresPerImage = numFeatures / numInputImages;
+  const typename ImageType::RegionType region =
+    this->m_InputImageList[0]->GetLargestPossibleRegion();
+
+  m_DenseFeatureImage = FeatureVectorImageType::New();
+  m_DenseFeatureImage->CopyInformation( this->m_InputImageList[0] );
+  m_DenseFeatureImage->SetRegions( region );
+  m_DenseFeatureImage->SetNumberOfComponentsPerPixel( numFeatures );
+  m_DenseFeatureImage->Allocate();
+
+  // Each distinct scale is filtered once, to the highest order it needs
+  std::map< double, unsigned int > scaleOrder;
+  for( unsigned int s = 0; s < m_ZeroScales.size(); ++s )
+    {
+    scaleOrder[ m_ZeroScales[s] ] = 0;
+    }
+  for( unsigned int s = 0; s < m_FirstScales.size(); ++s )
+    {
+    scaleOrder[ m_FirstScales[s] ] = 1;
+    }
+  for( unsigned int s = 0; s < m_SecondScales.size(); ++s )
+    {
+    scaleOrder[ m_SecondScales[s] ] = 2;
+    }
+  for( unsigned int s = 0; s < m_RidgeScales.size(); ++s )
+    {
+    scaleOrder[ m_RidgeScales[s] ] = 2;
+    }
+
+  const typename ImageType::SpacingType spacing =
+    this->m_InputImageList[0]->GetSpacing();
+  // Same kernel support as the pointwise jet functions
+  this->PrepareNJetFunctions( 1 );
+  const double extent = m_ThreadNJetFunctions[0][0]->GetExtent();
+
+  const unsigned int firstOffset = m_ZeroScales.size();
+  const unsigned int secondOffset = firstOffset
+    + m_FirstScales.size() * ( ImageDimension + 1 );
+  const unsigned int ridgeOffset = secondOffset
+    + m_SecondScales.size() * ( ImageDimension + 1 );
+
+  DenseFeatureThreadStruct str;
+  str.Buffer = m_DenseFeatureImage->GetBufferPointer();
+  str.NumberOfComponents = numFeatures;
+  str.NumberOfPixels = region.GetNumberOfPixels();
+
+  MultiThreader::Pointer threader = MultiThreader::New();
+  threader->SetNumberOfThreads( this->GetNumberOfThreads() );
+
+  JetImageListType jet;
+  typename std::map< double, unsigned int >::const_iterator scaleIt;
+  for( scaleIt = scaleOrder.begin(); scaleIt != scaleOrder.end(); ++scaleIt )
+    {
+    const double scale = scaleIt->first;
+    str.Scale = scale;
+    str.Jet = &jet;
+
+    // Sums of the absolute sampled kernel weights that NJetImageFunction
+    //   divides by, relative to the sum of the Gaussian weights.
+    double gTotal = 0;
+    double dTotal[ImageDimension];
+    double hTotal[ImageDimension][ImageDimension];
+    for( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      dTotal[i] = 0;
+      for( unsigned int j = 0; j < ImageDimension; ++j )
+        {
+        hTotal[i][j] = 0;
+        }
+      }
+    IndexType xMax;
+    IndexType xShift;
+    for( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      xMax[i] = static_cast< long >( vnl_math_ceil( scale * extent
+        / spacing[i] ) );
+      xShift[i] = -xMax[i];
+      }
+    const double radiusSquared = ( scale * extent ) * ( scale * extent );
+    bool done = false;
+    while( !done )
+      {
+      double u[ImageDimension];
+      double physDist = 0;
+      for( unsigned int i = 0; i < ImageDimension; ++i )
+        {
+        u[i] = xShift[i] * spacing[i];
+        physDist += u[i] * u[i];
+        }
+      if( physDist <= radiusSquared )
+        {
+        const double g = std::exp( -0.5 * physDist / ( scale * scale ) );
+        gTotal += g;
+        for( unsigned int i = 0; i < ImageDimension; ++i )
           {
-          if( featureCount == fNum )
+          dTotal[i] += vnl_math_abs( u[i] ) * g;
+          hTotal[i][i] += vnl_math_abs( u[i] * u[i] / ( scale * scale )
+            - 1.0 ) * g;
+          for( unsigned int j = i + 1; j < ImageDimension; ++j )
             {
-            return ( m[d][d] - fNumMean ) / fNumStdDev;
+            hTotal[i][j] += vnl_math_abs( u[i] * u[j] ) * g;
             }
-          featureCount++;
-          val += m[d][d]*m[d][d];
           }
-        if( featureCount == fNum )
+        }
+      unsigned int i = 0;
+      ++xShift[i];
+      while( !done && xShift[i] > xMax[i] )
+        {
+        xShift[i] = -xMax[i];
+        ++i;
+        if( i < ImageDimension )
+          {
+          ++xShift[i];
+          }
+        else
           {
-          return ( std::sqrt( val ) - fNumMean ) / fNumStdDev;
+          done = true;
           }
-        featureCount++;
         }
       }
-    else
+    for( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      str.DerivativeNorm[i] = ( dTotal[i] > 0 ) ? gTotal / dTotal[i] : 0;
+      for( unsigned int j = i; j < ImageDimension; ++j )
+        {
+        str.HessianNorm[i][j] = ( hTotal[i][j] > 0 )
+          ? gTotal / hTotal[i][j] : 0;
+        }
+      }
+
+    for( unsigned int inputImageNum = 0; inputImageNum < numInputImages;
+      ++inputImageNum )
       {
-      featureCount = m_ZeroScales.size()
-        + m_FirstScales.size() * (ImageDimension + 1)
-        + m_SecondScales.size() * (ImageDimension + 1);
-      for( unsigned int s = 0; s < m_RidgeScales.size(); s++ )
+      const unsigned int base = inputImageNum * featuresPerImage;
+      str.ZeroComponents.clear();
+      str.FirstComponents.clear();
+      str.SecondComponents.clear();
+      str.RidgeComponents.clear();
+      for( unsigned int s = 0; s < m_ZeroScales.size(); ++s )
         {
-        if( featureCount == fNum )
+        if( m_ZeroScales[s] == scale )
           {
-          njet->RidgenessAtIndex( indx, m_RidgeScales[s] );
-          return ( njet->GetMostRecentRidgeness()
-            - fNumMean ) / fNumStdDev;
+          str.ZeroComponents.push_back( base + s );
           }
-        featureCount++;
-        if( featureCount == fNum )
+        }
+      for( unsigned int s = 0; s < m_FirstScales.size(); ++s )
+        {
+        if( m_FirstScales[s] == scale )
           {
-          njet->RidgenessAtIndex( indx, m_RidgeScales[s] );
-          return ( njet->GetMostRecentRidgeRoundness()
-            - fNumMean ) / fNumStdDev;
+          str.FirstComponents.push_back( base + firstOffset
+            + s * ( ImageDimension + 1 ) );
           }
-        featureCount++;
-        if( featureCount == fNum )
+        }
+      for( unsigned int s = 0; s < m_SecondScales.size(); ++s )
+        {
+        if( m_SecondScales[s] == scale )
           {
-          njet->RidgenessAtIndex( indx, m_RidgeScales[s] );
-          return ( njet->GetMostRecentRidgeCurvature()
-            - fNumMean ) / fNumStdDev;
+          str.SecondComponents.push_back( base + secondOffset
+            + s * ( ImageDimension + 1 ) );
           }
-        featureCount++;
-        if( featureCount == fNum )
+        }
+      for( unsigned int s = 0; s < m_RidgeScales.size(); ++s )
+        {
+        if( m_RidgeScales[s] == scale )
           {
-          njet->RidgenessAtIndex( indx, m_RidgeScales[s] );
-          return ( njet->GetMostRecentRidgeLevelness()
-            - fNumMean ) / fNumStdDev;
+          str.RidgeComponents.push_back( base + ridgeOffset + s * 4 );
           }
-        featureCount++;
         }
+
+      this->ComputeDenseJet( this->m_InputImageList[inputImageNum], scale,
+        scaleIt->second, jet );
+
+      threader->SetSingleMethod( this->DenseFeatureThreaderCallback, &str );
+      threader->SingleMethodExecute();
       }
+    jet.clear();
+    }
+
+  m_DenseFeatureInputs.resize( numInputImages );
+  m_DenseFeatureInputMTimes.resize( numInputImages );
+  for( unsigned int i = 0; i < numInputImages; ++i )
+    {
+    m_DenseFeatureInputs[i] = this->m_InputImageList[i].GetPointer();
+    m_DenseFeatureInputMTimes[i] = this->m_InputImageList[i]->GetMTime();
     }
-  itkExceptionMacro( << "Requested non-existent FeatureVectorValue." );
 }
 
 template< class TImage >
@@ -291,6 +835,7 @@ NJetFeatureVectorGenerator< TImage >
 ::SetZeroScales( const NJetScalesType & scales )
 {
   m_ZeroScales = scales;
+  m_DenseFeatureImage = NULL;
 }
 
 template< class TImage >
@@ -299,6 +844,7 @@ NJetFeatureVectorGenerator< TImage >
 ::SetFirstScales( const NJetScalesType & scales )
 {
   m_FirstScales = scales;
+  m_DenseFeatureImage = NULL;
 }
 
 template< class TImage >
@@ -307,6 +853,7 @@ NJetFeatureVectorGenerator< TImage >
 ::SetSecondScales( const NJetScalesType & scales )
 {
   m_SecondScales = scales;
+  m_DenseFeatureImage = NULL;
 }
 
 template< class TImage >
@@ -315,6 +862,7 @@ NJetFeatureVectorGenerator< TImage >
 ::SetRidgeScales( const NJetScalesType & scales )
 {
   m_RidgeScales = scales;
+  m_DenseFeatureImage = NULL;
 }
 
 template< class TImage >
@@ -364,6 +912,18 @@ NJetFeatureVectorGenerator< TImage >
     << std::endl;
   os << indent << "RidgeScales.size() = " << m_RidgeScales.size()
     << std::endl;
+  os << indent << "ThreadNJetFunctions.size() = "
+    << m_ThreadNJetFunctions.size() << std::endl;
+  os << indent << "UseDenseFeatures = " << m_UseDenseFeatures << std::endl;
+  if( m_DenseFeatureImage.IsNotNull() )
+    {
+    os << indent << "DenseFeatureImage = " << m_DenseFeatureImage
+      << std::endl;
+    }
+  else
+    {
+    os << indent << "DenseFeatureImage = NULL" << std::endl;
+    }
 }
 
 } // End namespace tube
@@ -30,7 +30,6 @@ limitations under the License.
 #include <itkImageRegionConstIterator.h>
 #include <itkImageRegionIteratorWithIndex.h>
 
-#include <vnl/algo/vnl_symmetric_eigensystem.h>
 
 namespace itk
 {
@@ -1304,13 +1303,15 @@ HessianAtContinuousIndex( const ContinuousIndexType & cIndex,
   if( m_UseProjection )
     {
     HessianAtContinuousIndex( cIndex, scale, m );
-    vnl_symmetric_eigensystem< double > eigSys( m.GetVnlMatrix() );
+    vnl_matrix_fixed<double, ImageDimension, ImageDimension> eVect;
+    vnl_vector_fixed<double, ImageDimension> eVal;
+    ::tube::ComputeSymmetricEigen( m.GetVnlMatrix(), eVect, eVal );
 
     double dp = 0;
     for( unsigned int i = 0; i < ImageDimension; i++ )
       {
-      dp += dot_product( v1.GetVnlVector(), eigSys.get_eigenvector( i ) )
-              * eigSys.get_eigenvalue( i );
+      dp += dot_product( v1.GetVnlVector(), eVect.get_column( i ) )
+              * eVal[i];
       }
 
     m.Fill( 0 );
@@ -1353,16 +1354,18 @@ HessianAtContinuousIndex( const ContinuousIndexType & cIndex,
   if( m_UseProjection )
     {
     HessianAtContinuousIndex( cIndex, scale, m );
-    vnl_symmetric_eigensystem< double > eigSys( m.GetVnlMatrix() );
+    vnl_matrix_fixed<double, ImageDimension, ImageDimension> eVect;
+    vnl_vector_fixed<double, ImageDimension> eVal;
+    ::tube::ComputeSymmetricEigen( m.GetVnlMatrix(), eVect, eVal );
 
     double dp0 = 0;
     double dp1 = 0;
     for( unsigned int i = 0; i < ImageDimension; i++ )
       {
-      dp0 += dot_product( v1.GetVnlVector(), eigSys.get_eigenvector( i ) )
-              * eigSys.get_eigenvalue( i );
-      dp1 += dot_product( v2.GetVnlVector(), eigSys.get_eigenvector( i ) )
-              * eigSys.get_eigenvalue( i );
+      dp0 += dot_product( v1.GetVnlVector(), eVect.get_column( i ) )
+              * eVal[i];
+      dp1 += dot_product( v2.GetVnlVector(), eVect.get_column( i ) )
+              * eVal[i];
       }
 
     m[0][0] = dp0;
@@ -1822,11 +1825,12 @@ RidgenessAtContinuousIndex( const ContinuousIndexType & cIndex,
   double roundness = 0;
   double curvature = 0;
   double levelness = 0;
-  vnl_matrix<double> eVect( ImageDimension, ImageDimension );
-  vnl_vector<double> eVal( ImageDimension );
+  vnl_matrix_fixed<double, ImageDimension, ImageDimension> eVect;
+  vnl_vector_fixed<double, ImageDimension> eVal;
   vnl_vector<double> prevTangent;
-  ::tube::ComputeRidgeness<double>( h.GetVnlMatrix(), d.GetVnlVector(), prevTangent,
-    ridgeness, roundness, curvature, levelness,
+  ::tube::ComputeRidgeness( h.GetVnlMatrix(),
+    vnl_vector_fixed<double, ImageDimension>( d.GetDataPointer() ),
+    prevTangent, ridgeness, roundness, curvature, levelness,
     eVect, eVal );
 
   m_MostRecentIntensity = intensity;
@@ -1834,8 +1838,10 @@ RidgenessAtContinuousIndex( const ContinuousIndexType & cIndex,
   m_MostRecentRidgeRoundness = roundness;
   m_MostRecentRidgeCurvature = curvature;
   m_MostRecentRidgeLevelness = levelness;
-  m_MostRecentRidgeTangent.SetVnlVector( eVect.get_column(
-    ImageDimension-1 ) );
+  for( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    m_MostRecentRidgeTangent[i] = eVect( i, ImageDimension-1 );
+    }
 
   return m_MostRecentRidgeness;
 }
@@ -1856,9 +1862,9 @@ RidgenessAtContinuousIndex( const ContinuousIndexType & cIndex,
 
   val = JetAtContinuousIndex( cIndex, d, h, scale );
 
-  vnl_symmetric_eigensystem< double > eigSys( h.GetVnlMatrix() );
-
-  assert( eigSys.get_eigenvalue(0 ) <= eigSys.get_eigenvalue(1 ) );
+  vnl_matrix_fixed<double, ImageDimension, ImageDimension> eVect;
+  vnl_vector_fixed<double, ImageDimension> eVal;
+  ::tube::ComputeSymmetricEigen( h.GetVnlMatrix(), eVect, eVal );
 
   if( d.GetNorm() != 0 )
     {
@@ -1866,7 +1872,10 @@ RidgenessAtContinuousIndex( const ContinuousIndexType & cIndex,
     }
   else
     {
-    d.SetVnlVector( eigSys.get_eigenvector( ImageDimension-1 ) );
+    for( unsigned int i = 0; i < ImageDimension; i++ )
+      {
+      d[i] = eVect( i, ImageDimension-1 );
+      }
     }
 
   for( unsigned int i = 0; i < ImageDimension; i++ )
@@ -1875,14 +1884,14 @@ RidgenessAtContinuousIndex( const ContinuousIndexType & cIndex,
     double dp = 0;
     for( unsigned int j=0; j<ImageDimension; j++ )
       {
-      dp += eigSys.get_eigenvector( i )[j] * v1[j];
+      dp += eVect( j, i ) * v1[j];
       }
     dp = vnl_math_abs( dp );
     for( unsigned int j=0; j<ImageDimension; j++ )
       {
-      p[i] += dp * eigSys.get_eigenvector( i )[j] * d[j];
+      p[i] += dp * eVect( j, i ) * d[j];
       }
-    vv[i] = dp * eigSys.get_eigenvalue( i );
+    vv[i] = dp * eVal[i];
     }
 
   double sums = 0;
@@ -1926,9 +1935,9 @@ RidgenessAtContinuousIndex( const ContinuousIndexType & cIndex,
 
   val = JetAtContinuousIndex( cIndex, d, h, scale );
 
-  vnl_symmetric_eigensystem< double > eigSys( h.GetVnlMatrix() );
-
-  assert( eigSys.get_eigenvalue(0 ) <= eigSys.get_eigenvalue(1 ) );
+  vnl_matrix_fixed<double, ImageDimension, ImageDimension> eVect;
+  vnl_vector_fixed<double, ImageDimension> eVal;
+  ::tube::ComputeSymmetricEigen( h.GetVnlMatrix(), eVect, eVal );
 
   if( d.GetNorm() != 0 )
     {
@@ -1936,7 +1945,10 @@ RidgenessAtContinuousIndex( const ContinuousIndexType & cIndex,
     }
   else
     {
-    d.SetVnlVector( eigSys.get_eigenvector( ImageDimension-1 ) );
+    for( unsigned int i = 0; i < ImageDimension; i++ )
+      {
+      d[i] = eVect( i, ImageDimension-1 );
+      }
     }
 
   for( unsigned int i = 0; i < ImageDimension; i++ )
@@ -1945,25 +1957,25 @@ RidgenessAtContinuousIndex( const ContinuousIndexType & cIndex,
     double dp = 0;
     for( unsigned int j=0; j<ImageDimension; j++ )
       {
-      dp += eigSys.get_eigenvector( i )[j] * v1[j];
+      dp += eVect( j, i ) * v1[j];
       }
     dp = vnl_math_abs( dp );
     for( unsigned int j=0; j<ImageDimension; j++ )
       {
-      p[i] += dp * eigSys.get_eigenvector( i )[j] * d[j];
+      p[i] += dp * eVect( j, i ) * d[j];
       }
-    vv[i] = dp * eigSys.get_eigenvalue( i );
+    vv[i] = dp * eVal[i];
     dp = 0;
     for( unsigned int j=0; j<ImageDimension; j++ )
       {
-      dp += eigSys.get_eigenvector( i )[j] * v2[j];
+      dp += eVect( j, i ) * v2[j];
       }
     dp = vnl_math_abs( dp );
     for( unsigned int j=0; j<ImageDimension; j++ )
       {
-      p[i] += dp * eigSys.get_eigenvector( i )[j] * d[j];
+      p[i] += dp * eVect( j, i ) * d[j];
       }
-    vv[i] += dp * eigSys.get_eigenvalue( i );
+    vv[i] += dp * eVal[i];
     }
 
   double sums = 0;
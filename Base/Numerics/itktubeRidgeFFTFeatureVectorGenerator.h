@@ -91,6 +91,9 @@ public:
   virtual typename FeatureImageType::Pointer GetFeatureImage(
     unsigned int fNum ) const;
 
+  /** Compute the feature images.  The features of every scale are
+   *  outputs, so one image per feature and scale is kept: memory grows
+   *  with the number of scales. */
   virtual void Update( void );
 
   itkSetMacro( UseIntensityOnly, bool );
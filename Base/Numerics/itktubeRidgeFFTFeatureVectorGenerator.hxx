@@ -139,65 +139,77 @@ RidgeFFTFeatureVectorGenerator< TImage >
 
     ridgeF->SetUseIntensityOnly( false );
 
+    // The optimal-scale features are updated as each scale is computed,
+    //   so no scale's images need to be revisited afterwards
+    typename FeatureImageType::RegionType region =
+      this->m_InputImageList[0]->GetLargestPossibleRegion();
+    const unsigned int foScale = numFeatures - numFeaturesPerScale - 1;
+    const unsigned int foFeat = numFeatures - numFeaturesPerScale;
+    for( unsigned int f=foScale; f<numFeatures; ++f )
+      {
+      m_FeatureImageList[f] = FeatureImageType::New();
+      m_FeatureImageList[f]->CopyInformation( this->m_InputImageList[0] );
+      m_FeatureImageList[f]->SetRegions( region );
+      m_FeatureImageList[f]->Allocate();
+      }
+
+    typedef ImageRegionIterator< FeatureImageType >  IterType;
+    std::vector< IterType > iterF( numFeaturesPerScale );
+    std::vector< IterType > iterFO( numFeaturesPerScale );
+
     // compute intensity, ridgeness, roundness, curvature,
-    // and levelness features (in that order) for each scale
+    // and levelness features (in that order) for each scale.
+    // The same ridge filter is reused for every scale, so the spectrum
+    // of the input image is only computed once.
     unsigned int feat = 0;
     for( unsigned int s=0; s<m_Scales.size(); ++s )
       {
       ridgeF->SetScale( m_Scales[s] );
       ridgeF->Update();
 
+      const unsigned int scaleFeat = feat;
       m_FeatureImageList[feat++] = ridgeF->GetIntensity();
       m_FeatureImageList[feat++] = ridgeF->GetRidgeness();
       m_FeatureImageList[feat++] = ridgeF->GetRoundness();
       m_FeatureImageList[feat++] = ridgeF->GetCurvature();
       m_FeatureImageList[feat++] = ridgeF->GetLevelness();
-      }
 
-    typename FeatureImageType::RegionType region =
-      this->m_InputImageList[0]->GetLargestPossibleRegion();
-    while( feat < numFeatures )
-      {
-      m_FeatureImageList[feat] = FeatureImageType::New();
-      m_FeatureImageList[feat]->CopyInformation( this->m_InputImageList[0] );
-      m_FeatureImageList[feat]->SetRegions( region );
-      m_FeatureImageList[feat]->Allocate();
-      ++feat;
-      }
-
-    typedef ImageRegionIterator< FeatureImageType >  IterType;
-    std::vector< IterType > iterF( numFeatures );
-    for( unsigned int f=0; f<numFeatures; ++f )
-      {
-      iterF[f] = IterType( m_FeatureImageList[f], region );
-      }
-    unsigned int foScale = numFeatures - numFeaturesPerScale - 1;
-    unsigned int foFeat = numFeatures - numFeaturesPerScale;
-    while( !iterF[0].IsAtEnd() )
-      {
       for( unsigned int f=0; f<numFeaturesPerScale; ++f )
         {
-        iterF[ foFeat + f ].Set( iterF[ f ].Get() );
+        iterF[f] = IterType( m_FeatureImageList[ scaleFeat + f ], region );
+        iterFO[f] = IterType( m_FeatureImageList[ foFeat + f ], region );
         }
-      iterF[ foScale ].Set( m_Scales[ 0 ] );
-      for( unsigned int s=1; s<m_Scales.size(); ++s )
+      IterType iterFOScale( m_FeatureImageList[ foScale ], region );
+      while( !iterFOScale.IsAtEnd() )
         {
-        feat = s * numFeaturesPerScale;
-        for( unsigned int f=0; f<numFeaturesPerScale; ++f )
+        if( s == 0 )
           {
-          if( iterF[ feat + f ].Get() > iterF[ foFeat + f ].Get() )
+          for( unsigned int f=0; f<numFeaturesPerScale; ++f )
             {
-            iterF[ foFeat + f ].Set( iterF[ feat + f ].Get() );
-            if( f == featureForOptimalScale )
+            iterFO[ f ].Set( iterF[ f ].Get() );
+            }
+          iterFOScale.Set( m_Scales[ 0 ] );
+          }
+        else
+          {
+          for( unsigned int f=0; f<numFeaturesPerScale; ++f )
+            {
+            if( iterF[ f ].Get() > iterFO[ f ].Get() )
               {
-              iterF[ foScale ].Set( m_Scales[ s ] );
+              iterFO[ f ].Set( iterF[ f ].Get() );
+              if( f == featureForOptimalScale )
+                {
+                iterFOScale.Set( m_Scales[ s ] );
+                }
               }
             }
           }
-        }
-      for( unsigned int f=0; f<numFeatures; ++f )
-        {
-        ++iterF[ f ];
+        for( unsigned int f=0; f<numFeaturesPerScale; ++f )
+          {
+          ++iterF[ f ];
+          ++iterFO[ f ];
+          }
+        ++iterFOScale;
         }
       }
     }
@@ -27,6 +27,8 @@ limitations under the License.
 #include "tubeMacro.h"
 
 #include <vnl/vnl_math.h>
+#include <vnl/vnl_matrix_fixed.h>
+#include <vnl/vnl_vector_fixed.h>
 #include <vnl/vnl_vector_ref.h>
 
 #define EIGEN_MAX_ITERATIONS 100
@@ -75,6 +77,20 @@ ComputeRidgeness( const vnl_matrix<T> & H,
   double & linearity,
   vnl_matrix<T> & HEVect, vnl_vector<T> & HEVal );
 
+/** Compute Ridgeness measures of a fixed-size Hessian.
+ *  Does not allocate, so it can be called per voxel from many threads. */
+template< class T, unsigned int VDimension >
+void
+ComputeRidgeness( const vnl_matrix_fixed<T, VDimension, VDimension> & H,
+  const vnl_vector_fixed<T, VDimension> & D,
+  const vnl_vector<T> & prevTangent,
+  double & ridgeness,
+  double & roundness,
+  double & curvature,
+  double & linearity,
+  vnl_matrix_fixed<T, VDimension, VDimension> & HEVect,
+  vnl_vector_fixed<T, VDimension> & HEVal );
+
 /** Compute eigenvalues and vectors  */
 template< class T >
 void
@@ -94,6 +110,17 @@ void
 ComputeEigen(vnl_matrix<T> const & mat, vnl_matrix<T> &eVects,
   vnl_vector<T> &eVals, bool orderByAbs = false, bool minToMax = true );
 
+/** Compute eigenvalues and vectors of a small, fixed-size symmetric
+ *  matrix using cyclic Jacobi rotations.  A 2x2 matrix is solved by a
+ *  single rotation.  The input must be symmetric.  Does not allocate. */
+template< class T, unsigned int VDimension >
+void
+ComputeSymmetricEigen(
+  vnl_matrix_fixed<T, VDimension, VDimension> const & mat,
+  vnl_matrix_fixed<T, VDimension, VDimension> & eVects,
+  vnl_vector_fixed<T, VDimension> & eVals,
+  bool orderByAbs = false, bool minToMax = true );
+
 } // End namespace tube
 
 
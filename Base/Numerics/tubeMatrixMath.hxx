@@ -31,6 +31,8 @@ limitations under the License.
 #include <vnl/algo/vnl_cholesky.h>
 #include <vnl/algo/vnl_matrix_inverse.h>
 
+#include <limits>
+
 namespace tube
 {
 
@@ -130,24 +132,22 @@ ComputeEuclideanDistance( TPoint x, TPoint y )
   return std::sqrt(s);
 }
 
-template< class T >
+/**
+ * Compute the ridgeness measures from the eigen system of the Hessian.
+ * HEVect and HEVal must be ordered by decreasing absolute eigenvalue.
+ * Used by both the dynamic and the fixed-size ComputeRidgeness. */
+template< class T, class TMatrix, class TVector >
 void
-ComputeRidgeness( const vnl_matrix<T> & H,
-  const vnl_vector<T> & D,
+ComputeRidgenessFromEigen( unsigned int ImageDimension,
+  const TVector & D,
   const vnl_vector<T> & prevTangent,
   double & ridgeness,
   double & roundness,
   double & curvature,
   double & levelness,
-  vnl_matrix<T> & HEVect, vnl_vector<T> & HEVal )
+  TMatrix & HEVect, TVector & HEVal )
 {
-  unsigned int ImageDimension = D.size();
-
-  vnl_matrix<T> HSym( H );
-  ::tube::FixMatrixSymmetry( HSym );
-  ::tube::ComputeEigen( HSym, HEVect, HEVal, true, false );
-
-  vnl_vector<T> Dv = D;
+  TVector Dv( D );
   if( Dv.magnitude() > 0 )
     {
     Dv.normalize();
@@ -167,8 +167,12 @@ ComputeRidgeness( const vnl_matrix<T> & H,
     double closestVDProd = 0;
     for( unsigned int i=0; i<ImageDimension; i++ )
       {
-      double dProd = vnl_math_abs( dot_product( prevTangent,
-        HEVect.get_column(i) ) );
+      double dProd = 0;
+      for( unsigned int r=0; r<ImageDimension; r++ )
+        {
+        dProd += prevTangent[r] * HEVect( r, i );
+        }
+      dProd = vnl_math_abs( dProd );
       if( dProd > closestVDProd )
         {
         closestV = i;
@@ -179,21 +183,26 @@ ComputeRidgeness( const vnl_matrix<T> & H,
       {
       std::cout << "***********Mixing things up: Chosen t=evect#"
         << closestV << " dotProd = " << closestVDProd << std::endl;
-      double tf = HEVal[closestV];
+      T tf = HEVal[closestV];
       HEVal[closestV] = HEVal[ImageDimension-1];
       HEVal[ImageDimension-1] = tf;
-      vnl_vector< double > tv;
-      tv = HEVect.get_column( closestV );
-      HEVect.set_column( closestV, HEVect.get_column( ImageDimension-1 ) );
-      HEVect.set_column( ImageDimension-1, tv );
+      for( unsigned int r=0; r<ImageDimension; r++ )
+        {
+        tf = HEVect( r, closestV );
+        HEVect( r, closestV ) = HEVect( r, ImageDimension-1 );
+        HEVect( r, ImageDimension-1 ) = tf;
+        }
+      }
+    double dProd = 0;
+    for( unsigned int r=0; r<ImageDimension; r++ )
+      {
+      dProd += prevTangent[r] * HEVect( r, ImageDimension-1 );
       }
-    if( dot_product( prevTangent, HEVect.get_column( ImageDimension-1 ) )
-      < 0 )
+    if( dProd < 0 )
       {
-      for( unsigned int i=0; i<ImageDimension-1; ++i )
+      for( unsigned int r=0; r<ImageDimension; r++ )
         {
-        HEVect.get_column( ImageDimension-1 )[i] = -1 * HEVect.get_column(
-          ImageDimension-1 )[i];
+        HEVect( r, ImageDimension-1 ) = -HEVect( r, ImageDimension-1 );
         }
       }
     }
@@ -203,7 +212,11 @@ ComputeRidgeness( const vnl_matrix<T> & H,
   int ridge = 1;
   for( unsigned int i=0; i<ImageDimension-1; i++ )
     {
-    double dProd = dot_product( Dv, HEVect.get_column( i ) );
+    double dProd = 0;
+    for( unsigned int r=0; r<ImageDimension; r++ )
+      {
+      dProd += Dv[r] * HEVect( r, i );
+      }
     sump += dProd * dProd;
 
     double tf = HEVal[i];
@@ -266,6 +279,98 @@ ComputeRidgeness( const vnl_matrix<T> & H,
     }
 }
 
+/**
+ * Compute the ridgeness of a dynamic-size Hessian using the fixed-size
+ * solver, copying the results back into the dynamic containers. */
+template< class T, unsigned int VDimension >
+void
+ComputeRidgenessUsingFixedSize( const vnl_matrix<T> & H,
+  const vnl_vector<T> & D,
+  const vnl_vector<T> & prevTangent,
+  double & ridgeness,
+  double & roundness,
+  double & curvature,
+  double & levelness,
+  vnl_matrix<T> & HEVect, vnl_vector<T> & HEVal )
+{
+  vnl_matrix_fixed<T, VDimension, VDimension> HFixed( H.data_block() );
+  vnl_vector_fixed<T, VDimension> DFixed( D.data_block() );
+  vnl_matrix_fixed<T, VDimension, VDimension> HEVectFixed;
+  vnl_vector_fixed<T, VDimension> HEValFixed;
+
+  ::tube::ComputeRidgeness( HFixed, DFixed, prevTangent, ridgeness,
+    roundness, curvature, levelness, HEVectFixed, HEValFixed );
+
+  HEVect.set_size( VDimension, VDimension );
+  HEVect.copy_in( HEVectFixed.data_block() );
+  HEVal.set_size( VDimension );
+  HEVal.copy_in( HEValFixed.data_block() );
+}
+
+template< class T >
+void
+ComputeRidgeness( const vnl_matrix<T> & H,
+  const vnl_vector<T> & D,
+  const vnl_vector<T> & prevTangent,
+  double & ridgeness,
+  double & roundness,
+  double & curvature,
+  double & levelness,
+  vnl_matrix<T> & HEVect, vnl_vector<T> & HEVal )
+{
+  unsigned int ImageDimension = D.size();
+
+  switch( ImageDimension )
+    {
+    case 2:
+      ComputeRidgenessUsingFixedSize< T, 2 >( H, D, prevTangent,
+        ridgeness, roundness, curvature, levelness, HEVect, HEVal );
+      break;
+    case 3:
+      ComputeRidgenessUsingFixedSize< T, 3 >( H, D, prevTangent,
+        ridgeness, roundness, curvature, levelness, HEVect, HEVal );
+      break;
+    default:
+      {
+      vnl_matrix<T> HSym( H );
+      ::tube::FixMatrixSymmetry( HSym );
+      ::tube::ComputeEigen( HSym, HEVect, HEVal, true, false );
+
+      ComputeRidgenessFromEigen< T >( ImageDimension, D, prevTangent,
+        ridgeness, roundness, curvature, levelness, HEVect, HEVal );
+      break;
+      }
+    }
+}
+
+template< class T, unsigned int VDimension >
+void
+ComputeRidgeness( const vnl_matrix_fixed<T, VDimension, VDimension> & H,
+  const vnl_vector_fixed<T, VDimension> & D,
+  const vnl_vector<T> & prevTangent,
+  double & ridgeness,
+  double & roundness,
+  double & curvature,
+  double & levelness,
+  vnl_matrix_fixed<T, VDimension, VDimension> & HEVect,
+  vnl_vector_fixed<T, VDimension> & HEVal )
+{
+  vnl_matrix_fixed<T, VDimension, VDimension> HSym;
+  for( unsigned int r=0; r<VDimension; ++r )
+    {
+    HSym( r, r ) = H( r, r );
+    for( unsigned int c=r+1; c<VDimension; ++c )
+      {
+      HSym( r, c ) = ( H( r, c ) + H( c, r ) ) / 2;
+      HSym( c, r ) = HSym( r, c );
+      }
+    }
+  ::tube::ComputeSymmetricEigen( HSym, HEVect, HEVal, true, false );
+
+  ComputeRidgenessFromEigen< T >( VDimension, D, prevTangent,
+    ridgeness, roundness, curvature, levelness, HEVect, HEVal );
+}
+
 /**
  * Compute eigenvalues and vectors from ( W.inv() * B ) */
 template< class T >
@@ -602,6 +707,136 @@ ComputeEigen( vnl_matrix<T> const & mat,
     }
 }
 
+/**
+ * Compute eigenvalues and vectors of a fixed-size symmetric matrix */
+template< class T, unsigned int VDimension >
+void
+ComputeSymmetricEigen(
+  vnl_matrix_fixed<T, VDimension, VDimension> const & mat,
+  vnl_matrix_fixed<T, VDimension, VDimension> & eVects,
+  vnl_vector_fixed<T, VDimension> & eVals,
+  bool orderByAbs, bool minToMax )
+{
+  T a[VDimension][VDimension];
+  for( unsigned int r=0; r<VDimension; ++r )
+    {
+    for( unsigned int c=0; c<VDimension; ++c )
+      {
+      a[r][c] = mat( r, c );
+      eVects( r, c ) = ( r == c ) ? 1 : 0;
+      }
+    }
+
+  // Cyclic Jacobi: each rotation zeros one off-diagonal pair and the
+  //   off-diagonal mass converges quadratically, so a few sweeps suffice
+  for( unsigned int sweep=0; sweep<EIGEN_MAX_ITERATIONS; ++sweep )
+    {
+    T diagSum = 0;
+    T offDiagSum = 0;
+    for( unsigned int p=0; p<VDimension; ++p )
+      {
+      diagSum += vnl_math_abs( a[p][p] );
+      for( unsigned int q=p+1; q<VDimension; ++q )
+        {
+        offDiagSum += vnl_math_abs( a[p][q] );
+        }
+      }
+    if( offDiagSum == 0
+      || offDiagSum <= std::numeric_limits<T>::epsilon() * diagSum )
+      {
+      break;
+      }
+
+    for( unsigned int p=0; p<VDimension-1; ++p )
+      {
+      for( unsigned int q=p+1; q<VDimension; ++q )
+        {
+        const T apq = a[p][q];
+        if( apq == 0 )
+          {
+          continue;
+          }
+        const T theta = ( a[q][q] - a[p][p] ) / ( 2 * apq );
+        const T absTheta = vnl_math_abs( theta );
+        T t;
+        if( absTheta > 1 )
+          {
+          t = 1 / ( absTheta
+            * ( 1 + std::sqrt( 1 + 1 / ( theta * theta ) ) ) );
+          }
+        else
+          {
+          t = 1 / ( absTheta + std::sqrt( theta * theta + 1 ) );
+          }
+        if( theta < 0 )
+          {
+          t = -t;
+          }
+        const T c = 1 / std::sqrt( t * t + 1 );
+        const T s = t * c;
+
+        a[p][p] -= t * apq;
+        a[q][q] += t * apq;
+        a[p][q] = 0;
+        a[q][p] = 0;
+        for( unsigned int r=0; r<VDimension; ++r )
+          {
+          if( r != p && r != q )
+            {
+            const T arp = a[r][p];
+            const T arq = a[r][q];
+            a[r][p] = c * arp - s * arq;
+            a[p][r] = a[r][p];
+            a[r][q] = s * arp + c * arq;
+            a[q][r] = a[r][q];
+            }
+          const T vrp = eVects( r, p );
+          const T vrq = eVects( r, q );
+          eVects( r, p ) = c * vrp - s * vrq;
+          eVects( r, q ) = s * vrp + c * vrq;
+          }
+        }
+      }
+    }
+
+  for( unsigned int d=0; d<VDimension; ++d )
+    {
+    eVals[d] = a[d][d];
+    }
+
+  for( unsigned int i=0; i<VDimension-1; i++ )
+    {
+    for( unsigned int j=i+1; j<VDimension; j++ )
+      {
+      bool swap;
+      if( orderByAbs )
+        {
+        swap = ( vnl_math_abs( eVals[j] ) > vnl_math_abs( eVals[i] )
+          && !minToMax )
+          || ( vnl_math_abs( eVals[j] ) < vnl_math_abs( eVals[i] )
+          && minToMax );
+        }
+      else
+        {
+        swap = ( eVals[j] > eVals[i] && !minToMax )
+          || ( eVals[j] < eVals[i] && minToMax );
+        }
+      if( swap )
+        {
+        T tf = eVals[j];
+        eVals[j] = eVals[i];
+        eVals[i] = tf;
+        for( unsigned int r=0; r<VDimension; r++ )
+          {
+          tf = eVects( r, j );
+          eVects( r, j ) = eVects( r, i );
+          eVects( r, i ) = tf;
+          }
+        }
+      }
+    }
+}
+
 } // End namespace tube
 
 #endif // End !defined(__tubeMatrixMath_hxx)
@@ -259,6 +259,7 @@ SmoothTube( const typename TTube::Pointer & tube, double h,
     {
     return newTube;
     }
+  newPointList.reserve( pointList.size() );
 
   std::vector< double > w;
   int wSize = 0;
@@ -0,0 +1,132 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright 2010 Kitware Inc. 28 Corporate Drive,
+Clifton Park, NY, 12065, USA.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "itkImageToImageRegistrationHelper.h"
+
+#include <itkImageRegionIteratorWithIndex.h>
+
+#include <cmath>
+
+namespace
+{
+
+typedef itk::Image< float, 2 > HelperTestImageType;
+
+// A Gaussian blob, wide enough to survive shrinking by 4
+HelperTestImageType::Pointer CreateBlobImage( double centerX,
+  double centerY )
+{
+  HelperTestImageType::SizeType size;
+  size.Fill( 64 );
+  HelperTestImageType::Pointer image = HelperTestImageType::New();
+  image->SetRegions( size );
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex< HelperTestImageType > it( image,
+    image->GetLargestPossibleRegion() );
+  while( !it.IsAtEnd() )
+    {
+    const double dx = it.GetIndex()[0] - centerX;
+    const double dy = it.GetIndex()[1] - centerY;
+    it.Set( static_cast< float >(
+      100.0 * std::exp( -0.5 * ( dx * dx + dy * dy ) / 36.0 ) ) );
+    ++it;
+    }
+  return image;
+}
+
+} // End namespace
+
+int itkImageToImageRegistrationHelperTest( int itkNotUsed( argc ),
+  char * itkNotUsed( argv )[] )
+{
+  typedef itk::ImageToImageRegistrationHelper< HelperTestImageType >
+    RegistrationType;
+
+  RegistrationType::Pointer reger = RegistrationType::New();
+
+  // Zero is not a shrink factor
+  RegistrationType::ShrinkFactorsListType shrinkFactors;
+  shrinkFactors.push_back( 2 );
+  shrinkFactors.push_back( 0 );
+  bool caught = false;
+  try
+    {
+    reger->SetRigidShrinkFactors( shrinkFactors );
+    }
+  catch( itk::ExceptionObject & )
+    {
+    caught = true;
+    }
+  if( !caught )
+    {
+    std::cerr << "A zero shrink factor was accepted." << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The moving blob is the fixed one moved by ( 3, -2 )
+  reger->SetFixedImage( CreateBlobImage( 32, 32 ) );
+  reger->SetMovingImage( CreateBlobImage( 35, 30 ) );
+  reger->SetRandomNumberSeed( 1 );
+  reger->SetEnableInitialRegistration( false );
+  reger->SetEnableAffineRegistration( false );
+  reger->SetEnableBSplineRegistration( false );
+  reger->SetUseEvolutionaryOptimization( false );
+  reger->SetRigidSamplingRatio( 0.5 );
+  reger->SetRigidMetricMethodEnum(
+    RegistrationType::OptimizedRegistrationMethodType
+    ::MEAN_SQUARED_ERROR_METRIC );
+
+  shrinkFactors.clear();
+  shrinkFactors.push_back( 4 );
+  shrinkFactors.push_back( 2 );
+  shrinkFactors.push_back( 1 );
+  reger->SetRigidShrinkFactors( shrinkFactors );
+
+  try
+    {
+    reger->Initialize();
+    reger->Update();
+    }
+  catch( itk::ExceptionObject & e )
+    {
+    std::cerr << "Exception caught during registration:\n" << e
+      << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  RegistrationType::PointType fixedCenter;
+  fixedCenter[0] = 32;
+  fixedCenter[1] = 32;
+  const RegistrationType::PointType movingCenter =
+    reger->GetCurrentMatrixTransform()->TransformPoint( fixedCenter );
+  std::cout << "Fixed center maps to " << movingCenter << std::endl;
+  if( std::fabs( movingCenter[0] - 35 ) > 0.5
+    || std::fabs( movingCenter[1] - 30 ) > 0.5 )
+    {
+    std::cerr << "Expected ( 35, 30 )." << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
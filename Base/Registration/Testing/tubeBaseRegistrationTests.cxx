@@ -36,6 +36,7 @@ void RegisterTests( void )
   REGISTER_TEST( itkAnisotropicDiffusiveRegistrationGenerateTestingImages );
   REGISTER_TEST( itkAnisotropicDiffusiveRegistrationRegularizationTest );
 #endif
+  REGISTER_TEST( itkImageToImageRegistrationHelperTest );
   REGISTER_TEST( itktubeImageToTubeRigidMetricPerformanceTest );
   REGISTER_TEST( itktubeImageToTubeRigidMetricTest );
   REGISTER_TEST( itktubeImageToTubeRigidRegistrationPerformanceTest );
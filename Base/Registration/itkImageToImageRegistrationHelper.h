@@ -121,6 +121,8 @@ public:
   typedef typename BSplineRegistrationMethodType::TransformType
   BSplineTransformType;
 
+  typedef std::vector<unsigned int> ShrinkFactorsListType;
+
   //
   // Custom Methods
   //
@@ -381,6 +383,13 @@ public:
   itkSetMacro( RigidInterpolationMethodEnum, InterpolationMethodEnumType );
   itkGetConstMacro( RigidInterpolationMethodEnum, InterpolationMethodEnumType );
 
+  // Coarse-to-fine schedule, e.g., 4 2 1: the rigid stage is run on the
+  //   images shrunk by each factor in turn, starting each level from the
+  //   transform of the previous one.  Empty (the default) is the same as 1.
+  //   Throws if a factor is zero.
+  void SetRigidShrinkFactors( const ShrinkFactorsListType & factors );
+  itkGetConstReferenceMacro( RigidShrinkFactors, ShrinkFactorsListType );
+
   itkGetConstObjectMacro( RigidTransform, RigidTransformType );
   itkGetMacro( RigidMetricValue, double );
 
@@ -402,6 +411,9 @@ public:
   itkSetMacro( AffineInterpolationMethodEnum, InterpolationMethodEnumType );
   itkGetConstMacro( AffineInterpolationMethodEnum, InterpolationMethodEnumType );
 
+  void SetAffineShrinkFactors( const ShrinkFactorsListType & factors );
+  itkGetConstReferenceMacro( AffineShrinkFactors, ShrinkFactorsListType );
+
   itkGetConstObjectMacro( AffineTransform, AffineTransformType );
   itkGetMacro( AffineMetricValue, double );
 
@@ -439,6 +451,17 @@ protected:
 
   void PrintSelf( std::ostream & os, Indent indent ) const;
 
+  // Shrink an image by an integer factor, averaging the pixels that
+  //   are merged.  Returns the image itself when factor <= 1.
+  typename TImage::ConstPointer ShrinkImage( const TImage * image,
+    unsigned int factor ) const;
+
+  // Run one level of the rigid or affine coarse-to-fine schedule on the
+  //   images shrunk by shrinkFactor, starting from and updating the
+  //   current matrix transform.
+  void RegisterRigidLevel( unsigned int shrinkFactor, bool firstLevel );
+  void RegisterAffineLevel( unsigned int shrinkFactor, bool firstLevel );
+
 private:
 
   typedef typename InitialRegistrationMethodType::LandmarkPointType
@@ -528,6 +551,7 @@ private:
   double       m_RigidSamplingRatio;
   double       m_RigidTargetError;
   unsigned int m_RigidMaxIterations;
+  ShrinkFactorsListType m_RigidShrinkFactors;
 
   typename RigidTransformType::Pointer    m_RigidTransform;
   MetricMethodEnumType                    m_RigidMetricMethodEnum;
@@ -539,6 +563,7 @@ private:
   double       m_AffineSamplingRatio;
   double       m_AffineTargetError;
   unsigned int m_AffineMaxIterations;
+  ShrinkFactorsListType m_AffineShrinkFactors;
 
   typename AffineTransformType::Pointer   m_AffineTransform;
   MetricMethodEnumType                    m_AffineMetricMethodEnum;
@@ -34,6 +34,7 @@
 #include "itkSubtractImageFilter.h"
 #include "itkMinimumMaximumImageCalculator.h"
 #include "itkVector.h"
+#include "itktubeShrinkWithBlendingImageFilter.h"
 
 namespace itk
 {
@@ -118,6 +119,7 @@ ImageToImageRegistrationHelper<TImage>
   m_RigidSamplingRatio = 0.01;
   m_RigidTargetError = 0.0001;
   m_RigidMaxIterations = 100;
+  m_RigidShrinkFactors.clear();
   m_RigidTransform = NULL;
   m_RigidMetricMethodEnum =
     OptimizedRegistrationMethodType::MATTES_MI_METRIC;
@@ -129,6 +131,7 @@ ImageToImageRegistrationHelper<TImage>
   m_AffineSamplingRatio = 0.02;
   m_AffineTargetError = 0.0001;
   m_AffineMaxIterations = 50;
+  m_AffineShrinkFactors.clear();
   m_AffineTransform = NULL;
   m_AffineMetricMethodEnum =
     OptimizedRegistrationMethodType::MATTES_MI_METRIC;
@@ -435,133 +438,20 @@ ImageToImageRegistrationHelper<TImage>
       std::cout << "*** RIGID REGISTRATION ***" << std::endl;
       }
 
-    typename RigidRegistrationMethodType::Pointer regRigid;
-    regRigid = RigidRegistrationMethodType::New();
-    regRigid->SetRandomNumberSeed( m_RandomNumberSeed );
-    if( m_EnableInitialRegistration || !m_UseEvolutionaryOptimization )
+    ShrinkFactorsListType rigidShrinkFactors = m_RigidShrinkFactors;
+    if( rigidShrinkFactors.empty() )
       {
-      regRigid->SetUseEvolutionaryOptimization( false );
+      rigidShrinkFactors.push_back( 1 );
       }
-    regRigid->SetReportProgress( m_ReportProgress );
-    regRigid->SetMovingImage( m_CurrentMovingImage );
-    regRigid->SetFixedImage( m_FixedImage );
-    regRigid->SetNumberOfSamples( (unsigned int)( m_RigidSamplingRatio
-                                                  * fixedImageNumPixels ) );
-    regRigid->SetSampleFromOverlap( m_SampleFromOverlap );
-    regRigid->SetMinimizeMemory( m_MinimizeMemory );
-    regRigid->SetMaxIterations( m_RigidMaxIterations );
-    regRigid->SetTargetError( m_RigidTargetError );
-    if( m_UseFixedImageMaskObject )
-      {
-      if( m_FixedImageMaskObject.IsNotNull() )
-        {
-        regRigid->SetFixedImageMaskObject( m_FixedImageMaskObject );
-        }
-      }
-    if( m_UseMovingImageMaskObject )
-      {
-      if( m_MovingImageMaskObject.IsNotNull() )
-        {
-        regRigid->SetMovingImageMaskObject( m_MovingImageMaskObject );
-        }
-      }
-    if( m_SampleIntensityPortion > 0 )
-      {
-      typedef MinimumMaximumImageCalculator<ImageType> MinMaxCalcType;
-      typename MinMaxCalcType::Pointer calc = MinMaxCalcType::New();
-      calc->SetImage( m_FixedImage );
-      calc->Compute();
-      PixelType fixedImageMax = calc->GetMaximum();
-      PixelType fixedImageMin = calc->GetMinimum();
-
-      regRigid->SetFixedImageSamplesIntensityThreshold(
-        static_cast<PixelType>( ( m_SampleIntensityPortion *
-        (fixedImageMax - fixedImageMin) ) + fixedImageMin ) );
-      }
-    if( m_UseRegionOfInterest )
-      {
-      regRigid->SetRegionOfInterest( m_RegionOfInterestPoint1,
-        m_RegionOfInterestPoint2 );
-      }
-    regRigid->SetSampleFromOverlap( m_SampleFromOverlap );
-    regRigid->SetMetricMethodEnum( m_RigidMetricMethodEnum );
-    regRigid->SetInterpolationMethodEnum( m_RigidInterpolationMethodEnum );
-    typename RigidTransformType::ParametersType scales;
-    if( ImageDimension == 2 )
-      {
-      scales.set_size( 3 );
-      scales[0] = 1.0 / m_ExpectedRotationMagnitude;
-      scales[1] = 1.0 / ( m_ExpectedOffsetPixelMagnitude *
-        m_FixedImage->GetSpacing()[0]);
-      scales[2] = 1.0 / ( m_ExpectedOffsetPixelMagnitude *
-        m_FixedImage->GetSpacing()[0]);
-      }
-    else if( ImageDimension == 3 )
+    for( unsigned int level = 0; level < rigidShrinkFactors.size(); ++level )
       {
-      scales.set_size( 6 );
-      scales[0] = 1.0 / m_ExpectedRotationMagnitude;
-      scales[1] = 1.0 / m_ExpectedRotationMagnitude;
-      scales[2] = 1.0 / m_ExpectedRotationMagnitude;
-      scales[3] = 1.0 / ( m_ExpectedOffsetPixelMagnitude *
-        m_FixedImage->GetSpacing()[0]);
-      scales[4] = 1.0 / ( m_ExpectedOffsetPixelMagnitude *
-        m_FixedImage->GetSpacing()[0]);
-      scales[5] = 1.0 / ( m_ExpectedOffsetPixelMagnitude *
-        m_FixedImage->GetSpacing()[0]);
-      }
-    else
-      {
-      std::cerr
-        << "ERROR: Only 2 and 3 dimensional images are supported."
-        << std::endl;
-      }
-    /*
-    double minS = scales[0];
-    for(unsigned int i=1; i<scales.size(); i++)
-      {
-      if(scales[i] < minS)
+      if( this->GetReportProgress() && rigidShrinkFactors.size() > 1 )
         {
-        minS = scales[i];
+        std::cout << "*** Rigid level " << level << ": shrink factor "
+          << rigidShrinkFactors[level] << " ***" << std::endl;
         }
+      this->RegisterRigidLevel( rigidShrinkFactors[level], level == 0 );
       }
-    if(minS < 1)
-      {
-      for(unsigned int i=0; i<scales.size(); i++)
-        {
-        scales[i] /= minS;
-        }
-      }*/
-    regRigid->SetTransformParametersScales( scales );
-
-    if( m_CurrentMatrixTransform.IsNotNull() )
-      {
-      regRigid->GetTypedTransform()->SetCenter(
-        m_CurrentMatrixTransform->GetCenter() );
-      regRigid->GetTypedTransform()->SetMatrix(
-        m_CurrentMatrixTransform->GetMatrix() );
-      regRigid->GetTypedTransform()->SetOffset(
-        m_CurrentMatrixTransform->GetOffset() );
-      regRigid->SetInitialTransformParameters(
-        regRigid->GetTypedTransform()->GetParameters() );
-      regRigid->SetInitialTransformFixedParameters(
-        regRigid->GetTypedTransform()->GetFixedParameters() );
-      }
-
-    regRigid->Update();
-
-    m_RigidTransform = RigidTransformType::New();
-    m_RigidTransform->SetFixedParameters(
-      regRigid->GetTypedTransform()->GetFixedParameters() );
-    // must call GetAffineTransform here because the typed transform
-    // is a versor and has only 6 parameters (in this code the type
-    // RigidTransform is a 12 parameter transform)
-    m_RigidTransform->SetParametersByValue(
-      regRigid->GetAffineTransform()->GetParameters() );
-    m_CurrentMatrixTransform = regRigid->GetAffineTransform();
-    m_CurrentBSplineTransform = 0;
-
-    m_FinalMetricValue = regRigid->GetFinalMetricValue();
-    m_RigidMetricValue = m_FinalMetricValue;
 
     m_CompletedStage = RIGID_STAGE;
     m_CompletedResampling = false;
@@ -574,123 +464,20 @@ ImageToImageRegistrationHelper<TImage>
       std::cout << "*** AFFINE REGISTRATION ***" << std::endl;
       }
 
-    typename AffineRegistrationMethodType::Pointer regAff =
-      AffineRegistrationMethodType::New();
-    regAff->SetRandomNumberSeed( m_RandomNumberSeed );
-    regAff->SetReportProgress( m_ReportProgress );
-    regAff->SetMovingImage( m_CurrentMovingImage );
-    regAff->SetFixedImage( m_FixedImage );
-    regAff->SetNumberOfSamples( (unsigned int)(m_AffineSamplingRatio
-      * fixedImageNumPixels) );
-    if( m_UseRegionOfInterest )
-      {
-      regAff->SetRegionOfInterest( m_RegionOfInterestPoint1,
-        m_RegionOfInterestPoint2 );
-      }
-    regAff->SetSampleFromOverlap( m_SampleFromOverlap );
-    regAff->SetMinimizeMemory( m_MinimizeMemory );
-    regAff->SetMaxIterations( m_AffineMaxIterations );
-    regAff->SetTargetError( m_AffineTargetError );
-    if( m_EnableRigidRegistration || !m_UseEvolutionaryOptimization )
+    ShrinkFactorsListType affineShrinkFactors = m_AffineShrinkFactors;
+    if( affineShrinkFactors.empty() )
       {
-      regAff->SetUseEvolutionaryOptimization( false );
+      affineShrinkFactors.push_back( 1 );
       }
-    regAff->SetTargetError( m_AffineTargetError );
-    if( m_UseFixedImageMaskObject )
+    for( unsigned int level = 0; level < affineShrinkFactors.size(); ++level )
       {
-      if( m_FixedImageMaskObject.IsNotNull() )
+      if( this->GetReportProgress() && affineShrinkFactors.size() > 1 )
         {
-        regAff->SetFixedImageMaskObject( m_FixedImageMaskObject );
+        std::cout << "*** Affine level " << level << ": shrink factor "
+          << affineShrinkFactors[level] << " ***" << std::endl;
         }
+      this->RegisterAffineLevel( affineShrinkFactors[level], level == 0 );
       }
-    if( m_UseMovingImageMaskObject )
-      {
-      if( m_MovingImageMaskObject.IsNotNull() )
-        {
-        regAff->SetMovingImageMaskObject( m_MovingImageMaskObject );
-        }
-      }
-    if( m_SampleIntensityPortion > 0 )
-      {
-      typedef MinimumMaximumImageCalculator<ImageType> MinMaxCalcType;
-      typename MinMaxCalcType::Pointer calc = MinMaxCalcType::New();
-      calc->SetImage( m_FixedImage );
-      calc->Compute();
-      PixelType fixedImageMax = calc->GetMaximum();
-      PixelType fixedImageMin = calc->GetMinimum();
-
-      regAff->SetFixedImageSamplesIntensityThreshold(
-        static_cast<PixelType>( ( m_SampleIntensityPortion
-          * (fixedImageMax - fixedImageMin) ) + fixedImageMin ) );
-      }
-    regAff->SetMetricMethodEnum( m_AffineMetricMethodEnum );
-    regAff->SetInterpolationMethodEnum( m_AffineInterpolationMethodEnum );
-    typename AffineTransformType::ParametersType scales;
-    scales.set_size( ImageDimension * ImageDimension + ImageDimension );
-    unsigned int scaleNum = 0;
-    for( unsigned int d1 = 0; d1 < ImageDimension; d1++ )
-      {
-      for( unsigned int d2 = 0; d2 < ImageDimension; d2++ )
-        {
-        if( d1 == d2 )
-          {
-          scales[scaleNum] = 1.0 / (
-            m_ExpectedRotationMagnitude + m_ExpectedScaleMagnitude);
-          }
-        else
-          {
-          scales[scaleNum] = 1.0 / (
-            m_ExpectedRotationMagnitude + m_ExpectedSkewMagnitude);
-          }
-        ++scaleNum;
-        }
-      }
-    for( unsigned int d1 = 0; d1 < ImageDimension; d1++ )
-      {
-      scales[scaleNum] = 1.0 / (
-        m_ExpectedOffsetPixelMagnitude * m_FixedImage->GetSpacing()[0]);
-      ++scaleNum;
-      }
-    /*
-    double minS = scales[0];
-    for(unsigned int i=1; i<scaleNum; i++)
-      {
-      if(scales[i] < minS)
-        {
-        minS = scales[i];
-        }
-      }
-    if(minS < 1)
-      {
-      for(unsigned int i=0; i<scaleNum; i++)
-        {
-        scales[i] /= minS;
-        }
-      }*/
-    regAff->SetTransformParametersScales( scales );
-
-    if( m_CurrentMatrixTransform.IsNotNull() )
-      {
-      regAff->GetTypedTransform()->SetCenter(
-        m_CurrentMatrixTransform->GetCenter() );
-      regAff->GetTypedTransform()->SetMatrix(
-        m_CurrentMatrixTransform->GetMatrix() );
-      regAff->GetTypedTransform()->SetOffset(
-        m_CurrentMatrixTransform->GetOffset() );
-      regAff->SetInitialTransformParameters(
-        regAff->GetTypedTransform()->GetParameters() );
-      regAff->SetInitialTransformFixedParameters(
-        regAff->GetTypedTransform()->GetFixedParameters() );
-      }
-
-    regAff->Update();
-
-    m_AffineTransform = regAff->GetAffineTransform();
-    m_CurrentMatrixTransform = m_AffineTransform;
-    m_CurrentBSplineTransform = 0;
-
-    m_FinalMetricValue = regAff->GetFinalMetricValue();
-    m_AffineMetricValue = m_FinalMetricValue;
 
     m_CompletedStage = AFFINE_STAGE;
     m_CompletedResampling = false;
@@ -1387,6 +1174,339 @@ ImageToImageRegistrationHelper<TImage>
     }
 }
 
+template <class TImage>
+void
+ImageToImageRegistrationHelper<TImage>
+::RegisterRigidLevel( unsigned int shrinkFactor, bool firstLevel )
+{
+  typename TImage::ConstPointer levelFixedImage = this->ShrinkImage(
+    m_FixedImage, shrinkFactor );
+  typename TImage::ConstPointer levelMovingImage = this->ShrinkImage(
+    m_CurrentMovingImage, shrinkFactor );
+
+  typename RigidRegistrationMethodType::Pointer regRigid;
+  regRigid = RigidRegistrationMethodType::New();
+  regRigid->SetRandomNumberSeed( m_RandomNumberSeed );
+  if( m_EnableInitialRegistration || !m_UseEvolutionaryOptimization
+    || !firstLevel )
+    {
+    regRigid->SetUseEvolutionaryOptimization( false );
+    }
+  regRigid->SetReportProgress( m_ReportProgress );
+  regRigid->SetMovingImage( levelMovingImage );
+  regRigid->SetFixedImage( levelFixedImage );
+  regRigid->SetNumberOfSamples( (unsigned int)( m_RigidSamplingRatio
+    * levelFixedImage->GetLargestPossibleRegion().GetNumberOfPixels() ) );
+  regRigid->SetSampleFromOverlap( m_SampleFromOverlap );
+  regRigid->SetMinimizeMemory( m_MinimizeMemory );
+  regRigid->SetMaxIterations( m_RigidMaxIterations );
+  regRigid->SetTargetError( m_RigidTargetError );
+  if( m_UseFixedImageMaskObject )
+    {
+    if( m_FixedImageMaskObject.IsNotNull() )
+      {
+      regRigid->SetFixedImageMaskObject( m_FixedImageMaskObject );
+      }
+    }
+  if( m_UseMovingImageMaskObject )
+    {
+    if( m_MovingImageMaskObject.IsNotNull() )
+      {
+      regRigid->SetMovingImageMaskObject( m_MovingImageMaskObject );
+      }
+    }
+  if( m_SampleIntensityPortion > 0 )
+    {
+    typedef MinimumMaximumImageCalculator<ImageType> MinMaxCalcType;
+    typename MinMaxCalcType::Pointer calc = MinMaxCalcType::New();
+    calc->SetImage( m_FixedImage );
+    calc->Compute();
+    PixelType fixedImageMax = calc->GetMaximum();
+    PixelType fixedImageMin = calc->GetMinimum();
+
+    regRigid->SetFixedImageSamplesIntensityThreshold(
+      static_cast<PixelType>( ( m_SampleIntensityPortion *
+      (fixedImageMax - fixedImageMin) ) + fixedImageMin ) );
+    }
+  if( m_UseRegionOfInterest )
+    {
+    regRigid->SetRegionOfInterest( m_RegionOfInterestPoint1,
+      m_RegionOfInterestPoint2 );
+    }
+  regRigid->SetSampleFromOverlap( m_SampleFromOverlap );
+  regRigid->SetMetricMethodEnum( m_RigidMetricMethodEnum );
+  regRigid->SetInterpolationMethodEnum( m_RigidInterpolationMethodEnum );
+  typename RigidTransformType::ParametersType scales;
+  if( ImageDimension == 2 )
+    {
+    scales.set_size( 3 );
+    scales[0] = 1.0 / m_ExpectedRotationMagnitude;
+    scales[1] = 1.0 / ( m_ExpectedOffsetPixelMagnitude *
+      levelFixedImage->GetSpacing()[0]);
+    scales[2] = 1.0 / ( m_ExpectedOffsetPixelMagnitude *
+      levelFixedImage->GetSpacing()[0]);
+    }
+  else if( ImageDimension == 3 )
+    {
+    scales.set_size( 6 );
+    scales[0] = 1.0 / m_ExpectedRotationMagnitude;
+    scales[1] = 1.0 / m_ExpectedRotationMagnitude;
+    scales[2] = 1.0 / m_ExpectedRotationMagnitude;
+    scales[3] = 1.0 / ( m_ExpectedOffsetPixelMagnitude *
+      levelFixedImage->GetSpacing()[0]);
+    scales[4] = 1.0 / ( m_ExpectedOffsetPixelMagnitude *
+      levelFixedImage->GetSpacing()[0]);
+    scales[5] = 1.0 / ( m_ExpectedOffsetPixelMagnitude *
+      levelFixedImage->GetSpacing()[0]);
+    }
+  else
+    {
+    std::cerr
+      << "ERROR: Only 2 and 3 dimensional images are supported."
+      << std::endl;
+    }
+  /*
+  double minS = scales[0];
+  for(unsigned int i=1; i<scales.size(); i++)
+    {
+    if(scales[i] < minS)
+      {
+      minS = scales[i];
+      }
+    }
+  if(minS < 1)
+    {
+    for(unsigned int i=0; i<scales.size(); i++)
+      {
+      scales[i] /= minS;
+      }
+    }*/
+  regRigid->SetTransformParametersScales( scales );
+
+  if( m_CurrentMatrixTransform.IsNotNull() )
+    {
+    regRigid->GetTypedTransform()->SetCenter(
+      m_CurrentMatrixTransform->GetCenter() );
+    regRigid->GetTypedTransform()->SetMatrix(
+      m_CurrentMatrixTransform->GetMatrix() );
+    regRigid->GetTypedTransform()->SetOffset(
+      m_CurrentMatrixTransform->GetOffset() );
+    regRigid->SetInitialTransformParameters(
+      regRigid->GetTypedTransform()->GetParameters() );
+    regRigid->SetInitialTransformFixedParameters(
+      regRigid->GetTypedTransform()->GetFixedParameters() );
+    }
+
+  regRigid->Update();
+
+  m_RigidTransform = RigidTransformType::New();
+  m_RigidTransform->SetFixedParameters(
+    regRigid->GetTypedTransform()->GetFixedParameters() );
+  // must call GetAffineTransform here because the typed transform
+  // is a versor and has only 6 parameters (in this code the type
+  // RigidTransform is a 12 parameter transform)
+  m_RigidTransform->SetParametersByValue(
+    regRigid->GetAffineTransform()->GetParameters() );
+  m_CurrentMatrixTransform = regRigid->GetAffineTransform();
+  m_CurrentBSplineTransform = 0;
+
+  m_FinalMetricValue = regRigid->GetFinalMetricValue();
+  m_RigidMetricValue = m_FinalMetricValue;
+}
+
+template <class TImage>
+void
+ImageToImageRegistrationHelper<TImage>
+::RegisterAffineLevel( unsigned int shrinkFactor, bool firstLevel )
+{
+  typename TImage::ConstPointer levelFixedImage = this->ShrinkImage(
+    m_FixedImage, shrinkFactor );
+  typename TImage::ConstPointer levelMovingImage = this->ShrinkImage(
+    m_CurrentMovingImage, shrinkFactor );
+
+  typename AffineRegistrationMethodType::Pointer regAff =
+    AffineRegistrationMethodType::New();
+  regAff->SetRandomNumberSeed( m_RandomNumberSeed );
+  regAff->SetReportProgress( m_ReportProgress );
+  regAff->SetMovingImage( levelMovingImage );
+  regAff->SetFixedImage( levelFixedImage );
+  regAff->SetNumberOfSamples( (unsigned int)(m_AffineSamplingRatio
+    * levelFixedImage->GetLargestPossibleRegion().GetNumberOfPixels()) );
+  if( m_UseRegionOfInterest )
+    {
+    regAff->SetRegionOfInterest( m_RegionOfInterestPoint1,
+      m_RegionOfInterestPoint2 );
+    }
+  regAff->SetSampleFromOverlap( m_SampleFromOverlap );
+  regAff->SetMinimizeMemory( m_MinimizeMemory );
+  regAff->SetMaxIterations( m_AffineMaxIterations );
+  regAff->SetTargetError( m_AffineTargetError );
+  if( m_EnableRigidRegistration || !m_UseEvolutionaryOptimization
+    || !firstLevel )
+    {
+    regAff->SetUseEvolutionaryOptimization( false );
+    }
+  regAff->SetTargetError( m_AffineTargetError );
+  if( m_UseFixedImageMaskObject )
+    {
+    if( m_FixedImageMaskObject.IsNotNull() )
+      {
+      regAff->SetFixedImageMaskObject( m_FixedImageMaskObject );
+      }
+    }
+  if( m_UseMovingImageMaskObject )
+    {
+    if( m_MovingImageMaskObject.IsNotNull() )
+      {
+      regAff->SetMovingImageMaskObject( m_MovingImageMaskObject );
+      }
+    }
+  if( m_SampleIntensityPortion > 0 )
+    {
+    typedef MinimumMaximumImageCalculator<ImageType> MinMaxCalcType;
+    typename MinMaxCalcType::Pointer calc = MinMaxCalcType::New();
+    calc->SetImage( m_FixedImage );
+    calc->Compute();
+    PixelType fixedImageMax = calc->GetMaximum();
+    PixelType fixedImageMin = calc->GetMinimum();
+
+    regAff->SetFixedImageSamplesIntensityThreshold(
+      static_cast<PixelType>( ( m_SampleIntensityPortion
+        * (fixedImageMax - fixedImageMin) ) + fixedImageMin ) );
+    }
+  regAff->SetMetricMethodEnum( m_AffineMetricMethodEnum );
+  regAff->SetInterpolationMethodEnum( m_AffineInterpolationMethodEnum );
+  typename AffineTransformType::ParametersType scales;
+  scales.set_size( ImageDimension * ImageDimension + ImageDimension );
+  unsigned int scaleNum = 0;
+  for( unsigned int d1 = 0; d1 < ImageDimension; d1++ )
+    {
+    for( unsigned int d2 = 0; d2 < ImageDimension; d2++ )
+      {
+      if( d1 == d2 )
+        {
+        scales[scaleNum] = 1.0 / (
+          m_ExpectedRotationMagnitude + m_ExpectedScaleMagnitude);
+        }
+      else
+        {
+        scales[scaleNum] = 1.0 / (
+          m_ExpectedRotationMagnitude + m_ExpectedSkewMagnitude);
+        }
+      ++scaleNum;
+      }
+    }
+  for( unsigned int d1 = 0; d1 < ImageDimension; d1++ )
+    {
+    scales[scaleNum] = 1.0 / (
+      m_ExpectedOffsetPixelMagnitude * levelFixedImage->GetSpacing()[0]);
+    ++scaleNum;
+    }
+  /*
+  double minS = scales[0];
+  for(unsigned int i=1; i<scaleNum; i++)
+    {
+    if(scales[i] < minS)
+      {
+      minS = scales[i];
+      }
+    }
+  if(minS < 1)
+    {
+    for(unsigned int i=0; i<scaleNum; i++)
+      {
+      scales[i] /= minS;
+      }
+    }*/
+  regAff->SetTransformParametersScales( scales );
+
+  if( m_CurrentMatrixTransform.IsNotNull() )
+    {
+    regAff->GetTypedTransform()->SetCenter(
+      m_CurrentMatrixTransform->GetCenter() );
+    regAff->GetTypedTransform()->SetMatrix(
+      m_CurrentMatrixTransform->GetMatrix() );
+    regAff->GetTypedTransform()->SetOffset(
+      m_CurrentMatrixTransform->GetOffset() );
+    regAff->SetInitialTransformParameters(
+      regAff->GetTypedTransform()->GetParameters() );
+    regAff->SetInitialTransformFixedParameters(
+      regAff->GetTypedTransform()->GetFixedParameters() );
+    }
+
+  regAff->Update();
+
+  m_AffineTransform = regAff->GetAffineTransform();
+  m_CurrentMatrixTransform = m_AffineTransform;
+  m_CurrentBSplineTransform = 0;
+
+  m_FinalMetricValue = regAff->GetFinalMetricValue();
+  m_AffineMetricValue = m_FinalMetricValue;
+}
+
+template <class TImage>
+void
+ImageToImageRegistrationHelper<TImage>
+::SetRigidShrinkFactors( const ShrinkFactorsListType & factors )
+{
+  for( unsigned int i = 0; i < factors.size(); i++ )
+    {
+    if( factors[i] == 0 )
+      {
+      itkExceptionMacro( << "Rigid shrink factors must be positive." );
+      }
+    }
+  if( m_RigidShrinkFactors != factors )
+    {
+    m_RigidShrinkFactors = factors;
+    this->Modified();
+    }
+}
+
+template <class TImage>
+void
+ImageToImageRegistrationHelper<TImage>
+::SetAffineShrinkFactors( const ShrinkFactorsListType & factors )
+{
+  for( unsigned int i = 0; i < factors.size(); i++ )
+    {
+    if( factors[i] == 0 )
+      {
+      itkExceptionMacro( << "Affine shrink factors must be positive." );
+      }
+    }
+  if( m_AffineShrinkFactors != factors )
+    {
+    m_AffineShrinkFactors = factors;
+    this->Modified();
+    }
+}
+
+template <class TImage>
+typename TImage::ConstPointer
+ImageToImageRegistrationHelper<TImage>
+::ShrinkImage( const TImage * image, unsigned int factor ) const
+{
+  if( factor <= 1 )
+    {
+    return image;
+    }
+
+  typedef tube::ShrinkWithBlendingImageFilter<TImage, TImage> ShrinkFilterType;
+  typename ShrinkFilterType::Pointer shrinkFilter = ShrinkFilterType::New();
+  shrinkFilter->SetInput( image );
+  for( unsigned int i = 0; i < ImageDimension; i++ )
+    {
+    shrinkFilter->SetShrinkFactor( i, factor );
+    }
+  shrinkFilter->SetBlendWithMax( false );
+  shrinkFilter->SetBlendWithMean( true );
+  shrinkFilter->Update();
+
+  typename TImage::ConstPointer result = shrinkFilter->GetOutput();
+  return result;
+}
+
 template <class TImage>
 void
 ImageToImageRegistrationHelper<TImage>
@@ -1643,6 +1763,12 @@ ImageToImageRegistrationHelper<TImage>
     << std::endl;
   os << indent << "Rigid Max Iterations = " << m_RigidMaxIterations
     << std::endl;
+  os << indent << "Rigid Shrink Factors =";
+  for( unsigned int i = 0; i < m_RigidShrinkFactors.size(); i++ )
+    {
+    os << " " << m_RigidShrinkFactors[i];
+    }
+  os << std::endl;
   PrintSelfHelper( os, indent, "Rigid", m_RigidMetricMethodEnum,
                    m_RigidInterpolationMethodEnum );
   os << indent << std::endl;
@@ -1661,6 +1787,12 @@ ImageToImageRegistrationHelper<TImage>
     << std::endl;
   os << indent << "Affine Max Iterations = " << m_AffineMaxIterations
     << std::endl;
+  os << indent << "Affine Shrink Factors =";
+  for( unsigned int i = 0; i < m_AffineShrinkFactors.size(); i++ )
+    {
+    os << " " << m_AffineShrinkFactors[i];
+    }
+  os << std::endl;
   PrintSelfHelper( os, indent, "Affine", m_AffineMetricMethodEnum,
     m_AffineInterpolationMethodEnum );
   os << indent << std::endl;
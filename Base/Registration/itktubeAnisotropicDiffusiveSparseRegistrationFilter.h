@@ -31,6 +31,8 @@ limitations under the License.
 
 #include <vtkSmartPointer.h>
 
+#include <vector>
+
 class vtkFloatArray;
 class vtkPointLocator;
 class vtkPolyData;
@@ -207,6 +209,18 @@ public:
   typedef typename WeightComponentImageType::RegionType
       ThreadWeightComponentImageRegionType;
 
+  /** When the normals and weight structures are computed from the border
+   *  surface and tube list, each voxel only takes those of its closest
+   *  surface or tube point.  They are then stored as an image of indices
+   *  into per-point tables instead of as dense matrix images. */
+  typedef unsigned int                                  StructureIndexType;
+  typedef itk::Image< StructureIndexType, ImageDimension >
+      StructureIndexImageType;
+  typedef typename StructureIndexImageType::Pointer
+      StructureIndexImagePointer;
+  typedef itk::ImageRegionIterator< StructureIndexImageType >
+      StructureIndexImageRegionType;
+
   /** Organ boundary surface types */
   typedef vtkPolyData                                   BorderSurfaceType;
   typedef vtkSmartPointer< BorderSurfaceType >          BorderSurfacePointer;
@@ -269,11 +283,13 @@ public:
    * image overrides the border surface polydata if a border surface was
    * also supplied. */
   virtual void SetNormalMatrixImage( NormalMatrixImageType * normalImage )
-    { m_NormalMatrixImage = normalImage; }
-  virtual NormalMatrixImageType * GetNormalMatrixImage( void ) const
-    { return m_NormalMatrixImage; }
-  virtual NormalMatrixImageType * GetHighResolutionNormalMatrixImage( void ) const
-    { return m_HighResolutionNormalMatrixImage; }
+    {
+    m_NormalMatrixImage = normalImage;
+    this->ReleaseStructureIndexImages();
+    }
+  virtual NormalMatrixImageType * GetNormalMatrixImage( void ) const;
+  virtual NormalMatrixImageType * GetHighResolutionNormalMatrixImage( void )
+    const;
   /** Get the image of a specific normal vector (column of the normal matrix).
    *  Pointer should already have been initialized with New() */
   virtual void GetHighResolutionNormalVectorImage
@@ -284,11 +300,13 @@ public:
   /** Set/get the weighting matrix A image.  Setting the weighting matrix image
    * overrides the structure tensor eigen analysis. */
   virtual void SetWeightStructuresImage( WeightMatrixImageType * weightImage )
-    { m_WeightStructuresImage = weightImage; }
-  virtual WeightMatrixImageType * GetWeightStructuresImage( void ) const
-    { return m_WeightStructuresImage; }
-  virtual WeightMatrixImageType * GetHighResolutionWeightStructuresImage( void ) const
-    { return m_HighResolutionWeightStructuresImage; }
+    {
+    m_WeightStructuresImage = weightImage;
+    this->ReleaseStructureIndexImages();
+    }
+  virtual WeightMatrixImageType * GetWeightStructuresImage( void ) const;
+  virtual WeightMatrixImageType * GetHighResolutionWeightStructuresImage(
+    void ) const;
 
   /** Set/get the weighting value w image.  Setting the weighting component
     * image overrides the border surface polydata and lambda/gamma if the border
@@ -409,6 +427,25 @@ protected:
       float * tangentVector2,
       itk::Point< double, ImageDimension > otherPoint ) const;
 
+  /** Get the normal matrix N and weight structures A at a buffer offset of
+   *  the current resolution, whichever way they are stored. */
+  void GetNormalMatrixAndWeightStructures( SizeValueType offset,
+      NormalMatrixType & N, WeightMatrixType & A ) const
+    {
+    if( m_StructureIndexImage )
+      {
+      const StructureIndexType structure
+          = m_StructureIndexImage->GetBufferPointer()[offset];
+      N = m_StructureNormalMatrices[structure];
+      A = m_StructureWeightMatrices[structure];
+      }
+    else
+      {
+      N = m_NormalMatrixImage->GetBufferPointer()[offset];
+      A = m_WeightStructuresImage->GetBufferPointer()[offset];
+      }
+    }
+
 private:
   // Purposely not implemented
   AnisotropicDiffusiveSparseRegistrationFilter(const Self&);
@@ -442,6 +479,18 @@ private:
       GetNormalsAndDistancesFromClosestSurfacePointThreaderCallback(
           void * arg );
 
+  /** Drop the structure index images and tables, e.g. when the user
+   *  supplies a dense normal matrix or weight structures image. */
+  void ReleaseStructureIndexImages( void );
+
+  /** Expand a structure index image into a dense image using the given
+   *  per-structure table, reusing decodedImage if it matches. */
+  template< class TDecodedImage >
+  static void DecodeStructureIndexImage(
+      const StructureIndexImageType * indexImage,
+      const std::vector< typename TDecodedImage::PixelType > & table,
+      typename TDecodedImage::Pointer & decodedImage );
+
   /** Organ boundary surface and surface of border normals */
   BorderSurfacePointer                m_BorderSurface;
   TubeListPointer                     m_TubeList;
@@ -464,6 +513,23 @@ private:
   WeightComponentImagePointer
   m_HighResolutionWeightRegularizationsImage;
 
+  /** Compact storage of the normal matrices and weight structures: one
+   *  table entry per border surface point, then one per tube point, and an
+   *  index image (at the current and at the highest resolution) instead of
+   *  m_NormalMatrixImage and m_WeightStructuresImage. */
+  StructureIndexImagePointer          m_StructureIndexImage;
+  StructureIndexImagePointer          m_HighResolutionStructureIndexImage;
+  std::vector< NormalMatrixType >     m_StructureNormalMatrices;
+  std::vector< WeightMatrixType >     m_StructureWeightMatrices;
+
+  /** Dense images expanded from the compact storage on request by the
+   *  Get*NormalMatrixImage() and Get*WeightStructuresImage() methods */
+  mutable NormalMatrixImagePointer    m_DecodedNormalMatrixImage;
+  mutable WeightMatrixImagePointer    m_DecodedWeightStructuresImage;
+  mutable NormalMatrixImagePointer    m_DecodedHighResolutionNormalMatrixImage;
+  mutable WeightMatrixImagePointer
+  m_DecodedHighResolutionWeightStructuresImage;
+
   /** The lambda/gamma factors for computing the weight from distance. */
   WeightComponentType                 m_Lambda;
   WeightComponentType                 m_Gamma;
@@ -64,6 +64,12 @@ AnisotropicDiffusiveSparseRegistrationFilter
   m_HighResolutionNormalMatrixImage             = 0;
   m_HighResolutionWeightStructuresImage         = 0;
   m_HighResolutionWeightRegularizationsImage    = 0;
+  m_StructureIndexImage                         = 0;
+  m_HighResolutionStructureIndexImage           = 0;
+  m_DecodedNormalMatrixImage                    = 0;
+  m_DecodedWeightStructuresImage                = 0;
+  m_DecodedHighResolutionNormalMatrixImage      = 0;
+  m_DecodedHighResolutionWeightStructuresImage  = 0;
 
   // Lambda/gamma used to calculate weight from distance
   m_Lambda  = 0.01;
@@ -110,6 +116,13 @@ AnisotropicDiffusiveSparseRegistrationFilter
     os << indent << "Weight regularizations image:" << std::endl;
     m_WeightRegularizationsImage->Print( os, indent );
     }
+  if( m_StructureIndexImage )
+    {
+    os << indent << "Structure index image:" << std::endl;
+    m_StructureIndexImage->Print( os, indent );
+    os << indent << "Number of structures: "
+       << m_StructureNormalMatrices.size() << std::endl;
+    }
   os << indent << "lambda: " << m_Lambda << std::endl;
   os << indent << "gamma: " << m_Gamma << std::endl;
   if( m_HighResolutionNormalMatrixImage )
@@ -127,6 +140,155 @@ AnisotropicDiffusiveSparseRegistrationFilter
     os << indent << "High resolution weight regularizations image:" << std::endl;
     m_HighResolutionWeightRegularizationsImage->Print( os, indent );
     }
+  if( m_HighResolutionStructureIndexImage )
+    {
+    os << indent << "High resolution structure index image:" << std::endl;
+    m_HighResolutionStructureIndexImage->Print( os, indent );
+    }
+}
+
+/**
+ * Drops the compact storage of the normal matrices and weight structures
+ */
+template< class TFixedImage, class TMovingImage, class TDeformationField >
+void
+AnisotropicDiffusiveSparseRegistrationFilter
+  < TFixedImage, TMovingImage, TDeformationField >
+::ReleaseStructureIndexImages( void )
+{
+  m_StructureIndexImage = 0;
+  m_HighResolutionStructureIndexImage = 0;
+  m_StructureNormalMatrices.clear();
+  m_StructureWeightMatrices.clear();
+  m_DecodedNormalMatrixImage = 0;
+  m_DecodedWeightStructuresImage = 0;
+  m_DecodedHighResolutionNormalMatrixImage = 0;
+  m_DecodedHighResolutionWeightStructuresImage = 0;
+}
+
+/**
+ * Expands a structure index image into a dense image
+ */
+template< class TFixedImage, class TMovingImage, class TDeformationField >
+template< class TDecodedImage >
+void
+AnisotropicDiffusiveSparseRegistrationFilter
+  < TFixedImage, TMovingImage, TDeformationField >
+::DecodeStructureIndexImage(
+    const StructureIndexImageType * indexImage,
+    const std::vector< typename TDecodedImage::PixelType > & table,
+    typename TDecodedImage::Pointer & decodedImage )
+{
+  assert( indexImage );
+
+  if( !decodedImage
+      || !DiffusiveRegistrationFilterUtils::CompareImageAttributes(
+            decodedImage.GetPointer(), indexImage ) )
+    {
+    decodedImage = TDecodedImage::New();
+    DiffusiveRegistrationFilterUtils::AllocateSpaceForImage( decodedImage,
+                                                             indexImage );
+    }
+  else if( decodedImage->GetMTime() > indexImage->GetMTime() )
+    {
+    return;
+    }
+
+  const StructureIndexType * index = indexImage->GetBufferPointer();
+  typename TDecodedImage::PixelType * decoded
+      = decodedImage->GetBufferPointer();
+  const SizeValueType numberOfPixels
+      = indexImage->GetLargestPossibleRegion().GetNumberOfPixels();
+  for( SizeValueType i = 0; i < numberOfPixels; i++ )
+    {
+    assert( index[i] < table.size() );
+    decoded[i] = table[index[i]];
+    }
+  decodedImage->Modified();
+}
+
+/**
+ * Get the normal matrix image, expanding it from the compact storage
+ */
+template< class TFixedImage, class TMovingImage, class TDeformationField >
+typename AnisotropicDiffusiveSparseRegistrationFilter
+  < TFixedImage, TMovingImage, TDeformationField >::NormalMatrixImageType *
+AnisotropicDiffusiveSparseRegistrationFilter
+  < TFixedImage, TMovingImage, TDeformationField >
+::GetNormalMatrixImage( void ) const
+{
+  if( m_NormalMatrixImage || !m_StructureIndexImage )
+    {
+    return m_NormalMatrixImage;
+    }
+  Self::template DecodeStructureIndexImage< NormalMatrixImageType >(
+      m_StructureIndexImage, m_StructureNormalMatrices,
+      m_DecodedNormalMatrixImage );
+  return m_DecodedNormalMatrixImage;
+}
+
+/**
+ * Get the high resolution normal matrix image, expanding it from the compact
+ * storage
+ */
+template< class TFixedImage, class TMovingImage, class TDeformationField >
+typename AnisotropicDiffusiveSparseRegistrationFilter
+  < TFixedImage, TMovingImage, TDeformationField >::NormalMatrixImageType *
+AnisotropicDiffusiveSparseRegistrationFilter
+  < TFixedImage, TMovingImage, TDeformationField >
+::GetHighResolutionNormalMatrixImage( void ) const
+{
+  if( m_HighResolutionNormalMatrixImage
+      || !m_HighResolutionStructureIndexImage )
+    {
+    return m_HighResolutionNormalMatrixImage;
+    }
+  Self::template DecodeStructureIndexImage< NormalMatrixImageType >(
+      m_HighResolutionStructureIndexImage, m_StructureNormalMatrices,
+      m_DecodedHighResolutionNormalMatrixImage );
+  return m_DecodedHighResolutionNormalMatrixImage;
+}
+
+/**
+ * Get the weight structures image, expanding it from the compact storage
+ */
+template< class TFixedImage, class TMovingImage, class TDeformationField >
+typename AnisotropicDiffusiveSparseRegistrationFilter
+  < TFixedImage, TMovingImage, TDeformationField >::WeightMatrixImageType *
+AnisotropicDiffusiveSparseRegistrationFilter
+  < TFixedImage, TMovingImage, TDeformationField >
+::GetWeightStructuresImage( void ) const
+{
+  if( m_WeightStructuresImage || !m_StructureIndexImage )
+    {
+    return m_WeightStructuresImage;
+    }
+  Self::template DecodeStructureIndexImage< WeightMatrixImageType >(
+      m_StructureIndexImage, m_StructureWeightMatrices,
+      m_DecodedWeightStructuresImage );
+  return m_DecodedWeightStructuresImage;
+}
+
+/**
+ * Get the high resolution weight structures image, expanding it from the
+ * compact storage
+ */
+template< class TFixedImage, class TMovingImage, class TDeformationField >
+typename AnisotropicDiffusiveSparseRegistrationFilter
+  < TFixedImage, TMovingImage, TDeformationField >::WeightMatrixImageType *
+AnisotropicDiffusiveSparseRegistrationFilter
+  < TFixedImage, TMovingImage, TDeformationField >
+::GetHighResolutionWeightStructuresImage( void ) const
+{
+  if( m_HighResolutionWeightStructuresImage
+      || !m_HighResolutionStructureIndexImage )
+    {
+    return m_HighResolutionWeightStructuresImage;
+    }
+  Self::template DecodeStructureIndexImage< WeightMatrixImageType >(
+      m_HighResolutionStructureIndexImage, m_StructureWeightMatrices,
+      m_DecodedHighResolutionWeightStructuresImage );
+  return m_DecodedHighResolutionWeightStructuresImage;
 }
 
 /**
@@ -202,8 +364,9 @@ AnisotropicDiffusiveSparseRegistrationFilter
   assert( this->GetOutput() );
 
   // Whether or not we must compute the normal vector and/or weight images
-  bool computeNormals = !m_NormalMatrixImage;
-  bool computeWeightStructures = !m_WeightStructuresImage;
+  bool computeNormals = !m_NormalMatrixImage && !m_StructureIndexImage;
+  bool computeWeightStructures
+      = !m_WeightStructuresImage && !m_StructureIndexImage;
   bool computeWeightRegularizations = !m_WeightRegularizationsImage;
 
   // If we have a template for image attributes, use it.  The normal and weight
@@ -241,8 +404,24 @@ AnisotropicDiffusiveSparseRegistrationFilter
       this->ComputeTubeNormals();
       }
 
-    // Allocate the normal vector and/or weight images
-    if( computeNormals )
+    // Allocate the normal vector and/or weight images.  If both the normals
+    // and the weight structures are computed, they only take the values of
+    // the closest surface or tube point, so store an index image instead.
+    if( computeNormals && computeWeightStructures )
+      {
+      m_StructureIndexImage = StructureIndexImageType::New();
+      if( highResolutionTemplate )
+        {
+        DiffusiveRegistrationFilterUtils::AllocateSpaceForImage(
+                                 m_StructureIndexImage, highResolutionTemplate );
+        }
+      else
+        {
+        DiffusiveRegistrationFilterUtils::AllocateSpaceForImage(
+                                 m_StructureIndexImage, output );
+        }
+      }
+    else if( computeNormals )
       {
       m_NormalMatrixImage = NormalMatrixImageType::New();
       if( highResolutionTemplate )
@@ -256,7 +435,7 @@ AnisotropicDiffusiveSparseRegistrationFilter
                                  output );
         }
       }
-    if( computeWeightStructures )
+    if( computeWeightStructures && !m_StructureIndexImage )
       {
       m_WeightStructuresImage = WeightMatrixImageType::New();
       if( highResolutionTemplate )
@@ -297,13 +476,23 @@ AnisotropicDiffusiveSparseRegistrationFilter
   // On subsequent iterations, we just do the resampling.
 
   // Set the high resolution images only once
-  if( !m_HighResolutionNormalMatrixImage )
+  if( m_StructureIndexImage )
     {
-    m_HighResolutionNormalMatrixImage = m_NormalMatrixImage;
+    if( !m_HighResolutionStructureIndexImage )
+      {
+      m_HighResolutionStructureIndexImage = m_StructureIndexImage;
+      }
     }
-  if( !m_HighResolutionWeightStructuresImage )
+  else
     {
-    m_HighResolutionWeightStructuresImage = m_WeightStructuresImage;
+    if( !m_HighResolutionNormalMatrixImage )
+      {
+      m_HighResolutionNormalMatrixImage = m_NormalMatrixImage;
+      }
+    if( !m_HighResolutionWeightStructuresImage )
+      {
+      m_HighResolutionWeightStructuresImage = m_WeightStructuresImage;
+      }
     }
   if( !m_HighResolutionWeightRegularizationsImage )
     {
@@ -314,21 +503,37 @@ AnisotropicDiffusiveSparseRegistrationFilter
   // make sure that the attributes of the member images match those of the
   // current output, so that they can be used to calclulate the diffusion
   // tensors, deformation components, etc
-  if( !DiffusiveRegistrationFilterUtils::CompareImageAttributes(
-        m_NormalMatrixImage.GetPointer(), output.GetPointer() ) )
+  if( m_StructureIndexImage )
     {
-    DiffusiveRegistrationFilterUtils::ResampleImageNearestNeighbor(
-          m_HighResolutionNormalMatrixImage, output, m_NormalMatrixImage );
-    assert( DiffusiveRegistrationFilterUtils::CompareImageAttributes(
-             m_NormalMatrixImage.GetPointer(), output.GetPointer() ) );
+    if( !DiffusiveRegistrationFilterUtils::CompareImageAttributes(
+          m_StructureIndexImage.GetPointer(), output.GetPointer() ) )
+      {
+      DiffusiveRegistrationFilterUtils::ResampleImageNearestNeighbor(
+            m_HighResolutionStructureIndexImage, output,
+            m_StructureIndexImage );
+      assert( DiffusiveRegistrationFilterUtils::CompareImageAttributes(
+               m_StructureIndexImage.GetPointer(), output.GetPointer() ) );
+      }
     }
-  if( !DiffusiveRegistrationFilterUtils::CompareImageAttributes(
-        m_WeightStructuresImage.GetPointer(), output.GetPointer() ) )
+  else
     {
-    DiffusiveRegistrationFilterUtils::ResampleImageNearestNeighbor(
-          m_HighResolutionWeightStructuresImage, output, m_WeightStructuresImage );
-    assert( DiffusiveRegistrationFilterUtils::CompareImageAttributes(
-             m_WeightStructuresImage.GetPointer(), output.GetPointer() ) );
+    if( !DiffusiveRegistrationFilterUtils::CompareImageAttributes(
+          m_NormalMatrixImage.GetPointer(), output.GetPointer() ) )
+      {
+      DiffusiveRegistrationFilterUtils::ResampleImageNearestNeighbor(
+            m_HighResolutionNormalMatrixImage, output, m_NormalMatrixImage );
+      assert( DiffusiveRegistrationFilterUtils::CompareImageAttributes(
+               m_NormalMatrixImage.GetPointer(), output.GetPointer() ) );
+      }
+    if( !DiffusiveRegistrationFilterUtils::CompareImageAttributes(
+          m_WeightStructuresImage.GetPointer(), output.GetPointer() ) )
+      {
+      DiffusiveRegistrationFilterUtils::ResampleImageNearestNeighbor(
+            m_HighResolutionWeightStructuresImage, output,
+            m_WeightStructuresImage );
+      assert( DiffusiveRegistrationFilterUtils::CompareImageAttributes(
+               m_WeightStructuresImage.GetPointer(), output.GetPointer() ) );
+      }
     }
   if( !DiffusiveRegistrationFilterUtils::CompareImageAttributes(
         m_WeightRegularizationsImage.GetPointer(), output.GetPointer() ) )
@@ -533,6 +738,54 @@ AnisotropicDiffusiveSparseRegistrationFilter
     assert( tubeRadiusData );
     }
 
+  // Fill the tables of the compact storage: one entry per surface point,
+  // followed by one entry per tube point
+  if( m_StructureIndexImage )
+    {
+    NormalMatrixType normalMatrix;
+    WeightMatrixType weightMatrix;
+    m_StructureNormalMatrices.clear();
+    m_StructureWeightMatrices.clear();
+    if( surfacePointLocator )
+      {
+      weightMatrix.Fill( 0 );
+      weightMatrix(0,0) = 1.0;
+      const vtkIdType numberOfSurfacePoints
+          = m_BorderSurface->GetNumberOfPoints();
+      for( vtkIdType id = 0; id < numberOfSurfacePoints; id++ )
+        {
+        normalMatrix.Fill( 0 );
+        for( unsigned int i = 0; i < ImageDimension; i++ )
+          {
+          normalMatrix(i,0)
+              = surfaceNormalData->GetValue( id * ImageDimension + i );
+          }
+        m_StructureNormalMatrices.push_back( normalMatrix );
+        m_StructureWeightMatrices.push_back( weightMatrix );
+        }
+      }
+    if( tubePointLocator )
+      {
+      weightMatrix.Fill( 0 );
+      weightMatrix(0,0) = 1.0;
+      weightMatrix(1,1) = 1.0;
+      const vtkIdType numberOfTubePoints = m_TubeSurface->GetNumberOfPoints();
+      for( vtkIdType id = 0; id < numberOfTubePoints; id++ )
+        {
+        normalMatrix.Fill( 0 );
+        for( unsigned int i = 0; i < ImageDimension; i++ )
+          {
+          normalMatrix(i,0)
+              = tubeNormal1Data->GetValue( id * ImageDimension + i );
+          normalMatrix(i,1)
+              = tubeNormal2Data->GetValue( id * ImageDimension + i );
+          }
+        m_StructureNormalMatrices.push_back( normalMatrix );
+        m_StructureWeightMatrices.push_back( weightMatrix );
+        }
+      }
+    }
+
   // Set up struct for multithreaded processing.
   AnisotropicDiffusiveSparseRegistrationFilterThreadStruct str;
   str.Filter = this;
@@ -542,10 +795,20 @@ AnisotropicDiffusiveSparseRegistrationFilter
   str.TubeNormal1Data = tubeNormal1Data;
   str.TubeNormal2Data = tubeNormal2Data;
   str.TubeRadiusData = tubeRadiusData;
-  str.NormalMatrixImageLargestPossibleRegion
-      = m_NormalMatrixImage->GetLargestPossibleRegion();
-  str.WeightStructuresImageLargestPossibleRegion
-      = m_WeightStructuresImage->GetLargestPossibleRegion();
+  if( m_StructureIndexImage )
+    {
+    str.NormalMatrixImageLargestPossibleRegion
+        = m_StructureIndexImage->GetLargestPossibleRegion();
+    str.WeightStructuresImageLargestPossibleRegion
+        = m_StructureIndexImage->GetLargestPossibleRegion();
+    }
+  else
+    {
+    str.NormalMatrixImageLargestPossibleRegion
+        = m_NormalMatrixImage->GetLargestPossibleRegion();
+    str.WeightStructuresImageLargestPossibleRegion
+        = m_WeightStructuresImage->GetLargestPossibleRegion();
+    }
   str.WeightRegularizationsImageLargestPossibleRegion
       = m_WeightRegularizationsImage->GetLargestPossibleRegion();
   str.ComputeNormals = computeNormals;
@@ -562,8 +825,15 @@ AnisotropicDiffusiveSparseRegistrationFilter
   // Explicitly call Modified on the normal and weight images here, since
   // ThreadedGetNormalsAndDistancesFromClosestSurfacePoint changes these buffers
   // through iterators which do not increment the update buffer timestamp
-  this->m_NormalMatrixImage->Modified();
-  this->m_WeightStructuresImage->Modified();
+  if( m_StructureIndexImage )
+    {
+    this->m_StructureIndexImage->Modified();
+    }
+  else
+    {
+    this->m_NormalMatrixImage->Modified();
+    this->m_WeightStructuresImage->Modified();
+    }
   this->m_WeightRegularizationsImage->Modified();
 }
 
@@ -664,13 +934,31 @@ AnisotropicDiffusiveSparseRegistrationFilter
           || ( tubePointLocator && tubeNormal1Data && tubeNormal2Data
                && tubeRadiusData ) );
 
-  // Setup iterators over the normal vector and weight images
-  NormalMatrixImageRegionType normalIt(
-      m_NormalMatrixImage, normalRegionToProcess );
+  // Setup iterators over the normal vector and weight images, or over the
+  // structure index image if they are stored compactly
+  const bool useStructureIndex = m_StructureIndexImage.IsNotNull();
+  NormalMatrixImageRegionType normalIt;
+  WeightMatrixImageRegionType weightStructuresIt;
+  StructureIndexImageRegionType structureIndexIt;
+  if( useStructureIndex )
+    {
+    structureIndexIt = StructureIndexImageRegionType(
+        m_StructureIndexImage, normalRegionToProcess );
+    structureIndexIt.GoToBegin();
+    }
+  else
+    {
+    normalIt = NormalMatrixImageRegionType(
+        m_NormalMatrixImage, normalRegionToProcess );
+    weightStructuresIt = WeightMatrixImageRegionType(
+        m_WeightStructuresImage, weightMatrixRegionToProcess );
+    normalIt.GoToBegin();
+    weightStructuresIt.GoToBegin();
+    }
   WeightComponentImageRegionType weightRegularizationsIt(
       m_WeightRegularizationsImage, weightComponentRegionToProcess );
-  WeightMatrixImageRegionType weightStructuresIt(
-      m_WeightStructuresImage, weightMatrixRegionToProcess );
+  const vtkIdType numberOfSurfacePoints
+      = surfacePointLocator ? m_BorderSurface->GetNumberOfPoints() : 0;
 
   // The normal vector image will hold the normal of the closest point of the
   // surface polydata, and the weight image will be a function of the distance
@@ -697,17 +985,16 @@ AnisotropicDiffusiveSparseRegistrationFilter
   tubeWeightMatrix(1,1) = 1.0;
 
   // Determine the normals of and the distances to the nearest border point
-  for( normalIt.GoToBegin(),
-       weightRegularizationsIt.GoToBegin(), weightStructuresIt.GoToBegin();
-       !normalIt.IsAtEnd();
-       ++normalIt, ++weightRegularizationsIt, ++weightStructuresIt )
+  for( weightRegularizationsIt.GoToBegin();
+       !weightRegularizationsIt.IsAtEnd();
+       ++weightRegularizationsIt )
     {
     surfaceDistance = 100000000.0;
     tubeDistance = 100000000.0;
 
     // Find the id of the closest surface point to the current voxel
-    m_NormalMatrixImage->TransformIndexToPhysicalPoint( normalIt.GetIndex(),
-                                                        imageCoord );
+    m_WeightRegularizationsImage->TransformIndexToPhysicalPoint(
+        weightRegularizationsIt.GetIndex(), imageCoord );
     if( surfacePointLocator )
       {
       surfaceId = surfacePointLocator->FindClosestPoint(
@@ -751,8 +1038,27 @@ AnisotropicDiffusiveSparseRegistrationFilter
           = std::abs( distanceToCenterCoord - tubeRadiusData->GetValue( tubeId ));
       }
 
+    // With the compact storage, the normal and the weight structures are
+    // those of the table entry of the closest surface or tube point
+    if( useStructureIndex )
+      {
+      if( computeNormals || computeWeightStructures )
+        {
+        if( surfaceDistance <= tubeDistance )
+          {
+          structureIndexIt.Set(
+              static_cast< StructureIndexType >( surfaceId ) );
+          }
+        else
+          {
+          structureIndexIt.Set( static_cast< StructureIndexType >(
+              numberOfSurfacePoints + tubeId ) );
+          }
+        }
+      }
+
     // Find the normal of the surface point that is closest to the current voxel
-    if( computeNormals )
+    else if( computeNormals )
       {
       normalMatrix.Fill(0);
       for( unsigned int i = 0; i < ImageDimension; i++ )
@@ -788,7 +1094,7 @@ AnisotropicDiffusiveSparseRegistrationFilter
       }
 
     // Determine the weight structures based on the structure type
-    if( computeWeightStructures )
+    if( computeWeightStructures && !useStructureIndex )
       {
       if( surfaceDistance <= tubeDistance )
         {
@@ -799,6 +1105,16 @@ AnisotropicDiffusiveSparseRegistrationFilter
         weightStructuresIt.Set( tubeWeightMatrix );
         }
       }
+
+    if( useStructureIndex )
+      {
+      ++structureIndexIt;
+      }
+    else
+      {
+      ++normalIt;
+      ++weightStructuresIt;
+      }
     }
 }
 
@@ -861,8 +1177,8 @@ AnisotropicDiffusiveSparseRegistrationFilter
   assert( this->GetComputeRegularizationTerm() );
   //assert( m_BorderSurface->GetPointData()->GetNormals() || m_TubeSurface );
   // TODO put back
-  assert( m_NormalMatrixImage );
-  assert( m_WeightStructuresImage );
+  assert( m_StructureIndexImage
+          || ( m_NormalMatrixImage && m_WeightStructuresImage ) );
   assert( m_WeightRegularizationsImage );
 
   std::cout << "Computing normals and weights... " << std::endl;
@@ -981,8 +1297,8 @@ AnisotropicDiffusiveSparseRegistrationFilter
 ::ComputeDiffusionTensorImages( void )
 {
   assert( this->GetComputeRegularizationTerm() );
-  assert( m_NormalMatrixImage );
-  assert( m_WeightStructuresImage );
+  assert( m_StructureIndexImage
+          || ( m_NormalMatrixImage && m_WeightStructuresImage ) );
   assert( m_WeightRegularizationsImage );
 
   // For the anisotropic diffusive regularization, we need to setup the
@@ -1017,13 +1333,9 @@ AnisotropicDiffusiveSparseRegistrationFilter
   DiffusionTensorType     propTangentialDiffusionTensor;
   DiffusionTensorType     propNormalDiffusionTensor;
 
-  // Setup iterators
-  NormalMatrixImageRegionType normalIt = NormalMatrixImageRegionType(
-      m_NormalMatrixImage, m_NormalMatrixImage->GetLargestPossibleRegion() );
-  WeightMatrixImageRegionType weightStructuresIt
-      = WeightMatrixImageRegionType(
-          m_WeightStructuresImage,
-          m_WeightStructuresImage->GetLargestPossibleRegion() );
+  // Setup iterators.  The normal matrices and weight structures are looked
+  // up by buffer offset, since they may be stored as a structure index image
+  SizeValueType offset = 0;
   WeightComponentImageRegionType weightRegularizationsIt
       = WeightComponentImageRegionType(
       m_WeightRegularizationsImage,
@@ -1049,18 +1361,15 @@ AnisotropicDiffusiveSparseRegistrationFilter
           this->GetDiffusionTensorImage( PROP_NORMAL )
           ->GetLargestPossibleRegion() );
 
-  for( normalIt.GoToBegin(),
-       weightStructuresIt.GoToBegin(), weightRegularizationsIt.GoToBegin(),
+  for( weightRegularizationsIt.GoToBegin(),
        smoothTangentialTensorIt.GoToBegin(), smoothNormalTensorIt.GoToBegin(),
        propTangentialTensorIt.GoToBegin(), propNormalTensorIt.GoToBegin();
        !smoothTangentialTensorIt.IsAtEnd();
-       ++normalIt,
-       ++weightStructuresIt, ++weightRegularizationsIt,
+       ++offset, ++weightRegularizationsIt,
        ++smoothTangentialTensorIt, ++smoothNormalTensorIt,
        ++propTangentialTensorIt, ++propNormalTensorIt )
     {
-    N = normalIt.Get();
-    A = weightStructuresIt.Get();
+    this->GetNormalMatrixAndWeightStructures( offset, N, A );
     w = weightRegularizationsIt.Get();
 
     // The matrices are used for calculations, and will be copied to the
@@ -1108,7 +1417,8 @@ AnisotropicDiffusiveSparseRegistrationFilter
 {
   assert( this->GetComputeRegularizationTerm() );
   assert( this->GetOutput() );
-  assert( this->GetNormalMatrixImage() );
+  assert( m_StructureIndexImage
+          || ( m_NormalMatrixImage && m_WeightStructuresImage ) );
 
   // The output will be used as the template to allocate the images we will
   // use to store data computed before/during the registration
@@ -1120,13 +1430,6 @@ AnisotropicDiffusiveSparseRegistrationFilter
   // superclass will init them to zeros for us.
   // The prop multiplication vector is NAN_l
 
-  // Iterate over the normal matrix and weight images
-  NormalMatrixImageRegionType normalIt = NormalMatrixImageRegionType(
-      m_NormalMatrixImage, m_NormalMatrixImage->GetLargestPossibleRegion() );
-  WeightMatrixImageRegionType weightStructuresIt = WeightMatrixImageRegionType(
-      m_WeightStructuresImage,
-      m_WeightStructuresImage->GetLargestPossibleRegion() );
-
   DeformationVectorType multVector;
   multVector.Fill( 0.0 );
   NormalMatrixType N;
@@ -1146,14 +1449,13 @@ AnisotropicDiffusiveSparseRegistrationFilter
     // Calculate NAN_l
     DeformationVectorImageRegionType multIt = DeformationVectorImageRegionType(
         normalMultsImage, normalMultsImage->GetLargestPossibleRegion() );
-    for( normalIt.GoToBegin(), weightStructuresIt.GoToBegin(),
-         multIt.GoToBegin();
-         !multIt.IsAtEnd();
-         ++normalIt, ++weightStructuresIt, ++multIt )
+    // The normal matrices and weight structures are looked up by buffer
+    // offset, since they may be stored as a structure index image
+    SizeValueType offset = 0;
+    for( multIt.GoToBegin(); !multIt.IsAtEnd(); ++multIt, ++offset )
       {
       multVector.Fill( 0.0 );
-      N = normalIt.Get();
-      A = weightStructuresIt.Get();
+      this->GetNormalMatrixAndWeightStructures( offset, N, A );
       for( unsigned int j = 0; j < ImageDimension; j++ )
         {
         N_l[j] = N[i][j];
@@ -1338,33 +1640,22 @@ AnisotropicDiffusiveSparseRegistrationFilter
     int dim,
     bool getHighResolutionNormalVectorImage ) const
 {
-  if( getHighResolutionNormalVectorImage && !m_HighResolutionNormalMatrixImage )
-    {
-    return;
-    }
-  if( !getHighResolutionNormalVectorImage && !m_NormalMatrixImage )
+  // The normal matrix images may have to be expanded from the compact
+  // storage
+  NormalMatrixImageType * normalMatrixImage
+      = getHighResolutionNormalVectorImage
+        ? this->GetHighResolutionNormalMatrixImage()
+        : this->GetNormalMatrixImage();
+  if( !normalMatrixImage )
     {
     return;
     }
 
   // Allocate the vector image and iterate over the normal matrix image
-  NormalMatrixImageRegionType normalMatrixIt;
-  if( getHighResolutionNormalVectorImage )
-    {
-    DiffusiveRegistrationFilterUtils::AllocateSpaceForImage( normalImage,
-                                 m_HighResolutionNormalMatrixImage );
-    normalMatrixIt = NormalMatrixImageRegionType(
-        m_HighResolutionNormalMatrixImage,
-        m_HighResolutionNormalMatrixImage->GetLargestPossibleRegion() );
-    }
-  else
-    {
-    DiffusiveRegistrationFilterUtils::AllocateSpaceForImage( normalImage,
-                                 m_NormalMatrixImage );
-    normalMatrixIt = NormalMatrixImageRegionType(
-        m_NormalMatrixImage,
-        m_NormalMatrixImage->GetLargestPossibleRegion() );
-    }
+  DiffusiveRegistrationFilterUtils::AllocateSpaceForImage( normalImage,
+                               normalMatrixImage );
+  NormalMatrixImageRegionType normalMatrixIt = NormalMatrixImageRegionType(
+      normalMatrixImage, normalMatrixImage->GetLargestPossibleRegion() );
   typedef itk::ImageRegionIterator< NormalVectorImageType >
       NormalVectorImageRegionType;
   NormalVectorImageRegionType normalVectorIt = NormalVectorImageRegionType(
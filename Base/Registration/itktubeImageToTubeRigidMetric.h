@@ -28,6 +28,8 @@ limitations under the License.
 #include <itkCompensatedSummation.h>
 #include <itkGaussianDerivativeImageFunction.h>
 #include <itkImageToSpatialObjectMetric.h>
+#include <itkMultiThreader.h>
+#include <itkSymmetricSecondRankTensor.h>
 
 namespace itk
 {
@@ -139,6 +141,32 @@ public:
   itkSetMacro( Extent, ScalarType );
   itkGetConstMacro( Extent, ScalarType );
 
+  /** Use gradient and Hessian images of the fixed image, blurred at
+   * DerivativeImageScalesPerOctave scales per octave, instead of sampling
+   * the image along the tube normals.  Each tube point then costs one
+   * interpolation per image, but the 1-D derivative kernels are only
+   * approximated by the blurred image's derivatives at the nearest scale.
+   * Off by default.  Takes effect on Initialize(). */
+  itkSetMacro( UseDerivativeImages, bool );
+  itkGetConstMacro( UseDerivativeImages, bool );
+  itkBooleanMacro( UseDerivativeImages );
+
+  itkSetMacro( DerivativeImageScalesPerOctave, unsigned int );
+  itkGetConstMacro( DerivativeImageScalesPerOctave, unsigned int );
+
+  /** The 1-D derivative kernels are shared by the tube points whose scales
+   * round to the same of KernelScalesPerOctave log-spaced scales per
+   * octave, so the kernel scale is within 2^( 1 / ( 2 n ) ) of the point's
+   * scale.  Zero computes one kernel per distinct scale.  Defaults to 32.
+   * Takes effect on Initialize(). */
+  itkSetMacro( KernelScalesPerOctave, unsigned int );
+  itkGetConstMacro( KernelScalesPerOctave, unsigned int );
+
+  /** Set/Get the number of threads used to evaluate the tube points.
+   * The value and derivative do not depend on it. */
+  itkSetMacro( NumberOfThreads, unsigned int );
+  itkGetConstMacro( NumberOfThreads, unsigned int );
+
   /** Set/Get the scalar weights associated with every point in the tube.
    * The index of the point weights should correspond to "standard tube tree
    * interation". */
@@ -179,6 +207,56 @@ private:
   ScalarType m_MinimumScalingRadius;
   ScalarType m_Extent;
 
+  bool         m_UseDerivativeImages;
+  unsigned int m_DerivativeImageScalesPerOctave;
+  unsigned int m_KernelScalesPerOctave;
+
+  unsigned int m_NumberOfThreads;
+
+  typedef typename TubePointType::CovariantVectorType NormalType;
+
+  /** The tube points, copied at Initialize() in "standard tube tree
+   * iteration" order so they can be split among threads */
+  std::vector< InputPointType > m_TubePointPositions;
+  std::vector< NormalType >     m_TubePointNormal1s;
+  std::vector< NormalType >     m_TubePointNormal2s;
+  std::vector< ScalarType >     m_TubePointRadii;
+
+  /** The sampled 1-D Gaussian derivative kernels of one scale.  They only
+   * depend on the scale, so Initialize() computes them once for every
+   * bucket of KernelScalesPerOctave scales.  Tap i lies at distance
+   * FirstDistance + i * step along the normal. */
+  struct DerivativeKernelType
+    {
+    ScalarType                 Scale;
+    ScalarType                 FirstDistance;
+    ScalarType                 SecondDerivativeStep;
+    ScalarType                 FirstDerivativeStep;
+    std::vector< ScalarType >  SecondDerivativeValues;
+    std::vector< ScalarType >  FirstDerivativeValues;
+    ScalarType                 FirstDerivativeAbsoluteSum;
+    }; // End struct DerivativeKernelType
+
+  typedef Image< CovariantVector< ScalarType, ImageDimension >,
+    ImageDimension >                                  GradientImageType;
+  typedef Image< SymmetricSecondRankTensor< ScalarType, ImageDimension >,
+    ImageDimension >                                  HessianImageType;
+
+  struct DerivativeImagesType
+    {
+    ScalarType                            Scale;
+    typename GradientImageType::Pointer   Gradient;
+    typename HessianImageType::Pointer    Hessian;
+    }; // End struct DerivativeImagesType
+
+  /** Scales, kernels, and derivative images, indexed per tube point in
+   * "standard tube tree iteration" order */
+  std::vector< ScalarType >             m_PointScales;
+  std::vector< DerivativeKernelType >   m_DerivativeKernels;
+  std::vector< unsigned int >           m_PointKernelIndex;
+  std::vector< DerivativeImagesType >   m_DerivativeImages;
+  std::vector< unsigned int >           m_PointDerivativeImagesIndex;
+
   /** The center of rotation of the weighted tube points. */
   typedef PointType CenterOfRotationType;
   CenterOfRotationType m_CenterOfRotation;
@@ -191,13 +269,53 @@ private:
     OutputPointType & outputPoint,
     const TransformType * transform ) const;
 
+  /** Copy the tube points into the m_TubePoint* arrays */
+  void FlattenTubePoints( void );
+
+  /** Compute the kernels and derivative images used by the tube points */
+  void ComputePointScales( void );
+
+  /** Per-point results of EvaluateTubePoints().  Each thread writes the
+   * entries of its own points; the callers then sum them in point order,
+   * so the result does not depend on the number of threads. */
+  struct TubePointsThreadStruct
+    {
+    const Self *            Metric;
+    const TransformType *   Transform;
+    bool                    ComputeDerivative;
+    unsigned char *         Inside;
+    ScalarType *            LaplacianMagnitudes;
+    OutputPointType *       TransformedPoints;
+    VectorType *            TransformedNormal1s;
+    VectorType *            TransformedNormal2s;
+    VectorType *            PointDerivatives;
+    }; // End struct TubePointsThreadStruct
+
+  static ITK_THREAD_RETURN_TYPE TubePointsThreaderCallback( void * arg );
+
+  void EvaluateTubePoints( TubePointsThreadStruct & str ) const;
+
+  void ComputeDerivativeKernel( ScalarType scale,
+    DerivativeKernelType & kernel ) const;
+
+  /** Whether Initialize() precomputed the kernels for this point at this
+   * scale; otherwise, e.g. if Kappa changed since, they are recomputed. */
+  bool HasPrecomputedScale( SizeValueType pointId, ScalarType scale ) const;
+
+  /** Linearly interpolate a derivative image, clamping at its border */
+  template< class TImage >
+  static typename TImage::PixelType InterpolateDerivativeImage(
+    const TImage * image, const OutputPointType & point );
+
   ScalarType ComputeLaplacianMagnitude(
     const typename TubePointType::CovariantVectorType & tubeNormal,
     const ScalarType scale,
+    SizeValueType pointId,
     const OutputPointType & currentPoint ) const;
   ScalarType ComputeThirdDerivatives(
     const VectorType & v,
     const ScalarType scale,
+    SizeValueType pointId,
     const OutputPointType & currentPoint ) const;
 
   /**
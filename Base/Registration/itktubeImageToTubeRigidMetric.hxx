@@ -26,8 +26,12 @@ limitations under the License.
 
 #include "itktubeImageToTubeRigidMetric.h"
 
+#include <itkGradientRecursiveGaussianImageFilter.h>
+#include <itkHessianRecursiveGaussianImageFilter.h>
 #include <itkLinearInterpolateImageFunction.h>
 
+#include <map>
+
 namespace itk
 {
 
@@ -43,6 +47,12 @@ ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject, TTubeSpatialObject >
   m_MinimumScalingRadius = 0.1;
   m_Extent = 3.0;
 
+  m_UseDerivativeImages = false;
+  m_DerivativeImageScalesPerOctave = 4;
+  m_KernelScalesPerOctave = 32;
+
+  m_NumberOfThreads = MultiThreader::GetGlobalDefaultNumberOfThreads();
+
   m_CenterOfRotation.Fill( 0.0 );
 
   m_DerivativeImageFunction = DerivativeImageFunctionType::New();
@@ -104,6 +114,255 @@ ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject, TTubeSpatialObject >
 
   this->m_Interpolator->SetInputImage( this->m_FixedImage );
   this->m_DerivativeImageFunction->SetInputImage( this->m_FixedImage );
+
+  this->FlattenTubePoints();
+  this->ComputePointScales();
+}
+
+
+template< class TFixedImage, class TMovingSpatialObject,
+          class TTubeSpatialObject >
+void
+ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject, TTubeSpatialObject >
+::FlattenTubePoints( void )
+{
+  const SizeValueType tubePoints = this->m_FeatureWeights.GetSize();
+  m_TubePointPositions.clear();
+  m_TubePointPositions.reserve( tubePoints );
+  m_TubePointNormal1s.clear();
+  m_TubePointNormal1s.reserve( tubePoints );
+  m_TubePointNormal2s.clear();
+  m_TubePointNormal2s.reserve( tubePoints );
+  m_TubePointRadii.clear();
+  m_TubePointRadii.reserve( tubePoints );
+
+  typename TubeTreeType::ChildrenListType * tubeList = this->GetTubes();
+  typename TubeTreeType::ChildrenListType::const_iterator tubeIterator;
+  for( tubeIterator = tubeList->begin();
+       tubeIterator != tubeList->end();
+       ++tubeIterator )
+    {
+    TubeType* currentTube = dynamic_cast<TubeType*>(
+      ( *tubeIterator ).GetPointer() );
+
+    if( currentTube != NULL )
+      {
+      typename TubeType::PointListType::const_iterator pointIterator;
+      for( pointIterator = currentTube->GetPoints().begin();
+           pointIterator != currentTube->GetPoints().end();
+           ++pointIterator )
+        {
+        m_TubePointPositions.push_back( pointIterator->GetPosition() );
+        m_TubePointNormal1s.push_back( pointIterator->GetNormal1() );
+        m_TubePointNormal2s.push_back( pointIterator->GetNormal2() );
+        m_TubePointRadii.push_back( pointIterator->GetRadius() );
+        }
+      }
+    }
+  delete tubeList;
+}
+
+
+template< class TFixedImage, class TMovingSpatialObject,
+          class TTubeSpatialObject >
+void
+ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject, TTubeSpatialObject >
+::ComputePointScales( void )
+{
+  m_PointScales.clear();
+  m_DerivativeKernels.clear();
+  m_PointKernelIndex.clear();
+  m_DerivativeImages.clear();
+  m_PointDerivativeImagesIndex.clear();
+
+  std::map< ScalarType, unsigned int > kernelIndex;
+  std::map< int, unsigned int > imagesIndex;
+
+  for( unsigned int pointId = 0; pointId < m_TubePointRadii.size();
+    ++pointId )
+    {
+    ScalarType scalingRadius = m_TubePointRadii[pointId];
+    scalingRadius = std::max( scalingRadius, m_MinimumScalingRadius );
+    const ScalarType scale = scalingRadius * m_Kappa;
+    m_PointScales.push_back( scale );
+
+    // Round the scale to the nearest of the log-spaced kernel scales
+    ScalarType kernelScale = scale;
+    if( m_KernelScalesPerOctave > 0 )
+      {
+      const int kernelBucket = Math::Round< int >(
+        m_KernelScalesPerOctave * vcl_log( scale ) / vnl_math::ln2 );
+      kernelScale = std::pow( 2.0, static_cast< double >( kernelBucket )
+        / m_KernelScalesPerOctave );
+      }
+
+    typename std::map< ScalarType, unsigned int >::const_iterator
+      kernelIt = kernelIndex.find( kernelScale );
+    if( kernelIt == kernelIndex.end() )
+      {
+      kernelIt = kernelIndex.insert( std::make_pair( kernelScale,
+        static_cast< unsigned int >( m_DerivativeKernels.size() ) ) )
+        .first;
+      m_DerivativeKernels.push_back( DerivativeKernelType() );
+      this->ComputeDerivativeKernel( kernelScale,
+        m_DerivativeKernels.back() );
+      }
+    m_PointKernelIndex.push_back( kernelIt->second );
+
+    if( m_UseDerivativeImages )
+      {
+      // Round the scale to the nearest of the log-spaced scales
+      const int bucket = Math::Round< int >(
+        m_DerivativeImageScalesPerOctave
+        * vcl_log( scale ) / vnl_math::ln2 );
+      typename std::map< int, unsigned int >::const_iterator
+        imagesIt = imagesIndex.find( bucket );
+      if( imagesIt == imagesIndex.end() )
+        {
+        imagesIt = imagesIndex.insert( std::make_pair( bucket,
+          static_cast< unsigned int >( m_DerivativeImages.size() ) ) )
+          .first;
+        DerivativeImagesType images;
+        images.Scale = std::pow( 2.0, static_cast< double >( bucket )
+          / m_DerivativeImageScalesPerOctave );
+        m_DerivativeImages.push_back( images );
+        }
+      m_PointDerivativeImagesIndex.push_back( imagesIt->second );
+      }
+    }
+
+  typedef GradientRecursiveGaussianImageFilter< FixedImageType,
+    GradientImageType >                               GradientFilterType;
+  typedef HessianRecursiveGaussianImageFilter< FixedImageType,
+    HessianImageType >                                HessianFilterType;
+  for( unsigned int i = 0; i < m_DerivativeImages.size(); ++i )
+    {
+    typename GradientFilterType::Pointer gradientFilter =
+      GradientFilterType::New();
+    gradientFilter->SetInput( this->m_FixedImage );
+    gradientFilter->SetSigma( m_DerivativeImages[i].Scale );
+    gradientFilter->Update();
+    m_DerivativeImages[i].Gradient = gradientFilter->GetOutput();
+
+    typename HessianFilterType::Pointer hessianFilter =
+      HessianFilterType::New();
+    hessianFilter->SetInput( this->m_FixedImage );
+    hessianFilter->SetSigma( m_DerivativeImages[i].Scale );
+    hessianFilter->Update();
+    m_DerivativeImages[i].Hessian = hessianFilter->GetOutput();
+    }
+}
+
+
+template< class TFixedImage, class TMovingSpatialObject,
+          class TTubeSpatialObject >
+void
+ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject, TTubeSpatialObject >
+::ComputeDerivativeKernel( ScalarType scale,
+  DerivativeKernelType & kernel ) const
+{
+  // The taps are spaced as the convolutions used to step along the
+  // normal, but from the first distance so the round-off does not grow
+  const ScalarType scaleSquared = scale * scale;
+  const ScalarType scaleExtentProduct = scale * m_Extent;
+
+  kernel.Scale = scale;
+  kernel.FirstDistance = -scaleExtentProduct;
+  //! \todo better calculation of the increments than fixed steps
+  kernel.SecondDerivativeStep = 1.0;
+  kernel.FirstDerivativeStep = 0.1;
+
+  kernel.SecondDerivativeValues.clear();
+  for( ScalarType distance = -scaleExtentProduct;
+       distance <= scaleExtentProduct;
+       distance = kernel.FirstDistance + kernel.SecondDerivativeStep
+         * kernel.SecondDerivativeValues.size() )
+    {
+    const ScalarType distanceSquared = distance * distance;
+    kernel.SecondDerivativeValues.push_back(
+      ( -1.0 + ( distanceSquared / scaleSquared ) )
+      * std::exp( -0.5 * distanceSquared / scaleSquared ) );
+    }
+
+  kernel.FirstDerivativeValues.clear();
+  CompensatedSummationType kernelSum;
+  for( ScalarType distance = -scaleExtentProduct;
+       distance <= scaleExtentProduct;
+       distance = kernel.FirstDistance + kernel.FirstDerivativeStep
+         * kernel.FirstDerivativeValues.size() )
+    {
+    const ScalarType distanceSquared = distance * distance;
+    const ScalarType kernelValue =
+      2.0 * distance * std::exp( -0.5 * distanceSquared / scaleSquared );
+    kernel.FirstDerivativeValues.push_back( kernelValue );
+    kernelSum += vnl_math_abs( kernelValue );
+    }
+  kernel.FirstDerivativeAbsoluteSum = kernelSum.GetSum();
+}
+
+
+template< class TFixedImage, class TMovingSpatialObject,
+          class TTubeSpatialObject >
+bool
+ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject, TTubeSpatialObject >
+::HasPrecomputedScale( SizeValueType pointId, ScalarType scale ) const
+{
+  return pointId < m_PointScales.size()
+    && m_PointScales[pointId] == scale;
+}
+
+
+template< class TFixedImage, class TMovingSpatialObject,
+          class TTubeSpatialObject >
+template< class TImage >
+typename TImage::PixelType
+ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject, TTubeSpatialObject >
+::InterpolateDerivativeImage( const TImage * image,
+  const OutputPointType & point )
+{
+  ContinuousIndex< ScalarType, ImageDimension > cIndex;
+  image->TransformPhysicalPointToContinuousIndex( point, cIndex );
+
+  const typename TImage::RegionType region = image->GetBufferedRegion();
+  typename TImage::IndexType baseIndex;
+  ScalarType fraction[ ImageDimension ];
+  for( unsigned int ii = 0; ii < ImageDimension; ++ii )
+    {
+    baseIndex[ii] = Math::Floor< IndexValueType >( cIndex[ii] );
+    fraction[ii] = cIndex[ii] - baseIndex[ii];
+    }
+
+  typename TImage::PixelType value;
+  value.Fill( 0 );
+  for( unsigned int corner = 0; corner < ( 1u << ImageDimension );
+    ++corner )
+    {
+    ScalarType weight = 1;
+    typename TImage::IndexType index;
+    for( unsigned int ii = 0; ii < ImageDimension; ++ii )
+      {
+      if( corner & ( 1u << ii ) )
+        {
+        index[ii] = baseIndex[ii] + 1;
+        weight *= fraction[ii];
+        }
+      else
+        {
+        index[ii] = baseIndex[ii];
+        weight *= 1 - fraction[ii];
+        }
+      const IndexValueType lastIndex = region.GetIndex()[ii]
+        + static_cast< IndexValueType >( region.GetSize()[ii] ) - 1;
+      index[ii] = std::max( region.GetIndex()[ii],
+        std::min( lastIndex, index[ii] ) );
+      }
+    if( weight != 0 )
+      {
+      value += image->GetPixel( index ) * weight;
+      }
+    }
+
+  return value;
 }
 
 
@@ -231,40 +490,31 @@ ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject, TTubeSpatialObject >
   transformCopy->SetFixedParameters( this->m_Transform->GetFixedParameters() );
   transformCopy->SetParameters( parameters );
 
-  typename TubeTreeType::ChildrenListType::iterator tubeIterator;
-  typename TubeTreeType::ChildrenListType * tubeList = GetTubes();
-  SizeValueType weightCount = 0;
-  for( tubeIterator = tubeList->begin();
-       tubeIterator != tubeList->end();
-       ++tubeIterator )
+  const SizeValueType numberOfPoints = m_TubePointPositions.size();
+  std::vector< unsigned char > inside( numberOfPoints );
+  std::vector< ScalarType > laplacianMagnitudes( numberOfPoints );
+
+  TubePointsThreadStruct str;
+  str.Metric = this;
+  str.Transform = transformCopy;
+  str.ComputeDerivative = false;
+  str.Inside = numberOfPoints > 0 ? &( inside[0] ) : NULL;
+  str.LaplacianMagnitudes =
+    numberOfPoints > 0 ? &( laplacianMagnitudes[0] ) : NULL;
+  str.TransformedPoints = NULL;
+  str.TransformedNormal1s = NULL;
+  str.TransformedNormal2s = NULL;
+  str.PointDerivatives = NULL;
+  this->EvaluateTubePoints( str );
+
+  for( SizeValueType pointId = 0; pointId < numberOfPoints; ++pointId )
     {
-    TubeType * currentTube =
-      dynamic_cast< TubeType * >( ( *tubeIterator ).GetPointer() );
-    if( currentTube != NULL )
+    if( inside[pointId] )
       {
-      typename TubeType::PointListType::iterator pointIterator;
-      for( pointIterator = currentTube->GetPoints().begin();
-           pointIterator != currentTube->GetPoints().end();
-           ++pointIterator )
-        {
-        const InputPointType inputPoint = pointIterator->GetPosition();
-        OutputPointType currentPoint;
-        if( this->IsInside( inputPoint, currentPoint, transformCopy ) )
-          {
-          weightSum += m_FeatureWeights[weightCount];
-          ScalarType scalingRadius = pointIterator->GetRadius();
-          scalingRadius = std::max( scalingRadius, m_MinimumScalingRadius );
-
-          const ScalarType scale = scalingRadius * m_Kappa;
-
-          matchMeasure += m_FeatureWeights[weightCount] * vnl_math_abs(
-            this->ComputeLaplacianMagnitude( pointIterator->GetNormal1(),
-              scale,
-              currentPoint ) );
-          }
-        ++weightCount;
-        }
-      } // end is a tube
+      weightSum += m_FeatureWeights[pointId];
+      matchMeasure += m_FeatureWeights[pointId]
+        * laplacianMagnitudes[pointId];
+      }
     }
 
   if( weightSum.GetSum() == NumericTraits< ScalarType >::Zero )
@@ -282,7 +532,6 @@ ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject, TTubeSpatialObject >
 
   itkDebugMacro( << "matchMeasure = " << matchMeasure.GetSum() );
 
-  delete tubeList;
   return matchMeasure.GetSum();
 }
 
@@ -297,32 +546,62 @@ ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject, TTubeSpatialObject >
 ::ComputeLaplacianMagnitude(
   const typename TubePointType::CovariantVectorType & tubeNormal,
   const ScalarType scale,
+  SizeValueType pointId,
   const OutputPointType & currentPoint ) const
 {
+  const bool precomputed = this->HasPrecomputedScale( pointId, scale );
+
+  if( precomputed && pointId < m_PointDerivativeImagesIndex.size() )
+    {
+    // For a smooth image the sampled kernel below approximates
+    // sqrt( 2 pi ) scale^3 times the second derivative along the normal
+    const DerivativeImagesType & images =
+      m_DerivativeImages[ m_PointDerivativeImagesIndex[pointId] ];
+    const typename HessianImageType::PixelType hessian =
+      InterpolateDerivativeImage( images.Hessian.GetPointer(),
+        currentPoint );
+    ScalarType normalHessianNormal = 0;
+    for( unsigned int ii = 0; ii < ImageDimension; ++ii )
+      {
+      for( unsigned int jj = 0; jj < ImageDimension; ++jj )
+        {
+        normalHessianNormal += tubeNormal.GetElement(ii)
+          * hessian( ii, jj ) * tubeNormal.GetElement(jj);
+        }
+      }
+    return std::sqrt( 2.0 * vnl_math::pi ) * images.Scale * images.Scale
+      * images.Scale * normalHessianNormal;
+    }
+
+  DerivativeKernelType localKernel;
+  if( !precomputed )
+    {
+    this->ComputeDerivativeKernel( scale, localKernel );
+    }
+  const DerivativeKernelType & kernel = precomputed
+    ? m_DerivativeKernels[ m_PointKernelIndex[pointId] ] : localKernel;
+  const std::vector< ScalarType > & kernelValues =
+    kernel.SecondDerivativeValues;
+  const ScalarType step = kernel.SecondDerivativeStep;
+
   // We convolve the 1D signal defined by the direction v at point
   // currentPoint with a second derivative of a Gaussian
-  const ScalarType scaleSquared = scale * scale;
-  const ScalarType scaleExtentProduct = scale * m_Extent;
   CompensatedSummationType kernelSum;
   SizeValueType numberOfKernelPoints = 0;
 
-  for( ScalarType distance = -scaleExtentProduct;
-       distance <= scaleExtentProduct;
-       //! \todo better calculation of the increment instead of just +1
-       ++distance )
+  for( unsigned int tap = 0; tap < kernelValues.size(); ++tap )
     {
+    const ScalarType distance = kernel.FirstDistance + step * tap;
     typename FixedImageType::PointType point;
     for( unsigned int ii = 0; ii < ImageDimension; ++ii )
       {
-      point[ii] = currentPoint[ii] + distance * tubeNormal.GetElement(ii);
+      point[ii] = currentPoint[ii]
+        + distance * tubeNormal.GetElement(ii);
       }
 
     if( this->m_Interpolator->IsInsideBuffer( point ) )
       {
-      const ScalarType distanceSquared = distance * distance;
-      //! \todo cache this value, so it can be used in the next loop
-      kernelSum += ( -1.0 + ( distanceSquared / scaleSquared ) )
-        * std::exp( -0.5 * distanceSquared / scaleSquared );
+      kernelSum += kernelValues[tap];
       ++numberOfKernelPoints;
       }
     }
@@ -331,20 +610,16 @@ ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject, TTubeSpatialObject >
   //term?
   const ScalarType error = kernelSum.GetSum() / numberOfKernelPoints;
   CompensatedSummationType result;
-  for( ScalarType distance = -scaleExtentProduct;
-       distance <= scaleExtentProduct;
-       //! \todo better calculation of the increment instead of just +1
-       ++distance )
+  for( unsigned int tap = 0; tap < kernelValues.size(); ++tap )
     {
-    const ScalarType distanceSquared = distance * distance;
-    const ScalarType kernelValue =
-      ( -1.0 + ( distanceSquared / scaleSquared ) )
-      * std::exp( -0.5 * distanceSquared / scaleSquared ) - error;
+    const ScalarType kernelValue = kernelValues[tap] - error;
+    const ScalarType distance = kernel.FirstDistance + step * tap;
 
     typename FixedImageType::PointType point;
     for( unsigned int ii = 0; ii < ImageDimension; ++ii )
       {
-      point[ii] = currentPoint[ii] + distance * tubeNormal.GetElement(ii);
+      point[ii] = currentPoint[ii]
+        + distance * tubeNormal.GetElement(ii);
       }
 
     if( this->m_Interpolator->IsInsideBuffer( point ) )
@@ -404,88 +679,62 @@ ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject, TTubeSpatialObject >
   VnlMatrixType biasVI( TubeDimension, TubeDimension,
     NumericTraits< ScalarType >::Zero );
 
-  SizeValueType weightCount = 0;
-
   CompensatedSummationType dPosition[TubeDimension];
 
   VnlMatrixType tM( TubeDimension, TubeDimension );
   VnlVectorType v1T( TubeDimension );
   VnlVectorType v2T( TubeDimension );
 
-  typedef std::vector< OutputPointType > TubePointsContainerType;
-  TubePointsContainerType transformedTubePoints;
-  transformedTubePoints.reserve( m_FeatureWeights.GetSize() );
-
-  typedef std::vector< VectorType >      dTubePointsContainerType;
-  dTubePointsContainerType dtransformedTubePoints;
-  dtransformedTubePoints.reserve( m_FeatureWeights.GetSize() );
+  const SizeValueType numberOfPoints = m_TubePointPositions.size();
+  std::vector< unsigned char > inside( numberOfPoints );
+  std::vector< OutputPointType > transformedTubePoints( numberOfPoints );
+  std::vector< VectorType > transformedNormal1s( numberOfPoints );
+  std::vector< VectorType > transformedNormal2s( numberOfPoints );
+  std::vector< VectorType > dtransformedTubePoints( numberOfPoints );
 
   derivative.fill(0.0);
 
-  typename TubeTreeType::ChildrenListType * tubeList = GetTubes();
-  typename TubeTreeType::ChildrenListType::const_iterator tubeIterator;
-  for( tubeIterator = tubeList->begin();
-       tubeIterator != tubeList->end();
-       ++tubeIterator )
+  TubePointsThreadStruct str;
+  str.Metric = this;
+  str.Transform = transformCopy;
+  str.ComputeDerivative = true;
+  str.LaplacianMagnitudes = NULL;
+  if( numberOfPoints > 0 )
     {
-    TubeType* currentTube = dynamic_cast<TubeType*>(
-      ( *tubeIterator ).GetPointer() );
+    str.Inside = &( inside[0] );
+    str.TransformedPoints = &( transformedTubePoints[0] );
+    str.TransformedNormal1s = &( transformedNormal1s[0] );
+    str.TransformedNormal2s = &( transformedNormal2s[0] );
+    str.PointDerivatives = &( dtransformedTubePoints[0] );
+    }
+  else
+    {
+    str.Inside = NULL;
+    str.TransformedPoints = NULL;
+    str.TransformedNormal1s = NULL;
+    str.TransformedNormal2s = NULL;
+    str.PointDerivatives = NULL;
+    }
+  this->EvaluateTubePoints( str );
 
-    if( currentTube != NULL )
+  for( SizeValueType pointId = 0; pointId < numberOfPoints; ++pointId )
+    {
+    if( inside[pointId] )
       {
-      typename TubeType::PointListType::const_iterator pointIterator;
-      for( pointIterator = currentTube->GetPoints().begin();
-           pointIterator != currentTube->GetPoints().end();
-           ++pointIterator )
+      for( unsigned int ii = 0; ii < TubeDimension; ++ii )
         {
-        InputPointType inputPoint = pointIterator->GetPosition();
-        OutputPointType currentPoint;
-        if( this->IsInside( inputPoint, currentPoint, transformCopy ) )
-          {
-          transformedTubePoints.push_back( currentPoint );
-
-          //! \todo: these should be CovariantVectors?
-          VectorType v1;
-          VectorType v2;
-          for( unsigned int ii = 0; ii < TubeDimension; ++ii )
-            {
-            v1[ii] = pointIterator->GetNormal1()[ii];
-            v2[ii] = pointIterator->GetNormal2()[ii];
-            }
-
-          for( unsigned int ii = 0; ii < TubeDimension; ++ii )
-            {
-            v1T[ii] = transformCopy->TransformVector( v1 )[ii];
-            v2T[ii] = transformCopy->TransformVector( v2 )[ii];
-            }
-          tM = outer_product( v1T, v1T );
-          tM = tM + outer_product( v2T, v2T );
-          tM = m_FeatureWeights[weightCount] * tM;
-          biasV += tM;
-
-          v1 = transformCopy->TransformVector( v1 );
-          v2 = transformCopy->TransformVector( v2 );
-
-          ScalarType scalingRadius = pointIterator->GetRadius();
-          scalingRadius = std::max( scalingRadius, m_MinimumScalingRadius );
-
-          const ScalarType scale = scalingRadius * m_Kappa;
-
-          const ScalarType dXProj1
-            = this->ComputeThirdDerivatives( v1, scale, currentPoint );
-          const ScalarType dXProj2
-            = this->ComputeThirdDerivatives( v2, scale, currentPoint );
-
-          VectorType dtransformedTubePoint;
-          for( unsigned int ii = 0; ii < TubeDimension; ++ii )
-            {
-            dtransformedTubePoint[ii] = ( dXProj1 * v1[ii] + dXProj2 * v2[ii] );
-            dPosition[ii] +=
-              m_FeatureWeights[weightCount] * ( dtransformedTubePoint[ii] );
-            }
-          dtransformedTubePoints.push_back( dtransformedTubePoint );
-          }
-        ++weightCount;
+        v1T[ii] = transformedNormal1s[pointId][ii];
+        v2T[ii] = transformedNormal2s[pointId][ii];
+        }
+      tM = outer_product( v1T, v1T );
+      tM = tM + outer_product( v2T, v2T );
+      tM = m_FeatureWeights[pointId] * tM;
+      biasV += tM;
+
+      for( unsigned int ii = 0; ii < TubeDimension; ++ii )
+        {
+        dPosition[ii] += m_FeatureWeights[pointId]
+          * ( dtransformedTubePoints[pointId][ii] );
         }
       }
     }
@@ -511,49 +760,24 @@ ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject, TTubeSpatialObject >
     {
     offsets[ii] = dPosition[ii].GetSum();
     }
-  typename TubePointsContainerType::const_iterator transformedTubePointsIt =
-    transformedTubePoints.begin();
-  typename dTubePointsContainerType::const_iterator dtransformedTubePointsIt =
-    dtransformedTubePoints.begin();
-  weightCount = 0;
-  for( tubeIterator = tubeList->begin();
-       tubeIterator != tubeList->end();
-       ++tubeIterator )
+  for( SizeValueType pointId = 0; pointId < numberOfPoints; ++pointId )
     {
-    TubeType* currentTube = dynamic_cast<TubeType*>(
-      ( *tubeIterator ).GetPointer() );
-
-    if( currentTube != NULL )
+    if( inside[pointId] )
       {
-      typename TubeType::PointListType::const_iterator pointIterator;
-      for( pointIterator = currentTube->GetPoints().begin();
-           pointIterator != currentTube->GetPoints().end();
-           ++pointIterator )
+      VnlVectorType dXT( TubeDimension );
+      for( unsigned int ii = 0; ii < TubeDimension; ++ii )
         {
-        InputPointType inputPoint = pointIterator->GetPosition();
-        OutputPointType currentPoint;
-        //! \todo this checking is not necessary, but we have to make sure have
-        //the corresponding weight -- should cache the result and use it here.
-        if( this->IsInside( inputPoint, currentPoint, transformCopy ) )
-          {
-          VnlVectorType dXT( TubeDimension );
-          for( unsigned int ii = 0; ii < TubeDimension; ++ii )
-            {
-            dXT[ii] = ( *dtransformedTubePointsIt )[ii];
-            }
-
-          dXT = dXT * biasVI;
-
-          ScalarType angleDelta[TubeDimension];
-          this->GetDeltaAngles( *transformedTubePointsIt, dXT, offsets, angleDelta );
-          for( unsigned int ii = 0; ii < TubeDimension; ++ii )
-            {
-            dAngle[ii] += m_FeatureWeights[weightCount] * angleDelta[ii];
-            }
-          ++dtransformedTubePointsIt;
-          ++transformedTubePointsIt;
-          }
-        ++weightCount;
+        dXT[ii] = dtransformedTubePoints[pointId][ii];
+        }
+
+      dXT = dXT * biasVI;
+
+      ScalarType angleDelta[TubeDimension];
+      this->GetDeltaAngles( transformedTubePoints[pointId], dXT, offsets,
+        angleDelta );
+      for( unsigned int ii = 0; ii < TubeDimension; ++ii )
+        {
+        dAngle[ii] += m_FeatureWeights[pointId] * angleDelta[ii];
         }
       }
     }
@@ -564,8 +788,110 @@ ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject, TTubeSpatialObject >
   derivative[3] = dPosition[0].GetSum();
   derivative[4] = dPosition[1].GetSum();
   derivative[5] = dPosition[2].GetSum();
+}
 
-  delete tubeList;
+
+template< class TFixedImage, class TMovingSpatialObject,
+          class TTubeSpatialObject >
+ITK_THREAD_RETURN_TYPE
+ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject, TTubeSpatialObject >
+::TubePointsThreaderCallback( void * arg )
+{
+  MultiThreader::ThreadInfoStruct * info =
+    static_cast< MultiThreader::ThreadInfoStruct * >( arg );
+  const ThreadIdType threadId = info->ThreadID;
+  const ThreadIdType numThreads = info->NumberOfThreads;
+  TubePointsThreadStruct * str =
+    static_cast< TubePointsThreadStruct * >( info->UserData );
+
+  const Self * metric = str->Metric;
+  const SizeValueType numPoints = metric->m_TubePointPositions.size();
+  const SizeValueType startPoint = ( numPoints * threadId ) / numThreads;
+  const SizeValueType endPoint = ( numPoints * ( threadId + 1 ) )
+    / numThreads;
+
+  for( SizeValueType pointId = startPoint; pointId < endPoint; ++pointId )
+    {
+    OutputPointType currentPoint;
+    str->Inside[pointId] = metric->IsInside(
+      metric->m_TubePointPositions[pointId], currentPoint, str->Transform );
+    if( !str->Inside[pointId] )
+      {
+      continue;
+      }
+
+    ScalarType scalingRadius = metric->m_TubePointRadii[pointId];
+    scalingRadius = std::max( scalingRadius,
+      metric->m_MinimumScalingRadius );
+
+    const ScalarType scale = scalingRadius * metric->m_Kappa;
+
+    if( !str->ComputeDerivative )
+      {
+      str->LaplacianMagnitudes[pointId] = vnl_math_abs(
+        metric->ComputeLaplacianMagnitude(
+          metric->m_TubePointNormal1s[pointId], scale, pointId,
+          currentPoint ) );
+      continue;
+      }
+
+    str->TransformedPoints[pointId] = currentPoint;
+
+    //! \todo: these should be CovariantVectors?
+    VectorType v1;
+    VectorType v2;
+    for( unsigned int ii = 0; ii < TubeDimension; ++ii )
+      {
+      v1[ii] = metric->m_TubePointNormal1s[pointId][ii];
+      v2[ii] = metric->m_TubePointNormal2s[pointId][ii];
+      }
+    v1 = str->Transform->TransformVector( v1 );
+    v2 = str->Transform->TransformVector( v2 );
+    str->TransformedNormal1s[pointId] = v1;
+    str->TransformedNormal2s[pointId] = v2;
+
+    const ScalarType dXProj1 = metric->ComputeThirdDerivatives( v1,
+      scale, pointId, currentPoint );
+    const ScalarType dXProj2 = metric->ComputeThirdDerivatives( v2,
+      scale, pointId, currentPoint );
+
+    for( unsigned int ii = 0; ii < TubeDimension; ++ii )
+      {
+      str->PointDerivatives[pointId][ii] =
+        ( dXProj1 * v1[ii] + dXProj2 * v2[ii] );
+      }
+    }
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+
+template< class TFixedImage, class TMovingSpatialObject,
+          class TTubeSpatialObject >
+void
+ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject, TTubeSpatialObject >
+::EvaluateTubePoints( TubePointsThreadStruct & str ) const
+{
+  const SizeValueType numPoints = m_TubePointPositions.size();
+  if( numPoints == 0 )
+    {
+    return;
+    }
+
+  unsigned int numThreads = m_NumberOfThreads;
+  if( numThreads < 1 )
+    {
+    numThreads = 1;
+    }
+  if( numThreads > numPoints )
+    {
+    numThreads = numPoints;
+    }
+
+  MultiThreader::Pointer threader = MultiThreader::New();
+  threader->SetNumberOfThreads( numThreads );
+  threader->SetSingleMethod( this->TubePointsThreaderCallback, &str );
+  threader->SingleMethodExecute();
 }
 
 
@@ -590,31 +916,52 @@ ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject, TTubeSpatialObject >
 ::ComputeThirdDerivatives(
   const VectorType & tubeNormal,
   const ScalarType scale,
+  SizeValueType pointId,
   const OutputPointType & currentPoint ) const
 {
-  // We convolve the 1D signal defined by the direction v at point
-  // currentPoint with a second derivative of a Gaussian
-  CompensatedSummationType result;
-  CompensatedSummationType kernelSum;
-
-  const ScalarType scaleSquared = scale * scale;
-  const ScalarType scaleExtentProduct = scale * m_Extent;
+  const bool precomputed = this->HasPrecomputedScale( pointId, scale );
 
-  for( ScalarType distance = -scaleExtentProduct;
-       distance <= scaleExtentProduct;
-       //! \todo better way to calculate this increment
-       distance += 0.1 )
+  if( precomputed && pointId < m_PointDerivativeImagesIndex.size() )
     {
-    const ScalarType distanceSquared = distance * distance;
-    const ScalarType kernelValue =
-      2.0 * distance * std::exp( -0.5 * distanceSquared / scaleSquared );
+    // For a smooth image the sampled, normalized kernel below
+    // approximates sqrt( 2 pi ) scale / ( 2 ( 1 - exp( -extent^2 / 2 ) ) )
+    // times the first derivative along the normal
+    const DerivativeImagesType & images =
+      m_DerivativeImages[ m_PointDerivativeImagesIndex[pointId] ];
+    const typename GradientImageType::PixelType gradient =
+      InterpolateDerivativeImage( images.Gradient.GetPointer(),
+        currentPoint );
+    ScalarType normalGradient = 0;
+    for( unsigned int ii = 0; ii < ImageDimension; ++ii )
+      {
+      normalGradient += gradient[ii] * tubeNormal.GetElement(ii);
+      }
+    return std::sqrt( 2.0 * vnl_math::pi ) * images.Scale * normalGradient
+      / ( 2.0 * ( 1.0 - std::exp( -0.5 * m_Extent * m_Extent ) ) );
+    }
 
-    kernelSum += vnl_math_abs( kernelValue );
+  DerivativeKernelType localKernel;
+  if( !precomputed )
+    {
+    this->ComputeDerivativeKernel( scale, localKernel );
+    }
+  const DerivativeKernelType & kernel = precomputed
+    ? m_DerivativeKernels[ m_PointKernelIndex[pointId] ] : localKernel;
+  const std::vector< ScalarType > & kernelValues =
+    kernel.FirstDerivativeValues;
+  const ScalarType step = kernel.FirstDerivativeStep;
 
+  // We convolve the 1D signal defined by the direction v at point
+  // currentPoint with a first derivative of a Gaussian
+  CompensatedSummationType result;
+  for( unsigned int tap = 0; tap < kernelValues.size(); ++tap )
+    {
+    const ScalarType distance = kernel.FirstDistance + step * tap;
     typename FixedImageType::PointType point;
     for( unsigned int ii = 0; ii < ImageDimension; ++ii )
       {
-      point[ii] = currentPoint[ii] + distance * tubeNormal.GetElement(ii);
+      point[ii] = currentPoint[ii]
+        + distance * tubeNormal.GetElement(ii);
       }
 
     if( this->m_Interpolator->IsInsideBuffer( point ) )
@@ -622,11 +969,11 @@ ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject, TTubeSpatialObject >
       const ScalarType value =
         static_cast< ScalarType >(
           this->m_Interpolator->Evaluate( point ) );
-      result += value * kernelValue;
+      result += value * kernelValues[tap];
       }
     }
 
-  return result.GetSum() / kernelSum.GetSum();
+  return result.GetSum() / kernel.FirstDerivativeAbsoluteSum;
 }
 
 
@@ -25,6 +25,8 @@ limitations under the License.
 
 #include "itktubeFeatureVectorGenerator.h"
 
+#include <itkImageRegionConstIterator.h>
+
 int itktubePDFSegmenterParzenTest( int argc, char * argv[] )
 {
   if( argc != 12 )
@@ -235,6 +237,77 @@ int itktubePDFSegmenterParzenTest( int argc, char * argv[] )
     return EXIT_FAILURE;
     }
 
+  // Sparse PDFs should give nearly the same labeling as dense PDFs.  The
+  //   label map is modified in place, so a fresh copy is read.
+  ReaderType::Pointer sparseLabelmapReader = ReaderType::New();
+  sparseLabelmapReader->SetFileName( argv[5] );
+  try
+    {
+    sparseLabelmapReader->Update();
+    }
+  catch( itk::ExceptionObject & e )
+    {
+    std::cout << "Exception caught during input read:" << std::endl << e
+      << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  FilterType::Pointer sparseFilter = FilterType::New();
+  sparseFilter->SetFeatureVectorGenerator( fvGen );
+  sparseFilter->SetLabelMap( sparseLabelmapReader->GetOutput() );
+  sparseFilter->SetObjectId( 255 );
+  sparseFilter->AddObjectId( 127 );
+  sparseFilter->SetVoidId( 0 );
+  sparseFilter->SetErodeRadius( 0 );
+  sparseFilter->SetHoleFillIterations( 5 );
+  sparseFilter->SetHistogramSmoothingStandardDeviation( 2 );
+  sparseFilter->SetReclassifyObjectLabels(
+    filter->GetReclassifyObjectLabels() );
+  sparseFilter->SetReclassifyNotObjectLabels(
+    filter->GetReclassifyNotObjectLabels() );
+  sparseFilter->SetForceClassification(
+    filter->GetForceClassification() );
+  sparseFilter->SetUseSparsePDFs( true );
+  std::cout << "Sparse Update" << std::endl;
+  sparseFilter->Update();
+  sparseFilter->SetProbabilityImageSmoothingStandardDeviation( blur );
+  std::cout << "Sparse Classify" << std::endl;
+  sparseFilter->ClassifyImages();
+
+  if( !sparseFilter->GetPDFsAreSparse()
+    || sparseFilter->GetClassPDFImage( 0 ).IsNotNull()
+    || sparseFilter->GetLabeledFeatureSpace().IsNotNull() )
+    {
+    std::cout << "Sparse PDFs were not used." << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  itk::ImageRegionConstIterator< ImageType > denseIter(
+    filter->GetLabelMap(),
+    filter->GetLabelMap()->GetLargestPossibleRegion() );
+  itk::ImageRegionConstIterator< ImageType > sparseIter(
+    sparseFilter->GetLabelMap(),
+    sparseFilter->GetLabelMap()->GetLargestPossibleRegion() );
+  unsigned int numMatch = 0;
+  unsigned int numPixels = 0;
+  while( !denseIter.IsAtEnd() )
+    {
+    if( denseIter.Get() == sparseIter.Get() )
+      {
+      ++numMatch;
+      }
+    ++numPixels;
+    ++denseIter;
+    ++sparseIter;
+    }
+  std::cout << "Sparse/dense label agreement = " << numMatch << " / "
+    << numPixels << std::endl;
+  if( numMatch < 0.95 * numPixels )
+    {
+    std::cout << "Sparse and dense PDFs disagree." << std::endl;
+    return EXIT_FAILURE;
+    }
+
   // All objects should be automatically destroyed at this point
   return EXIT_SUCCESS;
 }
@@ -83,6 +83,9 @@ int itktubeTubeExtractorTest( int argc, char * argv[] )
   ImageType::IndexType imMaxX = tubeOp->GetExtractBoundMax();
   int margin = 10;
 
+  TubeOpType::SeedListType seeds;
+  TubeOpType::SeedRadiusListType seedRadii;
+
   int failures = 0;
   for( int mcRun=0; mcRun<2; mcRun++ )
     {
@@ -203,6 +206,8 @@ int itktubeTubeExtractorTest( int argc, char * argv[] )
       }
 
     std::cout << "Local tube discovery a success!" << std::endl;
+    seeds.push_back( x1 );
+    seedRadii.push_back( tubeOp->GetRadius() );
     std::cout << std::endl;
     std::cout << "***** Beginning tube extraction *****" << std::endl;
     TubeType::Pointer xTube = tubeOp->ExtractTube( x1, mcRun );
@@ -299,8 +304,178 @@ int itktubeTubeExtractorTest( int argc, char * argv[] )
     ++failures;
     }
 
+  std::cout << "***** Beginning multi-seed extraction *****" << std::endl;
+  tubeOp->SetDebug( false );
+  tubeOp->GetRidgeOp()->SetDebug( false );
+  tubeOp->GetRadiusOp()->SetDebug( false );
+  tubeOp->SetExtractBoundMin( imMinX );
+  tubeOp->SetExtractBoundMax( imMaxX );
+  tubeOp->SetNumberOfThreads( 2 );
+
+  // Every seed is given twice: only one of each pair may yield a tube
+  TubeOpType::SeedListType pairedSeeds;
+  TubeOpType::SeedRadiusListType pairedSeedRadii;
+  for( unsigned int i=0; i<seeds.size(); ++i )
+    {
+    pairedSeeds.push_back( seeds[i] );
+    pairedSeeds.push_back( seeds[i] );
+    pairedSeedRadii.push_back( seedRadii[i] );
+    pairedSeedRadii.push_back( seedRadii[i] );
+    }
+  TubeOpType::TubeListType xTubes = tubeOp->ExtractTubes( pairedSeeds,
+    pairedSeedRadii, 200 );
+  unsigned int numExtracted = 0;
+  for( unsigned int i=0; i<xTubes.size(); i+=2 )
+    {
+    if( xTubes[i].IsNotNull() && xTubes[i+1].IsNotNull() )
+      {
+      std::cout << "Multi-seed extraction: seed " << i/2
+        << " extracted twice." << std::endl;
+      ++failures;
+      }
+    if( xTubes[i].IsNotNull() || xTubes[i+1].IsNotNull() )
+      {
+      ++numExtracted;
+      }
+    }
+  if( !seeds.empty() && numExtracted == 0 )
+    {
+    std::cout << "Multi-seed extraction failed." << std::endl;
+    ++failures;
+    }
+  if( tubeOp->GetTubeGroup()->GetNumberOfChildren() != numExtracted )
+    {
+    std::cout << "Multi-seed extraction: tube group has "
+      << tubeOp->GetTubeGroup()->GetNumberOfChildren()
+      << " tubes, expected " << numExtracted << std::endl;
+    ++failures;
+    }
+
+  std::cout << "***** Comparing 1 and 4 thread extraction *****"
+    << std::endl;
+  // The results must not depend on the number of threads, nor on how far
+  //   ahead of the committed tubes the threads extract
+  int compFailures = 0;
+  // Seeds shifted by a voxel compete for the voxels of the tubes above
+  TubeOpType::SeedListType compSeeds( pairedSeeds );
+  TubeOpType::SeedRadiusListType compSeedRadii( pairedSeedRadii );
+  for( unsigned int i=0; i<seeds.size(); ++i )
+    {
+    TubeOpType::ContinuousIndexType x = seeds[i];
+    x[0] += 1;
+    compSeeds.push_back( x );
+    compSeedRadii.push_back( seedRadii[i] );
+    }
+  const unsigned int numCompRuns = 3;
+  TubeOpType::Pointer compOp[numCompRuns];
+  TubeOpType::TubeListType compTubes[numCompRuns];
+  for( unsigned int run=0; run<numCompRuns; ++run )
+    {
+    compOp[run] = TubeOpType::New();
+    compOp[run]->SetInputImage( im );
+    compOp[run]->SetRadius( 2.0 );
+    compOp[run]->SetExtractBoundMin( imMinX );
+    compOp[run]->SetExtractBoundMax( imMaxX );
+    compOp[run]->SetNumberOfThreads( ( run == 0 ) ? 1 : 4 );
+    if( run == 2 )
+      {
+      compOp[run]->SetSeedLookAhead( compSeeds.size() );
+      }
+    compTubes[run] = compOp[run]->ExtractTubes( compSeeds, compSeedRadii,
+      300 );
+    std::cout << "Run " << run << ": extracted again "
+      << compOp[run]->GetNumberOfReextractedSeeds() << " of "
+      << compSeeds.size() << " seeds." << std::endl;
+    }
+  if( compOp[0]->GetNumberOfReextractedSeeds() != 0 )
+    {
+    std::cout << "Thread comparison: single thread run extracted seeds "
+      << "again." << std::endl;
+    ++compFailures;
+    }
+  for( unsigned int run=1; run<numCompRuns; ++run )
+    {
+    if( compOp[run]->GetNumberOfReextractedSeeds() > compSeeds.size() )
+      {
+      std::cout << "Thread comparison: run " << run
+        << " extracted more seeds again than it has." << std::endl;
+      ++compFailures;
+      }
+    for( unsigned int i=0; i<compSeeds.size(); ++i )
+      {
+      if( compTubes[0][i].IsNull() != compTubes[run][i].IsNull() )
+        {
+        std::cout << "Thread comparison: run " << run << " seed " << i
+          << " extracted by only one run." << std::endl;
+        ++compFailures;
+        continue;
+        }
+      if( compTubes[0][i].IsNull() )
+        {
+        continue;
+        }
+      const PointListType & pnts0 = compTubes[0][i]->GetPoints();
+      const PointListType & pnts1 = compTubes[run][i]->GetPoints();
+      if( pnts0.size() != pnts1.size() )
+        {
+        std::cout << "Thread comparison: run " << run << " seed " << i
+          << " has " << pnts1.size() << " points, not " << pnts0.size()
+          << "." << std::endl;
+        ++compFailures;
+        continue;
+        }
+      for( unsigned int p=0; p<pnts0.size(); ++p )
+        {
+        if( pnts0[p].GetPosition() != pnts1[p].GetPosition()
+          || pnts0[p].GetRadius() != pnts1[p].GetRadius() )
+          {
+          std::cout << "Thread comparison: run " << run << " seed " << i
+            << " point " << p << " differs." << std::endl;
+          ++compFailures;
+          break;
+          }
+        }
+      }
+    for( unsigned int code=0;
+      code<compOp[0]->GetRidgeOp()->GetNumberOfFailureCodes(); ++code )
+      {
+      TubeOpType::RidgeOpType::FailureCodeEnum failureCode =
+        ( TubeOpType::RidgeOpType::FailureCodeEnum )code;
+      if( compOp[0]->GetRidgeOp()->GetFailureCodeCount( failureCode )
+        != compOp[run]->GetRidgeOp()->GetFailureCodeCount( failureCode ) )
+        {
+        std::cout << "Thread comparison: run " << run << " "
+          << compOp[0]->GetRidgeOp()->GetFailureCodeName( failureCode )
+          << " counts differ." << std::endl;
+        ++compFailures;
+        }
+      }
+    itk::ImageRegionIterator< TubeOpType::TubeMaskImageType > mask0It(
+      compOp[0]->GetTubeMaskImage(),
+      compOp[0]->GetTubeMaskImage()->GetLargestPossibleRegion() );
+    itk::ImageRegionIterator< TubeOpType::TubeMaskImageType > mask1It(
+      compOp[run]->GetTubeMaskImage(),
+      compOp[run]->GetTubeMaskImage()->GetLargestPossibleRegion() );
+    count = 0;
+    while( !mask0It.IsAtEnd() )
+      {
+      if( mask0It.Get() != mask1It.Get() )
+        {
+        ++count;
+        }
+      ++mask0It;
+      ++mask1It;
+      }
+    if( count > 0 )
+      {
+      std::cout << "Thread comparison: run " << run << " " << count
+        << " tube mask voxels differ." << std::endl;
+      ++compFailures;
+      }
+    }
+
   std::cout << "Number of failures = " << failures << std::endl;
-  if( failures > 1 )
+  if( failures > 1 || compFailures > 0 )
     {
     return EXIT_FAILURE;
     }
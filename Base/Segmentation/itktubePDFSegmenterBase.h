@@ -28,6 +28,7 @@ limitations under the License.
 
 #include <itkImage.h>
 #include <itkListSample.h>
+#include <itkMultiThreader.h>
 
 #include <vector>
 
@@ -135,6 +136,10 @@ public:
   itkSetMacro( ForceClassification, bool );
   itkGetMacro( ForceClassification, bool );
 
+  /** Number of threads used to compute the class probability images */
+  itkSetMacro( NumberOfThreads, unsigned int );
+  itkGetMacro( NumberOfThreads, unsigned int );
+
   void SetProgressProcessInformation( void * processInfo, double fraction,
     double start );
 
@@ -147,11 +152,23 @@ public:
     unsigned int classNum ) const;
 
   //
-  // Must overwrite
+  // Must overwrite.  Called concurrently from the classification threads.
   //
   virtual ProbabilityPixelType GetClassProbability( unsigned int
     classNum, const FeatureVectorType & fv ) const;
 
+  /**
+   * Probabilities of every class for a block of feature vectors.
+   *   features holds numVectors rows of GetNumberOfFeatures() values and
+   *   probabilities receives numVectors rows of GetNumberOfClasses()
+   *   values.  Called concurrently, on disjoint blocks, from the
+   *   classification threads.  Overwrite when classes can be evaluated
+   *   jointly or vectors in batches; by default calls GetClassProbability
+   *   for each vector and class. */
+  virtual void GetClassProbabilities( unsigned int numVectors,
+    const FeatureValueType * features,
+    ProbabilityPixelType * probabilities ) const;
+
 
 protected:
 
@@ -169,6 +186,16 @@ protected:
 
   void PrintSelf( std::ostream & os, Indent indent ) const;
 
+  struct ClassifyThreadStruct
+    {
+    const Self *                          Segmenter;
+    typename LabelMapType::RegionType     Region;
+    std::vector< ProbabilityPixelType * > ProbabilityBuffers;
+    }; // End struct ClassifyThreadStruct
+
+  /** Compute the class probabilities of a slab of the label map region */
+  static ITK_THREAD_RETURN_TYPE ClassifyThreaderCallback( void * arg );
+
   typedef std::vector< typename ProbabilityImageType::Pointer >
                                               ProbabilityImageVectorType;
   typedef std::vector< ProbabilityPixelType > ListVectorType;
@@ -210,6 +237,8 @@ private:
   bool                m_ReclassifyNotObjectLabels;
   bool                m_ForceClassification;
 
+  unsigned int        m_NumberOfThreads;
+
 }; // End class PDFSegmenterBase
 
 } // End namespace tube
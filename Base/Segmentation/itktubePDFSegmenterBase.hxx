@@ -79,6 +79,8 @@ PDFSegmenterBase< TImage, TLabelMap >
   m_ReclassifyNotObjectLabels = false;
   m_ForceClassification = false;
 
+  m_NumberOfThreads = MultiThreader::GetGlobalDefaultNumberOfThreads();
+
   m_ProbabilityImageVector.resize( 0 );
 
   m_ProgressProcessInfo = NULL;
@@ -237,6 +239,29 @@ PDFSegmenterBase< TImage, TLabelMap >
   return 0;
 }
 
+template< class TImage, class TLabelMap >
+void
+PDFSegmenterBase< TImage, TLabelMap >
+::GetClassProbabilities( unsigned int numVectors,
+  const FeatureValueType * features,
+  ProbabilityPixelType * probabilities ) const
+{
+  unsigned int numClasses = m_ObjectIdList.size();
+  unsigned int numFeatures = m_FeatureVectorGenerator->
+    GetNumberOfFeatures();
+
+  FeatureVectorType fv( numFeatures );
+  for( unsigned int v = 0; v < numVectors; ++v )
+    {
+    fv.copy_in( features + v * numFeatures );
+    for( unsigned int c = 0; c < numClasses; ++c )
+      {
+      probabilities[ v * numClasses + c ] =
+        this->GetClassProbability( c, fv );
+      }
+    }
+}
+
 template< class TImage, class TLabelMap >
 void
 PDFSegmenterBase< TImage, TLabelMap >
@@ -279,48 +304,83 @@ PDFSegmenterBase< TImage, TLabelMap >
 
   ListVectorType v;
   v.resize( numFeatures + ImageDimension );
-  FeatureVectorType fv;
-  typename LabelMapType::IndexType indx;
+
+  // The voxels of each slice that belong to the sample are gathered, and
+  //   their feature vectors generated in one batch.  The classes are
+  //   listed in iteration order, with -1 for the out class.
+  typename FeatureVectorGeneratorType::IndexListType sampleIndices;
+  std::vector< int > sampleClasses;
+  std::vector< FeatureValueType > sampleFeatures;
+
   bool found = false;
   int prevVal = itInLabelMap.Get() + 1;
   int prevC = 0;
   while( !itInLabelMap.IsAtEnd() )
     {
-    int val = itInLabelMap.Get();
-    indx = itInLabelMap.GetIndex();
-    fv = this->m_FeatureVectorGenerator->GetFeatureVector( indx );
-    for( unsigned int i = 0; i < numFeatures; i++ )
-      {
-      v[i] = fv[i];
-      }
-    for( unsigned int i = 0; i < ImageDimension; i++ )
-      {
-      v[numFeatures+i] = indx[i];
-      }
-    if( val != prevVal )
+    const IndexValueType slice =
+      itInLabelMap.GetIndex()[ImageDimension - 1];
+    sampleIndices.clear();
+    sampleClasses.clear();
+    while( !itInLabelMap.IsAtEnd()
+      && itInLabelMap.GetIndex()[ImageDimension - 1] == slice )
       {
-      found = false;
-      prevVal = val;
-      for( unsigned int c = 0; c < numClasses; c++ )
+      int val = itInLabelMap.Get();
+      if( val != prevVal )
         {
-        if( val == m_ObjectIdList[c] )
+        found = false;
+        prevVal = val;
+        for( unsigned int c = 0; c < numClasses; c++ )
           {
-          found = true;
-          prevVal = val;
-          prevC = c;
-          break;
+          if( val == m_ObjectIdList[c] )
+            {
+            found = true;
+            prevVal = val;
+            prevC = c;
+            break;
+            }
           }
         }
+      if( found )
+        {
+        sampleIndices.push_back( itInLabelMap.GetIndex() );
+        sampleClasses.push_back( prevC );
+        }
+      else if( val != m_VoidId )
+        {
+        sampleIndices.push_back( itInLabelMap.GetIndex() );
+        sampleClasses.push_back( -1 );
+        }
+      ++itInLabelMap;
       }
-    if( found )
+    if( sampleIndices.empty() )
       {
-      m_InClassList[prevC].push_back( v );
+      continue;
       }
-    else if( !found && val != m_VoidId )
+
+    sampleFeatures.resize( sampleIndices.size() * numFeatures );
+    this->m_FeatureVectorGenerator->GetFeatureVectors( sampleIndices,
+      &( sampleFeatures[0] ) );
+    for( unsigned int s = 0; s < sampleIndices.size(); s++ )
       {
-      m_OutClassList.push_back( v );
+      const FeatureValueType * fv = &( sampleFeatures[0] )
+        + numFeatures * s;
+      for( unsigned int i = 0; i < numFeatures; i++ )
+        {
+        v[i] = fv[i];
+        }
+      for( unsigned int i = 0; i < ImageDimension; i++ )
+        {
+        v[numFeatures+i] = sampleIndices[s][i];
+        }
+      if( sampleClasses[s] >= 0 )
+        {
+        m_InClassList[ sampleClasses[s] ].push_back( v );
+        }
+      else
+        {
+        m_OutClassList.push_back( v );
+        }
       }
-    ++itInLabelMap;
     }
 }
 
@@ -336,6 +396,81 @@ PDFSegmenterBase< TImage, TLabelMap >
   m_PDFsUpToDate = true;
 }
 
+template< class TImage, class TLabelMap >
+ITK_THREAD_RETURN_TYPE
+PDFSegmenterBase< TImage, TLabelMap >
+::ClassifyThreaderCallback( void * arg )
+{
+  MultiThreader::ThreadInfoStruct * info =
+    static_cast< MultiThreader::ThreadInfoStruct * >( arg );
+  const ThreadIdType threadId = info->ThreadID;
+  const ThreadIdType numThreads = info->NumberOfThreads;
+  ClassifyThreadStruct * str =
+    static_cast< ClassifyThreadStruct * >( info->UserData );
+  const Self * segmenter = str->Segmenter;
+
+  const unsigned int numSlices = str->Region.GetSize()[ImageDimension - 1];
+  const unsigned int startSlice = ( numSlices * threadId ) / numThreads;
+  const unsigned int endSlice = ( numSlices * ( threadId + 1 ) )
+    / numThreads;
+  if( startSlice >= endSlice )
+    {
+    return ITK_THREAD_RETURN_VALUE;
+    }
+
+  typename LabelMapType::RegionType threadRegion = str->Region;
+  threadRegion.SetIndex( ImageDimension - 1,
+    str->Region.GetIndex()[ImageDimension - 1] + startSlice );
+  threadRegion.SetSize( ImageDimension - 1, endSlice - startSlice );
+
+  // Voxels of the slab are contiguous in the probability image buffers
+  const SizeValueType sliceSize = str->Region.GetNumberOfPixels()
+    / numSlices;
+  SizeValueType offset = sliceSize * startSlice;
+
+  // Voxels are classified a row at a time, all classes at once
+  const unsigned int numClasses = str->ProbabilityBuffers.size();
+  const unsigned int numFeatures = segmenter->m_FeatureVectorGenerator->
+    GetNumberOfFeatures();
+  const unsigned int blockSize = str->Region.GetSize()[0];
+  std::vector< FeatureValueType > features( blockSize * numFeatures );
+  std::vector< ProbabilityPixelType > probabilities( blockSize
+    * numClasses );
+
+  typedef itk::ImageRegionConstIteratorWithIndex< LabelMapType >
+    ConstLabelMapIteratorType;
+  ConstLabelMapIteratorType itInLabelMap( segmenter->m_LabelMap,
+    threadRegion );
+  unsigned int numVectors = 0;
+  while( !itInLabelMap.IsAtEnd() )
+    {
+    segmenter->m_FeatureVectorGenerator->ThreadedGetFeatureVector(
+      itInLabelMap.GetIndex(), &( features[ numVectors * numFeatures ] ),
+      threadId );
+    ++numVectors;
+    ++itInLabelMap;
+
+    if( numVectors == blockSize || itInLabelMap.IsAtEnd() )
+      {
+      segmenter->GetClassProbabilities( numVectors, &( features[0] ),
+        &( probabilities[0] ) );
+      for( unsigned int v = 0; v < numVectors; ++v )
+        {
+        for( unsigned int c = 0; c < numClasses; ++c )
+          {
+          str->ProbabilityBuffers[c][offset] =
+            probabilities[ v * numClasses + c ]
+            * segmenter->m_PDFWeightList[c];
+          }
+        ++offset;
+        }
+      numVectors = 0;
+      }
+    }
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
 template< class TImage, class TLabelMap >
 void
 PDFSegmenterBase< TImage, TLabelMap >
@@ -364,10 +499,9 @@ PDFSegmenterBase< TImage, TLabelMap >
   //
   m_ProbabilityImageVector.resize( numClasses );
 
-  typedef itk::ImageRegionIterator<ProbabilityImageType>
-    ProbabilityImageIteratorType;
-  std::vector< ProbabilityImageIteratorType * > probIt( numClasses );
-
+  ClassifyThreadStruct str;
+  str.Segmenter = this;
+  str.ProbabilityBuffers.resize( numClasses );
   for( unsigned int c = 0; c < numClasses; c++ )
     {
     m_ProbabilityImageVector[c] = ProbabilityImageType::New();
@@ -377,10 +511,8 @@ PDFSegmenterBase< TImage, TLabelMap >
       GetInput( 0 ) );
     m_ProbabilityImageVector[c]->Allocate();
 
-    probIt[c] = new ProbabilityImageIteratorType(
-      m_ProbabilityImageVector[c],
-      m_ProbabilityImageVector[c]->GetLargestPossibleRegion() );
-    probIt[c]->GoToBegin();
+    str.ProbabilityBuffers[c] =
+      m_ProbabilityImageVector[c]->GetBufferPointer();
     }
 
   if( m_LabelMap.IsNull() )
@@ -394,35 +526,23 @@ PDFSegmenterBase< TImage, TLabelMap >
     m_ForceClassification = true;
     }
 
-  typedef itk::ImageRegionConstIteratorWithIndex< LabelMapType >
-    ConstLabelMapIteratorType;
-  ConstLabelMapIteratorType itInLabelMap( m_LabelMap,
-    m_LabelMap->GetLargestPossibleRegion() );
-  itInLabelMap.GoToBegin();
-
-  FeatureVectorType fv;
-  typename LabelMapType::IndexType indx;
-  while( !itInLabelMap.IsAtEnd() )
+  // Each thread classifies a slab of slices of the label map region
+  str.Region = m_LabelMap->GetLargestPossibleRegion();
+  unsigned int numThreads = m_NumberOfThreads;
+  if( numThreads > str.Region.GetSize()[ImageDimension - 1] )
     {
-    indx = itInLabelMap.GetIndex();
-    fv = m_FeatureVectorGenerator->GetFeatureVector( indx );
-
-    for( unsigned int c=0; c<numClasses; ++c )
-      {
-      double prob = this->GetClassProbability( c, fv );
-      prob *= m_PDFWeightList[c];
-      probIt[c]->Set( prob );
-
-      ++( *( probIt[c] ) );
-      }
-
-    ++itInLabelMap;
+    numThreads = str.Region.GetSize()[ImageDimension - 1];
     }
-
-  for( unsigned int c = 0; c < numClasses; ++c )
+  if( numThreads < 1 )
     {
-    delete probIt[c];
+    numThreads = 1;
     }
+  MultiThreader::Pointer threader = MultiThreader::New();
+  threader->SetNumberOfThreads( numThreads );
+  m_FeatureVectorGenerator->PrepareThreadedFeatures(
+    threader->GetNumberOfThreads() );
+  threader->SetSingleMethod( this->ClassifyThreaderCallback, &str );
+  threader->SingleMethodExecute();
 
   if( m_ProbabilityImageSmoothingStandardDeviation > 0 )
     {
@@ -895,6 +1015,7 @@ PDFSegmenterBase< TImage, TLabelMap >
     os << indent << "LabelMap = NULL" << std::endl;
     }
   os << indent << "Erode radius = " << m_ErodeRadius << std::endl;
+  os << indent << "NumberOfThreads = " << m_NumberOfThreads << std::endl;
   os << indent << "Hole fill iterations = " << m_HoleFillIterations
     << std::endl;
   os << indent << "PDF weight size = " << m_PDFWeightList.size()
@@ -29,6 +29,7 @@ limitations under the License.
 #include <itkImage.h>
 #include <itkListSample.h>
 
+#include <map>
 #include <vector>
 
 namespace itk
@@ -98,6 +99,12 @@ public:
   typedef Image< LabelMapPixelType, PARZEN_MAX_NUMBER_OF_FEATURES >
     LabeledFeatureSpaceType;
 
+  /** Occupied bins of a sparse PDF: numberOfFeatures bin indices per
+   *   occupied bin, and the number of samples in each */
+  typedef unsigned short                       SparseBinType;
+  typedef std::vector< SparseBinType >         SparseBinListType;
+  typedef std::vector< float >                 SparseCountListType;
+
   //
   // Methods
   //
@@ -106,12 +113,38 @@ public:
   itkSetMacro( OutlierRejectPortion, double );
   itkGetMacro( OutlierRejectPortion, double );
 
+  /**
+   * Store the class PDFs sparsely, as the occupied bins of the joint
+   *   histogram, and apply the Parzen window when a probability is
+   *   requested.  Memory then grows with the number of occupied bins
+   *   rather than with bins^features.  Sparse PDFs are always used when
+   *   there are more than PARZEN_MAX_NUMBER_OF_FEATURES features.  Class
+   *   PDF images and the labeled feature space are only available for
+   *   dense PDFs. */
+  itkSetMacro( UseSparsePDFs, bool );
+  itkGetMacro( UseSparsePDFs, bool );
+
+  /** True if the current PDFs are stored sparsely */
+  bool GetPDFsAreSparse( void ) const;
+
+  /** Returns NULL if the PDFs are sparse */
   typename PDFImageType::Pointer GetClassPDFImage(
     unsigned int classNum ) const;
 
   void SetClassPDFImage( unsigned int classNum,
     typename PDFImageType::Pointer classPDF );
 
+  /** Get the occupied bins of a sparse class PDF, e.g., to save it.
+   *   Returns false if the PDFs are not sparse. */
+  bool GetSparseClassPDF( unsigned int classNum, SparseBinListType & bins,
+    SparseCountListType & counts ) const;
+
+  /** Set a sparse class PDF from its occupied bins.  The number of bins
+   *   per feature and the histogram smoothing must already be set.  Any
+   *   dense PDFs are discarded. */
+  void SetSparseClassPDF( unsigned int classNum,
+    const SparseBinListType & bins, const SparseCountListType & counts );
+
   const VectorUIntType & GetNumberOfBinsPerFeature( void ) const;
   void             SetNumberOfBinsPerFeature( const VectorUIntType & nBin );
   const VectorDoubleType & GetBinMin( void ) const;
@@ -162,6 +195,49 @@ private:
   typedef std::vector< typename HistogramImageType::Pointer >
     ClassHistogramImageType;
 
+  typedef std::vector< SparseBinType >          SparseBinIndexType;
+
+  /** Occupied bins of one class, stored as an implicit k-d tree: the
+   *   median of every subrange is its node, split along SplitFeature */
+  struct SparseClassPDFType
+    {
+    std::vector< SparseBinType >  Bins;
+    std::vector< float >          Counts;
+    std::vector< unsigned char >  SplitFeature;
+    double                        Normalization;
+    }; // End struct SparseClassPDFType
+
+  typedef std::vector< SparseClassPDFType >     SparseClassPDFListType;
+
+  /** Orders occupied bins by one feature while building the k-d tree */
+  struct SparseBinCompare
+    {
+    const SparseBinType * Bins;
+    unsigned int          NumberOfFeatures;
+    unsigned int          Feature;
+    bool operator()( unsigned int a, unsigned int b ) const
+      {
+      return Bins[a * NumberOfFeatures + Feature]
+        < Bins[b * NumberOfFeatures + Feature];
+      }
+    }; // End struct SparseBinCompare
+
+  void GenerateSparsePDFs( void );
+
+  void GenerateSparseKernel( void );
+
+  void BuildSparseClassPDF( const SparseBinListType & bins,
+    const SparseCountListType & counts, SparseClassPDFType & pdf ) const;
+
+  void BuildSparseTree( const std::vector< SparseBinType > & bins,
+    const std::vector< float > & counts, std::vector< unsigned int > & order,
+    unsigned int begin, unsigned int end,
+    SparseClassPDFType & pdf ) const;
+
+  double EvaluateSparsePDF( const SparseClassPDFType & pdf,
+    const SparseBinIndexType & binIndex, unsigned int begin,
+    unsigned int end ) const;
+
   ClassHistogramImageType         m_InClassHistogram;
   VectorDoubleType                m_HistogramBinMin;
   VectorDoubleType                m_HistogramBinSize;
@@ -171,6 +247,10 @@ private:
 
   double                          m_HistogramSmoothingStandardDeviation;
 
+  bool                            m_UseSparsePDFs;
+  SparseClassPDFListType          m_SparseClassPDF;
+  std::vector< double >           m_SparseKernel;
+
   typename LabeledFeatureSpaceType::Pointer m_LabeledFeatureSpace;
 
 }; // End class PDFSegmenterParzen
@@ -46,6 +46,9 @@ limitations under the License.
 
 #include <vnl/vnl_matrix.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
 #include <limits>
 
 namespace itk
@@ -68,6 +71,10 @@ PDFSegmenterParzen< TImage, TLabelMap >
 
   m_OutlierRejectPortion = 0.001;
 
+  m_UseSparsePDFs = false;
+  m_SparseClassPDF.clear();
+  m_SparseKernel.clear();
+
   m_LabeledFeatureSpace = NULL;
 }
 
@@ -77,6 +84,14 @@ PDFSegmenterParzen< TImage, TLabelMap >
 {
 }
 
+template< class TImage, class TLabelMap >
+bool
+PDFSegmenterParzen< TImage, TLabelMap >
+::GetPDFsAreSparse( void ) const
+{
+  return !m_SparseClassPDF.empty();
+}
+
 template< class TImage, class TLabelMap >
 typename PDFSegmenterParzen< TImage, TLabelMap >::PDFImageType::Pointer
 PDFSegmenterParzen< TImage, TLabelMap >
@@ -100,6 +115,56 @@ PDFSegmenterParzen< TImage, TLabelMap >
     m_InClassHistogram.resize( this->m_ObjectIdList.size() );
     }
   m_InClassHistogram[classNum] = classPDF;
+  m_SparseClassPDF.clear();
+  this->m_SampleUpToDate = false;
+  this->m_PDFsUpToDate = true;
+  this->m_ClassProbabilityImagesUpToDate = false;
+}
+
+template< class TImage, class TLabelMap >
+bool
+PDFSegmenterParzen< TImage, TLabelMap >
+::GetSparseClassPDF( unsigned int classNum, SparseBinListType & bins,
+  SparseCountListType & counts ) const
+{
+  if( classNum >= m_SparseClassPDF.size() )
+    {
+    return false;
+    }
+  bins = m_SparseClassPDF[classNum].Bins;
+  counts = m_SparseClassPDF[classNum].Counts;
+  return true;
+}
+
+template< class TImage, class TLabelMap >
+void
+PDFSegmenterParzen< TImage, TLabelMap >
+::SetSparseClassPDF( unsigned int classNum,
+  const SparseBinListType & bins, const SparseCountListType & counts )
+{
+  unsigned int numFeatures = this->m_FeatureVectorGenerator->
+    GetNumberOfFeatures();
+  if( m_HistogramNumberOfBin.size() != numFeatures
+    || bins.size() != counts.size() * numFeatures )
+    {
+    throw( "Sparse PDF bins and counts do not match" );
+    }
+  for( unsigned int b = 0; b < bins.size(); ++b )
+    {
+    if( bins[b] >= m_HistogramNumberOfBin[ b % numFeatures ] )
+      {
+      throw( "Sparse PDF bin is outside of the histogram" );
+      }
+    }
+
+  if( this->m_ObjectIdList.size() != m_SparseClassPDF.size() )
+    {
+    m_SparseClassPDF.resize( this->m_ObjectIdList.size() );
+    }
+  m_InClassHistogram.clear();
+  m_LabeledFeatureSpace = NULL;
+  this->GenerateSparseKernel();
+  this->BuildSparseClassPDF( bins, counts, m_SparseClassPDF[classNum] );
   this->m_SampleUpToDate = false;
   this->m_PDFsUpToDate = true;
   this->m_ClassProbabilityImagesUpToDate = false;
@@ -421,6 +486,14 @@ PDFSegmenterParzen< TImage, TLabelMap >
       }
     }
 
+  if( m_UseSparsePDFs || numFeatures > PARZEN_MAX_NUMBER_OF_FEATURES )
+    {
+    this->GenerateSparsePDFs();
+    return;
+    }
+  m_SparseClassPDF.clear();
+  m_SparseKernel.clear();
+
   //
   //  Create joint histograms
   //
@@ -533,11 +606,269 @@ PDFSegmenterParzen< TImage, TLabelMap >
     }
 }
 
+template< class TImage, class TLabelMap >
+void
+PDFSegmenterParzen< TImage, TLabelMap >
+::GenerateSparsePDFs( void )
+{
+  unsigned int numClasses = this->m_ObjectIdList.size();
+  unsigned int numFeatures = this->m_FeatureVectorGenerator->
+    GetNumberOfFeatures();
+
+  for( unsigned int i = 0; i < numFeatures; i++ )
+    {
+    if( m_HistogramNumberOfBin[i]
+      > std::numeric_limits< SparseBinType >::max() )
+      {
+      throw( "Too many bins per feature for sparse PDFs" );
+      }
+    }
+
+  // The Parzen window is applied when a probability is requested, so
+  //   only the occupied bins and a 1D kernel (in bins) are kept
+  m_InClassHistogram.clear();
+  m_LabeledFeatureSpace = NULL;
+
+  this->GenerateSparseKernel();
+
+  typedef std::map< SparseBinIndexType, float > BinCountMapType;
+
+  m_SparseClassPDF.resize( numClasses );
+  SparseBinIndexType binIndex( numFeatures );
+  for( unsigned int c = 0; c < numClasses; c++ )
+    {
+    BinCountMapType binCount;
+    typename ListSampleType::const_iterator
+      inClassListIt( this->m_InClassList[c].begin() );
+    typename ListSampleType::const_iterator
+      inClassListItEnd( this->m_InClassList[c].end() );
+    while( inClassListIt != inClassListItEnd )
+      {
+      for( unsigned int i = 0; i < numFeatures; i++ )
+        {
+        double binV = (*inClassListIt)[i];
+        int binN = static_cast< int >( ( binV - m_HistogramBinMin[i] )
+          / m_HistogramBinSize[i] );
+        if( binN < 0 )
+          {
+          binN = 0;
+          }
+        else if( static_cast< unsigned int >( binN )
+          >= m_HistogramNumberOfBin[i] )
+          {
+          binN = m_HistogramNumberOfBin[i] - 1;
+          }
+        binIndex[i] = static_cast< SparseBinType >( binN );
+        }
+      binCount[ binIndex ] += 1;
+      ++inClassListIt;
+      }
+
+    unsigned int numBins = binCount.size();
+    SparseBinListType bins( numBins * numFeatures );
+    SparseCountListType counts( numBins );
+    typename BinCountMapType::const_iterator binIt = binCount.begin();
+    for( unsigned int b = 0; b < numBins; ++b, ++binIt )
+      {
+      std::copy( binIt->first.begin(), binIt->first.end(),
+        bins.begin() + b * numFeatures );
+      counts[b] = binIt->second;
+      }
+    binCount.clear();
+
+    this->BuildSparseClassPDF( bins, counts, m_SparseClassPDF[c] );
+    }
+}
+
+template< class TImage, class TLabelMap >
+void
+PDFSegmenterParzen< TImage, TLabelMap >
+::GenerateSparseKernel( void )
+{
+  unsigned int kernelRadius = 0;
+  if( m_HistogramSmoothingStandardDeviation > 0 )
+    {
+    kernelRadius = static_cast< unsigned int >(
+      std::ceil( 3 * m_HistogramSmoothingStandardDeviation ) );
+    }
+  m_SparseKernel.resize( kernelRadius + 1 );
+  m_SparseKernel[0] = 1;
+  for( unsigned int k = 1; k <= kernelRadius; ++k )
+    {
+    m_SparseKernel[k] = std::exp( -0.5 * k * k
+      / ( m_HistogramSmoothingStandardDeviation
+      * m_HistogramSmoothingStandardDeviation ) );
+    }
+}
+
+template< class TImage, class TLabelMap >
+void
+PDFSegmenterParzen< TImage, TLabelMap >
+::BuildSparseClassPDF( const SparseBinListType & bins,
+  const SparseCountListType & counts, SparseClassPDFType & pdf ) const
+{
+  unsigned int numFeatures = this->m_FeatureVectorGenerator->
+    GetNumberOfFeatures();
+  unsigned int numBins = counts.size();
+  int kernelRadius = static_cast< int >( m_SparseKernel.size() ) - 1;
+
+  std::vector< unsigned int > order( numBins );
+  for( unsigned int b = 0; b < numBins; ++b )
+    {
+    order[b] = b;
+    }
+
+  pdf.Bins.resize( numBins * numFeatures );
+  pdf.Counts.resize( numBins );
+  pdf.SplitFeature.resize( numBins );
+  this->BuildSparseTree( bins, counts, order, 0, numBins, pdf );
+
+  // Normalize as the dense PDF is: the blurred histogram, restricted to
+  //   the bin grid, sums to one
+  pdf.Normalization = 0;
+  for( unsigned int b = 0; b < numBins; ++b )
+    {
+    double weight = pdf.Counts[b];
+    for( unsigned int i = 0; i < numFeatures; i++ )
+      {
+      int bin = pdf.Bins[b * numFeatures + i];
+      double kernelSum = 0;
+      for( int k = -kernelRadius; k <= kernelRadius; ++k )
+        {
+        if( bin + k >= 0 && bin + k
+          < static_cast< int >( m_HistogramNumberOfBin[i] ) )
+          {
+          kernelSum += m_SparseKernel[ std::abs( k ) ];
+          }
+        }
+      weight *= kernelSum;
+      }
+    pdf.Normalization += weight;
+    }
+  if( pdf.Normalization > 0 )
+    {
+    pdf.Normalization = 1.0 / pdf.Normalization;
+    }
+}
+
+template< class TImage, class TLabelMap >
+void
+PDFSegmenterParzen< TImage, TLabelMap >
+::BuildSparseTree( const std::vector< SparseBinType > & bins,
+  const std::vector< float > & counts, std::vector< unsigned int > & order,
+  unsigned int begin, unsigned int end, SparseClassPDFType & pdf ) const
+{
+  if( begin >= end )
+    {
+    return;
+    }
+
+  unsigned int numFeatures = this->m_FeatureVectorGenerator->
+    GetNumberOfFeatures();
+
+  // Split along the feature with the largest spread of occupied bins
+  unsigned int splitFeature = 0;
+  int maxSpread = -1;
+  for( unsigned int i = 0; i < numFeatures; i++ )
+    {
+    SparseBinType binMin = bins[ order[begin] * numFeatures + i ];
+    SparseBinType binMax = binMin;
+    for( unsigned int b = begin + 1; b < end; ++b )
+      {
+      SparseBinType bin = bins[ order[b] * numFeatures + i ];
+      if( bin < binMin )
+        {
+        binMin = bin;
+        }
+      else if( bin > binMax )
+        {
+        binMax = bin;
+        }
+      }
+    if( binMax - binMin > maxSpread )
+      {
+      maxSpread = binMax - binMin;
+      splitFeature = i;
+      }
+    }
+
+  unsigned int mid = begin + ( end - begin ) / 2;
+  SparseBinCompare compare;
+  compare.Bins = &( bins[0] );
+  compare.NumberOfFeatures = numFeatures;
+  compare.Feature = splitFeature;
+  std::nth_element( order.begin() + begin, order.begin() + mid,
+    order.begin() + end, compare );
+
+  std::copy( bins.begin() + order[mid] * numFeatures,
+    bins.begin() + ( order[mid] + 1 ) * numFeatures,
+    pdf.Bins.begin() + mid * numFeatures );
+  pdf.Counts[mid] = counts[ order[mid] ];
+  pdf.SplitFeature[mid] = static_cast< unsigned char >( splitFeature );
+
+  this->BuildSparseTree( bins, counts, order, begin, mid, pdf );
+  this->BuildSparseTree( bins, counts, order, mid + 1, end, pdf );
+}
+
+template< class TImage, class TLabelMap >
+double
+PDFSegmenterParzen< TImage, TLabelMap >
+::EvaluateSparsePDF( const SparseClassPDFType & pdf,
+  const SparseBinIndexType & binIndex, unsigned int begin,
+  unsigned int end ) const
+{
+  if( begin >= end )
+    {
+    return 0;
+    }
+
+  int kernelRadius = static_cast< int >( m_SparseKernel.size() ) - 1;
+  unsigned int numFeatures = binIndex.size();
+  unsigned int mid = begin + ( end - begin ) / 2;
+  const SparseBinType * bin = &( pdf.Bins[ mid * numFeatures ] );
+
+  double sum = pdf.Counts[mid];
+  for( unsigned int i = 0; i < numFeatures && sum > 0; i++ )
+    {
+    int dist = std::abs( static_cast< int >( bin[i] )
+      - static_cast< int >( binIndex[i] ) );
+    if( dist > kernelRadius )
+      {
+      sum = 0;
+      }
+    else
+      {
+      sum *= m_SparseKernel[ dist ];
+      }
+    }
+
+  // Only visit the subtrees that can hold bins within the kernel
+  unsigned int split = pdf.SplitFeature[mid];
+  int delta = static_cast< int >( binIndex[split] )
+    - static_cast< int >( bin[split] );
+  if( delta - kernelRadius <= 0 )
+    {
+    sum += this->EvaluateSparsePDF( pdf, binIndex, begin, mid );
+    }
+  if( delta + kernelRadius >= 0 )
+    {
+    sum += this->EvaluateSparsePDF( pdf, binIndex, mid + 1, end );
+    }
+
+  return sum;
+}
+
 template< class TImage, class TLabelMap >
 void
 PDFSegmenterParzen< TImage, TLabelMap >
 ::GenerateLabeledFeatureSpace( void )
 {
+  if( this->GetPDFsAreSparse() )
+    {
+    m_LabeledFeatureSpace = NULL;
+    return;
+    }
+
   unsigned int numFeatures = this->m_FeatureVectorGenerator->
     GetNumberOfFeatures();
   m_LabeledFeatureSpace = LabeledFeatureSpaceType::New();
@@ -572,12 +903,13 @@ PDFSegmenterParzen< TImage, TLabelMap >
 
   typedef itk::ImageRegionIterator< HistogramImageType >
     PDFIteratorType;
-  std::vector< PDFIteratorType * > pdfIter( numClasses );
+  std::vector< PDFIteratorType > pdfIter;
+  pdfIter.reserve( numClasses );
   for( unsigned int i = 0; i < numClasses; i++ )
     {
-    pdfIter[i] = new PDFIteratorType( m_InClassHistogram[i],
-      m_InClassHistogram[i]->GetLargestPossibleRegion() );
-    pdfIter[i]->GoToBegin();
+    pdfIter.push_back( PDFIteratorType( m_InClassHistogram[i],
+      m_InClassHistogram[i]->GetLargestPossibleRegion() ) );
+    pdfIter[i].GoToBegin();
     }
 
   while( !fsIter.IsAtEnd() )
@@ -586,9 +918,9 @@ PDFSegmenterParzen< TImage, TLabelMap >
     ObjectIdType maxPC = this->m_VoidId;
     for( unsigned int c = 0; c < numClasses; c++ )
       {
-      if( pdfIter[c]->Get() > maxP )
+      if( pdfIter[c].Get() > maxP )
         {
-        maxP = pdfIter[c]->Get();
+        maxP = pdfIter[c].Get();
         maxPC = this->m_ObjectIdList[ c ];
         }
       }
@@ -597,14 +929,9 @@ PDFSegmenterParzen< TImage, TLabelMap >
     ++fsIter;
     for( unsigned int c = 0; c < numClasses; c++ )
       {
-      ++(*(pdfIter[c]));
+      ++pdfIter[c];
       }
     }
-
-  for( unsigned int c = 0; c < numClasses; c++ )
-    {
-    delete pdfIter[c];
-    }
 }
 
 template< class TImage, class TLabelMap >
@@ -623,6 +950,31 @@ PDFSegmenterParzen< TImage, TLabelMap >
 {
   unsigned int numFeatures = this->m_FeatureVectorGenerator->
     GetNumberOfFeatures();
+
+  if( this->GetPDFsAreSparse() )
+    {
+    SparseBinIndexType sparseBinIndex( numFeatures );
+    for( unsigned int i = 0; i < numFeatures; i++ )
+      {
+      int binN = static_cast< int >( ( fv[i] - m_HistogramBinMin[i] )
+        / m_HistogramBinSize[i] );
+      if( binN < 0 )
+        {
+        binN = 0;
+        }
+      else if( static_cast< unsigned int >( binN )
+        >= m_HistogramNumberOfBin[i] )
+        {
+        binN = m_HistogramNumberOfBin[i] - 1;
+        }
+      sparseBinIndex[i] = static_cast< SparseBinType >( binN );
+      }
+    const SparseClassPDFType & pdf = m_SparseClassPDF[classNum];
+    return static_cast< ProbabilityPixelType >( pdf.Normalization
+      * this->EvaluateSparsePDF( pdf, sparseBinIndex, 0,
+      pdf.Counts.size() ) );
+    }
+
   typename HistogramImageType::IndexType binIndex;
   binIndex.Fill( 0 );
   for( unsigned int i = 0; i < numFeatures; i++ )
@@ -673,6 +1025,11 @@ PDFSegmenterParzen< TImage, TLabelMap >
     << m_HistogramSmoothingStandardDeviation << std::endl;
   os << indent << "InClassHistogram size = "
     << m_InClassHistogram.size() << std::endl;
+  os << indent << "UseSparsePDFs = " << m_UseSparsePDFs << std::endl;
+  os << indent << "SparseClassPDF size = "
+    << m_SparseClassPDF.size() << std::endl;
+  os << indent << "SparseKernel size = "
+    << m_SparseKernel.size() << std::endl;
   if( m_HistogramBinMin.size() > 0 )
     {
     os << indent << "HistogramBinMin = " << m_HistogramBinMin[0]
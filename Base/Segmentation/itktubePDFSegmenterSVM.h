@@ -113,6 +113,12 @@ public:
   virtual ProbabilityPixelType GetClassProbability( unsigned int
     classNum, const FeatureVectorType & fv ) const;
 
+  /** Predicts a block of vectors from one node buffer; each prediction
+   *   gives the probabilities of all classes */
+  virtual void GetClassProbabilities( unsigned int numVectors,
+    const FeatureValueType * features,
+    ProbabilityPixelType * probabilities ) const;
+
 protected:
 
   PDFSegmenterSVM( void );
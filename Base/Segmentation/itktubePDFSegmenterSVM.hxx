@@ -28,6 +28,8 @@ limitations under the License.
 
 #include "svm.h"
 
+#include <algorithm>
+
 namespace itk
 {
 
@@ -310,30 +312,60 @@ PDFSegmenterSVM< TImage, TLabelMap >
   const
 {
   unsigned int numClasses = this->m_ObjectIdList.size();
-  unsigned int numFeatures = this->GetNumberOfFeatures();
 
-  svm_node * x = (struct svm_node *)malloc( ( numFeatures+1 ) *
-    sizeof( struct svm_node ) );
+  std::vector< ProbabilityPixelType > classProb( numClasses );
+  this->GetClassProbabilities( 1, fv.data_block(), &( classProb[0] ) );
+
+  return classProb[ classNum ];
+}
+
+template< class TImage, class TLabelMap >
+void
+PDFSegmenterSVM< TImage, TLabelMap >
+::GetClassProbabilities( unsigned int numVectors,
+  const FeatureValueType * features,
+  ProbabilityPixelType * probabilities ) const
+{
+  unsigned int numClasses = this->m_ObjectIdList.size();
+  unsigned int numFeatures = this->GetNumberOfFeatures();
 
-  for( unsigned int f=0; f<numFeatures; ++f )
+  // All vectors of the block share one buffer of nodes, each vector
+  //   terminated by an index of -1
+  std::vector< svm_node > x( numVectors * ( numFeatures + 1 ) );
+  unsigned int elementNum = 0;
+  for( unsigned int v=0; v<numVectors; ++v )
     {
-    x[ f ].index = f;
-    x[ f ].value = fv[ f ];
+    for( unsigned int f=0; f<numFeatures; ++f )
+      {
+      x[ elementNum ].index = f;
+      x[ elementNum ].value = features[ v * numFeatures + f ];
+      ++elementNum;
+      }
+    x[ elementNum ].index = -1;
+    x[ elementNum ].value = 0;
+    ++elementNum;
     }
-  x[ numFeatures ].index = -1;
-  x[ numFeatures ].value = 0;
-
-  double * probEstimates = (double *)malloc( numClasses *
-    sizeof( double ) );
 
-  svm_predict_probability( m_Model, x, probEstimates );
-  double classProb = probEstimates[ classNum ]
-    * this->GetSVMClassWeight( classNum );
+  unsigned int numModelClasses = svm_get_nr_class( m_Model );
+  std::vector< double > probEstimates( std::max( numClasses,
+    numModelClasses ) );
 
-  free( probEstimates );
-  free( x );
+  std::vector< double > classWeight( numClasses );
+  for( unsigned int c=0; c<numClasses; ++c )
+    {
+    classWeight[ c ] = this->GetSVMClassWeight( c );
+    }
 
-  return classProb;
+  for( unsigned int v=0; v<numVectors; ++v )
+    {
+    svm_predict_probability( m_Model, &( x[ v * ( numFeatures + 1 ) ] ),
+      &( probEstimates[0] ) );
+    for( unsigned int c=0; c<numClasses; ++c )
+      {
+      probabilities[ v * numClasses + c ] = probEstimates[ c ]
+        * classWeight[ c ];
+      }
+    }
 }
 
 template< class TImage, class TLabelMap >
@@ -35,6 +35,8 @@ limitations under the License.
 
 #include <vnl/vnl_vector.h>
 
+#include <algorithm>
+#include <utility>
 #include <vector>
 
 namespace itk
@@ -248,6 +250,15 @@ private:
   std::vector< double >                   m_KernelDistances;
   std::vector< double >                   m_KernelTangentDistances;
 
+  /** The kernel samples sorted by their distance to the tube, so that
+   *  the samples within a range of distances are found by binary search.
+   *  Values are stored as their medialness histogram bin. */
+  enum { KernelHistogramBins = 500 };
+
+  std::vector< double >                   m_KernelSortedDistances;
+  std::vector< double >                   m_KernelSortedTangentDistances;
+  std::vector< int >                      m_KernelSortedBins;
+
   double                                  m_KernelOptimalRadius;
   double                                  m_KernelOptimalRadiusMedialness;
   double                                  m_KernelOptimalRadiusBranchness;
@@ -108,6 +108,10 @@ RadiusExtractor2<TInputImage>
   m_KernelDistances.clear();
   m_KernelTangentDistances.clear();
 
+  m_KernelSortedDistances.clear();
+  m_KernelSortedTangentDistances.clear();
+  m_KernelSortedBins.clear();
+
   m_KernelOptimalRadius = 0;
   m_KernelOptimalRadiusMedialness = 0;
   m_KernelOptimalRadiusBranchness = 0;
@@ -381,6 +385,35 @@ RadiusExtractor2<TInputImage>
       done = true;
       }
     }
+
+  std::vector< std::pair< double, unsigned int > > distanceOrder(
+    kernelSize );
+  for( unsigned int i = 0; i < kernelSize; ++i )
+    {
+    distanceOrder[i].first = m_KernelDistances[i];
+    distanceOrder[i].second = i;
+    }
+  std::sort( distanceOrder.begin(), distanceOrder.end() );
+
+  m_KernelSortedDistances.resize( kernelSize );
+  m_KernelSortedTangentDistances.resize( kernelSize );
+  m_KernelSortedBins.resize( kernelSize );
+  for( unsigned int i = 0; i < kernelSize; ++i )
+    {
+    const unsigned int k = distanceOrder[i].second;
+    m_KernelSortedDistances[i] = m_KernelDistances[k];
+    m_KernelSortedTangentDistances[i] = m_KernelTangentDistances[k];
+    int bin = m_KernelValues[k] * KernelHistogramBins;
+    if( bin < 0 )
+      {
+      bin = 0;
+      }
+    else if( bin > KernelHistogramBins - 1 )
+      {
+      bin = KernelHistogramBins - 1;
+      }
+    m_KernelSortedBins[i] = bin;
+    }
 }
 
 template< class TInputImage >
@@ -427,10 +460,6 @@ RadiusExtractor2<TInputImage>
   double pVal = 0;
   double nVal = 0;
 
-  std::vector< double >::iterator iterDist;
-  std::vector< double >::iterator iterTanDist;
-  std::vector< double >::iterator iterValue;
-
   double areaR = r * r * vnl_math::pi;
   double distMax = ( r + 1.0 );
   double areaMax = distMax * distMax * vnl_math::pi;
@@ -450,7 +479,7 @@ RadiusExtractor2<TInputImage>
     std::cout << "   Area = " << areaPos << " - " << areaNeg << std::endl;
     }
 
-  const int histoBins = 500;
+  const int histoBins = KernelHistogramBins;
   unsigned int histoPos[histoBins];
   unsigned int histoNeg[histoBins];
   unsigned int histoPosCount = 0;
@@ -461,37 +490,34 @@ RadiusExtractor2<TInputImage>
     histoNeg[i] = 0;
     }
   int bin = 0;
-  iterDist = m_KernelDistances.begin();
-  iterTanDist = m_KernelTangentDistances.begin();
-  iterValue = m_KernelValues.begin();
-  while( iterDist != m_KernelDistances.end() )
+
+  // Only the samples with distMin <= dist <= distMax are visited, the ones
+  // with dist <= r being first
+  const double tanDistMax = std::max( r, 1.0 );
+  const unsigned int kBegin = std::lower_bound(
+    m_KernelSortedDistances.begin(), m_KernelSortedDistances.end(),
+    distMin ) - m_KernelSortedDistances.begin();
+  const unsigned int kSplit = std::upper_bound(
+    m_KernelSortedDistances.begin() + kBegin, m_KernelSortedDistances.end(),
+    r ) - m_KernelSortedDistances.begin();
+  const unsigned int kEnd = std::upper_bound(
+    m_KernelSortedDistances.begin() + kSplit, m_KernelSortedDistances.end(),
+    distMax ) - m_KernelSortedDistances.begin();
+  for( unsigned int k = kBegin; k < kSplit; ++k )
     {
-    if( ( ( *iterTanDist ) < r || ( *iterTanDist ) < 1 )
-      && ( *iterDist ) >= distMin && ( *iterDist ) <= distMax )
+    if( m_KernelSortedTangentDistances[k] < tanDistMax )
       {
-      bin = ( *iterValue ) * histoBins;
-      if( bin < 0 )
-        {
-        bin = 0;
-        }
-      else if( bin > histoBins - 1 )
-        {
-        bin = histoBins - 1;
-        }
-      if( (*iterDist) <= r )
-        {
-        ++histoPos[bin];
-        ++histoPosCount;
-        }
-      else
-        {
-        ++histoNeg[bin];
-        ++histoNegCount;
-        }
+      ++histoPos[ m_KernelSortedBins[k] ];
+      ++histoPosCount;
+      }
+    }
+  for( unsigned int k = kSplit; k < kEnd; ++k )
+    {
+    if( m_KernelSortedTangentDistances[k] < tanDistMax )
+      {
+      ++histoNeg[ m_KernelSortedBins[k] ];
+      ++histoNegCount;
       }
-    ++iterValue;
-    ++iterDist;
-    ++iterTanDist;
     }
 
   int binCount = 0;
@@ -555,14 +581,10 @@ RadiusExtractor2<TInputImage>
   double pVal = 0;
   double nVal = 0;
 
-  std::vector< double >::iterator iterDist;
-  std::vector< double >::iterator iterTanDist;
-  std::vector< double >::iterator iterValue;
-
   double distMax = r * this->GetKernelExtent();
   double distMin = 0;
 
-  const int histoBins = 500;
+  const int histoBins = KernelHistogramBins;
   unsigned int histoPos[histoBins];
   unsigned int histoNeg[histoBins];
   unsigned int histoPosCount = 0;
@@ -573,37 +595,28 @@ RadiusExtractor2<TInputImage>
     histoNeg[i] = 0;
     }
   int bin = 0;
-  iterDist = m_KernelDistances.begin();
-  iterTanDist = m_KernelTangentDistances.begin();
-  iterValue = m_KernelValues.begin();
-  while( iterDist != m_KernelDistances.end() )
+
+  const unsigned int kBegin = std::lower_bound(
+    m_KernelSortedDistances.begin(), m_KernelSortedDistances.end(),
+    distMin ) - m_KernelSortedDistances.begin();
+  const unsigned int kEnd = std::upper_bound(
+    m_KernelSortedDistances.begin() + kBegin, m_KernelSortedDistances.end(),
+    distMax ) - m_KernelSortedDistances.begin();
+  for( unsigned int k = kBegin; k < kEnd; ++k )
     {
-    if( ( *iterTanDist ) < r
-      && ( *iterDist ) >= distMin && ( *iterDist ) <= distMax )
+    if( m_KernelSortedTangentDistances[k] < r )
       {
-      bin = ( *iterValue ) * histoBins;
-      if( bin < 0 )
-        {
-        bin = 0;
-        }
-      else if( bin > histoBins - 1 )
-        {
-        bin = histoBins - 1;
-        }
-      if( (*iterDist) <= r )
+      if( m_KernelSortedDistances[k] <= r )
         {
-        ++histoPos[bin];
+        ++histoPos[ m_KernelSortedBins[k] ];
         ++histoPosCount;
         }
       else
         {
-        ++histoNeg[bin];
+        ++histoNeg[ m_KernelSortedBins[k] ];
         ++histoNegCount;
         }
       }
-    ++iterValue;
-    ++iterDist;
-    ++iterTanDist;
     }
 
   int binCount = 0;
@@ -993,6 +1006,8 @@ RadiusExtractor2<TInputImage>
     << std::endl;
   os << indent << "KernelTangentDistances = " << m_KernelTangentDistances.size()
     << std::endl;
+  os << indent << "KernelSortedDistances = " << m_KernelSortedDistances.size()
+    << std::endl;
 
   os << indent << "KernelOptimalRadius = " << m_KernelOptimalRadius
     << std::endl;
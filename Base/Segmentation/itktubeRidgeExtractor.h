@@ -36,10 +36,13 @@ limitations under the License.
 #include "tubeSplineND.h"
 
 #include <itkContinuousIndex.h>
+#include <itkSimpleFastMutexLock.h>
 #include <itkVesselTubeSpatialObject.h>
 
 #include <cmath>
 #include <list>
+#include <map>
+#include <vector>
 
 namespace itk
 {
@@ -111,6 +114,30 @@ public:
     ROUND_FAIL, CURVE_FAIL, LEVEL_FAIL, TANGENT_FAIL, DISTANCE_FAIL,
     OTHER_FAIL }                                FailureCodeEnum;
 
+  /** Tube mask values keyed by their offset in the mask buffer */
+  typedef std::map< OffsetValueType,
+    typename TubeMaskImageType::PixelType >     TubeMaskValueMapType;
+
+  /** Tube mask accesses of one ridge extraction done while staging.
+   *  Reads holds the mask values the extraction depended on, Writes the
+   *  values it set, and DeletedTubes the tubes it removed from the mask
+   *  after its last write. */
+  struct TubeMaskStagingType
+    {
+    TubeMaskValueMapType                            Reads;
+    TubeMaskValueMapType                            Writes;
+    std::vector< typename TubeType::ConstPointer >  DeletedTubes;
+    }; // End struct TubeMaskStagingType
+
+  /** Locks guarding a tube mask that is read by some threads while
+   *  another thread writes it.  Each lock covers every NumberOfLocks-th
+   *  slice of the mask. */
+  struct TubeMaskLocksType
+    {
+    enum { NumberOfLocks = 64 };
+    SimpleFastMutexLock                             Locks[ NumberOfLocks ];
+    }; // End struct TubeMaskLocksType
+
   /** Set the input image */
   void SetInputImage( typename ImageType::Pointer inputImage );
 
@@ -123,6 +150,35 @@ public:
   /** Set the mask image */
   itkSetObjectMacro( TubeMaskImage, TubeMaskImageType );
 
+  /** Record the tube mask accesses in staging instead of writing to the
+   *  mask.  The mask is then only read, so ridge extractors sharing it
+   *  can run in parallel.  NULL = write to the mask. */
+  void SetTubeMaskStaging( TubeMaskStagingType * staging );
+
+  /** Lock the tube mask while it is shared: staged reads then lock the
+   *  slice they read, and writes to the mask lock the slices they write.
+   *  Only one of the ridge extractors sharing the mask may write to it.
+   *  NULL = no locking. */
+  void SetTubeMaskLocks( TubeMaskLocksType * locks );
+
+  /** Return true if the mask still holds every value read in staging,
+   *  i.e., if repeating the staged extraction would give the same tube.
+   *  Call from the thread that writes to the mask. */
+  bool IsTubeMaskStagingCurrent( const TubeMaskStagingType & staging )
+    const;
+
+  /** Apply the writes and tube deletions recorded in staging to the mask */
+  void CommitTubeMaskStaging( const TubeMaskStagingType & staging );
+
+  /** Read the tube mask at indx, through the staging if one is set */
+  typename TubeMaskImageType::PixelType GetTubeMaskValue(
+    const IndexType & indx );
+
+  /** Use the input image, data range, extraction bounds, and tube mask of
+   *  another ridge extractor.  Avoids recomputing the image range and
+   *  allocating a new mask when creating per-thread ridge extractors. */
+  void ShareInputImage( const Self * ridgeExtractor );
+
   /** Set Data Minimum */
   void SetDataMin( double dataMin );
 
@@ -235,6 +291,23 @@ public:
   /** Get the extent */
   double GetScaleKernelExtent( void );
 
+  /** Cache blurred intensities in tiles, per scale, so that the lattice
+   *  values repeatedly requested by the data spline during traversal,
+   *  recovery, and dynamic scale changes are only convolved once.  Off by
+   *  default.  The cache belongs to this extractor and is not
+   *  thread-safe: threads must not share an extractor that uses it.
+   *  \sa BlurImageFunction::SetUseTileCache */
+  void SetUseIntensityCache( bool useIntensityCache );
+
+  /** Are blurred intensities cached */
+  bool GetUseIntensityCache( void );
+
+  /** Set the maximum number of bytes used by the intensity cache */
+  void SetIntensityCacheMemoryBudget( SizeValueType budget );
+
+  /** Get the maximum number of bytes used by the intensity cache */
+  SizeValueType GetIntensityCacheMemoryBudget( void );
+
   /** Set to re-estimate (based on local radius estimate) the scale to be
    * used for image measures made during ridge extraction */
   void SetDynamicScale( bool dynamicScale );
@@ -338,6 +411,10 @@ public:
   unsigned int      GetFailureCodeCount( FailureCodeEnum code ) const;
   void              ResetFailureCodeCounts( void );
 
+  /** Get/Add the counts of every failure code */
+  const IntVectorType & GetFailureCodeCounts( void ) const;
+  void              AddFailureCodeCounts( const IntVectorType & counts );
+
   /** Set the idle callback */
   void   IdleCallBack( bool ( *idleCallBack )( void ) );
 
@@ -356,6 +433,24 @@ protected:
   bool  TraverseOneWay( ContinuousIndexType & newX, VectorType & newT,
     MatrixType & newN, int dir, bool verbose=false );
 
+  /** Write the tube mask at indx, through the staging if one is set */
+  void SetTubeMaskValue( const IndexType & indx,
+    typename TubeMaskImageType::PixelType value );
+
+  /** Read the tube mask at indx and, if the voxel is unclaimed (or, when
+   *  claimOwned is true, already belongs to tubeId), mark it with tubeId
+   *  and tubePointCount.  Returns the value read. */
+  typename TubeMaskImageType::PixelType ClaimTubeMaskValue(
+    const IndexType & indx, int tubeId, int tubePointCount,
+    bool claimOwned );
+
+  /** Return the lock of the slice holding a mask buffer offset */
+  SimpleFastMutexLock & GetTubeMaskLock( OffsetValueType offset ) const;
+
+  /** Lock or unlock every slice of the mask, if locks are set */
+  void LockTubeMask( void ) const;
+  void UnlockTubeMask( void ) const;
+
 private:
 
   RidgeExtractor( const Self& );
@@ -366,6 +461,8 @@ private:
   typename BlurImageFunction<ImageType>::Pointer     m_DataFunc;
 
   typename TubeMaskImageType::Pointer                m_TubeMaskImage;
+  TubeMaskStagingType                              * m_TubeMaskStaging;
+  TubeMaskLocksType                                * m_TubeMaskLocks;
 
   bool                                               m_DynamicScale;
   double                                             m_DynamicScaleUsed;
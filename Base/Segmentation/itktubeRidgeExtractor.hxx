@@ -153,6 +153,9 @@ RidgeExtractor<TInputImage>
   m_FailureCodeCount.fill( 0 );
 
   m_Tube = NULL;
+
+  m_TubeMaskStaging = NULL;
+  m_TubeMaskLocks = NULL;
 }
 
 /**
@@ -251,6 +254,249 @@ RidgeExtractor<TInputImage>
   return m_InputImage;
 }
 
+/**
+ * Set the record used to stage tube mask accesses */
+template< class TInputImage >
+void
+RidgeExtractor<TInputImage>
+::SetTubeMaskStaging( TubeMaskStagingType * staging )
+{
+  m_TubeMaskStaging = staging;
+}
+
+/**
+ * Set the locks guarding a shared tube mask */
+template< class TInputImage >
+void
+RidgeExtractor<TInputImage>
+::SetTubeMaskLocks( TubeMaskLocksType * locks )
+{
+  m_TubeMaskLocks = locks;
+}
+
+/**
+ * Get the lock of the mask slice holding an offset */
+template< class TInputImage >
+SimpleFastMutexLock &
+RidgeExtractor<TInputImage>
+::GetTubeMaskLock( OffsetValueType offset ) const
+{
+  OffsetValueType slice = offset
+    / m_TubeMaskImage->GetOffsetTable()[ ImageDimension-1 ];
+
+  return m_TubeMaskLocks->Locks[ slice
+    % TubeMaskLocksType::NumberOfLocks ];
+}
+
+/**
+ * Lock every slice of the tube mask */
+template< class TInputImage >
+void
+RidgeExtractor<TInputImage>
+::LockTubeMask( void ) const
+{
+  if( m_TubeMaskLocks != NULL )
+    {
+    for( unsigned int i=0; i<TubeMaskLocksType::NumberOfLocks; ++i )
+      {
+      m_TubeMaskLocks->Locks[i].Lock();
+      }
+    }
+}
+
+/**
+ * Unlock every slice of the tube mask */
+template< class TInputImage >
+void
+RidgeExtractor<TInputImage>
+::UnlockTubeMask( void ) const
+{
+  if( m_TubeMaskLocks != NULL )
+    {
+    for( unsigned int i=0; i<TubeMaskLocksType::NumberOfLocks; ++i )
+      {
+      m_TubeMaskLocks->Locks[i].Unlock();
+      }
+    }
+}
+
+/**
+ * Check the values read while staging against the tube mask */
+template< class TInputImage >
+bool
+RidgeExtractor<TInputImage>
+::IsTubeMaskStagingCurrent( const TubeMaskStagingType & staging ) const
+{
+  const typename TubeMaskImageType::PixelType * buffer =
+    m_TubeMaskImage->GetBufferPointer();
+
+  typename TubeMaskValueMapType::const_iterator iter =
+    staging.Reads.begin();
+  while( iter != staging.Reads.end() )
+    {
+    if( buffer[ iter->first ] != iter->second )
+      {
+      return false;
+      }
+    ++iter;
+    }
+
+  return true;
+}
+
+/**
+ * Apply the writes and deletions recorded while staging to the mask */
+template< class TInputImage >
+void
+RidgeExtractor<TInputImage>
+::CommitTubeMaskStaging( const TubeMaskStagingType & staging )
+{
+  typename TubeMaskImageType::PixelType * buffer =
+    m_TubeMaskImage->GetBufferPointer();
+
+  this->LockTubeMask();
+
+  typename TubeMaskValueMapType::const_iterator iter =
+    staging.Writes.begin();
+  while( iter != staging.Writes.end() )
+    {
+    buffer[ iter->first ] = iter->second;
+    ++iter;
+    }
+
+  for( unsigned int i=0; i<staging.DeletedTubes.size(); ++i )
+    {
+    this->DeleteTube< TubeMaskImageType >(
+      staging.DeletedTubes[i].GetPointer(), m_TubeMaskImage );
+    }
+
+  this->UnlockTubeMask();
+}
+
+/**
+ * Share the input image and tube mask of another ridge extractor */
+template< class TInputImage >
+void
+RidgeExtractor<TInputImage>
+::ShareInputImage( const Self * ridgeExtractor )
+{
+  m_InputImage = ridgeExtractor->m_InputImage;
+
+  if( m_InputImage.IsNotNull() )
+    {
+    m_DataFunc->SetUseRelativeSpacing( true );
+    m_DataFunc->SetInputImage( m_InputImage );
+
+    m_DataMin = ridgeExtractor->m_DataMin;
+    m_DataMax = ridgeExtractor->m_DataMax;
+    m_DataRange = ridgeExtractor->m_DataRange;
+
+    m_ExtractBoundMin = ridgeExtractor->m_ExtractBoundMin;
+    m_ExtractBoundMax = ridgeExtractor->m_ExtractBoundMax;
+
+    typename ImageType::RegionType region;
+    region = m_InputImage->GetLargestPossibleRegion();
+    vnl_vector<int> vMin( ImageDimension );
+    vnl_vector<int> vMax( ImageDimension );
+    for( unsigned int i=0; i<ImageDimension; i++ )
+      {
+      vMin[i] = region.GetIndex()[i];
+      vMax[i] = region.GetIndex()[i] + region.GetSize()[i]-1;
+      }
+    m_DataSpline->SetXMin( vMin );
+    m_DataSpline->SetXMax( vMax );
+    }
+
+  m_TubeMaskImage = ridgeExtractor->m_TubeMaskImage;
+}
+
+/**
+ * Read the tube mask */
+template< class TInputImage >
+typename RidgeExtractor<TInputImage>::TubeMaskImageType::PixelType
+RidgeExtractor<TInputImage>
+::GetTubeMaskValue( const IndexType & indx )
+{
+  if( m_TubeMaskStaging == NULL )
+    {
+    return m_TubeMaskImage->GetPixel( indx );
+    }
+
+  OffsetValueType offset = m_TubeMaskImage->ComputeOffset( indx );
+  typename TubeMaskValueMapType::const_iterator iter =
+    m_TubeMaskStaging->Writes.find( offset );
+  if( iter != m_TubeMaskStaging->Writes.end() )
+    {
+    return iter->second;
+    }
+
+  // Only the first read of a voxel is recorded: it is the mask value
+  //   the extraction depends on
+  typename TubeMaskImageType::PixelType value;
+  if( m_TubeMaskLocks == NULL )
+    {
+    value = m_TubeMaskImage->GetPixel( indx );
+    }
+  else
+    {
+    SimpleFastMutexLock & lock = this->GetTubeMaskLock( offset );
+    lock.Lock();
+    value = m_TubeMaskImage->GetPixel( indx );
+    lock.Unlock();
+    }
+  m_TubeMaskStaging->Reads.insert( std::make_pair( offset, value ) );
+
+  return value;
+}
+
+/**
+ * Write the tube mask */
+template< class TInputImage >
+void
+RidgeExtractor<TInputImage>
+::SetTubeMaskValue( const IndexType & indx,
+  typename TubeMaskImageType::PixelType value )
+{
+  if( m_TubeMaskStaging == NULL )
+    {
+    if( m_TubeMaskLocks == NULL )
+      {
+      m_TubeMaskImage->SetPixel( indx, value );
+      }
+    else
+      {
+      SimpleFastMutexLock & lock = this->GetTubeMaskLock(
+        m_TubeMaskImage->ComputeOffset( indx ) );
+      lock.Lock();
+      m_TubeMaskImage->SetPixel( indx, value );
+      lock.Unlock();
+      }
+    }
+  else
+    {
+    m_TubeMaskStaging->Writes[ m_TubeMaskImage->ComputeOffset( indx ) ] =
+      value;
+    }
+}
+
+/**
+ * Read the tube mask and claim the voxel if it is free */
+template< class TInputImage >
+typename RidgeExtractor<TInputImage>::TubeMaskImageType::PixelType
+RidgeExtractor<TInputImage>
+::ClaimTubeMaskValue( const IndexType & indx, int tubeId,
+  int tubePointCount, bool claimOwned )
+{
+  typename TubeMaskImageType::PixelType value = GetTubeMaskValue( indx );
+  if( value == 0 || ( claimOwned && ( int )value == tubeId ) )
+    {
+    SetTubeMaskValue( indx, ( float )( tubeId
+      + ( tubePointCount/10000.0 ) ) );
+    }
+
+  return value;
+}
+
 /**
  * Set Data Min value */
 template< class TInputImage >
@@ -320,6 +566,46 @@ RidgeExtractor<TInputImage>
   return m_DataFunc->GetExtent();
 }
 
+/**
+ * Use the intensity cache */
+template< class TInputImage >
+void
+RidgeExtractor<TInputImage>
+::SetUseIntensityCache( bool useIntensityCache )
+{
+  m_DataFunc->SetUseTileCache( useIntensityCache );
+}
+
+/**
+ * Is the intensity cache used */
+template< class TInputImage >
+bool
+RidgeExtractor<TInputImage>
+::GetUseIntensityCache( void )
+{
+  return m_DataFunc->GetUseTileCache();
+}
+
+/**
+ * Set the memory budget of the intensity cache */
+template< class TInputImage >
+void
+RidgeExtractor<TInputImage>
+::SetIntensityCacheMemoryBudget( SizeValueType budget )
+{
+  m_DataFunc->SetTileCacheMemoryBudget( budget );
+}
+
+/**
+ * Get the memory budget of the intensity cache */
+template< class TInputImage >
+SizeValueType
+RidgeExtractor<TInputImage>
+::GetIntensityCacheMemoryBudget( void )
+{
+  return m_DataFunc->GetTileCacheMemoryBudget();
+}
+
 /**
  * Get the data spline */
 template< class TInputImage >
@@ -559,6 +845,8 @@ RidgeExtractor<TInputImage>
     {
     os << indent << "DataMask = NULL" << std::endl;
     }
+  os << indent << "TubeMaskStaging = " << m_TubeMaskStaging << std::endl;
+  os << indent << "TubeMaskLocks = " << m_TubeMaskLocks << std::endl;
   if( m_DataFunc.IsNotNull() )
     {
     os << indent << "DataFunc = " << m_DataFunc << std::endl;
@@ -722,7 +1010,7 @@ RidgeExtractor<TInputImage>
   pnts.clear();
 
   typename TubeMaskImageType::PixelType value =
-    m_TubeMaskImage->GetPixel( indx );
+    ClaimTubeMaskValue( indx, tubeId, tubePointCount, true );
   if( value != 0 && ( int )value != tubeId )
     {
     if( verbose || this->GetDebug() )
@@ -736,8 +1024,6 @@ RidgeExtractor<TInputImage>
     }
   else
     {
-    m_TubeMaskImage->SetPixel( indx, ( float )( tubeId
-      + ( tubePointCount/10000.0 ) ) );
     if( dir == 1 )
       {
       if( this->GetDebug() )
@@ -1139,7 +1425,8 @@ RidgeExtractor<TInputImage>
       {
       indx[i] = ( int )( lX[i]+0.5 );
       }
-    double maskVal = m_TubeMaskImage->GetPixel( indx );
+    double maskVal = ClaimTubeMaskValue( indx, tubeId, tubePointCount,
+      false );
 
     if( maskVal != 0 )
       {
@@ -1162,11 +1449,6 @@ RidgeExtractor<TInputImage>
         break;
         }
       }
-    else
-      {
-      m_TubeMaskImage->SetPixel( indx, ( float )( tubeId
-        + ( tubePointCount/10000.0 ) ) );
-      }
 
     /** Show the satus every 50 points */
     if( tubePointCount%50==0 )
@@ -1415,6 +1697,22 @@ RidgeExtractor<TInputImage>
   m_FailureCodeCount.fill( 0 );
 }
 
+template< class TInputImage >
+const typename RidgeExtractor<TInputImage>::IntVectorType &
+RidgeExtractor<TInputImage>
+::GetFailureCodeCounts( void ) const
+{
+  return m_FailureCodeCount;
+}
+
+template< class TInputImage >
+void
+RidgeExtractor<TInputImage>
+::AddFailureCodeCounts( const IntVectorType & counts )
+{
+  m_FailureCodeCount += counts;
+}
+
 
 /**
  * Compute the local ridge
@@ -1518,7 +1816,9 @@ RidgeExtractor<TInputImage>
         }
       }
 
-    if( m_TubeMaskImage->GetPixel( indx ) != 0 )
+    typename TubeMaskImageType::PixelType maskVal =
+      GetTubeMaskValue( indx );
+    if( maskVal != 0 )
       {
       if( m_StatusCallBack )
         {
@@ -1527,7 +1827,7 @@ RidgeExtractor<TInputImage>
       if( verbose || this->GetDebug() )
         {
         std::cout << "RidgeExtractor::LocalRidge() : Revisited voxel 3"
-          << m_TubeMaskImage->GetPixel( indx ) << std::endl;
+          << maskVal << std::endl;
         }
       return REVISITED_VOXEL;
       }
@@ -1681,7 +1981,7 @@ RidgeExtractor<TInputImage>
     indx[i] = (int)(lX[i] + 0.5);
     }
   typename TubeMaskImageType::PixelType value =
-    m_TubeMaskImage->GetPixel( indx );
+    GetTubeMaskValue( indx );
   if( value != 0 && ( int )value != tubeId )
     {
     m_CurrentFailureCode = REVISITED_VOXEL;
@@ -1968,7 +2268,18 @@ bool
 RidgeExtractor<TInputImage>
 ::DeleteTube( const TubeType * tube )
 {
-  return this->DeleteTube< TubeMaskImageType >( tube, m_TubeMaskImage );
+  if( m_TubeMaskStaging != NULL )
+    {
+    m_TubeMaskStaging->DeletedTubes.push_back( tube );
+    return true;
+    }
+
+  this->LockTubeMask();
+  bool result = this->DeleteTube< TubeMaskImageType >( tube,
+    m_TubeMaskImage );
+  this->UnlockTubeMask();
+
+  return result;
 }
 
 
@@ -2104,7 +2415,12 @@ bool
 RidgeExtractor<TInputImage>
 ::AddTube( const TubeType * tube )
 {
-  return this->AddTube< TubeMaskImageType >( tube, m_TubeMaskImage );
+  this->LockTubeMask();
+  bool result = this->AddTube< TubeMaskImageType >( tube,
+    m_TubeMaskImage );
+  this->UnlockTubeMask();
+
+  return result;
 }
 
 /** Set the idle call back */
@@ -34,8 +34,13 @@ limitations under the License.
 
 #include "itkGroupSpatialObject.h"
 
+#include <itkConditionVariable.h>
+#include <itkMultiThreader.h>
+#include <itkMutexLock.h>
 #include <itkObject.h>
 
+#include <vector>
+
 namespace itk
 {
 
@@ -102,6 +107,12 @@ public:
    * Defines the type of vectors used */
   typedef itk::Vector<double,  ImageDimension >         VectorType;
 
+  /**
+   * Defines the seed and tube lists used by ExtractTubes */
+  typedef std::vector< ContinuousIndexType >            SeedListType;
+  typedef std::vector< double >                         SeedRadiusListType;
+  typedef std::vector< typename TubeType::Pointer >     TubeListType;
+
 
   /**
    * Set the input image */
@@ -182,6 +193,44 @@ public:
     unsigned int tubeID,
     bool verbose=false );
 
+  /**
+   * Set/Get the number of threads used by ExtractTubes */
+  itkSetMacro( NumberOfThreads, unsigned int );
+  itkGetMacro( NumberOfThreads, unsigned int );
+
+  /**
+   * Set/Get how many seeds per thread ExtractTubes may extract ahead of
+   * the last tube added to the mask.  Larger values keep the threads
+   * busy when extraction times vary, but more staged tubes are then
+   * invalidated by the tubes added before them. */
+  itkSetMacro( SeedLookAhead, unsigned int );
+  itkGetMacro( SeedLookAhead, unsigned int );
+
+  /**
+   * Get the number of seeds of the last ExtractTubes call whose staged
+   * tube was discarded and that were extracted again */
+  itkGetMacro( NumberOfReextractedSeeds, unsigned int );
+
+  /**
+   * Extract a tube from every seed in the list, as if ExtractTube and
+   * AddTube were called for each seed in turn.  Seed i is extracted at
+   * radius seedRadii[i] with tube ID firstTubeID + i.  All threads share
+   * the tube mask.  The calling thread adds the tubes to it in seed
+   * order, while the other threads extract the next seeds, at most
+   * SeedLookAhead seeds ahead, reading the mask as it is and staging
+   * their writes.  A staged tube whose reads no longer match the mask
+   * when its turn comes is discarded and its seed is extracted again
+   * on the calling thread.  The tubes, the tube mask, and the failure
+   * code counts of GetRidgeOp() are thus the same for any number of
+   * threads.  The returned list holds one entry per seed, NULL where
+   * extraction failed.  If verbose, the progress of each seed is
+   * printed in seed order.  The abort callback may be called from the
+   * worker threads, the other callbacks only from the calling thread. */
+  TubeListType ExtractTubes( const SeedListType & seeds,
+    const SeedRadiusListType & seedRadii,
+    unsigned int firstTubeID=1,
+    bool verbose=false );
+
   /**
    * Get the list of tubes that have been extracted */
   typename TubeGroupType::Pointer GetTubeGroup( void );
@@ -234,6 +283,74 @@ protected:
 
   void PrintSelf( std::ostream & os, Indent indent ) const;
 
+  /**
+   * Extract a tube using the given ridge and radius extractors.  The new
+   * tube callbacks are not called. */
+  typename TubeType::Pointer ExtractTubeUsingOps(
+    const ContinuousIndexType & x, unsigned int tubeID,
+    RidgeOpType * ridgeOp, RadiusOpType * radiusOp, bool verbose );
+
+  /**
+   * Call the new tube and status callbacks for an extracted tube */
+  void NotifyNewTube( TubeType * tube );
+
+  /**
+   * Copy the parameters of m_RidgeOp and m_RadiusOp to a thread's ops */
+  void InitializeThreadOps( RidgeOpType * ridgeOp, RadiusOpType * radiusOp );
+
+  /**
+   * Static function used as a "callback" by the MultiThreader.  Thread 0
+   * adds the tubes to the mask in seed order; the other threads extract
+   * the next seeds with the tube mask staged. */
+  static ITK_THREAD_RETURN_TYPE ExtractTubesThreaderCallback( void * arg );
+
+  /**
+   * Staged extraction from one seed */
+  struct SeedExtractionType
+    {
+    SeedExtractionType( void ) : Extracted( false ) {}
+
+    bool                                          Extracted;
+    typename TubeType::Pointer                    Tube;
+    typename RidgeOpType::TubeMaskStagingType     Staging;
+    typename RidgeOpType::IntVectorType           FailureCodeCounts;
+    }; // End struct SeedExtractionType
+
+  /**
+   * Internal structure used for passing data to the threading library */
+  struct ExtractTubesThreadStruct
+    {
+    Self                                        * Filter;
+    const SeedListType                          * Seeds;
+    const SeedRadiusListType                    * SeedRadii;
+    unsigned int                                  FirstTubeID;
+    bool                                          Verbose;
+    TubeListType                                * Tubes;
+    std::vector< SeedExtractionType >             Extractions;
+    std::vector< typename RidgeOpType::Pointer >  RidgeOps;
+    std::vector< typename RadiusOpType::Pointer > RadiusOps;
+    typename RidgeOpType::TubeMaskLocksType       TubeMaskLocks;
+
+    // Guarded by SeedLock.  Seeds before NextSeed have been handed to a
+    //   thread, and seeds before NextCommit have been added to the mask.
+    SimpleMutexLock                               SeedLock;
+    ConditionVariable::Pointer                    SeedCondition;
+    unsigned int                                  NextSeed;
+    unsigned int                                  NextCommit;
+    unsigned int                                  LookAhead;
+    bool                                          Done;
+    }; // End struct ExtractTubesThreadStruct
+
+  /**
+   * Add the tubes of the seeds to the mask in seed order, extracting
+   * the seeds not staged by the other threads */
+  void CommitExtractions( ExtractTubesThreadStruct * str );
+
+  /**
+   * Stage the extractions of the seeds handed to a worker thread */
+  void StageExtractions( ExtractTubesThreadStruct * str,
+    RidgeOpType * ridgeOp, RadiusOpType * radiusOp );
+
   typename RidgeExtractor<ImageType>::Pointer   m_RidgeOp;
   typename RadiusExtractor2<ImageType>::Pointer m_RadiusOp;
 
@@ -255,6 +372,9 @@ private:
 
   typename TubeGroupType::Pointer   m_TubeGroup;
 
+  unsigned int                      m_NumberOfThreads;
+  unsigned int                      m_SeedLookAhead;
+  unsigned int                      m_NumberOfReextractedSeeds;
 
 }; // End class TubeExtractor
 
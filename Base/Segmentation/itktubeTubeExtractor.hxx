@@ -61,6 +61,10 @@ TubeExtractor<TInputImage>
   m_TubeColor[3] = 1.0f;
 
   m_TubeGroup = TubeGroupType::New();
+
+  m_NumberOfThreads = MultiThreader::GetGlobalDefaultNumberOfThreads();
+  m_SeedLookAhead = 4;
+  m_NumberOfReextractedSeeds = 0;
 }
 
 /**
@@ -337,12 +341,32 @@ TubeExtractor<TInputImage>
     throw( "Input data must be set first in TubeExtractor" );
     }
 
+  typename TubeType::Pointer tube = this->ExtractTubeUsingOps( x, tubeID,
+    this->m_RidgeOp, this->m_RadiusOp, verbose );
+  if( tube.IsNotNull() )
+    {
+    this->NotifyNewTube( tube );
+    }
+
+  return tube;
+}
+
+/**
+ * Extract the tube using the given ridge and radius extractors */
+template< class TInputImage >
+typename TubeExtractor< TInputImage >::TubeType::Pointer
+TubeExtractor<TInputImage>
+::ExtractTubeUsingOps( const ContinuousIndexType & x, unsigned int tubeID,
+  RidgeOpType * ridgeOp, RadiusOpType * radiusOp, bool verbose )
+{
   IndexType xi;
   for( unsigned int i=0; i<ImageDimension; ++i )
     {
     xi[i] = x[i];
     }
-  if( this->m_RidgeOp->GetTubeMaskImage()->GetPixel( xi ) != 0 )
+  typename TubeMaskImageType::PixelType maskVal =
+    ridgeOp->GetTubeMaskValue( xi );
+  if( maskVal != 0 )
     {
     if( this->GetDebug() )
       {
@@ -352,7 +376,7 @@ TubeExtractor<TInputImage>
     return NULL;
     }
 
-  typename TubeType::Pointer tube = this->m_RidgeOp->ExtractRidge( x,
+  typename TubeType::Pointer tube = ridgeOp->ExtractRidge( x,
     tubeID, verbose );
 
   if( tube.IsNull() )
@@ -369,7 +393,8 @@ TubeExtractor<TInputImage>
     {
     if( this->m_AbortProcess() )
       {
-      if( this->m_StatusCallBack )
+      // Worker threads do not call the status callback
+      if( this->m_StatusCallBack && ridgeOp == this->m_RidgeOp )
         {
         this->m_StatusCallBack( "Extract: Ridge", "Aborted", 0 );
         }
@@ -377,11 +402,30 @@ TubeExtractor<TInputImage>
       }
     }
 
-  if( !this->m_RadiusOp->ExtractRadii( tube ) )
+  if( !radiusOp->ExtractRadii( tube ) )
     {
     return NULL;
     }
 
+  // Set the Spacing of the tube as the same spacing of the image
+  typename ImageType::SpacingType spacing;
+  for( unsigned int i=0; i<ImageDimension; i++ )
+    {
+    spacing[i] = this->m_InputImage->GetSpacing()[i];
+    }
+  tube->GetIndexToObjectTransform()->SetScaleComponent( spacing );
+
+  return tube;
+
+}
+
+/**
+ * Call the callbacks for a new tube */
+template< class TInputImage >
+void
+TubeExtractor<TInputImage>
+::NotifyNewTube( TubeType * tube )
+{
   if( this->m_NewTubeCallBack != NULL )
     {
     this->m_NewTubeCallBack( tube );
@@ -393,17 +437,346 @@ TubeExtractor<TInputImage>
     std::sprintf( s, "%ld points", tube->GetPoints().size() );
     this->m_StatusCallBack( "Extract: Ridge", s, 0 );
     }
+}
 
-  // Set the Spacing of the tube as the same spacing of the image
-  typename ImageType::SpacingType spacing;
-  for( unsigned int i=0; i<ImageDimension; i++ )
+/**
+ * Copy the extraction parameters to the ops used by a thread */
+template< class TInputImage >
+void
+TubeExtractor<TInputImage>
+::InitializeThreadOps( RidgeOpType * ridgeOp, RadiusOpType * radiusOp )
+{
+  ridgeOp->ShareInputImage( this->m_RidgeOp );
+  ridgeOp->SetDataMin( this->m_RidgeOp->GetDataMin() );
+  ridgeOp->SetDataMax( this->m_RidgeOp->GetDataMax() );
+  ridgeOp->SetExtractBoundMin( this->m_RidgeOp->GetExtractBoundMin() );
+  ridgeOp->SetExtractBoundMax( this->m_RidgeOp->GetExtractBoundMax() );
+  ridgeOp->SetScale( this->m_RidgeOp->GetScale() );
+  ridgeOp->SetScaleKernelExtent( this->m_RidgeOp->GetScaleKernelExtent() );
+  ridgeOp->SetDynamicScale( this->m_RidgeOp->GetDynamicScale() );
+  ridgeOp->SetDynamicStepSize( this->m_RidgeOp->GetDynamicStepSize() );
+  ridgeOp->SetStepX( this->m_RidgeOp->GetStepX() );
+  ridgeOp->SetMaxTangentChange( this->m_RidgeOp->GetMaxTangentChange() );
+  ridgeOp->SetMaxXChange( this->m_RidgeOp->GetMaxXChange() );
+  ridgeOp->SetMinRidgeness( this->m_RidgeOp->GetMinRidgeness() );
+  ridgeOp->SetMinRidgenessStart( this->m_RidgeOp->GetMinRidgenessStart() );
+  ridgeOp->SetMinRoundness( this->m_RidgeOp->GetMinRoundness() );
+  ridgeOp->SetMinRoundnessStart( this->m_RidgeOp->GetMinRoundnessStart() );
+  ridgeOp->SetMinCurvature( this->m_RidgeOp->GetMinCurvature() );
+  ridgeOp->SetMinCurvatureStart( this->m_RidgeOp->GetMinCurvatureStart() );
+  ridgeOp->SetMinLevelness( this->m_RidgeOp->GetMinLevelness() );
+  ridgeOp->SetMinLevelnessStart( this->m_RidgeOp->GetMinLevelnessStart() );
+  ridgeOp->SetMaxRecoveryAttempts(
+    this->m_RidgeOp->GetMaxRecoveryAttempts() );
+  ridgeOp->SetUseIntensityCache( this->m_RidgeOp->GetUseIntensityCache() );
+  ridgeOp->SetIntensityCacheMemoryBudget(
+    this->m_RidgeOp->GetIntensityCacheMemoryBudget() );
+  ridgeOp->SetDebug( this->m_RidgeOp->GetDebug() );
+
+  radiusOp->SetInputImage( this->m_RadiusInputImage );
+  radiusOp->SetDataMin( this->m_RadiusOp->GetDataMin() );
+  radiusOp->SetDataMax( this->m_RadiusOp->GetDataMax() );
+  radiusOp->SetRadiusStart( this->m_RadiusOp->GetRadiusStart() );
+  radiusOp->SetRadiusMin( this->m_RadiusOp->GetRadiusMin() );
+  radiusOp->SetRadiusMax( this->m_RadiusOp->GetRadiusMax() );
+  radiusOp->SetRadiusStep( this->m_RadiusOp->GetRadiusStep() );
+  radiusOp->SetRadiusTolerance( this->m_RadiusOp->GetRadiusTolerance() );
+  radiusOp->SetRadiusCorrectionScale(
+    this->m_RadiusOp->GetRadiusCorrectionScale() );
+  radiusOp->SetRadiusCorrectionFunction(
+    this->m_RadiusOp->GetRadiusCorrectionFunction() );
+  radiusOp->SetMinMedialness( this->m_RadiusOp->GetMinMedialness() );
+  radiusOp->SetMinMedialnessStart(
+    this->m_RadiusOp->GetMinMedialnessStart() );
+  radiusOp->SetNumKernelPoints( this->m_RadiusOp->GetNumKernelPoints() );
+  radiusOp->SetKernelPointStep( this->m_RadiusOp->GetKernelPointStep() );
+  radiusOp->SetKernelStep( this->m_RadiusOp->GetKernelStep() );
+  radiusOp->SetKernelExtent( this->m_RadiusOp->GetKernelExtent() );
+  radiusOp->SetDebug( this->m_RadiusOp->GetDebug() );
+
+  ridgeOp->SetRadiusExtractor( radiusOp );
+}
+
+/**
+ * Extract the tubes from a list of seeds using multiple threads */
+template< class TInputImage >
+typename TubeExtractor< TInputImage >::TubeListType
+TubeExtractor<TInputImage>
+::ExtractTubes( const SeedListType & seeds,
+  const SeedRadiusListType & seedRadii, unsigned int firstTubeID,
+  bool verbose )
+{
+  if( this->m_RidgeOp.IsNull() )
     {
-    spacing[i] = this->m_InputImage->GetSpacing()[i];
+    throw( "Input data must be set first in TubeExtractor" );
+    }
+  if( seeds.size() != seedRadii.size() )
+    {
+    throw( "Number of seeds and seed radii differ in TubeExtractor" );
     }
-  tube->GetIndexToObjectTransform()->SetScaleComponent( spacing );
 
-  return tube;
+  TubeListType tubes( seeds.size() );
+  this->m_NumberOfReextractedSeeds = 0;
+  if( seeds.empty() )
+    {
+    return tubes;
+    }
+
+  unsigned int numberOfThreads = this->m_NumberOfThreads;
+  if( numberOfThreads > seeds.size() )
+    {
+    numberOfThreads = seeds.size();
+    }
+  if( numberOfThreads < 1 )
+    {
+    numberOfThreads = 1;
+    }
 
+  MultiThreader::Pointer threader = MultiThreader::New();
+  threader->SetNumberOfThreads( numberOfThreads );
+  numberOfThreads = threader->GetNumberOfThreads();
+
+  ExtractTubesThreadStruct str;
+  str.Filter = this;
+  str.Seeds = &seeds;
+  str.SeedRadii = &seedRadii;
+  str.FirstTubeID = firstTubeID;
+  str.Verbose = verbose;
+  str.Tubes = &tubes;
+  str.Extractions.resize( seeds.size() );
+  str.SeedCondition = ConditionVariable::New();
+  str.NextSeed = 0;
+  str.NextCommit = 0;
+  str.LookAhead = this->m_SeedLookAhead * numberOfThreads;
+  if( str.LookAhead < 1 )
+    {
+    str.LookAhead = 1;
+    }
+  str.Done = false;
+
+  // Thread 0 uses m_RidgeOp and m_RadiusOp.  Each other thread has its
+  //   own ops, so an intensity cache is never shared between threads;
+  //   the threads split the cache memory budget.
+  str.RidgeOps.resize( numberOfThreads );
+  str.RadiusOps.resize( numberOfThreads );
+  for( unsigned int t=1; t<numberOfThreads; ++t )
+    {
+    str.RidgeOps[t] = RidgeOpType::New();
+    str.RadiusOps[t] = RadiusOpType::New();
+    this->InitializeThreadOps( str.RidgeOps[t], str.RadiusOps[t] );
+    str.RidgeOps[t]->SetIntensityCacheMemoryBudget(
+      this->m_RidgeOp->GetIntensityCacheMemoryBudget() / numberOfThreads );
+    str.RidgeOps[t]->SetTubeMaskLocks( &( str.TubeMaskLocks ) );
+    }
+  if( numberOfThreads > 1 )
+    {
+    this->m_RidgeOp->SetTubeMaskLocks( &( str.TubeMaskLocks ) );
+    }
+
+  double scaleOriginal = this->m_RidgeOp->GetScale();
+  double radiusOriginal = this->m_RadiusOp->GetRadiusStart();
+
+  threader->SetSingleMethod( this->ExtractTubesThreaderCallback, &str );
+  threader->SingleMethodExecute();
+
+  this->m_RidgeOp->SetTubeMaskLocks( NULL );
+  this->m_RidgeOp->SetScale( scaleOriginal );
+  this->m_RadiusOp->SetRadiusStart( radiusOriginal );
+
+  if( verbose && numberOfThreads > 1 )
+    {
+    std::cout << "Extracted again " << this->m_NumberOfReextractedSeeds
+      << " of " << seeds.size() << " seeds." << std::endl;
+    }
+
+  return tubes;
+}
+
+/**
+ * Run the committing thread or a staging thread */
+template< class TInputImage >
+ITK_THREAD_RETURN_TYPE
+TubeExtractor<TInputImage>
+::ExtractTubesThreaderCallback( void * arg )
+{
+  int threadId = ((MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+
+  ExtractTubesThreadStruct * str = (ExtractTubesThreadStruct *)
+    (((MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+
+  // Thread 0 runs on the calling thread, so the callbacks called while
+  //   committing are called from the calling thread
+  if( threadId == 0 )
+    {
+    str->Filter->CommitExtractions( str );
+    }
+  else
+    {
+    str->Filter->StageExtractions( str, str->RidgeOps[ threadId ],
+      str->RadiusOps[ threadId ] );
+    }
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+/**
+ * Add the tubes to the mask in seed order */
+template< class TInputImage >
+void
+TubeExtractor<TInputImage>
+::CommitExtractions( ExtractTubesThreadStruct * str )
+{
+  const SeedListType & seeds = *( str->Seeds );
+  const SeedRadiusListType & seedRadii = *( str->SeedRadii );
+
+  for( unsigned int seedNum=0; seedNum<seeds.size(); ++seedNum )
+    {
+    if( this->m_AbortProcess != NULL && this->m_AbortProcess() )
+      {
+      break;
+      }
+
+    SeedExtractionType & extraction = str->Extractions[ seedNum ];
+
+    // Extract the seed here if no other thread has taken it, otherwise
+    //   wait for its staged extraction
+    bool staged = false;
+    str->SeedLock.Lock();
+    if( str->NextSeed == seedNum )
+      {
+      ++( str->NextSeed );
+      }
+    else
+      {
+      while( !extraction.Extracted )
+        {
+        str->SeedCondition->Wait( &( str->SeedLock ) );
+        }
+      staged = true;
+      }
+    str->SeedLock.Unlock();
+
+    if( str->Verbose )
+      {
+      std::cout << "Extracting from index point " << seeds[ seedNum ]
+        << " at radius " << seedRadii[ seedNum ] << std::endl;
+      }
+
+    typename TubeType::Pointer tube;
+    if( staged
+      && this->m_RidgeOp->IsTubeMaskStagingCurrent( extraction.Staging ) )
+      {
+      this->m_RidgeOp->CommitTubeMaskStaging( extraction.Staging );
+      this->m_RidgeOp->AddFailureCodeCounts(
+        extraction.FailureCodeCounts );
+      tube = extraction.Tube;
+      }
+    else
+      {
+      if( staged )
+        {
+        ++( this->m_NumberOfReextractedSeeds );
+        }
+      this->m_RidgeOp->SetScale( seedRadii[ seedNum ] );
+      this->m_RadiusOp->SetRadiusStart( seedRadii[ seedNum ] );
+      tube = this->ExtractTubeUsingOps( seeds[ seedNum ],
+        str->FirstTubeID + seedNum, this->m_RidgeOp, this->m_RadiusOp,
+        false );
+      }
+
+    if( tube.IsNotNull() )
+      {
+      this->NotifyNewTube( tube );
+      if( this->AddTube( tube ) )
+        {
+        ( *( str->Tubes ) )[ seedNum ] = tube;
+        }
+      }
+
+    if( str->Verbose )
+      {
+      if( tube.IsNotNull() )
+        {
+        std::cout << "  Extracted " << tube->GetPoints().size()
+          << " points." << std::endl;
+        }
+      else
+        {
+        std::cout << "  Ridge not found." << std::endl;
+        }
+      }
+
+    extraction = SeedExtractionType();
+
+    str->SeedLock.Lock();
+    str->NextCommit = seedNum + 1;
+    str->SeedCondition->Broadcast();
+    str->SeedLock.Unlock();
+    }
+
+  // Release the staging threads, also when aborted
+  str->SeedLock.Lock();
+  str->Done = true;
+  str->SeedCondition->Broadcast();
+  str->SeedLock.Unlock();
+}
+
+/**
+ * Stage the extractions of the seeds handed to a staging thread */
+template< class TInputImage >
+void
+TubeExtractor<TInputImage>
+::StageExtractions( ExtractTubesThreadStruct * str, RidgeOpType * ridgeOp,
+  RadiusOpType * radiusOp )
+{
+  const SeedListType & seeds = *( str->Seeds );
+  const SeedRadiusListType & seedRadii = *( str->SeedRadii );
+
+  while( true )
+    {
+    // Take the next seed within the look-ahead of the committed seeds
+    unsigned int seedNum = 0;
+    bool found = false;
+    str->SeedLock.Lock();
+    while( !str->Done && str->NextSeed < seeds.size() )
+      {
+      if( str->NextSeed < str->NextCommit + str->LookAhead )
+        {
+        seedNum = str->NextSeed;
+        ++( str->NextSeed );
+        found = true;
+        break;
+        }
+      str->SeedCondition->Wait( &( str->SeedLock ) );
+      }
+    str->SeedLock.Unlock();
+    if( !found )
+      {
+      break;
+      }
+
+    // Only this thread accesses the extraction until it is marked as
+    //   extracted
+    SeedExtractionType & extraction = str->Extractions[ seedNum ];
+
+    ridgeOp->SetScale( seedRadii[ seedNum ] );
+    radiusOp->SetRadiusStart( seedRadii[ seedNum ] );
+    ridgeOp->ResetFailureCodeCounts();
+
+    // Traversal messages are not printed: they would interleave with
+    //   those of the other threads
+    ridgeOp->SetTubeMaskStaging( &( extraction.Staging ) );
+    extraction.Tube = this->ExtractTubeUsingOps( seeds[ seedNum ],
+      str->FirstTubeID + seedNum, ridgeOp, radiusOp, false );
+    ridgeOp->SetTubeMaskStaging( NULL );
+
+    extraction.FailureCodeCounts = ridgeOp->GetFailureCodeCounts();
+
+    str->SeedLock.Lock();
+    extraction.Extracted = true;
+    str->SeedCondition->Broadcast();
+    str->SeedLock.Unlock();
+    }
 }
 
 /**
@@ -600,6 +973,12 @@ void TubeExtractor<TInputImage>
   os << indent << "TubeColor.g = " << this->m_TubeColor[1] << std::endl;
   os << indent << "TubeColor.b = " << this->m_TubeColor[2] << std::endl;
   os << indent << "TubeColor.a = " << this->m_TubeColor[3] << std::endl;
+  os << indent << "NumberOfThreads = " << this->m_NumberOfThreads
+    << std::endl;
+  os << indent << "SeedLookAhead = " << this->m_SeedLookAhead
+    << std::endl;
+  os << indent << "NumberOfReextractedSeeds = "
+    << this->m_NumberOfReextractedSeeds << std::endl;
 }
 
 } // End namespace tube